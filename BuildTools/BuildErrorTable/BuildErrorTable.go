@@ -209,63 +209,35 @@ func main() {
     output.WriteString(`
 struct _LIBCPP_HIDDEN ErrorInfo
 {
-    FORCE_INLINE
-    ErrorInfo(ViolationSeverity __v, EPUBSpec __s, std::string __sect, std::string __msg) _NOEXCEPT : _severity(__v), _spec(__s), _section(__sect), _message(__msg) {}
-    FORCE_INLINE
-    ErrorInfo(const ErrorInfo& __o) : _severity(__o._severity), _spec(__o._spec), _section(__o._section), _message(__o._message) {}
-    FORCE_INLINE
-    ErrorInfo(ErrorInfo&& __o) : _severity(__o._severity), _spec(__o._spec), _section(std::move(__o._section)), _message(std::move(__o._message)) {}
-    FORCE_INLINE
-    ~ErrorInfo() {}
-    
-    ErrorInfo&          operator=(const ErrorInfo& __o)
-    {
-        _severity = __o._severity;
-        _spec = __o._spec;
-        _section = __o._section;
-        _message = __o._message;
-        return *this;
-    }
-    ErrorInfo&          operator=(ErrorInfo&& __o)
-    {
-        _severity = __o._severity;
-        _spec = __o._spec;
-        _section = std::move(__o._section);
-        _message = std::move(__o._message);
-        return *this;
-    }
-
-private:
-    ErrorInfo()                             _DELETED_;
+    EPUBError           _error;
+    ViolationSeverity   _severity;
+    EPUBSpec            _spec;
+    const char*         _section;
+    const char*         _message;
 
-public:
+    FORCE_INLINE
+    EPUBError           Error() const       _NOEXCEPT   { return _error; }
     FORCE_INLINE
     ViolationSeverity   Severity() const    _NOEXCEPT   { return _severity; }
     FORCE_INLINE
     EPUBSpec            Spec() const        _NOEXCEPT   { return _spec; }
     FORCE_INLINE
-    const std::string&  Section() const     _NOEXCEPT   { return _section; }
+    const char*         Section() const     _NOEXCEPT   { return _section; }
     FORCE_INLINE
-    const std::string&  Message() const     _NOEXCEPT   { return _message; }
-
-private:
-    ViolationSeverity   _severity;
-    EPUBSpec            _spec;
-    std::string         _section;
-    std::string         _message;
+    const char*         Message() const     _NOEXCEPT   { return _message; }
 
 };
 
-typedef std::map<EPUBError, ErrorInfo>                                     ErrorLookup;
-
 `)
 
-	output.WriteString("#if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)\n\n")
-	output.WriteString("static const ErrorLookup gErrorLookupTable = {\n")
+	// the lookup functions binary-search the table, so it must stay in the order
+	//  the errors are declared (which is ascending order of their values)
+	output.WriteString("// sorted by error code, in the order the errors are declared\n")
+	output.WriteString("static CONSTEXPR const ErrorInfo gErrorLookupTable[] = {\n")
 	output.Flush()
 
 	for i, info := range infoList {
-		if _, err := fmt.Fprintf(output, "    {EPUBError::%s, {%s, %s, \"%s\", \"%s\"}}", info.name, info.severity, info.spec, info.section, info.message); err != nil {
+		if _, err := fmt.Fprintf(output, "    {EPUBError::%s, %s, %s, \"%s\", \"%s\"}", info.name, info.severity, info.spec, info.section, info.message); err != nil {
 			panic(err)
 		}
 		if i == len(infoList)-1 {
@@ -279,19 +251,5 @@ typedef std::map<EPUBError, ErrorInfo>                                     Error
 	}
 
 	output.WriteString("};\n")
-	output.WriteString("\n#else   // !EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)\n\n")
-	output.WriteString("static ErrorLookup gErrorLookupTable;\n\n")
-	output.WriteString("INITIALIZER(__initErrorTables)\n{\n")
-	output.Flush()
-
-	for _, info := range infoList {
-		if _, err := fmt.Fprintf(output, "    gErrorLookupTable[%s] = ErrorInfo(EPUBError::%s, %s, \"%s\", \"%s\");\n", info.name, info.severity, info.spec, info.section, info.message); err != nil {
-			panic(err)
-		}
-		output.Flush()
-	}
-
-	output.WriteString("}\n")
-	output.WriteString("\n#endif  // !EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)\n")
 	output.Flush()
 }
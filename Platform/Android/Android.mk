@@ -236,11 +236,16 @@ LOCAL_SRC_FILES := \
 		ePub3/ePub/spine.cpp \
 		ePub3/ePub/manifest.cpp \
 		ePub3/ePub/cfi.cpp \
+		ePub3/ePub/packed_cfi.cpp \
+		ePub3/ePub/cfi_resolver.cpp \
 		ePub3/ePub/nav_point.cpp \
 		ePub3/ePub/nav_table.cpp \
 		ePub3/ePub/glossary.cpp \
 		ePub3/ePub/library.cpp \
+		ePub3/ePub/library_catalog.cpp \
 		ePub3/ePub/font_obfuscation.cpp \
+		ePub3/ePub/filter.cpp \
+		ePub3/ePub/decryption.cpp \
 		ePub3/ePub/encryption.cpp \
 		ePub3/ePub/signatures.cpp \
 		ePub3/utilities/iri.cpp \
@@ -270,6 +275,10 @@ LOCAL_SRC_FILES := \
 		ePub3/ePub/media_support_info.cpp \
 		ePub3/utilities/byte_stream.cpp \
 		ePub3/utilities/ring_buffer.cpp \
+		ePub3/utilities/task_queue.cpp \
+		ePub3/utilities/executor.cpp \
+		ePub3/utilities/shared_string.cpp \
+		ePub3/utilities/utf_transcode.cpp \
 		ePub3/utilities/ref_counted.cpp \
 		ePub3/utilities/run_loop_android.cpp \
 		ePub3/utilities/epub_locale.cpp \
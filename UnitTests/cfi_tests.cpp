@@ -20,8 +20,18 @@
 //
 
 #include "../ePub3/ePub/cfi.h"
+#include "../ePub3/ePub/cfi_resolver.h"
+#include "../ePub3/ePub/packed_cfi.h"
+#include "../ePub3/ePub/cfi_interval_index.h"
 #include "../ePub3/utilities/error_handler.h"
 #include "catch.hpp"
+#include <libxml/parser.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
 
 using namespace ePub3;
 
@@ -110,3 +120,315 @@ TEST_CASE("Location and Range CFIs should be reassignable by CFI or string, even
     REQUIRE_NOTHROW(base = "/6/4!/4/3:5");
     REQUIRE_FALSE(base.IsRangeTriplet());
 }
+
+TEST_CASE("CFI components should round-trip through the parser", "")
+{
+    REQUIRE(CFI("/6/4[chap01]!/4[body01]/10[para05]/3:10").String() == "epubcfi(/6/4[chap01]!/4[body01]/10[para05]/3:10)");
+    REQUIRE(CFI("epubcfi(/6/14[xchap_05]!/4/2~87.24)").String() == "epubcfi(/6/14[xchap_05]!/4/2~87.24)");
+    REQUIRE(CFI("epubcfi(/6/14!/4/2@50:25.5)").String() == "epubcfi(/6/14!/4/2@50:25.5)");
+    REQUIRE(CFI("epubcfi(/6/14!/4/2~23.5@27.53:34)").String() == "epubcfi(/6/14!/4/2~23.5@27.53:34)");
+    REQUIRE(CFI("/6/4!/2/1:3[yyy;s=a]").CharacterSideBias() == CFI::SideBias::After);
+    REQUIRE(CFI("/6/4!/2/1:3[yyy]").String() == "epubcfi(/6/4!/2/1:3[yyy])");
+    
+    // qualifiers may contain path and range delimiters
+    CFI delimited("/6/4[a,b/c]!/4/2,/1:3,/1:5");
+    REQUIRE(delimited.IsRangeTriplet());
+    REQUIRE(delimited.String() == "epubcfi(/6/4[a,b/c]!/4/2,/1:3,/1:5)");
+    
+    // offsets which can't be read are reported rather than ignored
+    REQUIRE_THROWS_AS(CFI("/6/4!/2/1:"), epub_spec_error);
+    REQUIRE_THROWS_AS(CFI("/6/4!/2/1~"), epub_spec_error);
+    REQUIRE_THROWS_AS(CFI("/6/4!/2/1@25"), epub_spec_error);
+    REQUIRE_THROWS_AS(CFI("/6/4[chap01!/2"), epub_spec_error);
+    REQUIRE_THROWS_AS(CFI("/6/99999999999"), epub_spec_error);
+}
+
+static const char gResolverDocument[] =
+    "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>Test</title></head>"
+    "<body id=\"body01\"><p>first para</p><p id=\"para02\">Hello <b>bold</b> world</p>"
+    "<p id=\"para03\">a\xF0\x9F\x98\x80" "b</p><p/></body></html>";
+
+TEST_CASE("CFIs should resolve to nodes and offsets within a document", "")
+{
+    xmlDocPtr doc = xmlReadMemory(gResolverDocument, int(sizeof(gResolverDocument)-1), "test.xhtml", "utf-8", 0);
+    REQUIRE(doc != nullptr);
+    
+    {
+        CFIResolver resolver(doc);
+        
+        auto result = resolver.Resolve(CFI("/4[body01]/4[para02]/1:3"));
+        REQUIRE(result.Succeeded());
+        REQUIRE(result.start.node->type == XML_TEXT_NODE);
+        REQUIRE(std::strcmp(reinterpret_cast<const char*>(result.start.node->content), "Hello ") == 0);
+        REQUIRE(result.start.characterOffset == 3);
+        
+        // package-based CFIs start within the document after the spine indirection
+        result = resolver.Resolve(CFI("epubcfi(/6/4[chap01]!/4/4/3:2)"));
+        REQUIRE(result.Succeeded());
+        REQUIRE(std::strcmp(reinterpret_cast<const char*>(result.start.node->content), " world") == 0);
+        REQUIRE(result.start.byteOffset == 2);
+        
+        result = resolver.Resolve(CFI("/4/4/2"));
+        REQUIRE(xmlStrEqual(result.start.node->name, BAD_CAST "b"));
+        REQUIRE_FALSE(result.start.hasOffset);
+        
+        // a stale step is corrected using its id assertion
+        result = resolver.Resolve(CFI("/4/2[para02]/1:0"));
+        REQUIRE(result.start.node->parent == resolver.ElementWithID("para02"));
+        
+        // offsets are counted in UTF-16 units
+        result = resolver.Resolve(CFI("/4/6/1:3"));
+        REQUIRE(result.start.characterOffset == 3);
+        REQUIRE(result.start.byteOffset == 5);
+        
+        // an empty run of text resolves to its parent
+        result = resolver.Resolve(CFI("/4/8/1"));
+        REQUIRE(result.Succeeded());
+        REQUIRE(xmlStrEqual(result.start.node->name, BAD_CAST "p"));
+        
+        result = resolver.Resolve(CFI("/4/4,/1:0,/3:6"));
+        REQUIRE(result.isRange);
+        REQUIRE(result.start.node == result.end.node->prev->prev);
+        REQUIRE(result.end.characterOffset == 6);
+        
+        REQUIRE_THROWS_AS(resolver.Resolve(CFI("/4/10")), epub_spec_error);
+    }
+    
+    xmlFreeDoc(doc);
+}
+
+TEST_CASE("CFI batches should resolve with per-item errors", "")
+{
+    xmlDocPtr doc = xmlReadMemory(gResolverDocument, int(sizeof(gResolverDocument)-1), "test.xhtml", "utf-8", 0);
+    REQUIRE(doc != nullptr);
+    
+    {
+        CFIResolver resolver(doc);
+        CFIResolver::CFIList cfis;
+        cfis.emplace_back("/4/4/1:1");
+        cfis.emplace_back("/4/10");
+        cfis.emplace_back("/4/4/1:50");
+        cfis.emplace_back("/4/4/1/2");
+        cfis.emplace_back("/4/2/1:10");
+        
+        auto results = resolver.ResolveAll(cfis);
+        REQUIRE(results.size() == cfis.size());
+        REQUIRE(results[0].Succeeded());
+        REQUIRE(results[1].error == EPUBError::CFIStepOutOfBounds);
+        REQUIRE(results[2].error == EPUBError::CFICharOffsetOutOfBounds);
+        REQUIRE(results[3].error == EPUBError::CFIUnexpectedComponent);
+        REQUIRE(results[4].Succeeded());
+        REQUIRE(results[4].start.characterOffset == 10);
+    }
+    
+    xmlFreeDoc(doc);
+}
+
+TEST_CASE("CFIs should be generated for document locations in bulk", "")
+{
+    xmlDocPtr doc = xmlReadMemory(gResolverDocument, int(sizeof(gResolverDocument)-1), "test.xhtml", "utf-8", 0);
+    REQUIRE(doc != nullptr);
+    
+    {
+        CFIResolver resolver(doc);
+        xmlNodePtr para = resolver.ElementWithID("para02");
+        REQUIRE(para != nullptr);
+        
+        CFIResolver::Location loc;
+        loc.node = para->children->next;        // <b>
+        REQUIRE(resolver.CFIForLocation(loc).String() == "epubcfi(/4[body01]/4[para02]/2)");
+        
+        loc.node = para->last;                  // " world"
+        loc.hasOffset = true;
+        loc.characterOffset = 2;
+        REQUIRE(resolver.CFIForLocation(loc, CFI("/6/4[chap01]!")).String() == "epubcfi(/6/4[chap01]!/4[body01]/4[para02]/3:2)");
+        
+        // every text location should survive a round trip
+        CFIResolver::LocationList locations;
+        for ( xmlNodePtr p = resolver.ElementWithID("body01")->children; p != nullptr; p = p->next )
+        {
+            for ( xmlNodePtr text = p->children; text != nullptr; text = text->next )
+            {
+                if ( text->type != XML_TEXT_NODE )
+                    continue;
+                loc.node = text;
+                loc.characterOffset = 1;
+                locations.push_back(loc);
+            }
+        }
+        REQUIRE(locations.size() == 4);
+        
+        CFIResolver::ErrorList errors;
+        auto cfis = resolver.CFIsForLocations(locations, CFI("/6/4!"), &errors);
+        auto results = resolver.ResolveAll(cfis);
+        for ( size_t i = 0; i < locations.size(); i++ )
+        {
+            REQUIRE(errors[i] == EPUBError::NoError);
+            REQUIRE(results[i].start.node == locations[i].node);
+            REQUIRE(results[i].start.characterOffset == 1);
+        }
+        
+        // locations which can't be represented yield empty CFIs
+        locations.clear();
+        loc.node = para;
+        locations.push_back(loc);               // character offset on a paragraph
+        loc.node = nullptr;
+        locations.push_back(loc);
+        cfis = resolver.CFIsForLocations(locations, CFI(), &errors);
+        REQUIRE(cfis[0].Empty());
+        REQUIRE(errors[0] == EPUBError::CFICharOffsetOnIllegalElement);
+        REQUIRE(cfis[1].Empty());
+        REQUIRE(errors[1] != EPUBError::NoError);
+    }
+    
+    xmlFreeDoc(doc);
+}
+
+TEST_CASE("Packed CFIs should round-trip and sort in document order", "")
+{
+    // in document order
+    static const char* const kOrdered[] = {
+        "/6/4!",
+        "/6/4!/4",
+        "/6/4!/4/2/1:0",
+        "/6/4!/4/2/1:7",
+        "/6/4!/4/2/1:7[;s=b]",
+        "/6/4!/4/2/1:7[;s=a]",
+        "/6/4!/4/2/1:300",
+        "/6/4!/4/2/3:2",
+        "/6/4!/4/2/4",
+        "/6/4!/4/500/2",
+        "/6/4!/4/70000/2",
+        "/6/4!/6~2.5",
+        "/6/4!/6~12.25",
+        "/6/6!/2",
+        "/6/10000000!",
+    };
+    static const size_t kCount = sizeof(kOrdered)/sizeof(kOrdered[0]);
+    
+    std::vector<PackedCFI> packed;
+    for ( size_t i = 0; i < kCount; i++ )
+    {
+        packed.emplace_back(CFI(kOrdered[i]));
+        REQUIRE(PackedCFI(packed.back().ToCFI()) == packed.back());
+    }
+    
+    for ( size_t i = 1; i < kCount; i++ )
+    {
+        REQUIRE(packed[i-1] < packed[i]);
+        REQUIRE(std::memcmp(packed[i-1].Data(), packed[i].Data(), std::min(packed[i-1].Size(), packed[i].Size())) <= 0);
+    }
+    
+    std::vector<PackedCFI> shuffled(packed.rbegin(), packed.rend());
+    shuffled.push_back(packed[3]);
+    std::sort(shuffled.begin(), shuffled.end());
+    shuffled.erase(std::unique(shuffled.begin(), shuffled.end()), shuffled.end());
+    REQUIRE(shuffled == packed);
+    
+    // qualifiers are dropped; ranges encode either end
+    CFI range("/6/4[chap01]!/4[body01]/10,/2/1:3,/3:4");
+    REQUIRE(PackedCFI(range).ToCFI() == CFI("/6/4!/4/10/2/1:3"));
+    REQUIRE(PackedCFI(range, PackedCFI::Endpoint::End).ToCFI() == CFI("/6/4!/4/10/3:4"));
+    REQUIRE(PackedCFI(CFI("/6/4!/4/2@25:75.5")).ToCFI() == CFI("/6/4!/4/2@25:75.5"));
+    
+    // encoding into a caller's buffer reports the space required
+    uint8_t buf[4];
+    size_t needed = PackedCFI::Encode(CFI("/6/4!/4/2/1:7"), PackedCFI::Endpoint::Start, buf, sizeof(buf));
+    REQUIRE(needed == packed[3].Size());
+    REQUIRE(std::memcmp(buf, packed[3].Data(), sizeof(buf)) == 0);
+    
+    CFI decoded;
+    REQUIRE(PackedCFI::Decode(packed[3].Data(), 2, decoded));
+    static const uint8_t kBad[] = { 0x01, 0x05 };
+    REQUIRE_FALSE(PackedCFI::Decode(kBad, sizeof(kBad), decoded));
+    
+    REQUIRE_THROWS_AS(PackedCFI(CFI("/6/4:5/2")), CFI::InvalidCFI);
+}
+
+TEST_CASE("CFI interval indices should find overlapping intervals", "")
+{
+    CFIIntervalIndex<int> index;
+    index.Insert(CFI("/6/4!/4/2,/1:0,/1:10"), 1);
+    index.Insert(CFI("/6/4!/4/2,/1:5,/3:2"), 2);
+    index.Insert(CFI("/6/4!/4/6/1:3"), 3);
+    index.Insert(CFI("/6/6!/4/2,/1:0,/1:4"), 4);
+    index.Insert(CFI("/6/4!/4,/2/1:8,/8/1:0"), 5);
+    REQUIRE(index.Size() == 5);
+    
+    REQUIRE(index.Containing(CFI("/6/4!/4/2/1:7")) == (std::vector<int>{1, 2}));
+    REQUIRE(index.Containing(CFI("/6/4!/4/2/1:10")) == (std::vector<int>{1, 2, 5}));
+    REQUIRE(index.Containing(CFI("/6/4!/4/2/1:11")) == (std::vector<int>{2, 5}));
+    REQUIRE(index.Overlapping(CFI("/6/4!/4/4,/1:0,/1:1")) == (std::vector<int>{5}));
+    REQUIRE(index.Overlapping(CFI("/6/4!/4,/6/1:0,/10/1:0")) == (std::vector<int>{5, 3}));
+    REQUIRE(index.Within(CFI("/6/4!")) == (std::vector<int>{1, 2, 5, 3}));
+    REQUIRE(index.Within(CFI("/6/6!")) == (std::vector<int>{4}));
+    REQUIRE(index.Within(CFI("/6/8!")).empty());
+    
+    REQUIRE(index.Remove(CFI("/6/4!/4/2,/1:5,/3:2"), 2));
+    REQUIRE_FALSE(index.Remove(CFI("/6/4!/4/2,/1:5,/3:2"), 2));
+    REQUIRE(index.Containing(CFI("/6/4!/4/2/1:9")) == (std::vector<int>{1, 5}));
+    REQUIRE(index.Size() == 4);
+    
+    // compare against a brute-force scan
+    srand(42);
+    CFIIntervalIndex<int> big;
+    std::vector<std::pair<PackedCFI, PackedCFI>> intervals;
+    for ( int i = 0; i < 2000; i++ )
+    {
+        std::stringstream ss;
+        ss << "/6/" << 2*(1 + rand()%10) << "!/4/" << 2*(1 + rand()%20) << ",/1:" << rand()%50 << ",/" << 3 + 2*(rand()%4) << ":" << rand()%50;
+        CFI cfi(ss.str());
+        intervals.emplace_back(PackedCFI(cfi, PackedCFI::Endpoint::Start), PackedCFI(cfi, PackedCFI::Endpoint::End));
+        big.Insert(cfi, i);
+    }
+    for ( int i = 0; i < 2000; i += 3 )
+    {
+        REQUIRE(big.Remove(intervals[i].first, intervals[i].second, i));
+    }
+    
+    for ( int q = 0; q < 50; q++ )
+    {
+        std::stringstream ss;
+        ss << "/6/" << 2*(1 + rand()%10) << "!/4/" << 2*(1 + rand()%20) << "/1:" << rand()%50;
+        CFI query(ss.str());
+        PackedCFI point(query);
+        
+        std::vector<int> expected;
+        for ( int i = 0; i < 2000; i++ )
+        {
+            if ( (i % 3) != 0 && intervals[i].first <= point && point <= intervals[i].second )
+                expected.push_back(i);
+        }
+        
+        std::vector<int> found = big.Containing(query);
+        std::sort(found.begin(), found.end());
+        REQUIRE(found == expected);
+    }
+}
+
+TEST_CASE("CFI parsing throughput", "[cfi][benchmark][hide]")
+{
+    static const char* const kCFIs[] = {
+        "epubcfi(/6/4[chap01ref]!/4[body01]/10[para05]/3:10)",
+        "epubcfi(/6/14[xchap_05]!/4/2~23.5@27.53:34)",
+        "epubcfi(/6/4[chap01ref]!/4[body01]/10[para05],/2/1:1,/3:4)",
+        "/6/8!/4/2/12/1:152[;s=b]",
+    };
+    static const size_t kCount = sizeof(kCFIs)/sizeof(kCFIs[0]);
+    static const size_t kIterations = 250000;
+    
+    std::vector<string> strings(kCFIs, kCFIs + kCount);
+    size_t components = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+    {
+        CFI cfi(strings[i % kCount]);
+        components += cfi.Empty() ? 0 : 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    
+    REQUIRE(components == kIterations);
+    WARN("Parsed " << kIterations << " CFIs in " << (elapsed.count() / 1000) << "ms ("
+         << (elapsed.count() == 0 ? 0 : (kIterations * 1000000) / elapsed.count()) << " per second)");
+}
@@ -20,7 +20,14 @@
 //
 
 #include "../ePub3/ePub/container.h"
+#include "../ePub3/utilities/run_loop.h"
+#include "../ePub3/utilities/byte_stream.h"
+#include "../ePub3/ePub/archive.h"
 #include "catch.hpp"
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace ePub3;
 
@@ -49,3 +56,159 @@ TEST_CASE("", "Version should be 1.0")
     ContainerPtr container = Container::OpenContainer(EPUB_PATH);
     REQUIRE(container->Version() == "1.0");
 }
+
+TEST_CASE("Streams should remain readable after their container is destroyed", "")
+{
+    ContainerPtr container = Container::OpenContainer(EPUB_PATH);
+    REQUIRE(container != nullptr);
+    
+    unique_ptr<ByteStream> stream = container->ReadStreamAtPath("META-INF/container.xml");
+    unique_ptr<ArchiveReader> reader = container->GetArchive()->ReaderAtPath("META-INF/container.xml");
+    REQUIRE(stream != nullptr);
+    REQUIRE(reader != nullptr);
+    
+    // the archive goes with its container, but its lock and zip handle live on
+    std::weak_ptr<Archive> archive = container->GetArchive();
+    container.reset();
+    REQUIRE(archive.expired());
+    
+    char streamBuf[5] = {0}, readerBuf[5] = {0};
+    REQUIRE(stream->ReadBytes(streamBuf, 4) == 4);
+    REQUIRE(reader->read(readerBuf, 4) == 4);
+    REQUIRE(std::string(streamBuf) == std::string(readerBuf));
+}
+
+// runs the current thread's loop until a final stage is reported
+static void RunUntilOpened(const std::vector<Container::OpenStage>& stages)
+{
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    for ( int i = 0; i < 100; i++ )
+    {
+        if ( !stages.empty() && stages.back() >= Container::OpenStage::NavigationReady )
+            break;
+        rl->Run(true, std::chrono::milliseconds(100));
+    }
+}
+
+TEST_CASE("Asynchronous opens should report each stage in order on the run loop", "")
+{
+    typedef Container::OpenStage Stage;
+    std::vector<Stage> stages;
+    std::thread::id loopThread = std::this_thread::get_id();
+    bool wrongThread = false, navigationEarly = false, spineMissing = false;
+    ContainerPtr opened;
+    
+    Container::OpenContainerAsync(EPUB_PATH, RunLoop::CurrentRunLoop(), [&](Stage stage, ContainerPtr container, std::exception_ptr error) {
+        stages.push_back(stage);
+        if ( std::this_thread::get_id() != loopThread )
+            wrongThread = true;
+        if ( stage == Stage::SpineReady )
+        {
+            // the first spine item can be displayed before navigation is parsed
+            if ( container->DefaultPackage()->FirstSpineItem() == nullptr )
+                spineMissing = true;
+            if ( container->DefaultPackage()->TableOfContents() != nullptr )
+                navigationEarly = true;
+        }
+        opened = container;
+    });
+    RunUntilOpened(stages);
+    
+    REQUIRE(stages == (std::vector<Stage>{Stage::ArchiveIndexed, Stage::PackagesParsed, Stage::SpineReady, Stage::NavigationReady}));
+    REQUIRE_FALSE(wrongThread);
+    REQUIRE_FALSE(spineMissing);
+    REQUIRE_FALSE(navigationEarly);
+    REQUIRE(opened != nullptr);
+    REQUIRE(opened->DefaultPackage()->TableOfContents() != nullptr);
+}
+
+TEST_CASE("Packages should stay read-only while their navigation loads", "")
+{
+    typedef Container::OpenStage Stage;
+    auto refused = std::make_shared<std::promise<bool>>();
+    auto finished = std::make_shared<std::promise<Stage>>();
+    
+    // with no run loop, SpineReady is reported before the navigation documents are collected
+    Container::OpenContainerAsync(EPUB_PATH, nullptr, [refused, finished](Stage stage, ContainerPtr container, std::exception_ptr error) {
+        if ( stage == Stage::SpineReady )
+        {
+            try
+            {
+                container->DefaultPackage()->Open("EPUB/package.opf");
+                refused->set_value(false);
+            }
+            catch (const std::logic_error&)
+            {
+                refused->set_value(true);
+            }
+        }
+        else if ( stage >= Stage::NavigationReady )
+        {
+            finished->set_value(stage);
+        }
+    });
+    
+    REQUIRE(refused->get_future().get());
+    REQUIRE(finished->get_future().get() == Stage::NavigationReady);
+}
+
+TEST_CASE("Cancelled asynchronous opens should report only their cancellation", "")
+{
+    typedef Container::OpenStage Stage;
+    std::vector<Stage> stages;
+    
+    Container::AsyncOpenPtr op = Container::OpenContainerAsync(EPUB_PATH, RunLoop::CurrentRunLoop(), [&](Stage stage, ContainerPtr container, std::exception_ptr error) {
+        stages.push_back(stage);
+    });
+    op->Cancel();
+    REQUIRE(op->IsCancelled());
+    RunUntilOpened(stages);
+    
+    // make sure nothing else was on its way
+    RunLoop::CurrentRunLoop()->Run(true, std::chrono::milliseconds(50));
+    REQUIRE(stages == (std::vector<Stage>{Stage::Cancelled}));
+}
+
+TEST_CASE("Opens cancelled after the spine is ready should leave the packages usable", "")
+{
+    typedef Container::OpenStage Stage;
+    auto opened = std::make_shared<std::promise<Container::AsyncOpenPtr>>();
+    auto finished = std::make_shared<std::promise<Stage>>();
+    auto opSource = std::make_shared<std::shared_future<Container::AsyncOpenPtr>>(opened->get_future());
+    ContainerPtr spineReady;
+    
+    // with no run loop, cancelling from SpineReady stops the navigation documents being collected
+    Container::AsyncOpenPtr op = Container::OpenContainerAsync(EPUB_PATH, nullptr, [opSource, finished, &spineReady](Stage stage, ContainerPtr container, std::exception_ptr error) {
+        if ( stage == Stage::SpineReady )
+        {
+            spineReady = container;
+            opSource->get()->Cancel();
+        }
+        else if ( stage >= Stage::NavigationReady )
+        {
+            finished->set_value(stage);
+        }
+    });
+    opened->set_value(op);
+    
+    REQUIRE(finished->get_future().get() == Stage::Cancelled);
+    REQUIRE(spineReady != nullptr);
+    REQUIRE_NOTHROW(spineReady->DefaultPackage()->Open("EPUB/package.opf"));
+}
+
+TEST_CASE("Failed asynchronous opens should report the error", "")
+{
+    typedef Container::OpenStage Stage;
+    std::vector<Stage> stages;
+    std::exception_ptr failure;
+    
+    Container::OpenContainerAsync("UnitTests/main.cpp", RunLoop::CurrentRunLoop(), [&](Stage stage, ContainerPtr container, std::exception_ptr error) {
+        stages.push_back(stage);
+        failure = error;
+    });
+    RunUntilOpened(stages);
+    
+    REQUIRE(stages.size() > 0);
+    REQUIRE(stages.back() == Stage::Failed);
+    REQUIRE(failure != nullptr);
+}
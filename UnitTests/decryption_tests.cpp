@@ -0,0 +1,289 @@
+//
+//  decryption_tests.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "../ePub3/ePub/container.h"
+#include "../ePub3/ePub/decryption.h"
+#include "../ePub3/utilities/error_handler.h"
+#include "catch.hpp"
+#include <map>
+
+using namespace ePub3;
+
+static const char gPlaintext[] = "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body><p>All happy families are alike; each unhappy family is unhappy in its own way. All happy families are alike; each unhappy family is unhappy in its own way. All happy families are alike; each unhappy family is unhappy in its own way. All happy families are alike; each unhappy family is unhappy in its own way. </p></body></html>";
+static const uint8_t gAES128Ciphertext[400] = {
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+    0x49, 0x8e, 0x39, 0x63, 0xd3, 0xfb, 0xd0, 0xa9, 0x15, 0x79, 0xed, 0x81, 0x7f, 0xde, 0x97, 0x18,
+    0x91, 0x5b, 0x4e, 0xe9, 0x7e, 0x23, 0x68, 0xcb, 0xf8, 0xcb, 0xd5, 0x99, 0x9a, 0xf8, 0x2a, 0xf8,
+    0x87, 0x78, 0x4b, 0x75, 0x00, 0x72, 0x45, 0x49, 0x39, 0xa7, 0xa2, 0x7f, 0xfd, 0x96, 0xde, 0x86,
+    0xd8, 0x6a, 0x5e, 0x05, 0x8e, 0x64, 0x88, 0x42, 0xfb, 0x92, 0x43, 0x86, 0xc8, 0x50, 0x0e, 0x2a,
+    0xc4, 0x19, 0x0d, 0xd3, 0x41, 0x3a, 0x62, 0x20, 0xd9, 0x3b, 0xe0, 0x90, 0xcb, 0x0a, 0x17, 0x0b,
+    0x54, 0x3b, 0x1a, 0x69, 0xf4, 0xd7, 0x14, 0x9b, 0xd1, 0xb4, 0x9d, 0x20, 0xf5, 0x6a, 0xae, 0x02,
+    0x82, 0x1e, 0x12, 0x7f, 0xda, 0xb5, 0xac, 0x1a, 0x51, 0x8f, 0x38, 0x3a, 0x17, 0xfd, 0xde, 0x88,
+    0x91, 0x6d, 0x4b, 0x44, 0x4e, 0x62, 0xc0, 0x9f, 0xe0, 0x8e, 0x66, 0x78, 0xae, 0x7e, 0xb3, 0xe1,
+    0x46, 0xe0, 0x22, 0xad, 0xe7, 0x6a, 0x24, 0x3e, 0x60, 0x22, 0x91, 0xbe, 0xd6, 0x24, 0x2e, 0x0b,
+    0x47, 0xb7, 0xcb, 0xc4, 0xe0, 0x68, 0x62, 0x42, 0x65, 0xc4, 0x78, 0xb0, 0xc2, 0x1a, 0x5f, 0xb2,
+    0xf8, 0x00, 0x47, 0x20, 0x8d, 0x5a, 0x91, 0x67, 0x37, 0xd1, 0x9b, 0x6b, 0x41, 0xc6, 0x63, 0x9a,
+    0x58, 0x62, 0x2e, 0x12, 0x99, 0x06, 0xa3, 0xfe, 0x3e, 0x33, 0xf8, 0x2a, 0x29, 0x3e, 0xa9, 0x70,
+    0xf7, 0x59, 0xb5, 0x0d, 0x63, 0x81, 0x7e, 0x28, 0xde, 0x93, 0x11, 0x97, 0xa1, 0x81, 0xc4, 0xd2,
+    0xc1, 0x9f, 0x1b, 0x51, 0x57, 0xc9, 0x12, 0x03, 0x33, 0x36, 0x2b, 0x01, 0xe1, 0x8c, 0x41, 0x3d,
+    0x6e, 0x08, 0xe6, 0xde, 0x0d, 0x32, 0xa3, 0x41, 0xc1, 0x14, 0x80, 0xdd, 0xed, 0xb5, 0x61, 0x4a,
+    0xdf, 0x00, 0x0e, 0xb6, 0x91, 0xf6, 0xaa, 0x85, 0x4c, 0x50, 0xb2, 0xa0, 0xb6, 0xb2, 0xba, 0x2e,
+    0xb6, 0x6f, 0x10, 0xb7, 0x3e, 0x8a, 0x20, 0x81, 0xc4, 0xf7, 0xeb, 0xfc, 0x7f, 0x09, 0x6a, 0xb3,
+    0x0a, 0xd4, 0x78, 0xd1, 0x1c, 0xa6, 0xaa, 0x25, 0x9f, 0x30, 0x02, 0x79, 0x8e, 0x28, 0x14, 0xa6,
+    0xf0, 0xf9, 0xda, 0x8c, 0xe9, 0xef, 0x4b, 0x1d, 0xa7, 0xef, 0xec, 0xbb, 0x57, 0x5b, 0x72, 0x8e,
+    0x9b, 0x33, 0x5b, 0x6b, 0x99, 0xb9, 0x05, 0xcb, 0xc8, 0x2a, 0xff, 0x14, 0xc8, 0xb9, 0x17, 0x7e,
+    0x2d, 0xcc, 0x6f, 0x38, 0x12, 0xa6, 0xe8, 0xb2, 0x89, 0xd6, 0xa5, 0xdc, 0x82, 0x0c, 0x5c, 0x5d,
+    0x91, 0x46, 0x2c, 0xc8, 0x23, 0x7e, 0x63, 0x1e, 0x77, 0xee, 0x8f, 0x7d, 0xfd, 0xe9, 0x00, 0xf9,
+    0xf9, 0xf2, 0x1d, 0x45, 0x83, 0xa7, 0x32, 0x49, 0x6d, 0x80, 0x10, 0x45, 0x0b, 0x69, 0xc3, 0x2b,
+    0x87, 0x0b, 0x12, 0xaf, 0x04, 0x47, 0x9e, 0xb6, 0x3c, 0xae, 0x6b, 0xd7, 0x5f, 0x1c, 0xd6, 0x49,
+};
+static const uint8_t gAES256DeflatedCiphertext[144] = {
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+    0xbb, 0x25, 0x93, 0x45, 0x9c, 0x24, 0x2d, 0x4d, 0x48, 0x96, 0xdb, 0xae, 0x50, 0xde, 0x72, 0x2a,
+    0xa1, 0x33, 0x41, 0x21, 0x1d, 0x02, 0xc6, 0x7c, 0x36, 0x4c, 0xa2, 0xaa, 0xce, 0x5c, 0x19, 0x9e,
+    0x66, 0x3f, 0x95, 0xea, 0x43, 0xd2, 0x5a, 0x39, 0x81, 0xb2, 0x12, 0x80, 0x2b, 0x51, 0x84, 0x64,
+    0x84, 0xa5, 0x70, 0x72, 0x72, 0x9b, 0xc8, 0xc2, 0x42, 0x84, 0x7f, 0x19, 0x63, 0xc5, 0xde, 0x89,
+    0x39, 0x37, 0xca, 0x4a, 0xa0, 0xb0, 0x5c, 0x4e, 0x13, 0xc1, 0xa4, 0xce, 0x7f, 0xd8, 0x30, 0xb6,
+    0xe9, 0xcd, 0x00, 0xa6, 0x8d, 0xb6, 0xeb, 0xfe, 0x88, 0xc9, 0xed, 0x24, 0x74, 0x79, 0xf8, 0x6c,
+    0xd2, 0x4f, 0xb6, 0xfa, 0xa1, 0x59, 0x49, 0x2a, 0x41, 0x80, 0x54, 0xca, 0xdf, 0xbe, 0x0e, 0xe1,
+    0xc9, 0xcc, 0xea, 0x6a, 0x99, 0x29, 0x9f, 0x59, 0x55, 0x33, 0x48, 0xdd, 0x89, 0x0b, 0xed, 0x73,
+};
+
+// a local key store, standing in for a real licensing service
+class TestKeyProvider
+{
+public:
+    TestKeyProvider() : _keys(), _requests(0) {
+        for ( uint8_t i = 0; i < 16; i++ )
+            _keys["urn:test:key128"].push_back(i);
+        for ( uint8_t i = 0; i < 32; i++ )
+            _keys["urn:test:key256"].push_back(i);
+    }
+    
+    bool operator()(const EncryptionInfo* encInfo, std::vector<uint8_t>& key) {
+        _requests++;
+        auto found = _keys.find(encInfo->KeyName());
+        if ( found == _keys.end() )
+            return false;
+        key = found->second;
+        return true;
+    }
+    
+    int Requests() const { return _requests; }
+    
+private:
+    std::map<string, std::vector<uint8_t>> _keys;
+    int _requests;
+};
+
+// runs the whole ciphertext through a filter in chunks of the given size
+static std::string DecryptInChunks(const DecryptionFilter& filter, FilterContext* ctx, const uint8_t* cipher, size_t len, size_t chunkSize)
+{
+    std::string result;
+    for ( size_t off = 0; off < len; off += chunkSize )
+    {
+        size_t n = std::min(chunkSize, len - off);
+        std::vector<uint8_t> chunk(cipher + off, cipher + off + n);
+        
+        size_t outLen = 0;
+        void* output = filter.FilterData(ctx, chunk.data(), n, &outLen);
+        result.append(reinterpret_cast<const char*>(output), outLen);
+        if ( output != chunk.data() )
+            delete [] reinterpret_cast<uint8_t*>(output);
+    }
+    
+    size_t outLen = 0;
+    void* output = filter.FinishFilter(ctx, &outLen);
+    if ( output != nullptr )
+    {
+        result.append(reinterpret_cast<const char*>(output), outLen);
+        delete [] reinterpret_cast<uint8_t*>(output);
+    }
+    return result;
+}
+
+static bool HasKey(const unique_ptr<FilterContext>& ctx)
+{
+    auto decryptionCtx = dynamic_cast<DecryptionFilter::DecryptionContext*>(ctx.get());
+    return decryptionCtx != nullptr && decryptionCtx->HasKey();
+}
+
+TEST_CASE("AES-CBC resources should decrypt in any chunk size", "")
+{
+    ContainerPtr c = std::make_shared<Container>();
+    auto encInfo = std::make_shared<EncryptionInfo>(c);
+    encInfo->SetPath("EPUB/chapter1.xhtml");
+    encInfo->SetAlgorithm(DecryptionFilter::AES128CBCAlgorithmID);
+    encInfo->SetKeyName("urn:test:key128");
+    
+    REQUIRE(DecryptionFilter::DecryptionTypeSniffer(nullptr, encInfo.get()));
+    
+    TestKeyProvider provider;
+    const DecryptionFilter filter(std::ref(provider));
+    for ( size_t chunkSize : {1, 7, 16, 17, 100, 4096} )
+    {
+        auto ctx = filter.MakeFilterContext(nullptr, encInfo.get());
+        REQUIRE(HasKey(ctx));
+        REQUIRE(DecryptInChunks(filter, ctx.get(), gAES128Ciphertext, sizeof(gAES128Ciphertext), chunkSize) == gPlaintext);
+    }
+    REQUIRE(provider.Requests() == 6);
+}
+
+TEST_CASE("One decryption filter should handle interleaved resources", "")
+{
+    ContainerPtr c = std::make_shared<Container>();
+    auto encInfo128 = std::make_shared<EncryptionInfo>(c);
+    encInfo128->SetAlgorithm(DecryptionFilter::AES128CBCAlgorithmID);
+    encInfo128->SetKeyName("urn:test:key128");
+    
+    auto encInfo256 = std::make_shared<EncryptionInfo>(c);
+    encInfo256->SetAlgorithm(DecryptionFilter::AES256CBCAlgorithmID);
+    encInfo256->SetKeyName("urn:test:key256");
+    encInfo256->SetCompression(EncryptionInfo::CompressionMethod::Deflated, sizeof(gPlaintext)-1);
+    
+    TestKeyProvider provider;
+    const DecryptionFilter filter(std::ref(provider));
+    auto ctx1 = filter.MakeFilterContext(nullptr, encInfo128.get());
+    auto ctx2 = filter.MakeFilterContext(nullptr, encInfo256.get());
+    
+    // alternate between the two resources, one block at a time
+    std::string out1, out2;
+    size_t off1 = 0, off2 = 0;
+    while ( off1 < sizeof(gAES128Ciphertext) || off2 < sizeof(gAES256DeflatedCiphertext) )
+    {
+        uint8_t chunk[16];
+        size_t outLen = 0;
+        void* output = nullptr;
+        
+        if ( off1 < sizeof(gAES128Ciphertext) )
+        {
+            memcpy(chunk, gAES128Ciphertext + off1, 16);
+            output = filter.FilterData(ctx1.get(), chunk, 16, &outLen);
+            out1.append(reinterpret_cast<const char*>(output), outLen);
+            if ( output != chunk )
+                delete [] reinterpret_cast<uint8_t*>(output);
+            off1 += 16;
+        }
+        if ( off2 < sizeof(gAES256DeflatedCiphertext) )
+        {
+            memcpy(chunk, gAES256DeflatedCiphertext + off2, 16);
+            output = filter.FilterData(ctx2.get(), chunk, 16, &outLen);
+            out2.append(reinterpret_cast<const char*>(output), outLen);
+            if ( output != chunk )
+                delete [] reinterpret_cast<uint8_t*>(output);
+            off2 += 16;
+        }
+    }
+    
+    out1 += DecryptInChunks(filter, ctx1.get(), nullptr, 0, 1);
+    out2 += DecryptInChunks(filter, ctx2.get(), nullptr, 0, 1);
+    REQUIRE(out1 == gPlaintext);
+    REQUIRE(out2 == gPlaintext);
+}
+
+TEST_CASE("Resources compressed before encryption should be inflated", "")
+{
+    ContainerPtr c = std::make_shared<Container>();
+    auto encInfo = std::make_shared<EncryptionInfo>(c);
+    encInfo->SetPath("EPUB/chapter1.xhtml");
+    encInfo->SetAlgorithm(DecryptionFilter::AES256CBCAlgorithmID);
+    encInfo->SetKeyName("urn:test:key256");
+    encInfo->SetCompression(EncryptionInfo::CompressionMethod::Deflated, sizeof(gPlaintext)-1);
+    
+    TestKeyProvider provider;
+    DecryptionFilter::SetKeyProvider(std::ref(provider));
+    
+    // single-resource filter, using the global key provider
+    DecryptionFilter filter(encInfo);
+    std::string output;
+    for ( size_t off = 0; off < sizeof(gAES256DeflatedCiphertext); off += 33 )
+    {
+        size_t n = std::min(sizeof(gAES256DeflatedCiphertext) - off, size_t(33));
+        uint8_t chunk[33];
+        memcpy(chunk, gAES256DeflatedCiphertext + off, n);
+        
+        size_t outLen = 0;
+        void* result = filter.FilterData(chunk, n, &outLen);
+        output.append(reinterpret_cast<const char*>(result), outLen);
+        if ( result != chunk )
+            delete [] reinterpret_cast<uint8_t*>(result);
+    }
+    
+    size_t outLen = 0;
+    void* result = filter.FinishFilter(&outLen);
+    REQUIRE(result != nullptr);
+    output.append(reinterpret_cast<const char*>(result), outLen);
+    delete [] reinterpret_cast<uint8_t*>(result);
+    
+    REQUIRE(output == gPlaintext);
+    REQUIRE(provider.Requests() == 1);
+    
+    DecryptionFilter::SetKeyProvider(nullptr);
+}
+
+TEST_CASE("Resources without a known key should report an error", "")
+{
+    ContainerPtr c = std::make_shared<Container>();
+    auto encInfo = std::make_shared<EncryptionInfo>(c);
+    encInfo->SetAlgorithm(DecryptionFilter::AES128CBCAlgorithmID);
+    encInfo->SetKeyName("urn:test:unknown");
+    
+    TestKeyProvider provider;
+    DecryptionFilter filter(std::ref(provider));
+    REQUIRE(DecryptionFilter::DecryptionTypeSniffer(nullptr, encInfo.get()));
+    REQUIRE_THROWS_AS(filter.MakeFilterContext(nullptr, encInfo.get()), std::runtime_error);
+    
+    // if the handler lets it continue, the resource produces nothing
+    int handled = 0;
+    ErrorHandlerScope scope([&handled](const std::runtime_error&) { handled++; return true; });
+    auto ctx = filter.MakeFilterContext(nullptr, encInfo.get());
+    REQUIRE(handled == 1);
+    REQUIRE_FALSE(HasKey(ctx));
+    REQUIRE(DecryptInChunks(filter, ctx.get(), gAES128Ciphertext, sizeof(gAES128Ciphertext), 64).empty());
+    
+    // font obfuscation isn't handled by this filter
+    encInfo->SetAlgorithm("http://www.idpf.org/2008/embedding");
+    REQUIRE_FALSE(DecryptionFilter::DecryptionTypeSniffer(nullptr, encInfo.get()));
+}
+
+TEST_CASE("Damaged ciphertext should report an error", "")
+{
+    ContainerPtr c = std::make_shared<Container>();
+    auto encInfo = std::make_shared<EncryptionInfo>(c);
+    encInfo->SetAlgorithm(DecryptionFilter::AES128CBCAlgorithmID);
+    encInfo->SetKeyName("urn:test:key128");
+    
+    TestKeyProvider provider;
+    DecryptionFilter filter(std::ref(provider));
+    
+    // cut off partway through the final block
+    auto ctx = filter.MakeFilterContext(nullptr, encInfo.get());
+    REQUIRE(HasKey(ctx));
+    REQUIRE_THROWS_AS(DecryptInChunks(filter, ctx.get(), gAES128Ciphertext, sizeof(gAES128Ciphertext)-5, 64), std::runtime_error);
+    
+    // cut off at a block boundary, so the padding is wrong
+    ctx = filter.MakeFilterContext(nullptr, encInfo.get());
+    REQUIRE_THROWS_AS(DecryptInChunks(filter, ctx.get(), gAES128Ciphertext, sizeof(gAES128Ciphertext)-DecryptionFilter::BlockSize, 64), std::runtime_error);
+    
+    // nothing but the IV
+    ctx = filter.MakeFilterContext(nullptr, encInfo.get());
+    REQUIRE_THROWS_AS(DecryptInChunks(filter, ctx.get(), gAES128Ciphertext, DecryptionFilter::BlockSize, 64), std::runtime_error);
+}
@@ -0,0 +1,213 @@
+//
+//  error_handler_tests.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "../ePub3/utilities/error_handler.h"
+#include "../ePub3/ePub/cfi.h"
+#include "../ePub3/ePub/container.h"
+#include "catch.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace ePub3;
+
+#define MISSING_TITLE_EPUB_PATH "TestData/missing-title.epub"
+
+TEST_CASE("Spec error messages and severities should come from the error table", "")
+{
+    // the first and last entries, and one from each specification in between
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::OCFResourceNotInManifest).message() == "All resources accessed by a publication rendition MUST be listed in its manifest.");
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::OCFNoContainerFile).message() == "Containers MUST have a META-INF/container.xml file.");
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::OPFMissingTitleMetadata).message() == "Package metadata MUST include 'dc:title'.");
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::CFINonSlashStartCharacter).message() == "A CFI reference MUST begin with a slash (/) character.");
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::CFIRangeComponentCountInvalid).message() == "A CFI appears to have a number of range components other than 1 (no range) or 3 (a valid range).");
+
+    REQUIRE(epub_spec_error(EPUBError::OCFNoContainerFile).Severity() == ViolationSeverity::Critical);
+    REQUIRE(epub_spec_error(EPUBError::OCFNonUTF8FileNames).Severity() == ViolationSeverity::Minor);
+    REQUIRE(epub_spec_error(EPUBError::CFIRangeContainsSideBias).Severity() == ViolationSeverity::Medium);
+
+    std::string detail = DetailedErrorMessage(EPUBError::OPFMissingTitleMetadata);
+    REQUIRE(detail.find("Major violation of Open Publications Format 3.0") == 0);
+    REQUIRE(detail.find("3.4.2") != std::string::npos);
+
+    // codes with no entry
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::NoError).message() == "Unspecified EPUB specification error");
+    REQUIRE(ErrorCodeForEPUBError(EPUBError::OCFErrorMax).message() == "Unspecified EPUB specification error");
+    REQUIRE(DetailedErrorMessage(EPUBError::CFIErrorMax) == "<unknown epub spec error>");
+}
+
+TEST_CASE("Error handler scopes should apply only to their own thread, and nest", "")
+{
+    int outerCount = 0, innerCount = 0;
+
+    {
+        ErrorHandlerScope outer([&](const std::runtime_error&) { outerCount++; return true; });
+        REQUIRE_NOTHROW(HandleError(EPUBError::OPFMissingTitleMetadata));
+        REQUIRE(outerCount == 1);
+
+        {
+            ErrorHandlerScope inner([&](const std::runtime_error&) { innerCount++; return false; });
+            REQUIRE_THROWS_AS(HandleError(EPUBError::OPFMissingTitleMetadata), const epub_spec_error&);
+            REQUIRE_THROWS_AS(HandleError(std::errc::io_error), const std::runtime_error&);
+            REQUIRE(innerCount == 2);
+            REQUIRE(outerCount == 1);
+        }
+
+        REQUIRE_NOTHROW(HandleError(EPUBError::OPFMissingTitleMetadata, "no title"));
+        REQUIRE(outerCount == 2);
+
+        // other threads still get the global handler, which rejects Major violations
+        bool threw = false;
+        std::thread other([&threw]() {
+            try
+            {
+                HandleError(EPUBError::OPFMissingTitleMetadata);
+            }
+            catch (epub_spec_error&)
+            {
+                threw = true;
+            }
+        });
+        other.join();
+        REQUIRE(threw);
+        REQUIRE(outerCount == 2);
+    }
+
+    REQUIRE_THROWS_AS(HandleError(EPUBError::OPFMissingTitleMetadata), const epub_spec_error&);
+    REQUIRE(outerCount == 2);
+}
+
+TEST_CASE("Error recorders should store errors without handling them", "")
+{
+    int handled = 0;
+    ErrorHandlerScope scope([&](const std::runtime_error&) { handled++; return true; });
+
+    {
+        ErrorRecorder recorder(4);
+        REQUIRE(recorder.Capacity() == 4);
+
+        HandleError(EPUBError::OPFMissingTitleMetadata);
+        {
+            ErrorLocation location("metadata");
+            HandleError(EPUBError::OPFMissingLanguageMetadata, "no language");
+        }
+        HandleError(std::errc::io_error);
+        REQUIRE(handled == 1);          // not a spec error, so it's handled as usual
+
+        REQUIRE(recorder.Size() == 2);
+        REQUIRE(recorder[0].code == EPUBError::OPFMissingTitleMetadata);
+        REQUIRE(recorder[0].location == nullptr);
+        REQUIRE(recorder[1].code == EPUBError::OPFMissingLanguageMetadata);
+        REQUIRE(std::strcmp(recorder[1].location, "metadata") == 0);
+
+        // CFI parsing carries on past the error, and notes where it came from
+        CFI cfi("6/4");
+        REQUIRE(recorder.Size() == 3);
+        REQUIRE(recorder[2].code == EPUBError::CFINonSlashStartCharacter);
+        REQUIRE(std::strcmp(recorder[2].location, "CFI") == 0);
+
+        // once full, the rest are only counted
+        HandleError(EPUBError::OPFMissingTitleMetadata);
+        HandleError(EPUBError::OPFMissingTitleMetadata);
+        REQUIRE(recorder.Size() == 4);
+        REQUIRE(recorder.Dropped() == 1);
+        REQUIRE(recorder.TotalCount() == 5);
+        REQUIRE(recorder.Count(EPUBError::OPFMissingTitleMetadata) == 2);
+        REQUIRE(handled == 1);
+
+        recorder.Clear();
+        REQUIRE(recorder.Size() == 0);
+        REQUIRE(recorder.TotalCount() == 0);
+        REQUIRE(recorder.begin() == recorder.end());
+
+        // critical errors are recorded, and handled too
+        HandleError(EPUBError::OCFNoContainerFile);
+        REQUIRE(recorder.Size() == 1);
+        REQUIRE(recorder[0].code == EPUBError::OCFNoContainerFile);
+        REQUIRE(handled == 2);
+    }
+
+    HandleError(EPUBError::OPFMissingTitleMetadata);
+    REQUIRE(handled == 3);
+}
+
+TEST_CASE("Error recorders should not hide critical errors from the default handler", "")
+{
+    ErrorRecorder recorder;
+    REQUIRE_NOTHROW(HandleError(EPUBError::OPFMissingTitleMetadata));
+    REQUIRE_THROWS_AS(HandleError(EPUBError::OCFNoContainerFile), const epub_spec_error&);
+    REQUIRE(recorder.Size() == 2);
+}
+
+TEST_CASE("Asynchronous opens should report errors to the opening thread's handler", "")
+{
+    // the default handler rejects a missing title, so the package is dropped
+    ContainerPtr rejected = Container::OpenContainerAsync(MISSING_TITLE_EPUB_PATH).get();
+    REQUIRE(rejected != nullptr);
+    REQUIRE(rejected->DefaultPackage() == nullptr);
+
+    std::thread::id handlerThread;
+    int handled = 0;
+    std::future<ContainerPtr> pending;
+
+    {
+        ErrorHandlerScope scope([&](const std::runtime_error&) {
+            handlerThread = std::this_thread::get_id();
+            handled++;
+            return true;
+        });
+        pending = Container::OpenContainerAsync(MISSING_TITLE_EPUB_PATH);
+    }
+
+    // the handler goes along with the open, even once the scope has gone
+    ContainerPtr container = pending.get();
+    REQUIRE(container != nullptr);
+    REQUIRE(container->DefaultPackage() != nullptr);
+    REQUIRE(handled == 1);
+    REQUIRE(handlerThread != std::this_thread::get_id());
+}
+
+TEST_CASE("Raising spec errors with a handler and with a recorder", "[errors][benchmark][hide]")
+{
+    static const int kCount = 200000;
+    int handled = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ErrorHandlerScope scope([&handled](const std::runtime_error&) { handled++; return true; });
+        for ( int i = 0; i < kCount; i++ )
+            HandleError(EPUBError::OPFMissingTitleMetadata);
+    }
+    auto handlerTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    ErrorRecorder recorder(kCount);
+    start = std::chrono::steady_clock::now();
+    for ( int i = 0; i < kCount; i++ )
+        HandleError(EPUBError::OPFMissingTitleMetadata);
+    auto recorderTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(handled == kCount);
+    REQUIRE(recorder.Size() == static_cast<std::size_t>(kCount));
+
+    WARN("Raised " << kCount << " spec errors: " << (handlerTime.count() / 1000) << "ms through a handler, "
+         << (recorderTime.count() / 1000) << "ms into a recorder");
+}
@@ -0,0 +1,212 @@
+//
+//  executor_tests.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "../ePub3/utilities/executor.h"
+#include "../ePub3/ePub/container.h"
+#include "catch.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ePub3;
+
+#define EPUB_PATH "TestData/childrens-literature-20120722.epub"
+
+TEST_CASE("Executor should return results and exceptions through futures", "")
+{
+    Executor executor(4);
+    REQUIRE(executor.ThreadCount() == 4);
+    REQUIRE_FALSE(executor.IsWorkerThread());
+
+    std::vector<std::future<int>> results;
+    for ( int i = 0; i < 100; i++ )
+    {
+        results.push_back(executor.Submit([i]() { return i * 2; }));
+    }
+
+    int total = 0;
+    for ( auto& result : results )
+    {
+        total += result.get();
+    }
+    REQUIRE(total == 9900);
+
+    auto failure = executor.Submit([]() -> int { throw std::runtime_error("failed"); });
+    REQUIRE_THROWS_AS(failure.get(), const std::runtime_error&);
+}
+
+TEST_CASE("Executor completions should be delivered on the target run loop", "")
+{
+    Executor executor(2);
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    std::thread::id loopThread = std::this_thread::get_id();
+
+    std::thread::id workerThread, completionThread;
+    int result = 0;
+    bool done = false;
+
+    executor.Submit([&]() {
+        workerThread = std::this_thread::get_id();
+        return 42;
+    }, rl, [&](std::future<int> future) {
+        completionThread = std::this_thread::get_id();
+        result = future.get();
+        done = true;
+    });
+
+    for ( int i = 0; i < 100 && !done; i++ )
+    {
+        rl->Run(true, std::chrono::milliseconds(100));
+    }
+
+    REQUIRE(done);
+    REQUIRE(result == 42);
+    REQUIRE(completionThread == loopThread);
+    REQUIRE(workerThread != loopThread);
+}
+
+TEST_CASE("Executor tasks should be able to wait on tasks they submit", "")
+{
+    // a single worker must run the subtasks itself while it waits for them
+    Executor executor(1);
+
+    auto outer = executor.Submit([&executor]() {
+        std::vector<std::future<int>> inner;
+        for ( int i = 1; i <= 10; i++ )
+        {
+            inner.push_back(executor.Submit([i]() { return i; }));
+        }
+
+        int total = 0;
+        for ( auto& f : inner )
+        {
+            total += executor.Wait(f);
+        }
+        return total;
+    });
+
+    REQUIRE(outer.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    REQUIRE(outer.get() == 55);
+}
+
+TEST_CASE("Executor tasks should only run their own subtasks while waiting", "")
+{
+    Executor executor(1);
+    std::atomic<bool> started(false), posted(false), waiting(false);
+    bool ranWhileWaiting = true;
+
+    auto outer = executor.Submit([&]() {
+        auto inner = executor.Submit([]() { return 1; });
+        started = true;
+        while ( !posted )
+            std::this_thread::yield();
+
+        waiting = true;
+        int result = executor.Wait(inner);
+        waiting = false;
+        return result;
+    });
+
+    // queued after the inner task by another thread, so it's not the outer task's to run
+    while ( !started )
+        std::this_thread::yield();
+    auto unrelated = executor.Submit([&]() {
+        ranWhileWaiting = waiting;
+        return 0;
+    });
+    posted = true;
+
+    REQUIRE(outer.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    REQUIRE(outer.get() == 1);
+    REQUIRE(unrelated.get() == 0);
+    REQUIRE_FALSE(ranWhileWaiting);
+}
+
+TEST_CASE("Containers and documents should load on the shared executor", "")
+{
+    auto pending = Container::OpenContainerAsync(EPUB_PATH);
+    ContainerPtr container = pending.get();
+    REQUIRE(container != nullptr);
+
+    PackagePtr pkg = container->DefaultPackage();
+    REQUIRE(pkg != nullptr);
+    REQUIRE(pkg->TableOfContents() != nullptr);
+
+    std::vector<std::pair<ManifestItemPtr, std::future<xmlDocPtr>>> documents;
+    for ( auto item = pkg->FirstSpineItem(); item != nullptr; item = item->Next() )
+    {
+        ManifestItemPtr manifestItem = item->ManifestItem();
+        documents.emplace_back(manifestItem, manifestItem->ReferencedDocumentAsync());
+    }
+    REQUIRE(documents.size() > 1);
+
+    for ( auto& document : documents )
+    {
+        xmlDocPtr doc = document.second.get();
+        REQUIRE(doc != nullptr);
+
+        xmlDocPtr expected = document.first->ReferencedDocument();
+        REQUIRE(expected != nullptr);
+        REQUIRE(xmlStrEqual(xmlDocGetRootElement(doc)->name, xmlDocGetRootElement(expected)->name));
+
+        xmlFreeDoc(expected);
+        xmlFreeDoc(doc);
+    }
+}
+
+TEST_CASE("Loading spine documents serially and on the shared executor", "[executor][benchmark][hide]")
+{
+    static const int kPasses = 20;
+    ContainerPtr container = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = container->DefaultPackage();
+
+    std::vector<ManifestItemPtr> items;
+    for ( auto item = pkg->FirstSpineItem(); item != nullptr; item = item->Next() )
+    {
+        items.push_back(item->ManifestItem());
+    }
+    REQUIRE(items.size() > 0);
+
+    auto start = std::chrono::steady_clock::now();
+    for ( int pass = 0; pass < kPasses; pass++ )
+    {
+        for ( auto& item : items )
+            xmlFreeDoc(item->ReferencedDocument());
+    }
+    auto serialTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for ( int pass = 0; pass < kPasses; pass++ )
+    {
+        std::vector<std::future<xmlDocPtr>> documents;
+        for ( auto& item : items )
+            documents.push_back(item->ReferencedDocumentAsync());
+        for ( auto& document : documents )
+            xmlFreeDoc(document.get());
+    }
+    auto asyncTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    WARN("Loaded " << items.size() << " spine documents " << kPasses << " times: serially in "
+         << (serialTime.count() / 1000) << "ms, on " << Executor::Shared()->ThreadCount()
+         << " workers in " << (asyncTime.count() / 1000) << "ms");
+}
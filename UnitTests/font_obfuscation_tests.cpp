@@ -24,6 +24,11 @@
 #include "../ePub3/ePub/package.h"
 #include "../ePub3/utilities/byte_stream.h"
 #include "catch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <stdexcept>
+#include <thread>
 
 #define EPUB_PATH "TestData/wasteland-otf-obf-20120118.epub"
 #define FONT_SUBPATH "EPUB/OldStandard-Regular.obf.otf"
@@ -73,3 +78,265 @@ TEST_CASE("Obfuscated fonts are decrypted properly", "")
     if ( output != bytes )
         delete [] reinterpret_cast<uint8_t*>(output);
 }
+
+TEST_CASE("Font obfuscation keys are built once per container and shared", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    auto encInfo = c->EncryptionInfoForPath(FONT_SUBPATH);
+    REQUIRE(bool(encInfo));
+    
+    FontObfuscationKeyPtr key = c->ObfuscationKeyForAlgorithm(encInfo->Algorithm());
+    REQUIRE(bool(key));
+    REQUIRE(key->KeySize() == FontObfuscationKey::IDPFKeySize);
+    
+    // the container's key should match one derived from scratch
+    FontObfuscationKeyPtr derived = FontObfuscationKey::KeyForContainer(c.get(), FontObfuscationKey::Algorithm::IDPF);
+    REQUIRE(memcmp(key->Key(), derived->Key(), key->KeySize()) == 0);
+    
+    // all obfuscators for this container share the same key material
+    FontObfuscator first(c.get());
+    FontObfuscator second(c.get());
+    REQUIRE(first.ObfuscationKey() == key);
+    REQUIRE(second.ObfuscationKey() == key);
+    
+    // no Adobe-obfuscated resources in this container
+    REQUIRE_FALSE(bool(c->ObfuscationKeyForAlgorithm("http://ns.adobe.com/pdf/enc#RC")));
+}
+
+TEST_CASE("Expanded obfuscation masks produce the same output", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    FontObfuscationKeyPtr key = c->ObfuscationKeyForAlgorithm("http://www.idpf.org/2008/embedding");
+    REQUIRE(bool(key));
+    
+    FontObfuscationKeyPtr expanded = std::make_shared<FontObfuscationKey>(FontObfuscationKey::Algorithm::IDPF, key->Key(), key->KeySize(), true);
+    REQUIRE(expanded->HasExpandedMask());
+    
+    auto stream = c->ReadStreamAtPath(FONT_SUBPATH);
+    REQUIRE_FALSE(stream == nullptr);
+    
+    uint8_t bytes[1080];
+    ssize_t numRead = stream->ReadBytes(bytes, 1080);
+    REQUIRE(numRead == 1080);
+    
+    uint8_t copy[1080];
+    memcpy(copy, bytes, sizeof(copy));
+    
+    // feed the data through in odd-sized chunks to exercise the offset handling
+    FontObfuscator plain(key);
+    FontObfuscator fast(expanded);
+    size_t outLen = 0;
+    for ( size_t off = 0; off < sizeof(bytes); off += 333 )
+    {
+        size_t len = std::min(sizeof(bytes) - off, size_t(333));
+        plain.FilterData(bytes + off, len, &outLen);
+        fast.FilterData(copy + off, len, &outLen);
+    }
+    
+    uint8_t ident[4] = { 'O', 'T', 'T', 'O' };
+    REQUIRE(memcmp(bytes, ident, 4) == 0);
+    REQUIRE(memcmp(bytes, copy, sizeof(bytes)) == 0);
+}
+
+TEST_CASE("Encryption info lookups should match equivalent paths", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    auto encInfo = c->EncryptionInfoForPath(FONT_SUBPATH);
+    REQUIRE(bool(encInfo));
+    REQUIRE(c->IsEncrypted(FONT_SUBPATH));
+    
+    REQUIRE(c->EncryptionInfoForPath("/" FONT_SUBPATH) == encInfo);
+    REQUIRE(c->EncryptionInfoForPath("EPUB/./OldStandard-Regular.obf.otf") == encInfo);
+    REQUIRE(c->EncryptionInfoForPath("EPUB/fonts/../OldStandard-Regular.obf.otf") == encInfo);
+    REQUIRE(c->EncryptionInfoForPath("EPUB/OldStandard%2DRegular.obf.otf") == encInfo);
+    
+    REQUIRE(c->EncryptionInfoForPath("EPUB/wasteland-content.xhtml") == nullptr);
+    REQUIRE(c->EncryptionInfoForPath("") == nullptr);
+    REQUIRE_FALSE(c->IsEncrypted("EPUB/wasteland-content.xhtml"));
+    
+    // an escaped slash is part of a name, not a separator
+    REQUIRE(c->EncryptionInfoForPath("EPUB%2FOldStandard-Regular.obf.otf") == nullptr);
+    
+    REQUIRE(Container::NormalizedPath("/a//b/./c/../d") == "a/b/d");
+    REQUIRE(Container::NormalizedPath("a%20b.xhtml") == "a b.xhtml");
+    REQUIRE(Container::NormalizedPath("a%2") == "a%2");
+    REQUIRE(Container::NormalizedPath("a%2Fb/c") == "a%2Fb/c");
+}
+
+TEST_CASE("Packages should cache the filters applicable to each manifest item", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+    ManifestItemPtr font = pkg->ManifestItemWithID(FONT_MANIFEST_ID);
+    ManifestItemPtr nav = pkg->ManifestItemWithID("nav");
+    
+    auto obfuscator = std::make_shared<FontObfuscator>(c.get());
+    pkg->AddContentFilter(obfuscator);
+    REQUIRE(pkg->ContentFilterMaskForItem(font.get()) == 1);
+    REQUIRE(pkg->ContentFilterMaskForItem(nav.get()) == 0);
+    
+    // a filter whose sniffer counts how often it's called
+    int sniffs = 0;
+    auto counter = std::make_shared<FontObfuscator>(c.get());
+    counter->SetTypeSniffer([&sniffs](const ManifestItem* item, const EncryptionInfo*) {
+        sniffs++;
+        return item->HasProperty(ItemProperties::Navigation);
+    });
+    pkg->AddContentFilter(counter);
+    
+    int sniffsAtInstall = sniffs;
+    REQUIRE(sniffsAtInstall == int(pkg->Manifest().size()));
+    
+    // newer filters go first
+    REQUIRE(pkg->ContentFilterMaskForItem(font.get()) == 2);
+    REQUIRE(pkg->ContentFilterMaskForItem(nav.get()) == 1);
+    
+    auto filters = pkg->ContentFiltersForItem(font.get());
+    REQUIRE(filters.size() == 1);
+    REQUIRE(filters[0] == obfuscator);
+    filters = pkg->ContentFiltersForItem(nav.get());
+    REQUIRE(filters.size() == 1);
+    REQUIRE(filters[0] == counter);
+    REQUIRE(sniffs == sniffsAtInstall);
+    
+    REQUIRE(pkg->RemoveContentFilter(counter));
+    REQUIRE_FALSE(pkg->RemoveContentFilter(counter));
+    REQUIRE(pkg->ContentFilterMaskForItem(font.get()) == 1);
+    REQUIRE(pkg->ContentFilterMaskForItem(nav.get()) == 0);
+}
+
+TEST_CASE("Filter pipelines for the same item should run independently", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+    ManifestItemPtr font = pkg->ManifestItemWithID(FONT_MANIFEST_ID);
+    pkg->AddContentFilter(std::make_shared<FontObfuscator>(c.get()));
+    
+    REQUIRE(pkg->FilterPipelineForItem(pkg->ManifestItemWithID("nav").get())->Empty());
+    
+    auto pipeline1 = pkg->FilterPipelineForItem(font.get());
+    auto pipeline2 = pkg->FilterPipelineForItem(font.get());
+    REQUIRE_FALSE(pipeline1->Empty());
+    
+    auto stream = c->ReadStreamAtPath(FONT_SUBPATH);
+    uint8_t bytes[1200];
+    REQUIRE(stream->ReadBytes(bytes, sizeof(bytes)) == sizeof(bytes));
+    
+    uint8_t copy[sizeof(bytes)];
+    memcpy(copy, bytes, sizeof(bytes));
+    
+    // interleave the two pipelines, using different chunk sizes
+    size_t outLen = 0;
+    for ( size_t off = 0; off < sizeof(bytes); off += 100 )
+        pipeline1->FilterData(bytes + off, 100, &outLen);
+    for ( size_t off = 0; off < sizeof(copy); off += 300 )
+    {
+        pipeline2->FilterData(copy + off, 300, &outLen);
+        REQUIRE(outLen == 300);
+    }
+    
+    REQUIRE(pipeline1->FinishFilter(&outLen) == nullptr);
+    REQUIRE(outLen == 0);
+    
+    uint8_t ident[4] = { 'O', 'T', 'T', 'O' };
+    REQUIRE(memcmp(bytes, ident, 4) == 0);
+    REQUIRE(memcmp(bytes, copy, sizeof(bytes)) == 0);
+}
+
+// a filter written against the original, context-free interface
+class UppercaseFilter : public ContentFilter
+{
+public:
+    UppercaseFilter() : ContentFilter([](const ManifestItem*, const EncryptionInfo*) { return true; }), _calls(0) {}
+    
+    virtual void * FilterData(void *data, size_t len, size_t *outputLen) {
+        _calls++;
+        char* chars = reinterpret_cast<char*>(data);
+        for ( size_t i = 0; i < len; i++ )
+            chars[i] = static_cast<char>(toupper(chars[i]));
+        *outputLen = len;
+        return data;
+    }
+    
+    int Calls() const { return _calls; }
+    
+private:
+    int _calls;
+};
+
+TEST_CASE("Filters overriding the context-free FilterData() should still run in a pipeline", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+    auto filter = std::make_shared<UppercaseFilter>();
+    pkg->AddContentFilter(filter);
+    
+    auto pipeline = pkg->FilterPipelineForItem(pkg->ManifestItemWithID("nav").get());
+    REQUIRE_FALSE(pipeline->Empty());
+    
+    char text[] = "hello";
+    size_t outLen = 0;
+    REQUIRE(pipeline->FilterData(text, 5, &outLen) == text);
+    REQUIRE(outLen == 5);
+    REQUIRE(std::string(text) == "HELLO");
+    REQUIRE(filter->Calls() == 1);
+}
+
+class IncompleteFilter : public ContentFilter
+{
+public:
+    IncompleteFilter() : ContentFilter([](const ManifestItem*, const EncryptionInfo*) { return true; }) {}
+};
+
+TEST_CASE("Filters overriding neither FilterData() should fail rather than recurse", "")
+{
+    auto filter = std::make_shared<IncompleteFilter>();
+    char text[] = "hello";
+    size_t outLen = 0;
+    
+    FilterPipeline pipeline(FilterPipeline::FilterList{filter}, nullptr, nullptr);
+    REQUIRE_THROWS_AS(pipeline.FilterData(text, 5, &outLen), const std::logic_error&);
+    REQUIRE_THROWS_AS(filter->FilterData(text, 5, &outLen), const std::logic_error&);
+    
+    // the failure doesn't stick
+    REQUIRE_THROWS_AS(filter->FilterData(text, 5, &outLen), const std::logic_error&);
+}
+
+TEST_CASE("Filters should be safe to change while other threads look them up", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+    ManifestItemPtr font = pkg->ManifestItemWithID(FONT_MANIFEST_ID);
+    auto obfuscator = std::make_shared<FontObfuscator>(c.get());
+    pkg->AddContentFilter(obfuscator);
+    
+    std::atomic<bool> done(false);
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> readers;
+    for ( int i = 0; i < 4; i++ )
+    {
+        readers.emplace_back([&]() {
+            while ( !done )
+            {
+                // the obfuscator always applies to the font, whatever else is installed
+                auto filters = pkg->ContentFiltersForItem(font.get());
+                if ( std::find(filters.begin(), filters.end(), obfuscator) == filters.end() )
+                    mismatches++;
+            }
+        });
+    }
+    
+    for ( int i = 0; i < 200; i++ )
+    {
+        auto extra = std::make_shared<UppercaseFilter>();
+        pkg->AddContentFilter(extra);
+        pkg->RemoveContentFilter(extra);
+    }
+    
+    done = true;
+    for ( auto& reader : readers )
+        reader.join();
+    
+    REQUIRE(mismatches.load() == 0);
+    REQUIRE(pkg->ContentFilters().size() == 1);
+}
@@ -0,0 +1,393 @@
+//
+//  library_tests.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "../ePub3/ePub/library.h"
+#include "../ePub3/ePub/container.h"
+#include "../ePub3/ePub/package.h"
+#include "../ePub3/ePub/library_catalog.h"
+#include "catch.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ePub3;
+
+#define EPUB_PATH "TestData/childrens-literature-20120722.epub"
+
+// the library's constructors are protected; it's designed to be subclassed
+class TestLibrary : public Library
+{
+public:
+    TestLibrary() : Library() {}
+    TestLibrary(const string& path) : Library(path) {}
+};
+
+TEST_CASE("Concurrent library loads should share a single container", "[library]")
+{
+    TestLibrary library;
+    std::vector<ContainerPtr> results(8);
+    std::vector<std::thread> threads;
+    
+    for ( size_t i = 0; i < results.size(); i++ )
+    {
+        threads.emplace_back([&library, &results, i]() {
+            results[i] = library.ContainerAtPath(EPUB_PATH);
+        });
+    }
+    for ( auto& thread : threads )
+        thread.join();
+    
+    REQUIRE(results[0] != nullptr);
+    for ( auto& result : results )
+        REQUIRE(result == results[0]);
+    
+    PackagePtr pkg = results[0]->DefaultPackage();
+    REQUIRE(library.PathForEPubWithUniqueID(pkg->UniqueID()) == EPUB_PATH);
+    REQUIRE(library.PackageWithUniqueID(pkg->UniqueID()) == pkg);
+}
+
+TEST_CASE("Idle library containers should be evicted and reloaded on demand", "[library]")
+{
+    TestLibrary library;
+    library.AddPublicationsInContainerAtPath(EPUB_PATH);
+    
+    string uid;
+    {
+        PackagePtr pkg = library.ContainerAtPath(EPUB_PATH, false)->DefaultPackage();
+        uid = pkg->UniqueID();
+        
+        // still in use, so it stays
+        REQUIRE(library.EvictIdleContainers(Library::Clock::duration::zero()) == 0);
+    }
+    
+    // not yet idle for long enough
+    REQUIRE(library.EvictIdleContainers(std::chrono::hours(1)) == 0);
+    
+    REQUIRE(library.EvictIdleContainers(Library::Clock::duration::zero()) == 1);
+    REQUIRE(library.ContainerAtPath(EPUB_PATH, false) == nullptr);
+    REQUIRE(library.PackageWithUniqueID(uid, false) == nullptr);
+    
+    PackagePtr reloaded = library.PackageWithUniqueID(uid);
+    REQUIRE(reloaded != nullptr);
+    REQUIRE(reloaded->UniqueID() == uid);
+}
+
+TEST_CASE("Library residency limits should unload the least-recently-used containers", "[library]")
+{
+    const char* otherPath = "TestData/widget-figure-gallery-20121022.epub";
+    TestLibrary library;
+    library.SetResidencyLimits(1, 0);
+    
+    REQUIRE(library.ContainerAtPath(EPUB_PATH) != nullptr);
+    REQUIRE(library.ContainerAtPath(otherPath) != nullptr);
+    
+    Library::Statistics stats = library.GetStatistics();
+    REQUIRE(stats.loads == 2);
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.residentContainers == 1);
+    REQUIRE(stats.residentBytes > 0);
+    REQUIRE(library.ContainerAtPath(EPUB_PATH, false) == nullptr);
+    
+    {
+        // transparently reloaded; the other one goes instead
+        ContainerPtr container = library.ContainerAtPath(EPUB_PATH);
+        REQUIRE(container != nullptr);
+        REQUIRE(library.ContainerAtPath(otherPath, false) == nullptr);
+        REQUIRE(library.GetStatistics().residentBytes == container->EstimatedMemoryUsage());
+        
+        // containers in use are never unloaded
+        library.SetResidencyLimits(0, 1);
+        REQUIRE(library.GetStatistics().residentContainers == 1);
+    }
+    
+    REQUIRE(library.EnforceResidencyLimits() == 1);
+    stats = library.GetStatistics();
+    REQUIRE(stats.loads == 3);
+    REQUIRE(stats.evictions == 3);
+    REQUIRE(stats.residentContainers == 0);
+    REQUIRE(stats.residentBytes == 0);
+}
+
+TEST_CASE("Library catalogs should be written and read without opening any container", "[library][catalog]")
+{
+    const char* catalogPath = "library_tests.catalog";
+    const char* otherPath = "TestData/widget-figure-gallery-20121022.epub";
+    const char* thirdPath = "TestData/wasteland-otf-obf-20120118.epub";
+    string uid, otherUID, thirdUID;
+    
+    {
+        TestLibrary library;
+        library.AddPublicationsInContainerAtPath(EPUB_PATH);
+        library.AddPublicationsInContainerAtPath(otherPath);
+        uid = library.ContainerAtPath(EPUB_PATH)->DefaultPackage()->UniqueID();
+        otherUID = library.ContainerAtPath(otherPath)->DefaultPackage()->UniqueID();
+        REQUIRE(library.WriteCatalog(catalogPath));
+    }
+    
+    REQUIRE(LibraryCatalog::IsCatalogFile(catalogPath));
+    REQUIRE_FALSE(LibraryCatalog::IsCatalogFile(EPUB_PATH));
+    
+    {
+        TestLibrary library(catalogPath);
+        REQUIRE(library.Catalog() != nullptr);
+        REQUIRE(library.PathForEPubWithUniqueID(uid) == EPUB_PATH);
+        REQUIRE(library.PathForEPubWithUniqueID(otherUID) == otherPath);
+        REQUIRE(library.PathForEPubWithPackageID(LibraryCatalog::PackageIDForUniqueID(uid.stl_str())) == EPUB_PATH);
+        REQUIRE(library.PathForEPubWithUniqueID("urn:uuid:unknown").empty());
+        REQUIRE(library.GetStatistics().loads == 0);
+        
+        // new publications are journaled into the catalog
+        library.AddPublicationsInContainerAtPath(thirdPath);
+        thirdUID = library.ContainerAtPath(thirdPath)->DefaultPackage()->UniqueID();
+        
+        // loading a catalogued container doesn't journal anything
+        REQUIRE(library.PackageWithUniqueID(uid) != nullptr);
+    }
+    
+    shared_ptr<LibraryCatalog> catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->PathForUniqueID(thirdUID) == thirdPath);
+    REQUIRE(catalog->AllContents().size() == 3);
+    
+    // an interrupted append is ignored
+    {
+        std::ofstream stream(catalogPath, std::ios::out|std::ios::binary|std::ios::app);
+        stream.write("\x40\x00\x00\x00\x01\x02", 6);
+    }
+    catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->PathForUniqueID(thirdUID) == thirdPath);
+    
+    REQUIRE(catalog->Compact());
+    REQUIRE(catalog->PathForUniqueID(thirdUID) == thirdPath);
+    REQUIRE(catalog->PathForUniqueID(uid) == EPUB_PATH);
+    REQUIRE(catalog->AllContents().size() == 3);
+    
+    catalog.reset();
+    std::remove(catalogPath);
+}
+
+TEST_CASE("Library catalog appends should follow the last valid journal record", "[library][catalog]")
+{
+    const char* catalogPath = "library_tests_journal.catalog";
+    LibraryCatalog::Contents contents;
+    contents["books/0.epub"].push_back("urn:isbn:9780000000000");
+    REQUIRE(LibraryCatalog::Write(catalogPath, contents));
+    
+    shared_ptr<LibraryCatalog> catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->Append("books/1.epub", {"urn:isbn:9780000000001"}));
+    REQUIRE(catalog->Append("books/2.epub", {"urn:isbn:9780000000002"}));
+    catalog.reset();
+    
+    // cut the last record short, as a crash partway through an append would
+    std::string bytes;
+    {
+        std::ifstream stream(catalogPath, std::ios::in|std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream stream(catalogPath, std::ios::out|std::ios::binary|std::ios::trunc);
+        stream.write(bytes.data(), bytes.size() - 3);
+    }
+    
+    catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->PathForUniqueID("urn:isbn:9780000000001") == "books/1.epub");
+    REQUIRE(catalog->PathForUniqueID("urn:isbn:9780000000002").empty());
+    REQUIRE(catalog->Append("books/3.epub", {"urn:isbn:9780000000003"}));
+    catalog.reset();
+    
+    catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->PathForUniqueID("urn:isbn:9780000000001") == "books/1.epub");
+    REQUIRE(catalog->PathForUniqueID("urn:isbn:9780000000003") == "books/3.epub");
+    REQUIRE(catalog->AllContents().size() == 3);
+    
+    catalog.reset();
+    std::remove(catalogPath);
+}
+
+TEST_CASE("Library catalogs should compact while other threads use them", "[library][catalog]")
+{
+    const char* catalogPath = "library_tests_compact.catalog";
+    LibraryCatalog::Contents contents;
+    contents["books/0.epub"].push_back("urn:isbn:9780000000000");
+    REQUIRE(LibraryCatalog::Write(catalogPath, contents));
+    shared_ptr<LibraryCatalog> catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    
+    static const int kAppends = 200;
+    bool missing = false;
+    std::thread reader([&]() {
+        for ( int i = 0; i < 2000; i++ )
+        {
+            if ( catalog->PathForUniqueID("urn:isbn:9780000000000") != "books/0.epub" )
+                missing = true;
+        }
+    });
+    std::thread writer([&]() {
+        for ( int i = 1; i <= kAppends; i++ )
+        {
+            std::stringstream path, uid;
+            path << "books/" << i << ".epub";
+            uid << "urn:isbn:" << (9780000000000LL + i);
+            catalog->Append(path.str(), {uid.str()});
+        }
+    });
+    
+    for ( int i = 0; i < 10; i++ )
+        REQUIRE(catalog->Compact());
+    
+    reader.join();
+    writer.join();
+    REQUIRE_FALSE(missing);
+    REQUIRE(catalog->AllContents().size() == size_t(kAppends + 1));
+    
+    // nothing was lost to a compaction
+    REQUIRE(catalog->Compact());
+    catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    REQUIRE(catalog->AllContents().size() == size_t(kAppends + 1));
+    
+    catalog.reset();
+    std::remove(catalogPath);
+}
+
+TEST_CASE("Library catalog hash lookups should find every identifier", "[library][catalog]")
+{
+    const char* catalogPath = "library_tests_large.catalog";
+    LibraryCatalog::Contents contents;
+    for ( int i = 0; i < 5000; i++ )
+    {
+        std::stringstream path, uid;
+        path << "books/" << i << ".epub";
+        uid << "urn:isbn:" << (9780000000000LL + i) << "@2013-06-07T00:00:00Z";
+        contents[path.str()].push_back(uid.str());
+    }
+    
+    REQUIRE(LibraryCatalog::Write(catalogPath, contents));
+    shared_ptr<LibraryCatalog> catalog = LibraryCatalog::Open(catalogPath);
+    REQUIRE(catalog != nullptr);
+    
+    for ( auto& pair : contents )
+    {
+        REQUIRE(catalog->PathForUniqueID(pair.second[0]) == pair.first);
+        REQUIRE(catalog->PathForPackageID(LibraryCatalog::PackageIDForUniqueID(pair.second[0])) == pair.first);
+    }
+    REQUIRE(catalog->PathForUniqueID("urn:isbn:9780000000000").empty());
+    REQUIRE(catalog->PathForPackageID("urn:isbn:0").empty());
+    REQUIRE(catalog->AllContents() == contents);
+    
+    catalog.reset();
+    std::remove(catalogPath);
+}
+
+TEST_CASE("Package IDs containing '@' should still be found", "[library][catalog]")
+{
+    const char* catalogPath = "library_tests_at.catalog";
+    const char* listPath = "library_tests_at.txt";
+    const std::string datedUID("mailto:a@b.com@2013-06-07T00:00:00Z");
+    const std::string undatedUID("mailto:c@d.com");
+    REQUIRE(LibraryCatalog::PackageIDForUniqueID(datedUID) == "mailto:a@b.com");
+    
+    LibraryCatalog::Contents contents;
+    contents["books/a.epub"].push_back(datedUID);
+    contents["books/c.epub"].push_back(undatedUID);
+    REQUIRE(LibraryCatalog::Write(catalogPath, contents));
+    
+    {
+        std::ofstream list(listPath);
+        list << "books/a.epub," << datedUID << "\n";
+    }
+    
+    {
+        TestLibrary library(catalogPath);
+        REQUIRE(library.PathForEPubWithPackageID("mailto:a@b.com") == "books/a.epub");
+        REQUIRE(library.PathForEPubWithPackageID("mailto:c@d.com") == "books/c.epub");
+        REQUIRE(library.PathForEPubWithPackageID("mailto:a").empty());
+    }
+    {
+        TestLibrary library(listPath);
+        REQUIRE(library.PathForEPubWithPackageID("mailto:a@b.com") == "books/a.epub");
+        REQUIRE(library.PathForEPubWithPackageID("mailto:a").empty());
+    }
+    
+    std::remove(catalogPath);
+    std::remove(listPath);
+}
+
+TEST_CASE("Container identifiers should be readable without opening the container", "[library]")
+{
+    const char* paths[] = {
+        "TestData/childrens-literature-20120722.epub",
+        "TestData/cole-voyage-of-life-20120320.epub",
+        "TestData/wasteland-otf-obf-20120118.epub",
+        "TestData/widget-figure-gallery-20121022.epub",
+    };
+    
+    for ( auto path : paths )
+    {
+        ContainerPtr container = Container::OpenContainer(path);
+        Container::PathList uniqueIDs = Container::PackageUniqueIDsAtPath(path);
+        REQUIRE(uniqueIDs.size() == container->Packages().size());
+        for ( size_t i = 0; i < uniqueIDs.size(); i++ )
+        {
+            REQUIRE(uniqueIDs[i] == container->Packages()[i]->UniqueID());
+        }
+    }
+    
+    REQUIRE(Container::PackageUniqueIDsAtPath("TestData/no-such-file.epub").empty());
+}
+
+TEST_CASE("Bulk ingestion should register every publication in a directory", "[library]")
+{
+    TestLibrary library;
+    std::vector<Library::IngestionProgress> reports;
+    Library::IngestionProgress result = library.AddPublicationsInDirectory("TestData", [&](const Library::IngestionProgress& progress) {
+        reports.push_back(progress);
+    }, 4);
+    
+    REQUIRE(result.total == 6);
+    REQUIRE(result.completed == 6);
+    size_t accounted = result.added + result.failed;
+    REQUIRE(accounted >= 5);
+    REQUIRE_FALSE(reports.empty());
+    REQUIRE(reports.back().completed == 6);
+    for ( size_t i = 1; i < reports.size(); i++ )
+        REQUIRE(reports[i].completed >= reports[i-1].completed);
+    
+    // nothing was loaded to do this
+    REQUIRE(library.GetStatistics().loads == 0);
+    
+    string uid = Container::PackageUniqueIDsAtPath(EPUB_PATH)[0];
+    REQUIRE(library.PathForEPubWithUniqueID(uid).find("childrens-literature") != string::npos);
+    REQUIRE(library.PackageWithUniqueID(uid) != nullptr);
+    
+    // nothing new the second time around
+    result = library.AddPublicationsAtPaths({EPUB_PATH, "TestData/no-such-file.epub"});
+    REQUIRE(result.added == 0);
+    REQUIRE(result.failed == 1);
+}
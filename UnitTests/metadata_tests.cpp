@@ -112,6 +112,22 @@ TEST_CASE("Author details should be accessible in different ways", "")
     REQUIRE(pkg->Authors() == "Charles Madison Curry and Erle Elsworth Clippinger");
 }
 
+TEST_CASE("Attribution lists should share storage with the metadata", "")
+{
+    PackagePtr pkg = GetContainer()->Packages()[0];
+    Package::SharedAttributionList authorNames = pkg->SharedAuthorNames(false);
+    REQUIRE(authorNames.size() == 2);
+    
+    auto creators = pkg->PropertiesMatching(DCType::Creator);
+    REQUIRE(creators.size() == authorNames.size());
+    for ( size_t i = 0; i < creators.size(); i++ )
+    {
+        REQUIRE(authorNames[i].SharesStorageWith(creators[i]->SharedValue()));
+        REQUIRE(authorNames[i] == creators[i]->Value());
+    }
+    REQUIRE(pkg->AuthorNames(false) == Package::AttributionList(authorNames.begin(), authorNames.end()));
+}
+
 TEST_CASE("Subjects should be correct", "")
 {
     Package::StringList expected({"Children -- Books and reading", "Children's literature -- Study and teaching"});
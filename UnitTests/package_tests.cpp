@@ -986,6 +986,71 @@ TEST_CASE("Package should have multiple manifest items, and they should be index
     REQUIRE(fetched == randomItem);
 }
 
+TEST_CASE("Manifest items should be indexable by path", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+
+    for ( auto& pair : pkg->Manifest() )
+    {
+        ManifestItemPtr item = pair.second;
+        REQUIRE(item->AbsolutePath() == _Str(pkg->BasePath(), item->Href()));
+        REQUIRE(pkg->ManifestItemAtPath(item->AbsolutePath()) == item);
+        REQUIRE(pkg->ManifestItemForHref(item->Href()) == item);
+    }
+
+    REQUIRE(pkg->ManifestItemAtPath("/EPUB/./css/../images/cover.png") == pkg->ManifestItemWithID("cover-img"));
+    REQUIRE(pkg->ManifestItemAtPath("EPUB/package.opf") == nullptr);
+}
+
+TEST_CASE("Links between manifest items should resolve relative to the referring item", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+
+    ManifestItemPtr css = pkg->ManifestItemWithID("css");
+    ManifestItemPtr cover = pkg->ManifestItemWithID("cover");
+    ManifestItemPtr image = pkg->ManifestItemWithID("cover-img");
+    REQUIRE(css != nullptr);
+    REQUIRE(cover != nullptr);
+    REQUIRE(image != nullptr);
+
+    // twice each, so the second lookup comes from the cache
+    for ( int i = 0; i < 2; i++ )
+    {
+        REQUIRE(pkg->ManifestItemForHref("../images/cover.png", css) == image);
+        REQUIRE(pkg->ManifestItemForHref("images/cover.png?size=large", cover) == image);
+        REQUIRE(pkg->ManifestItemForHref("/EPUB/s04.xhtml#pgepubid00001", css) == pkg->ManifestItemWithID("s04"));
+        REQUIRE(pkg->ManifestItemForHref("#top", cover) == cover);
+        REQUIRE(pkg->ManifestItemForHref("../images/cover.png", cover) == nullptr);
+        REQUIRE(pkg->ManifestItemForHref("http://example.com/images/cover.png", cover) == nullptr);
+    }
+
+    // links which don't resolve aren't remembered, and those which do are bounded
+    size_t before = pkg->EstimatedMemoryUsage();
+    for ( int i = 0; i < 1000; i++ )
+    {
+        REQUIRE(pkg->ManifestItemForHref(_Str("missing-", i, ".png"), cover) == nullptr);
+    }
+    REQUIRE(pkg->EstimatedMemoryUsage() == before);
+    
+    static const int kLinks = 100000;
+    int mismatches = 0;
+    for ( int i = 0; i < kLinks; i++ )
+    {
+        if ( pkg->ManifestItemForHref(_Str("images/cover.png?n=", i), cover) != image )
+            mismatches++;
+    }
+    REQUIRE(mismatches == 0);
+    size_t grown = pkg->EstimatedMemoryUsage() - before;
+    REQUIRE(grown > 0);
+    REQUIRE(grown < kLinks * sizeof(void*));
+
+    REQUIRE(PackageBase::ResolvePath("EPUB/text/ch1.xhtml", "../images/a%20b.png") == "EPUB/images/a b.png");
+    REQUIRE(PackageBase::ResolvePath("EPUB/", "/META-INF/container.xml") == "META-INF/container.xml");
+    REQUIRE(PackageBase::ResolvePath("EPUB/", "mailto:someone@example.com").empty());
+}
+
 TEST_CASE("Package should have multiple spine items", "")
 {
     ContainerPtr c = Container::OpenContainer(EPUB_PATH);
@@ -1030,6 +1095,43 @@ TEST_CASE("Package should be able to create and resolve basic CFIs", "")
     REQUIRE(remainder == fragment);
 }
 
+TEST_CASE("Package should resolve batches of CFIs with per-item errors", "")
+{
+    ContainerPtr c = Container::OpenContainer(EPUB_PATH);
+    PackagePtr pkg = c->DefaultPackage();
+    auto first = pkg->SpineItemAt(0);
+    auto second = pkg->SpineItemAt(1);
+    
+    std::vector<CFI> cfis;
+    cfis.push_back(pkg->CFIForSpineItem(second) + CFI("/4/2/1:3"));
+    cfis.push_back(CFI(_Str("/", pkg->SpineCFIIndex(), "/2!")));
+    cfis.push_back(CFI(_Str("/", pkg->SpineCFIIndex(), "/2[", second->Idref(), "]!/4")));  // corrected by idref
+    cfis.push_back(CFI("/2/2!"));
+    cfis.push_back(CFI(_Str("/", pkg->SpineCFIIndex(), "/20000!")));
+    cfis.push_back(CFI(_Str("/", pkg->SpineCFIIndex(), "/2[no-such-idref]!")));
+    cfis.push_back(CFI(_Str("/", pkg->SpineCFIIndex(), "/4")));
+    
+    auto results = pkg->ManifestItemsForCFIs(cfis);
+    REQUIRE(results.size() == cfis.size());
+    
+    REQUIRE(results[0].error == EPUBError::NoError);
+    REQUIRE(results[0].item == second->ManifestItem());
+    REQUIRE(results[0].remainingCFI == CFI("/4/2/1:3"));
+    
+    REQUIRE(results[1].error == EPUBError::NoError);
+    REQUIRE(results[1].item == first->ManifestItem());
+    REQUIRE(results[1].remainingCFI.Empty());
+    
+    REQUIRE(results[2].item == second->ManifestItem());
+    REQUIRE(results[2].remainingCFI == CFI("/4"));
+    
+    REQUIRE(results[3].error == EPUBError::CFIInvalidSpineLocation);
+    REQUIRE(results[4].error == EPUBError::CFIStepOutOfBounds);
+    REQUIRE(results[5].error == EPUBError::CFIIndirectionTargetMissing);
+    REQUIRE(results[6].error == EPUBError::CFIUnexpectedComponent);
+    REQUIRE(results[6].item == nullptr);
+}
+
 TEST_CASE("Package should parse bindings correctly.", "")
 {
     ContainerPtr c = Container::OpenContainer(BINDINGS_EPUB_PATH);
@@ -0,0 +1,287 @@
+//
+//  run_loop_tests.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "../ePub3/utilities/run_loop.h"
+#include "catch.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace ePub3;
+
+// the public Timer constructors only accept durations in whole seconds
+class TestTimer : public RunLoop::Timer
+{
+public:
+    TestTimer(Clock::time_point fireDate, Clock::duration interval, TimerFn fn) : Timer(fireDate, interval, fn) {}
+};
+
+static TestTimer* MakeTimer(std::chrono::milliseconds fromNow, RunLoop::Timer::TimerFn fn, std::chrono::milliseconds interval=std::chrono::milliseconds(0))
+{
+    return new TestTimer(RunLoop::Timer::Clock::now() + fromNow, interval, fn);
+}
+
+// runs the loop once, without waiting
+static RunLoop::ExitReason Poll(RunLoop* rl)
+{
+    return rl->Run(false, std::chrono::seconds(0));
+}
+
+TEST_CASE("Timers should fire in order of their fire dates", "")
+{
+    using std::chrono::milliseconds;
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    std::vector<int> fired;
+
+    TestTimer* timers[] = {
+        MakeTimer(milliseconds(-1), [&](RunLoop::Timer&) { fired.push_back(1); }),
+        MakeTimer(milliseconds(-3), [&](RunLoop::Timer&) { fired.push_back(3); }),
+        MakeTimer(milliseconds(-2), [&](RunLoop::Timer&) { fired.push_back(2); }),
+        MakeTimer(milliseconds(60000), [&](RunLoop::Timer&) { fired.push_back(0); }),
+    };
+    for ( auto timer : timers )
+    {
+        rl->AddTimer(timer);
+        REQUIRE(rl->ContainsTimer(timer));
+    }
+
+    Poll(rl);
+    REQUIRE(fired == (std::vector<int>{3, 2, 1}));
+
+    // non-repeating timers are removed once they've fired
+    Poll(rl);
+    REQUIRE(fired.size() == 3);
+    REQUIRE(rl->ContainsTimer(timers[3]));
+
+    rl->RemoveTimer(timers[3]);
+}
+
+TEST_CASE("Rescheduled timers should fire at their new date", "")
+{
+    using std::chrono::milliseconds;
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    int early = 0, late = 0, repeats = 0;
+
+    TestTimer* first = MakeTimer(milliseconds(60000), [&](RunLoop::Timer&) { early++; });
+    TestTimer* second = MakeTimer(milliseconds(-1), [&](RunLoop::Timer&) { late++; });
+    TestTimer* repeating = MakeTimer(milliseconds(-1), [&](RunLoop::Timer&) { repeats++; }, milliseconds(60000));
+    rl->AddTimer(first);
+    rl->AddTimer(second);
+    rl->AddTimer(repeating);
+
+    RunLoop::Timer::Clock::time_point when = RunLoop::Timer::Clock::now() - milliseconds(5);
+    first->SetNextFireDate(when);
+    when += std::chrono::hours(1);
+    second->SetNextFireDate(when);
+
+    Poll(rl);
+    REQUIRE(early == 1);
+    REQUIRE(late == 0);
+    REQUIRE(repeats == 1);
+
+    // the repeating timer has been re-armed for a minute from now
+    Poll(rl);
+    REQUIRE(repeats == 1);
+    REQUIRE(rl->ContainsTimer(repeating));
+
+    // the cancelled repeating timer is next due, so it's discarded by the next pass
+    second->Cancel();
+    repeating->Cancel();
+    Poll(rl);
+    REQUIRE(late == 0);
+    REQUIRE(repeats == 1);
+    rl->RemoveTimer(second);
+}
+
+TEST_CASE("Signalled event sources should fire once per signal", "")
+{
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    int a = 0, b = 0;
+
+    RunLoop::EventSource* sourceA = new RunLoop::EventSource([&](RunLoop::EventSource&) { a++; });
+    RunLoop::EventSource* sourceB = new RunLoop::EventSource([&](RunLoop::EventSource&) { b++; });
+    rl->AddEventSource(sourceA);
+    rl->AddEventSource(sourceB);
+    REQUIRE(rl->ContainsEventSource(sourceA));
+
+    sourceB->Signal();
+    sourceB->Signal();
+    Poll(rl);
+    REQUIRE(a == 0);
+    REQUIRE(b == 1);
+
+    Poll(rl);
+    REQUIRE(b == 1);
+
+    sourceA->Signal();
+    sourceB->Signal();
+    REQUIRE(rl->Run(true, std::chrono::seconds(0)) == RunLoop::ExitReason::RunHandledSource);
+    int handled = a + b;
+    REQUIRE(handled == 2);
+    REQUIRE(rl->Run(true, std::chrono::seconds(0)) == RunLoop::ExitReason::RunHandledSource);
+    REQUIRE(a == 1);
+    REQUIRE(b == 2);
+
+    rl->RemoveEventSource(sourceA);
+    rl->RemoveEventSource(sourceB);
+    REQUIRE_FALSE(rl->ContainsEventSource(sourceA));
+}
+
+TEST_CASE("Signalling a source from another thread should wake a waiting run loop", "")
+{
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    int fired = 0;
+
+    RunLoop::EventSource* source = new RunLoop::EventSource([&](RunLoop::EventSource&) { fired++; });
+    rl->AddEventSource(source);
+
+    std::thread signaller([source]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        source->Signal();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    RunLoop::ExitReason reason = rl->Run(true, std::chrono::seconds(10));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    signaller.join();
+
+    REQUIRE(reason == RunLoop::ExitReason::RunHandledSource);
+    REQUIRE(fired == 1);
+    REQUIRE(elapsed < std::chrono::seconds(5));
+
+    rl->RemoveEventSource(source);
+}
+
+TEST_CASE("Functions performed from other threads should run in order on the run loop", "")
+{
+    static const int kThreads = 4;
+    static const int kPerThread = 1000;     // enough to overflow the queue's ring
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    std::thread::id loopThread = std::this_thread::get_id();
+
+    std::vector<int> lastSeen(kThreads, -1);
+    int total = 0, outOfOrder = 0, wrongThread = 0;
+
+    std::vector<std::thread> posters;
+    for ( int t = 0; t < kThreads; t++ )
+    {
+        posters.emplace_back([&, t]() {
+            for ( int i = 0; i < kPerThread; i++ )
+            {
+                rl->PerformFunction([&, t, i]() {
+                    if ( lastSeen[t] != i - 1 )
+                        outOfOrder++;
+                    if ( std::this_thread::get_id() != loopThread )
+                        wrongThread++;
+                    lastSeen[t] = i;
+                    total++;
+                });
+            }
+        });
+    }
+
+    for ( int i = 0; i < 1000 && total < kThreads * kPerThread; i++ )
+    {
+        rl->Run(true, std::chrono::milliseconds(100));
+    }
+    for ( auto& poster : posters )
+    {
+        poster.join();
+    }
+
+    REQUIRE(total == kThreads * kPerThread);
+    REQUIRE(outOfOrder == 0);
+    REQUIRE(wrongThread == 0);
+}
+
+TEST_CASE("Cross-thread PerformFunction throughput", "[runloop][benchmark][hide]")
+{
+    static const int kCount = 200000;
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    int performed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread poster([&]() {
+        for ( int i = 0; i < kCount; i++ )
+            rl->PerformFunction([&performed]() { performed++; });
+    });
+
+    while ( performed < kCount )
+    {
+        rl->Run(true, std::chrono::milliseconds(100));
+    }
+    poster.join();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(performed == kCount);
+    WARN("Performed " << kCount << " functions posted from another thread in " << (elapsed.count() / 1000) << "ms");
+}
+
+TEST_CASE("Run loop iteration cost with many timers and sources", "[runloop][benchmark][hide]")
+{
+    using std::chrono::milliseconds;
+    static const int kCount = 10000;
+    static const int kIterations = 2000;
+    static const int kSignalsPerIteration = 10;
+
+    RunLoop* rl = RunLoop::CurrentRunLoop();
+    int timersFired = 0, sourcesFired = 0;
+
+    std::vector<RunLoop::Timer*> timers;
+    std::vector<RunLoop::EventSource*> sources;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( int i = 0; i < kCount; i++ )
+    {
+        // all in the future, so none fire during the run
+        RunLoop::Timer* timer = MakeTimer(milliseconds(60000 + (i * 7919) % kCount), [&](RunLoop::Timer&) { timersFired++; });
+        timers.push_back(timer);
+        rl->AddTimer(timer);
+
+        RunLoop::EventSource* source = new RunLoop::EventSource([&](RunLoop::EventSource&) { sourcesFired++; });
+        sources.push_back(source);
+        rl->AddEventSource(source);
+    }
+    auto addTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for ( int i = 0; i < kIterations; i++ )
+    {
+        for ( int j = 0; j < kSignalsPerIteration; j++ )
+            sources[(i * kSignalsPerIteration + j) * 31 % kCount]->Signal();
+        Poll(rl);
+    }
+    auto runTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(timersFired == 0);
+    REQUIRE(sourcesFired == kIterations * kSignalsPerIteration);
+
+    WARN("Registered " << kCount << " timers and sources in " << (addTime.count() / 1000) << "ms; "
+         << kIterations << " iterations took " << (runTime.count() / 1000) << "ms ("
+         << (runTime.count() / kIterations) << "us each)");
+
+    for ( int i = 0; i < kCount; i++ )
+    {
+        rl->RemoveTimer(timers[i]);
+        rl->RemoveEventSource(sources[i]);
+    }
+}
@@ -20,7 +20,10 @@
 //
 
 #include "../ePub3/utilities/utfstring.h"
+#include "../ePub3/utilities/utf_transcode.h"
+#include "../ePub3/utilities/shared_string.h"
 #include "catch.hpp"
+#include <chrono>
 
 using ePub3::string;
 
@@ -69,3 +72,232 @@ TEST_CASE("string charset searching", "find_first_of with a set containing utf-8
     REQUIRE_THROWS_AS(str.find_first_of(str.stl_str().substr(0, 2)), string::InvalidUTF8Sequence);
     REQUIRE(str.find_first_of("#$%") == string::npos);
 }
+
+TEST_CASE("string positional access", "Long strings should report the same positions whether or not their code-point index is in use")
+{
+    // long enough to be indexed, with multibyte characters on either side of several index strides
+    string str;
+    for ( int i = 0; i < 100; i++ )
+        str.append(u8"ab…c\U0001F600");
+    
+    REQUIRE(str.size() == 500);
+    REQUIRE(str.at(0) == char32_t('a'));
+    REQUIRE(str.at(2) == char32_t(0x2026));
+    REQUIRE(str.at(64) == str.at(4));
+    REQUIRE(str.at(499) == char32_t(0x1F600));
+    REQUIRE(str.substr(254, 3) == string(u8"\U0001F600ab"));
+    REQUIRE(str.find(u8"c\U0001F600", 300) == 303);
+    
+    // mutations must discard the index
+    str.erase(0, 2);
+    REQUIRE(str.size() == 498);
+    REQUIRE(str.at(0) == char32_t(0x2026));
+    str.insert(0, u8"é");
+    REQUIRE(str.size() == 499);
+    REQUIRE(str.at(1) == char32_t(0x2026));
+    str.resize(65);
+    REQUIRE(str.size() == 65);
+    REQUIRE(str.at(63) == char32_t(0x1F600));
+    REQUIRE(str.at(64) == char32_t('a'));
+    
+    string copy(str);
+    copy.append(100, char32_t(0x2026));
+    REQUIRE(str.size() == 65);
+    REQUIRE(copy.size() == 165);
+    
+    string ascii(200, 'x');
+    REQUIRE(ascii.size() == 200);
+    ascii.replace(199, 1, u8"…");
+    REQUIRE(ascii.size() == 200);
+    REQUIRE(ascii.at(199) == char32_t(0x2026));
+    REQUIRE(ascii.utf8_size() == 202);
+}
+
+TEST_CASE("UTF-8 validation", "Malformed UTF-8 should be rejected wherever it appears, including after a run of ASCII")
+{
+    std::string ascii(40, 'a');
+    REQUIRE(ePub3::ValidateUTF8(ascii.data(), ascii.size()));
+    REQUIRE(ePub3::ValidateUTF8(u8"caf\u00E9 \u2026 \U0001F600", 14));
+    
+    static const char* const kInvalid[] = {
+        "\x80",                // stray continuation byte
+        "\xC0\xAF",            // overlong
+        "\xE0\x80\xAF",        // overlong
+        "\xED\xA0\x80",        // encoded surrogate
+        "\xF4\x90\x80\x80",    // beyond U+10FFFF
+        "\xE2\x80",            // truncated
+    };
+    for ( auto bad : kInvalid )
+    {
+        std::string str = ascii + bad + ascii;
+        SCOPED_INFO("Checking " << str);
+        REQUIRE_FALSE(ePub3::ValidateUTF8(str.data(), str.size()));
+    }
+}
+
+TEST_CASE("UTF-8 code point counting", "Vector counting should match the string's own idea of its length")
+{
+    string str;
+    for ( int i = 0; i < 37; i++ )
+        str.append(u8"x\u00E9y\u2026z\U0001F600");
+    
+    REQUIRE(ePub3::CountUTF8CodePoints(str.data(), str.utf8_size()) == str.size());
+    REQUIRE(str.size() == 37*6);
+    
+    size_t offset = ePub3::UTF8OffsetOfCodePoint(str.data(), str.utf8_size(), 6*20+3);
+    REQUIRE(offset == 12*20+4);
+    REQUIRE(ePub3::UTF8OffsetOfCodePoint(str.data(), str.utf8_size(), str.size()) == str.utf8_size());
+    REQUIRE(ePub3::ASCIIPrefixLength(str.data(), str.utf8_size()) == 1);
+}
+
+TEST_CASE("UTF-16 transcoding", "Round trips through UTF-16 should be lossless, and malformed input should be reported")
+{
+    std::u16string utf16;
+    for ( int i = 0; i < 50; i++ )
+        utf16 += u"Chapter \u00E9\u2026\U0001F600 ";
+    
+    string str(utf16.c_str(), utf16.size());
+    REQUIRE(str.utf16string() == utf16);
+    REQUIRE(str.size() == 50*12);
+    
+    string appended(u"abc");
+    appended.append(utf16.c_str(), utf16.size());
+    REQUIRE(appended.utf16string() == u"abc" + utf16);
+    
+    char16_t unpaired[] = { u'a', 0xD800, u'b' };
+    char out[9];
+    REQUIRE(ePub3::TranscodeUTF16ToUTF8(unpaired, 3, out) == ePub3::TranscodeError);
+    
+    std::vector<string> strings = { string(u8"title"), string(), string(u8"\u65E5\u672C\u8A9E"), str };
+    std::u16string buffer;
+    std::vector<size_t> offsets;
+    REQUIRE(ePub3::TranscodeToUTF16(strings, buffer, offsets));
+    REQUIRE(offsets.size() == 5);
+    REQUIRE(buffer.substr(offsets[0], offsets[1]-offsets[0]) == u"title");
+    REQUIRE(offsets[1] == offsets[2]);
+    REQUIRE(buffer.substr(offsets[2], offsets[3]-offsets[2]) == u"\u65E5\u672C\u8A9E");
+    REQUIRE(buffer.substr(offsets[3]) == utf16);
+    
+    strings.push_back(string("\xC0\xAF"));
+    REQUIRE_FALSE(ePub3::TranscodeToUTF16(strings, buffer, offsets));
+    REQUIRE(offsets.empty());
+}
+
+TEST_CASE("shared strings", "Copies of a SharedString should share its storage")
+{
+    using ePub3::SharedString;
+    
+    SharedString empty;
+    REQUIRE(empty.empty());
+    REQUIRE_FALSE(empty.IsShared());
+    REQUIRE(SharedString(static_cast<const xmlChar*>(nullptr)).empty());
+    
+    SharedString small("en-US");
+    REQUIRE_FALSE(small.IsShared());
+    SharedString smallCopy(small);
+    REQUIRE(smallCopy == small);
+    REQUIRE(smallCopy == "en-US");
+    REQUIRE(smallCopy.c_str() != small.c_str());
+    
+    string value(u8"Children\u2019s Literature: A Textbook of Sources");
+    SharedString large(value);
+    REQUIRE(large.IsShared());
+    REQUIRE(large == value);
+    REQUIRE(value == large);
+    REQUIRE(large.size() == value.size());
+    REQUIRE(large.utf8_size() == value.utf8_size());
+    
+    SharedString largeCopy(large);
+    REQUIRE(largeCopy.SharesStorageWith(large));
+    REQUIRE(largeCopy.c_str() == large.c_str());
+    
+    ePub3::SharedStringList list(3, large);
+    for ( auto& item : list )
+    {
+        REQUIRE(item.SharesStorageWith(large));
+    }
+    
+    SharedString moved(std::move(largeCopy));
+    REQUIRE(moved.SharesStorageWith(large));
+    REQUIRE_FALSE(largeCopy.IsShared());
+    REQUIRE(largeCopy.empty());
+    
+    // the value outlives the original
+    const char* bytes = large.c_str();
+    large = small;
+    REQUIRE(large == small);
+    REQUIRE(moved.c_str() == bytes);
+    REQUIRE(moved == value);
+    
+    // ordering matches that of the values
+    REQUIRE(SharedString("abc") < SharedString("abd"));
+    REQUIRE_FALSE(moved < moved);
+    REQUIRE(moved.compare(SharedString(value)) == 0);
+}
+
+TEST_CASE("UTF-16 transcoding throughput", "[string][benchmark][hide]")
+{
+    static const size_t kIterations = 20000;
+    
+    string source;
+    for ( int i = 0; i < 40; i++ )
+        source.append(u8"The quick brown fox \u2014 jumps over the lazy dog. ");
+    std::string utf8 = source.stl_str();
+    std::u16string utf16 = source.utf16string();
+    
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+    {
+        std::u16string converted;
+        utf8::utf8to16(utf8.begin(), utf8.end(), std::back_inserter(converted));
+        total += converted.size();
+    }
+    auto iterative = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+        total -= source.utf16string().size();
+    auto vector = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    REQUIRE(total == 0);
+    
+    WARN("UTF-8 to UTF-16, " << kIterations << " x " << utf8.size() << " bytes: utf8-cpp "
+         << (iterative.count() / 1000) << "ms, kernels " << (vector.count() / 1000) << "ms");
+    
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+    {
+        std::string converted;
+        utf8::utf16to8(utf16.begin(), utf16.end(), std::back_inserter(converted));
+        total += converted.size();
+    }
+    iterative = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+        total -= string(utf16.c_str(), utf16.size()).utf8_size();
+    vector = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    REQUIRE(total == 0);
+    
+    WARN("UTF-16 to UTF-8, " << kIterations << " x " << utf16.size() << " units: utf8-cpp "
+         << (iterative.count() / 1000) << "ms, kernels " << (vector.count() / 1000) << "ms");
+    
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+    {
+        size_t count = 0;
+        for ( auto pos = utf8.begin(); pos < utf8.end(); count++ )
+            pos += UTF8CharLen(*pos);
+        total += count;
+    }
+    iterative = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < kIterations; i++ )
+        total -= ePub3::CountUTF8CodePoints(utf8.data(), utf8.size());
+    vector = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    REQUIRE(total == 0);
+    
+    WARN("Code point counting, " << kIterations << " x " << utf8.size() << " bytes: by lead byte "
+         << (iterative.count() / 1000) << "ms, kernels " << (vector.count() / 1000) << "ms");
+}
@@ -234,6 +234,7 @@ bool IDNToASCII(const char16* src, int src_len, CanonOutputW* output) {
     if ( src_len > output->capacity() )
         output->Resize(src_len);
     string16::traits_type::copy(output->data(), src, src_len);
+    output->set_length(src_len);
 #endif
     return true;
 }
@@ -272,6 +273,7 @@ bool IDNToUnicode(const char16* src, int src_len, CanonOutputW* output)
     if ( src_len > output->capacity() )
         output->Resize(src_len);
     string16::traits_type::copy(output->data(), src, src_len);
+    output->set_length(src_len);
 #endif
     return true;
 }
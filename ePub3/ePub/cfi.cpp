@@ -22,6 +22,9 @@
 #include "cfi.h"
 #include <ePub3/utilities/error_handler.h>
 #include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 EPUB3_BEGIN_NAMESPACE
 
@@ -30,6 +33,7 @@ CFI::CFI(const CFI& base, const CFI& start, const CFI& end) : _components(base._
 }
 CFI::CFI(const string& str) : _components(), _rangeStart(), _rangeEnd(), _options(0)
 {
+    ErrorLocation location("CFI");
     if ( CompileCFI(str) == false )
         HandleError(EPUBError::CFIParseFailed, _Str("Invalid CFI string: ", str.stl_str()));
 }
@@ -213,98 +217,94 @@ void CFI::AppendComponents(std::stringstream& builder, ComponentList::const_iter
         ++pos;
     }
 }
-CFI::StringList CFI::CFIComponentStrings(const string &cfi, const string& delimiter)
+const char* CFI::FindDelimiter(const char* pos, const char* end, char delimiter)
 {
-    CFI::StringList components;
-    string breaks = delimiter + "[";
-    string tmp;
-    string::size_type pos = 0, loc = 0;
-    
-    while ( pos < cfi.size() )
+    for ( ; pos != end; ++pos )
     {
-        loc = cfi.find_first_of(breaks, pos);
-        if ( loc > pos )
+        if ( *pos == delimiter )
+            return pos;
+        
+        if ( *pos == '[' )
         {
-            if ( loc == string::npos )
-            {
-                tmp.append(cfi, pos, cfi.size()-pos);
-                if ( !tmp.empty() )
-                    components.push_back(tmp);
-                tmp.clear();
-                break;
-            }
-            else
-            {
-                tmp.append(cfi, pos, loc-pos);
-            }
-            pos = loc;
+            // skip the qualifier, which may contain delimiter characters
+            pos = std::find(pos, end, ']');
+            if ( pos == end )
+                return nullptr;
         }
-        
-        if ( cfi[loc] == '[' )
+    }
+    
+    return end;
+}
+size_t CFI::RangedCFIComponents(Span cfi, Span pieces[3])
+{
+    size_t count = 0;
+    const char* pos = cfi.begin;
+    
+    while ( pos != cfi.end )
+    {
+        const char* loc = FindDelimiter(pos, cfi.end, ',');
+        if ( loc == nullptr )
         {
-            loc = cfi.find_first_of(']', loc);
-            if ( loc == string::npos )
-            {
-                HandleError(EPUBError::CFIParseFailed, _Str("CFI '", cfi, "' has an unterminated qualifier"));
-            }
-            
-            ++loc;
-            tmp.append(cfi, pos, loc-pos);
+            HandleError(EPUBError::CFIParseFailed, _Str("CFI '", std::string(cfi.begin, cfi.end), "' has an unterminated qualifier"));
+            loc = cfi.end;
         }
-        else if ( cfi.find(delimiter, loc) == loc )
+        
+        if ( loc != pos )
         {
-            // delimiter found, push the current string
-            if ( !tmp.empty() )
-                components.push_back(tmp);
-            tmp.clear();
-            
-            if ( loc == string::npos )
-                break;
-            loc++;
+            if ( count < 3 )
+                pieces[count] = Span(pos, loc);
+            ++count;
         }
         
-        pos = loc;
+        if ( loc == cfi.end )
+            break;
+        pos = loc + 1;
     }
     
-    if ( !tmp.empty() )
-        components.push_back(tmp);
-    
-    return components;
+    return count;
 }
 bool CFI::CompileCFI(const string &str)
 {
+    // work directly on the UTF-8 bytes: nothing is copied until a component's
+    // qualifiers are stored
+    Span cfi(str.c_str(), str.c_str() + str.utf8_size());
+    
     // strip the 'epubcfi(...)' wrapping
-    string cfi(str);
-    if ( str.find("epubcfi(") == 0 )
+    static const char kWrapper[] = "epubcfi(";
+    static const size_t kWrapperLen = sizeof(kWrapper) - 1;
+    if ( cfi.size() >= kWrapperLen && std::memcmp(cfi.begin, kWrapper, kWrapperLen) == 0 )
     {
-        cfi = cfi.substr(8, (str.size()-1)-8);
+        cfi.begin += kWrapperLen;
+        if ( !cfi.empty() )
+            --cfi.end;      // the closing parenthesis
     }
-    else if ( str.size() == 0 )
+    else if ( cfi.empty() )
     {
         HandleError(EPUBError::CFIParseFailed, "Empty CFI string");
         return false;
     }
-    else if ( str[0] != '/' )
+    else if ( *cfi.begin != '/' )
     {
         HandleError(EPUBError::CFINonSlashStartCharacter);
     }
     
-    StringList rangePieces = RangedCFIComponents(cfi);
-    if ( rangePieces.size() != 1 && rangePieces.size() != 3 )
+    Span rangePieces[3];
+    size_t numPieces = RangedCFIComponents(cfi, rangePieces);
+    if ( numPieces != 1 && numPieces != 3 )
     {
-        HandleError(EPUBError::CFIRangeComponentCountInvalid, _Str("Expected 1 or 3 range components, got ", rangePieces.size()));
-        if ( rangePieces.size() == 0 )
+        HandleError(EPUBError::CFIRangeComponentCountInvalid, _Str("Expected 1 or 3 range components, got ", numPieces));
+        if ( numPieces == 0 )
             return false;
     }
     
-    if ( CompileComponentsToList(CFIComponentStrings(rangePieces[0]), &_components) == false )
+    if ( CompileComponentsToList(rangePieces[0], &_components) == false )
         return false;
     
-    if ( rangePieces.size() >= 3 )
+    if ( numPieces >= 3 )
     {
-        if ( CompileComponentsToList(CFIComponentStrings(rangePieces[1]), &_rangeStart) == false )
+        if ( CompileComponentsToList(rangePieces[1], &_rangeStart) == false )
             return false;
-        if ( CompileComponentsToList(CFIComponentStrings(rangePieces[2]), &_rangeEnd) == false )
+        if ( CompileComponentsToList(rangePieces[2], &_rangeEnd) == false )
             return false;
         
         // now sanity-check the range delimiters:
@@ -332,9 +332,9 @@ bool CFI::CompileCFI(const string &str)
         }
         
         // where the delimiters' component ranges overlap, start must be <= end
-        auto maxsz = std::max(_rangeStart.size(), _rangeEnd.size());
+        auto minsz = std::min(_rangeStart.size(), _rangeEnd.size());
         bool inequalNodeIndexFound = false;
-        for ( decltype(maxsz) i = 0; i < maxsz; i++ )
+        for ( decltype(minsz) i = 0; i < minsz; i++ )
         {
             if ( _rangeStart[i].nodeIndex > _rangeEnd[i].nodeIndex )
             {
@@ -368,13 +368,26 @@ bool CFI::CompileCFI(const string &str)
     
     return true;
 }
-bool CFI::CompileComponentsToList(const StringList &strings, ComponentList *list)
+bool CFI::CompileComponentsToList(Span str, ComponentList *list)
 {
     try
     {
-        for ( auto str : strings )
+        const char* pos = str.begin;
+        while ( pos != str.end )
         {
-            list->emplace_back(str);
+            const char* loc = FindDelimiter(pos, str.end, '/');
+            if ( loc == nullptr )
+            {
+                HandleError(EPUBError::CFIParseFailed, _Str("CFI '", std::string(str.begin, str.end), "' has an unterminated qualifier"));
+                return false;
+            }
+            
+            if ( loc != pos )
+                list->emplace_back(pos, loc);
+            
+            if ( loc == str.end )
+                break;
+            pos = loc + 1;
         }
     }
     catch (const epub_spec_error& exc)
@@ -394,87 +407,156 @@ bool CFI::CompileComponentsToList(const StringList &strings, ComponentList *list
 #pragma mark - CFI Component
 #endif
 
+// Reads an unsigned decimal integer, advancing `pos` past it.
+static bool _ParseInteger(const char*& pos, const char* end, uint32_t& result)
+{
+    const char* start = pos;
+    uint64_t value = 0;
+    for ( ; pos != end && *pos >= '0' && *pos <= '9'; ++pos )
+    {
+        value = (value * 10) + static_cast<uint64_t>(*pos - '0');
+        if ( value > std::numeric_limits<uint32_t>::max() )
+            return false;
+    }
+    
+    if ( pos == start )
+        return false;
+    
+    result = static_cast<uint32_t>(value);
+    return true;
+}
+
+// Reads a decimal number of the form [-]digits[.digits], advancing `pos` past it.
+static bool _ParseNumber(const char*& pos, const char* end, float& result)
+{
+    static const double kPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+    };
+    static const size_t kMaxDigits = sizeof(kPowersOfTen)/sizeof(kPowersOfTen[0]) - 1;
+    
+    bool negative = false;
+    if ( pos != end && (*pos == '-' || *pos == '+') )
+        negative = (*pos++ == '-');
+    
+    // accumulate every significant digit into one integer, then scale once
+    uint64_t mantissa = 0;
+    size_t digits = 0, fractionDigits = 0;
+    int wholeExponent = 0;
+    bool inFraction = false, anyDigits = false;
+    for ( ; pos != end; ++pos )
+    {
+        char ch = *pos;
+        if ( ch == '.' && !inFraction )
+        {
+            inFraction = true;
+            continue;
+        }
+        if ( ch < '0' || ch > '9' )
+            break;
+        
+        anyDigits = true;
+        if ( digits < kMaxDigits && fractionDigits < kMaxDigits )
+        {
+            mantissa = (mantissa * 10) + static_cast<uint64_t>(ch - '0');
+            if ( mantissa != 0 )
+                ++digits;
+            if ( inFraction )
+                ++fractionDigits;
+        }
+        else if ( !inFraction )
+        {
+            ++wholeExponent;    // too many whole digits; remaining ones only add magnitude
+        }
+    }
+    
+    if ( !anyDigits )
+        return false;
+    
+    double value = static_cast<double>(mantissa);
+    if ( fractionDigits != 0 )
+        value /= kPowersOfTen[fractionDigits];
+    for ( ; wholeExponent > 0; --wholeExponent )
+        value *= 10.0;
+    
+    result = static_cast<float>(negative ? -value : value);
+    return true;
+}
+
 CFI::Component::Component(const string& str) : flags(0), nodeIndex(0), qualifier(), characterOffset(0), temporalOffset(), spatialOffset(), textQualifier(), sideBias(SideBias::Unspecified)
 {
     Parse(str);
 }
-void CFI::Component::Parse(const string &str)
+CFI::Component::Component(const char* begin, const char* end) : flags(0), nodeIndex(0), qualifier(), characterOffset(0), temporalOffset(), spatialOffset(), textQualifier(), sideBias(SideBias::Unspecified)
+{
+    Parse(begin, end);
+}
+void CFI::Component::Parse(const char* begin, const char* end)
 {
-    if ( str.empty() )
+    if ( begin == end )
     {
         HandleError(EPUBError::CFIParseFailed, "Empty string supplied to CFI::Component");
         return;
     }
     
-    std::string utf8 = str.stl_str();
-    std::istringstream iss(utf8);
+    const char* pos = begin;
     
     // read an integer
-    iss >> nodeIndex;
-    if ( nodeIndex == 0 && iss.fail() )
+    if ( !_ParseInteger(pos, end, nodeIndex) )
     {
-        HandleError(EPUBError::CFIParseFailed, _Str("No node value at start of CFI::Component string '", str, "'"));
+        HandleError(EPUBError::CFIParseFailed, _Str("No node value at start of CFI::Component string '", std::string(begin, end), "'"));
         return;
     }
     
-    while ( !iss.eof() )
+    while ( pos != end )
     {
-        char next = 0;
-        iss >> next;
+        char next = *pos++;
         
         switch ( next )
         {
             case '[':
             {
-                size_t pos = static_cast<size_t>(iss.tellg());
-                iss.ignore(std::numeric_limits<std::streamsize>::max(), ']');
-                size_t end = ((size_t)iss.tellg()) - 1;
-                
-                if ( iss.eof() )
+                const char* close = std::find(pos, end, ']');
+                if ( close == end )
                 {
                     HandleError(EPUBError::CFIParseFailed);
                     return;
                 }
                 
-                if ( characterOffset != 0 )
+                if ( HasCharacterOffset() )
                 {
                     // this is a text qualifier
                     flags |= TextQualifier;
-                    std::string sub = utf8.substr(pos, end-pos);
                     
                     // is there a side-bias?
-                    auto biasPos = sub.find(";s=");
-                    if ( biasPos == std::string::npos )
-                    {
-                        textQualifier = std::move(sub);
-                    }
-                    else
+                    static const char kBias[] = ";s=";
+                    const char* biasPos = std::search(pos, close, kBias, kBias+3);
+                    textQualifier = string(pos, static_cast<size_t>(biasPos - pos));
+                    
+                    if ( biasPos != close && close - biasPos > 3 )
                     {
-                        textQualifier = sub.substr(0, biasPos);
-                        if ( sub.size() > biasPos + 3 )
+                        switch ( biasPos[3] )
                         {
-                            switch ( sub[biasPos+3] )
-                            {
-                                case 'b':
-                                    sideBias = SideBias::Before;
-                                    break;
-                                case 'a':
-                                    sideBias = SideBias::After;
-                                    break;
-                                default:
-                                    sideBias = SideBias::Unspecified;
-                                    break;
-                            }
+                            case 'b':
+                                sideBias = SideBias::Before;
+                                break;
+                            case 'a':
+                                sideBias = SideBias::After;
+                                break;
+                            default:
+                                sideBias = SideBias::Unspecified;
+                                break;
                         }
                     }
                 }
                 else
                 {
                     // it's a position qualifier
-                    qualifier = utf8.substr(pos, end-pos);
+                    qualifier = string(pos, static_cast<size_t>(close - pos));
                     flags |= Qualifier;
                 }
                 
+                pos = close + 1;
                 break;
             }
                 
@@ -485,7 +567,11 @@ void CFI::Component::Parse(const string &str)
                     break;
                 
                 // read a numeral
-                iss >> temporalOffset;
+                if ( !_ParseNumber(pos, end, temporalOffset) )
+                {
+                    HandleError(EPUBError::CFIParseFailed, _Str("Invalid temporal offset in CFI::Component string '", std::string(begin, end), "'"));
+                    return;
+                }
                 flags |= TemporalOffset;
                 break;
             }
@@ -498,17 +584,19 @@ void CFI::Component::Parse(const string &str)
                 
                 // two floats, separated by a colon
                 float x, y;
+                if ( !_ParseNumber(pos, end, x) || pos == end || *pos != ':' )
+                {
+                    HandleError(EPUBError::CFISpatialOffsetInvalidFormat);
+                    return;
+                }
                 
-                // read x
-                iss >> x;
-                
-                // check for and skip delimiter
-                if ( iss.peek() != ':' )
-                    break;
-                iss.ignore(1);
-                
-                // read y
-                iss >> y;
+                // skip delimiter and read y
+                ++pos;
+                if ( !_ParseNumber(pos, end, y) )
+                {
+                    HandleError(EPUBError::CFISpatialOffsetInvalidFormat);
+                    return;
+                }
                 
                 spatialOffset.x = x;
                 spatialOffset.y = y;
@@ -522,7 +610,11 @@ void CFI::Component::Parse(const string &str)
                 if ( HasSpatialTemporalOffset() )
                     break;
                 
-                iss >> characterOffset;
+                if ( !_ParseInteger(pos, end, characterOffset) )
+                {
+                    HandleError(EPUBError::CFIParseFailed, _Str("Invalid character offset in CFI::Component string '", std::string(begin, end), "'"));
+                    return;
+                }
                 flags |= CharacterOffset;
                 break;
             }
@@ -530,7 +622,7 @@ void CFI::Component::Parse(const string &str)
             case '!':
             {
                 // must be the last character, and no offsets
-                if ( ((int)iss.peek()) != -1 || HasSpatialTemporalOffset() || HasCharacterOffset() )
+                if ( pos != end || HasSpatialTemporalOffset() || HasCharacterOffset() )
                     break;
                 
                 flags |= Indirector;
@@ -250,6 +250,9 @@ protected:
         /// Creates a component from a string.
                         Component(const string& str);
         ///
+        /// Creates a component from a range of UTF-8 bytes within a CFI string.
+                        Component(const char* begin, const char* end);
+        ///
         /// Creates a numeric component with no flags.
         Component(uint32_t __nodeIdx=0) : flags(0), nodeIndex(__nodeIdx), qualifier(), characterOffset(0), temporalOffset(), spatialOffset(), textQualifier(), sideBias(SideBias::Unspecified) {}
         ///
@@ -281,7 +284,8 @@ protected:
         bool            HasSpatialTemporalOffset()          const _NOEXCEPT { return HasFlag(SpatialTemporalOffset); }
         
     private:
-        void            Parse(const string& str);
+        void            Parse(const string& str)            { Parse(str.c_str(), str.c_str()+str.utf8_size()); }
+        void            Parse(const char* begin, const char* end);
     };
     
     ///
@@ -302,6 +306,8 @@ protected:
     // PackageBase should be able to work with components
     friend class    PackageBase;
     friend class    Package;
+    friend class    CFIResolver;
+    friend class    PackedCFI;
     
     ///
     /// The total number of components in a CFI, including range components.
@@ -318,17 +324,38 @@ protected:
     /// Appends components to a string stream. Used by Stringify().
     static void         AppendComponents(std::stringstream& stream, ComponentList::const_iterator start, ComponentList::const_iterator end);
     
-    typedef std::vector<string>    StringList;
-    
     ///
-    /// Breaks a CFI string into its components.
-    static StringList   CFIComponentStrings(const string& cfi, const string& delimiter = "/");
+    /// A non-owning view onto a run of bytes within a CFI string, used while parsing.
+    struct Span
+    {
+        const char*     begin;
+        const char*     end;
+        
+        Span() : begin(nullptr), end(nullptr) {}
+        Span(const char* b, const char* e) : begin(b), end(e) {}
+        
+        bool            empty()                             const _NOEXCEPT { return begin == end; }
+        size_t          size()                              const _NOEXCEPT { return static_cast<size_t>(end - begin); }
+    };
+    
+    /**
+     Locates the next occurrence of a delimiter which is not inside a `[...]`
+     qualifier.
+     @param pos The position from which to search.
+     @param end The end of the CFI string.
+     @param delimiter The delimiter character.
+     @result The location of the delimiter, `end` if there are no more delimiters,
+     or `nullptr` if an unterminated qualifier was found.
+     */
+    static const char*  FindDelimiter(const char* pos, const char* end, char delimiter);
     ///
-    /// Breaks a ranged CFI string into base, start, and end CFI strings
-    static StringList   RangedCFIComponents(const string& cfi)          { return CFIComponentStrings(cfi, ","); }
+    /// Breaks a ranged CFI string into base, start, and end pieces. Returns the
+    /// number of non-empty pieces found, which may be more than three.
+    static size_t       RangedCFIComponents(Span cfi, Span pieces[3]);
     ///
-    /// Compiles CFI component strings into a component list.
-    static bool         CompileComponentsToList(const StringList& strings, ComponentList* list);
+    /// Compiles the components of a CFI (or of one piece of a ranged CFI) into a
+    /// component list.
+    static bool         CompileComponentsToList(Span str, ComponentList* list);
     ///
     /// Top-level CFI compilation method.
     bool                CompileCFI(const string& str);
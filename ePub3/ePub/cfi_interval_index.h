@@ -0,0 +1,399 @@
+//
+//  cfi_interval_index.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__cfi_interval_index__
+#define __ePub3__cfi_interval_index__
+
+#include <ePub3/epub3.h>
+#include <ePub3/cfi.h>
+#include <ePub3/packed_cfi.h>
+#include <vector>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ An index of CFI intervals, such as highlights or annotations, which can quickly
+ find every interval overlapping a range or containing a location.
+ 
+ Intervals are ordered using their PackedCFI encodings, and stored in a balanced
+ (randomized) binary tree in which each node also records the greatest end location
+ within its subtree. Insertion and removal take O(log n) time, and a query which
+ returns k intervals takes O(log n + k) time in practice, skipping any subtree
+ whose intervals all end before the query begins.
+ 
+ All intervals are closed: a location CFI is stored as an interval which starts and
+ ends at the same location, and two intervals which share only an endpoint overlap.
+ 
+ The index is not thread-safe; queries may run concurrently with one another, but
+ not with modifications.
+ @tparam _Tp The type of value associated with each interval, such as an annotation
+ identifier. It must be copyable, default-constructible and equality-comparable.
+ @ingroup epub-model
+ */
+template <typename _Tp>
+class CFIIntervalIndex
+{
+public:
+    typedef _Tp                 value_type;
+    typedef std::vector<_Tp>    ValueList;
+    
+    ///
+    /// A stored interval.
+    struct Interval
+    {
+        PackedCFI   start;      ///< The first location in the interval.
+        PackedCFI   end;        ///< The last location in the interval.
+        _Tp         value;      ///< The value associated with the interval.
+    };
+    
+public:
+                    CFIIntervalIndex() : _nodes(), _free(), _root(kNil), _size(0), _serial(0), _seed(0x9E3779B9) {}
+                    CFIIntervalIndex(const CFIIntervalIndex& o) : _nodes(o._nodes), _free(o._free), _root(o._root), _size(o._size), _serial(o._serial), _seed(o._seed) {}
+                    CFIIntervalIndex(CFIIntervalIndex&& o) : _nodes(std::move(o._nodes)), _free(std::move(o._free)), _root(o._root), _size(o._size), _serial(o._serial), _seed(o._seed) { o._root = kNil; o._size = 0; }
+                    ~CFIIntervalIndex() {}
+    
+    ///
+    /// The number of intervals in the index.
+    size_t          Size()                          const   { return _size; }
+    ///
+    /// Returns `true` if the index contains no intervals.
+    bool            Empty()                         const   { return _size == 0; }
+    ///
+    /// Removes all intervals.
+    void            Clear()                                 { _nodes.clear(); _free.clear(); _root = kNil; _size = 0; }
+    
+    /**
+     Adds an interval.
+     @param cfi A ranged CFI, or a location CFI which is stored as a single-location
+     interval.
+     @param value The value to associate with the interval.
+     */
+    void            Insert(const CFI& cfi, const _Tp& value)
+    {
+        Insert(PackedCFI(cfi, PackedCFI::Endpoint::Start), PackedCFI(cfi, PackedCFI::Endpoint::End), value);
+    }
+    ///
+    /// Adds an interval using encoded endpoints, which will be swapped if out of order.
+    void            Insert(const PackedCFI& start, const PackedCFI& end, const _Tp& value);
+    
+    /**
+     Removes an interval.
+     @param cfi The CFI with which the interval was inserted.
+     @param value The value associated with the interval.
+     @result Returns `true` if a matching interval was found and removed.
+     */
+    bool            Remove(const CFI& cfi, const _Tp& value)
+    {
+        return Remove(PackedCFI(cfi, PackedCFI::Endpoint::Start), PackedCFI(cfi, PackedCFI::Endpoint::End), value);
+    }
+    ///
+    /// Removes an interval using encoded endpoints.
+    bool            Remove(const PackedCFI& start, const PackedCFI& end, const _Tp& value);
+    
+    /**
+     Calls a function for every interval which overlaps a range, in order of their
+     start locations.
+     @param start The first location in the range.
+     @param end The last location in the range.
+     @param fn A function or functor taking a `const Interval&` argument.
+     */
+    template <class _Fn>
+    void            ForEachOverlapping(const PackedCFI& start, const PackedCFI& end, _Fn fn)   const
+    {
+        Query(_root, start, &end, true, fn);
+    }
+    
+    ///
+    /// Returns the values of all intervals overlapping a ranged or location CFI.
+    ValueList       Overlapping(const CFI& cfi)     const
+    {
+        ValueList result;
+        auto collect = [&result](const Interval& i) { result.push_back(i.value); };
+        PackedCFI start(cfi, PackedCFI::Endpoint::Start), end(cfi, PackedCFI::Endpoint::End);
+        Query(_root, start, &end, true, collect);
+        return result;
+    }
+    
+    ///
+    /// Returns the values of all intervals containing a location (a stabbing query).
+    ValueList       Containing(const CFI& location) const
+    {
+        ValueList result;
+        auto collect = [&result](const Interval& i) { result.push_back(i.value); };
+        PackedCFI point(location);
+        Query(_root, point, &point, true, collect);
+        return result;
+    }
+    
+    /**
+     Returns the values of all intervals which overlap the content at or beneath a
+     location.
+     
+     For example, passing the CFI of a spine item (such as `/6/4!`) will return all
+     intervals which touch that spine item's content document.
+     @param location A location CFI identifying an element, spine item, or document.
+     @result The values of the matching intervals.
+     */
+    ValueList       Within(const CFI& location)     const;
+    
+protected:
+    typedef int32_t     NodeRef;
+    static const NodeRef kNil = -1;
+    
+    struct Node
+    {
+        Interval    interval;
+        PackedCFI   maxEnd;     ///< The greatest end location in this subtree.
+        uint64_t    serial;     ///< Insertion order, which orders intervals with equal starts.
+        uint32_t    priority;
+        NodeRef     left;
+        NodeRef     right;
+    };
+    
+    std::vector<Node>       _nodes;
+    std::vector<NodeRef>    _free;      ///< Unused slots within `_nodes`.
+    NodeRef                 _root;
+    size_t                  _size;
+    uint64_t                _serial;
+    uint32_t                _seed;
+    
+    ///
+    /// Returns `true` if a node sorts before the given key.
+    bool            Before(const Node& n, const PackedCFI& start, uint64_t serial) const
+    {
+        int cmp = n.interval.start.Compare(start);
+        return cmp < 0 || (cmp == 0 && n.serial < serial);
+    }
+    
+    ///
+    /// Recomputes a node's maximum end location from its children.
+    void            Update(NodeRef t)
+    {
+        Node& n = _nodes[t];
+        n.maxEnd = n.interval.end;
+        if ( n.left != kNil && n.maxEnd < _nodes[n.left].maxEnd )
+            n.maxEnd = _nodes[n.left].maxEnd;
+        if ( n.right != kNil && n.maxEnd < _nodes[n.right].maxEnd )
+            n.maxEnd = _nodes[n.right].maxEnd;
+    }
+    
+    ///
+    /// Splits a subtree into nodes before a key (`l`) and the remainder (`r`).
+    void            Split(NodeRef t, const PackedCFI& start, uint64_t serial, NodeRef& l, NodeRef& r)
+    {
+        if ( t == kNil )
+        {
+            l = r = kNil;
+        }
+        else if ( Before(_nodes[t], start, serial) )
+        {
+            Split(_nodes[t].right, start, serial, _nodes[t].right, r);
+            l = t;
+            Update(t);
+        }
+        else
+        {
+            Split(_nodes[t].left, start, serial, l, _nodes[t].left);
+            r = t;
+            Update(t);
+        }
+    }
+    
+    ///
+    /// Joins two subtrees, where every node in `l` sorts before every node in `r`.
+    NodeRef         Merge(NodeRef l, NodeRef r)
+    {
+        if ( l == kNil )
+            return r;
+        if ( r == kNil )
+            return l;
+        
+        if ( _nodes[l].priority > _nodes[r].priority )
+        {
+            _nodes[l].right = Merge(_nodes[l].right, r);
+            Update(l);
+            return l;
+        }
+        
+        _nodes[r].left = Merge(l, _nodes[r].left);
+        Update(r);
+        return r;
+    }
+    
+    ///
+    /// Locates the node holding a particular interval.
+    NodeRef         Find(NodeRef t, const PackedCFI& start, const PackedCFI& end, const _Tp& value) const
+    {
+        while ( t != kNil )
+        {
+            const Node& n = _nodes[t];
+            int cmp = n.interval.start.Compare(start);
+            if ( cmp < 0 )
+            {
+                t = n.right;
+                continue;
+            }
+            if ( cmp > 0 )
+            {
+                t = n.left;
+                continue;
+            }
+            
+            // equal starts may lie on both sides
+            if ( n.interval.end == end && n.interval.value == value )
+                return t;
+            NodeRef found = Find(n.left, start, end, value);
+            if ( found != kNil )
+                return found;
+            t = n.right;
+        }
+        return kNil;
+    }
+    
+    /**
+     Reports every interval in a subtree which overlaps a range.
+     @param t The subtree.
+     @param lo The start of the range.
+     @param hi The end of the range, or `nullptr` if it is unbounded.
+     @param hiInclusive Whether the range includes `hi`.
+     @param fn The function to call for each matching interval.
+     */
+    template <class _Fn>
+    void            Query(NodeRef t, const PackedCFI& lo, const PackedCFI* hi, bool hiInclusive, _Fn& fn) const
+    {
+        if ( t == kNil )
+            return;
+        
+        const Node& n = _nodes[t];
+        if ( n.maxEnd < lo )
+            return;             // everything here ends before the range
+        
+        Query(n.left, lo, hi, hiInclusive, fn);
+        
+        if ( hi != nullptr )
+        {
+            int cmp = n.interval.start.Compare(*hi);
+            if ( cmp > 0 || (cmp == 0 && !hiInclusive) )
+                return;         // this node and everything to its right starts after the range
+        }
+        
+        if ( n.interval.end >= lo )
+            fn(n.interval);
+        
+        Query(n.right, lo, hi, hiInclusive, fn);
+    }
+    
+};
+
+template <typename _Tp>
+const typename CFIIntervalIndex<_Tp>::NodeRef CFIIntervalIndex<_Tp>::kNil;
+
+template <typename _Tp>
+void CFIIntervalIndex<_Tp>::Insert(const PackedCFI& start, const PackedCFI& end, const _Tp& value)
+{
+    NodeRef ref;
+    if ( _free.empty() )
+    {
+        ref = static_cast<NodeRef>(_nodes.size());
+        _nodes.emplace_back();
+    }
+    else
+    {
+        ref = _free.back();
+        _free.pop_back();
+    }
+    
+    // xorshift32, for treap priorities
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    
+    Node& n = _nodes[ref];
+    bool inOrder = (start <= end);
+    n.interval.start = (inOrder ? start : end);
+    n.interval.end = (inOrder ? end : start);
+    n.interval.value = value;
+    n.maxEnd = n.interval.end;
+    n.serial = _serial++;
+    n.priority = _seed;
+    n.left = n.right = kNil;
+    
+    NodeRef l, r;
+    Split(_root, n.interval.start, n.serial, l, r);
+    _root = Merge(Merge(l, ref), r);
+    ++_size;
+}
+
+template <typename _Tp>
+bool CFIIntervalIndex<_Tp>::Remove(const PackedCFI& start, const PackedCFI& end, const _Tp& value)
+{
+    bool inOrder = (start <= end);
+    NodeRef ref = Find(_root, (inOrder ? start : end), (inOrder ? end : start), value);
+    if ( ref == kNil )
+        return false;
+    
+    // split the node out on its own, then join the rest back together
+    PackedCFI key(_nodes[ref].interval.start);
+    uint64_t serial = _nodes[ref].serial;
+    NodeRef l, m, r;
+    Split(_root, key, serial, l, r);
+    Split(r, key, serial+1, m, r);
+    _root = Merge(l, r);
+    
+    _nodes[ref].interval.value = _Tp();
+    _free.push_back(ref);
+    --_size;
+    return true;
+}
+
+template <typename _Tp>
+typename CFIIntervalIndex<_Tp>::ValueList CFIIntervalIndex<_Tp>::Within(const CFI& location) const
+{
+    ValueList result;
+    auto collect = [&result](const Interval& i) { result.push_back(i.value); };
+    
+    // every encoding beneath a location has its encoding as a prefix, so the upper
+    // bound is the smallest encoding greater than all of those
+    PackedCFI lo(location);
+    uint8_t bytes[PackedCFI::MaxSize];
+    size_t len = lo.Size();
+    std::memcpy(bytes, lo.Data(), len);
+    while ( len > 0 && bytes[len-1] == 0xFF )
+        --len;
+    
+    if ( len == 0 )
+    {
+        Query(_root, lo, nullptr, false, collect);
+    }
+    else
+    {
+        bytes[len-1]++;
+        PackedCFI hi(bytes, len);
+        Query(_root, lo, &hi, false, collect);
+    }
+    
+    return result;
+}
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__cfi_interval_index__) */
@@ -0,0 +1,421 @@
+//
+//  cfi_resolver.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "cfi_resolver.h"
+#include <algorithm>
+#include <deque>
+
+EPUB3_BEGIN_NAMESPACE
+
+// Returns the value of an element's `id` (or `xml:id`) attribute, without copying it.
+static const xmlChar* _IDForElement(xmlNodePtr element)
+{
+    for ( xmlAttrPtr attr = element->properties; attr != nullptr; attr = attr->next )
+    {
+        if ( xmlStrEqual(attr->name, BAD_CAST "id") == 0 )
+            continue;
+        if ( attr->ns != nullptr && xmlStrEqual(attr->ns->href, XML_XML_NAMESPACE) == 0 )
+            continue;
+        if ( attr->children == nullptr || attr->children->type != XML_TEXT_NODE )
+            continue;
+        return attr->children->content;
+    }
+    return nullptr;
+}
+
+// Counts the UTF-16 units needed to represent some UTF-8 text.
+static size_t _UTF16Length(const xmlChar* utf8)
+{
+    size_t result = 0;
+    for ( ; *utf8 != 0; ++utf8 )
+    {
+        if ( (*utf8 & 0xC0) == 0x80 )
+            continue;                   // continuation byte
+        result += (*utf8 >= 0xF0 ? 2 : 1);  // four-byte sequences need a surrogate pair
+    }
+    return result;
+}
+
+// Finds the byte offset within some UTF-8 text of a UTF-16 offset.
+static size_t _ByteOffsetForUTF16Offset(const xmlChar* utf8, size_t offset)
+{
+    const xmlChar* pos = utf8;
+    while ( offset > 0 && *pos != 0 )
+    {
+        offset -= std::min(offset, size_t(*pos >= 0xF0 ? 2 : 1));
+        ++pos;
+        while ( (*pos & 0xC0) == 0x80 )
+            ++pos;
+    }
+    return static_cast<size_t>(pos - utf8);
+}
+
+static inline bool _IsTextNode(xmlNodePtr node)
+{
+    return node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE;
+}
+
+CFIResolver::CFIResolver(xmlDocPtr doc) : _doc(doc), _root(nullptr), _children(), _childIndex(), _textSteps(), _ids()
+{
+    if ( _doc != nullptr )
+        _root = xmlDocGetRootElement(_doc);
+    BuildIndex();
+}
+CFIResolver::CFIResolver(CFIResolver&& o) : _doc(o._doc), _root(o._root), _children(std::move(o._children)), _childIndex(std::move(o._childIndex)), _textSteps(std::move(o._textSteps)), _ids(std::move(o._ids))
+{
+    o._doc = nullptr;
+    o._root = nullptr;
+}
+void CFIResolver::BuildIndex()
+{
+    if ( _root == nullptr )
+        return;
+    
+    // breadth-first, so each element's children are appended contiguously
+    std::deque<std::pair<xmlNodePtr, uint32_t>> queue;
+    queue.emplace_back(_root, 0);
+    
+    while ( !queue.empty() )
+    {
+        xmlNodePtr element = queue.front().first;
+        ElementEntry entry = { static_cast<uint32_t>(_children.size()), 0, queue.front().second, _IDForElement(element) };
+        queue.pop_front();
+        
+        if ( entry.ident != nullptr )
+            _ids.emplace(reinterpret_cast<const char*>(entry.ident), element);   // first occurrence wins
+        
+        for ( xmlNodePtr child = element->children; child != nullptr; child = child->next )
+        {
+            if ( _IsTextNode(child) )
+            {
+                // text between element children n and n+1 has step 2n+1
+                _textSteps[child] = (entry.count * 2) + 1;
+                continue;
+            }
+            if ( child->type != XML_ELEMENT_NODE )
+                continue;
+            
+            _children.push_back(child);
+            entry.count++;
+            queue.emplace_back(child, entry.count * 2);
+        }
+        
+        _childIndex[element] = entry;
+    }
+}
+xmlNodePtr CFIResolver::ElementWithID(const std::string& ident) const
+{
+    auto found = _ids.find(ident);
+    if ( found == _ids.end() )
+        return nullptr;
+    return found->second;
+}
+CFIResolver::Result CFIResolver::Resolve(const CFI& cfi) const
+{
+    Result result;
+    EPUBError err = ResolveCFI(cfi, result);
+    if ( err != EPUBError::NoError )
+        HandleError(err, _Str("Unable to resolve CFI ", cfi.String().stl_str()));
+    return result;
+}
+CFIResolver::ResultList CFIResolver::ResolveAll(const CFIList& cfis) const
+{
+    ResultList results(cfis.size());
+    for ( size_t i = 0; i < cfis.size(); i++ )
+    {
+        ResolveCFI(cfis[i], results[i]);
+    }
+    return results;
+}
+EPUBError CFIResolver::ResolveCFI(const CFI& cfi, Result& result) const
+{
+    result = Result();
+    
+    if ( _root == nullptr )
+        return (result.error = EPUBError::CFIIndirectionTargetNotFound);
+    
+    // skip over any package-document steps
+    auto pos = cfi._components.begin(), end = cfi._components.end();
+    auto indirector = std::find_if(pos, end, [](const CFI::Component& c) { return c.IsIndirector(); });
+    if ( indirector != end )
+        pos = indirector + 1;
+    
+    if ( cfi.IsRangeTriplet() == false )
+    {
+        result.error = ResolveSteps(pos, end, _root, result.start);
+        result.end = result.start;
+        return result.error;
+    }
+    
+    // resolve the common base to an element, then each end of the range from there
+    result.isRange = true;
+    Location base;
+    result.error = ResolveSteps(pos, end, _root, base);
+    if ( result.error != EPUBError::NoError )
+        return result.error;
+    if ( base.node->type != XML_ELEMENT_NODE || base.hasOffset )
+        return (result.error = EPUBError::CFIUnexpectedComponent);
+    
+    result.error = ResolveSteps(cfi._rangeStart.begin(), cfi._rangeStart.end(), base.node, result.start);
+    if ( result.error == EPUBError::NoError )
+        result.error = ResolveSteps(cfi._rangeEnd.begin(), cfi._rangeEnd.end(), base.node, result.end);
+    return result.error;
+}
+EPUBError CFIResolver::ResolveSteps(CFI::ComponentList::const_iterator pos, CFI::ComponentList::const_iterator end,
+                                    xmlNodePtr node, Location& location) const
+{
+    location = Location();
+    location.node = node;
+    
+    for ( ; pos != end; ++pos )
+    {
+        const CFI::Component& step = *pos;
+        bool terminal = (pos + 1 == end);
+        
+        if ( step.IsIndirector() )
+            return EPUBError::CFIIndirectionTargetNotFound;     // nested documents aren't indexed
+        if ( !terminal && (step.flags & CFI::Component::OffsetsMask) != 0 )
+            return EPUBError::CFICharOffsetInNonTerminatingStep;
+        if ( step.nodeIndex == 0 )
+            return EPUBError::CFIStepOutOfBounds;
+        
+        auto found = _childIndex.find(node);
+        if ( found == _childIndex.end() )
+            return EPUBError::CFIStepOutOfBounds;
+        const ElementEntry& children = found->second;
+        
+        if ( (step.nodeIndex % 2) == 1 )
+        {
+            // a run of text can only be the last step
+            if ( !terminal )
+                return EPUBError::CFIUnexpectedComponent;
+            return ResolveTextStep(node, children, step, location);
+        }
+        
+        uint32_t childIdx = step.nodeIndex / 2;
+        if ( childIdx > children.count )
+            return EPUBError::CFIStepOutOfBounds;
+        node = _children[children.first + childIdx - 1];
+        
+        if ( step.HasQualifier() )
+        {
+            // the id assertion wins if the document has changed since the CFI was made
+            const xmlChar* ident = _childIndex.find(node)->second.ident;
+            if ( ident == nullptr || step.qualifier.stl_str() != reinterpret_cast<const char*>(ident) )
+            {
+                xmlNodePtr asserted = ElementWithID(step.qualifier.stl_str());
+                if ( asserted != nullptr )
+                    node = asserted;
+            }
+        }
+        
+        location.node = node;
+        
+        if ( step.HasCharacterOffset() )
+        {
+            // only an <img> (via its alt text) may take a character offset
+            if ( xmlStrEqual(node->name, BAD_CAST "img") == 0 )
+                return EPUBError::CFICharOffsetOnIllegalElement;
+            location.hasOffset = true;
+            location.characterOffset = step.characterOffset;
+        }
+    }
+    
+    return EPUBError::NoError;
+}
+EPUBError CFIResolver::ResolveTextStep(xmlNodePtr parent, const ElementEntry& children, const CFI::Component& step,
+                                       Location& location) const
+{
+    // odd indices identify the (possibly empty) run of nodes before, between, or after element children
+    uint32_t runIdx = (step.nodeIndex - 1) / 2;
+    if ( runIdx > children.count )
+        return EPUBError::CFIStepOutOfBounds;
+    
+    xmlNodePtr first = (runIdx == 0 ? parent->children : _children[children.first + runIdx - 1]->next);
+    xmlNodePtr last = (runIdx < children.count ? _children[children.first + runIdx] : nullptr);
+    
+    location.node = parent;
+    
+    // the character offset counts across every text node in the run
+    size_t remaining = (step.HasCharacterOffset() ? step.characterOffset : 0);
+    xmlNodePtr lastText = nullptr;
+    size_t lastTextLength = 0;
+    
+    for ( xmlNodePtr node = first; node != last; node = node->next )
+    {
+        if ( !_IsTextNode(node) || node->content == nullptr )
+            continue;
+        
+        size_t length = _UTF16Length(node->content);
+        if ( remaining < length || (remaining == length && !step.HasCharacterOffset()) )
+        {
+            location.node = node;
+            if ( step.HasCharacterOffset() )
+            {
+                location.hasOffset = true;
+                location.characterOffset = static_cast<uint32_t>(remaining);
+                location.byteOffset = _ByteOffsetForUTF16Offset(node->content, remaining);
+            }
+            return EPUBError::NoError;
+        }
+        
+        remaining -= length;
+        lastText = node;
+        lastTextLength = length;
+    }
+    
+    if ( !step.HasCharacterOffset() )
+        return EPUBError::NoError;          // an empty run
+    
+    if ( lastText == nullptr )
+        return (remaining == 0 ? EPUBError::NoError : EPUBError::CFICharOffsetOutOfBounds);
+    if ( remaining != 0 )
+        return EPUBError::CFICharOffsetOutOfBounds;
+    
+    // the offset is at the very end of the run
+    location.node = lastText;
+    location.hasOffset = true;
+    location.characterOffset = static_cast<uint32_t>(lastTextLength);
+    location.byteOffset = xmlStrlen(lastText->content);
+    return EPUBError::NoError;
+}
+CFI CFIResolver::CFIForLocation(const Location& location, const CFI& base) const
+{
+    PathCache cache;
+    CFI result;
+    EPUBError err = GenerateCFI(location, base, cache, result);
+    if ( err != EPUBError::NoError )
+        HandleError(err, "Unable to generate a CFI for the supplied location");
+    return result;
+}
+CFIResolver::CFIList CFIResolver::CFIsForLocations(const LocationList& locations, const CFI& base, ErrorList* pErrors) const
+{
+    CFIList result(locations.size());
+    if ( pErrors != nullptr )
+        pErrors->assign(locations.size(), EPUBError::NoError);
+    
+    PathCache cache;
+    for ( size_t i = 0; i < locations.size(); i++ )
+    {
+        EPUBError err = GenerateCFI(locations[i], base, cache, result[i]);
+        if ( err != EPUBError::NoError )
+        {
+            result[i].Clear();
+            if ( pErrors != nullptr )
+                (*pErrors)[i] = err;
+        }
+    }
+    
+    return result;
+}
+EPUBError CFIResolver::GenerateCFI(const Location& location, const CFI& base, PathCache& cache, CFI& result) const
+{
+    if ( location.node == nullptr || base.IsRangeTriplet() )
+        return EPUBError::CFIParseFailed;
+    
+    xmlNodePtr node = location.node;
+    
+    if ( node->type == XML_ELEMENT_NODE )
+    {
+        // only an <img> (via its alt text) may take a character offset
+        if ( location.hasOffset && xmlStrEqual(node->name, BAD_CAST "img") == 0 )
+            return EPUBError::CFICharOffsetOnIllegalElement;
+        
+        // the path to an element ends with its own step
+        const CFI::ComponentList* path = PathToElement(node, cache);
+        if ( path == nullptr || path->empty() )
+            return EPUBError::CFIStepOutOfBounds;
+        
+        result._components = base._components;
+        result._components.insert(result._components.end(), path->begin(), path->end());
+        if ( location.hasOffset )
+        {
+            result._components.back().flags |= CFI::Component::CharacterOffset;
+            result._components.back().characterOffset = location.characterOffset;
+        }
+        return EPUBError::NoError;
+    }
+    
+    auto step = _textSteps.find(node);
+    if ( step == _textSteps.end() )
+        return EPUBError::CFIStepOutOfBounds;
+    
+    CFI::Component last(step->second);
+    if ( location.hasOffset )
+    {
+        if ( node->content == nullptr || location.characterOffset > _UTF16Length(node->content) )
+            return EPUBError::CFICharOffsetOutOfBounds;
+        
+        // the offset counts from the start of the run of text this node belongs to
+        size_t offset = location.characterOffset;
+        for ( xmlNodePtr prev = node->prev; prev != nullptr && prev->type != XML_ELEMENT_NODE; prev = prev->prev )
+        {
+            if ( _IsTextNode(prev) && prev->content != nullptr )
+                offset += _UTF16Length(prev->content);
+        }
+        
+        last.flags |= CFI::Component::CharacterOffset;
+        last.characterOffset = static_cast<uint32_t>(offset);
+    }
+    
+    const CFI::ComponentList* path = PathToElement(node->parent, cache);
+    if ( path == nullptr )
+        return EPUBError::CFIStepOutOfBounds;
+    
+    result._components = base._components;
+    result._components.insert(result._components.end(), path->begin(), path->end());
+    result._components.push_back(std::move(last));
+    return EPUBError::NoError;
+}
+const CFI::ComponentList* CFIResolver::PathToElement(xmlNodePtr element, PathCache& cache) const
+{
+    auto cached = cache.find(element);
+    if ( cached != cache.end() )
+        return &cached->second;
+    
+    auto found = _childIndex.find(element);
+    if ( found == _childIndex.end() )
+        return nullptr;
+    
+    CFI::ComponentList path;
+    if ( element != _root )
+    {
+        const CFI::ComponentList* parentPath = PathToElement(element->parent, cache);
+        if ( parentPath == nullptr )
+            return nullptr;
+        
+        path = *parentPath;
+        
+        CFI::Component step(found->second.step);
+        if ( found->second.ident != nullptr )
+        {
+            step.flags |= CFI::Component::Qualifier;
+            step.qualifier = reinterpret_cast<const char*>(found->second.ident);
+        }
+        path.push_back(std::move(step));
+    }
+    
+    // references to unordered_map values remain valid as the cache grows
+    return &(cache[element] = std::move(path));
+}
+
+EPUB3_END_NAMESPACE
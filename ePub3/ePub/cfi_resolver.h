@@ -0,0 +1,247 @@
+//
+//  cfi_resolver.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__cfi_resolver__
+#define __ePub3__cfi_resolver__
+
+#include <ePub3/epub3.h>
+#include <ePub3/cfi.h>
+#include <ePub3/utilities/error_handler.h>
+#include <libxml/tree.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ The CFIResolver class locates the nodes within a content document which are
+ identified by CFIs, and generates CFIs for locations within the document.
+ 
+ When it is created, the resolver walks the document once and records the element
+ children of every element in a single table, along with every element's `id` and
+ the CFI step index of every element and text node. Each step of a CFI is then
+ resolved by indexing into that table, rather than by walking the siblings of the
+ current node, and `id` assertions are checked (and corrected, where the document
+ has changed) using a hash lookup. Likewise, generating a CFI for a node only
+ requires looking up the precomputed steps of its ancestors.
+ 
+ The resolver does not take ownership of the document, which must outlive it. The
+ document must not be modified while the resolver is in use; if it is, create a
+ new resolver.
+ 
+ Resolution methods are `const` and may be called from multiple threads at once.
+ @see Package::ManifestItemForCFI()
+ @ingroup epub-model
+ */
+class CFIResolver
+{
+public:
+    /**
+     A location within a document.
+     
+     A location refers to an element, or to a text node with a character offset. A
+     CFI step which identifies an empty run of text between two elements is
+     reported as the parent element, with no character offset.
+     */
+    struct Location
+    {
+        xmlNodePtr      node;               ///< The element or text node, or `nullptr` if unresolved.
+        bool            hasOffset;          ///< Whether the location includes a character offset.
+        uint32_t        characterOffset;    ///< The offset within `node`'s text, in UTF-16 units as used by CFIs.
+        size_t          byteOffset;         ///< The same offset, in bytes within `node`'s UTF-8 content.
+        
+        Location() : node(nullptr), hasOffset(false), characterOffset(0), byteOffset(0) {}
+    };
+    
+    ///
+    /// The result of resolving a single CFI.
+    struct Result
+    {
+        Location        start;      ///< The location, or the start of a range.
+        Location        end;        ///< The end of a range; identical to `start` for a location CFI.
+        bool            isRange;    ///< Whether the CFI was a range.
+        EPUBError       error;      ///< `EPUBError::NoError` if the CFI was resolved.
+        
+        Result() : start(), end(), isRange(false), error(EPUBError::NoError) {}
+        
+        ///
+        /// Returns `true` if the CFI was resolved successfully.
+        bool            Succeeded()     const   { return error == EPUBError::NoError; }
+    };
+    
+    typedef std::vector<CFI>        CFIList;
+    typedef std::vector<Result>     ResultList;
+    typedef std::vector<Location>   LocationList;
+    typedef std::vector<EPUBError>  ErrorList;
+    
+public:
+    /**
+     Creates a resolver for a content document, building its node index.
+     @param doc The content document. This must remain valid for the lifetime of
+     the resolver.
+     */
+    EPUB3_EXPORT explicit   CFIResolver(xmlDocPtr doc);
+    ///
+    /// C++11 move constructor.
+    EPUB3_EXPORT            CFIResolver(CFIResolver&& o);
+                            CFIResolver(const CFIResolver&)     _DELETED_;
+    virtual                 ~CFIResolver() {}
+    
+    ///
+    /// Returns the document being resolved against.
+    xmlDocPtr               Document()                          const   { return _doc; }
+    
+    /**
+     Resolves a single CFI.
+     
+     The CFI may be relative to the content document, such as the remaining CFI
+     produced by Package::ManifestItemForCFI(), or a complete package-based CFI,
+     in which case everything up to and including its first indirection step is
+     skipped.
+     
+     Errors are reported through the current error handler, and are also recorded
+     in the result if the handler chooses to ignore them.
+     @param cfi The CFI to resolve.
+     @result The resolved location or range.
+     */
+    EPUB3_EXPORT
+    Result                  Resolve(const CFI& cfi)             const;
+    
+    /**
+     Resolves a batch of CFIs against the document.
+     
+     Unlike Resolve(const CFI&), this method does not invoke the error handler: a
+     CFI which can't be resolved is given an error code in its result, and the
+     remainder of the batch is still processed.
+     @param cfis The CFIs to resolve.
+     @result One result per input CFI, in the same order.
+     */
+    EPUB3_EXPORT
+    ResultList              ResolveAll(const CFIList& cfis)     const;
+    
+    /**
+     Generates a CFI for a location within the document.
+     
+     Errors are reported through the current error handler; if the handler chooses
+     to ignore them, an empty CFI is returned.
+     @param location The location. Its `node` must be an element or text node within
+     the document; if `hasOffset` is set, `characterOffset` is used as an offset
+     into that node, in UTF-16 units.
+     @param base A CFI to which the document-relative path will be appended, such as
+     the result of Package::CFIForSpineItem(). This must not be a range.
+     @result A CFI identifying the location, including `id` assertions for every
+     element step which has one.
+     */
+    EPUB3_EXPORT
+    CFI                     CFIForLocation(const Location& location, const CFI& base=CFI())   const;
+    
+    /**
+     Generates CFIs for a batch of locations within the document.
+     
+     The path to each element is computed once per batch, so locations which share
+     ancestors (such as many search hits in the same paragraph) share the work.
+     Unlike CFIForLocation(), this method does not invoke the error handler.
+     @param locations The locations for which to generate CFIs.
+     @param base A CFI to which each document-relative path will be appended.
+     @param pErrors If not `nullptr`, this will be filled with one error code per
+     location, or `EPUBError::NoError` where a CFI was generated.
+     @result One CFI per location, in the same order. Locations which could not be
+     represented yield an empty CFI.
+     */
+    EPUB3_EXPORT
+    CFIList                 CFIsForLocations(const LocationList& locations, const CFI& base=CFI(), ErrorList* pErrors=nullptr) const;
+    
+    /**
+     Locates an element using its `id` attribute.
+     @param ident The `id` value to look for.
+     @result The element with the given `id`, or `nullptr` if there is none.
+     */
+    EPUB3_EXPORT
+    xmlNodePtr              ElementWithID(const std::string& ident) const;
+    
+protected:
+    ///
+    /// The indexed details of an element.
+    struct ElementEntry
+    {
+        uint32_t        first;      ///< The index of the first child in `_children`.
+        uint32_t        count;      ///< The number of element children.
+        uint32_t        step;       ///< The element's own (even) CFI step index; zero for the root.
+        const xmlChar*  ident;      ///< The element's `id`, or `nullptr`.
+    };
+    
+    typedef std::unordered_map<xmlNodePtr, ElementEntry>    ChildIndex;
+    typedef std::unordered_map<xmlNodePtr, uint32_t>        TextStepIndex;
+    typedef std::unordered_map<std::string, xmlNodePtr>     IDIndex;
+    typedef std::unordered_map<xmlNodePtr, CFI::ComponentList>  PathCache;
+    
+    xmlDocPtr                   _doc;
+    xmlNodePtr                  _root;      ///< The document element, from which all steps begin.
+    std::vector<xmlNodePtr>     _children;  ///< The element children of every element, each element's children contiguous.
+    ChildIndex                  _childIndex;
+    TextStepIndex               _textSteps; ///< The (odd) CFI step index of every text node.
+    IDIndex                     _ids;
+    
+    ///
+    /// Walks the document, building the child and id tables.
+    void                    BuildIndex();
+    
+    ///
+    /// Resolves a CFI, returning an error code rather than raising an error.
+    EPUBError               ResolveCFI(const CFI& cfi, Result& result)  const;
+    
+    /**
+     Resolves a sequence of CFI steps.
+     @param pos The first step to resolve.
+     @param end The end of the step sequence.
+     @param node The element from which to begin.
+     @param location Storage for the resolved location. If there are no steps, this
+     is set to `node`.
+     @result An error code, or `EPUBError::NoError`.
+     */
+    EPUBError               ResolveSteps(CFI::ComponentList::const_iterator pos, CFI::ComponentList::const_iterator end,
+                                         xmlNodePtr node, Location& location) const;
+    
+    ///
+    /// Resolves an odd-indexed step (a run of text) and any character offset.
+    EPUBError               ResolveTextStep(xmlNodePtr parent, const ElementEntry& children, const CFI::Component& step,
+                                            Location& location) const;
+    
+    ///
+    /// Generates a CFI for a location, returning an error code rather than raising an error.
+    EPUBError               GenerateCFI(const Location& location, const CFI& base, PathCache& cache, CFI& result) const;
+    
+    /**
+     Obtains the CFI steps leading to an element.
+     @param element The element.
+     @param cache Previously-computed paths, to which this element's path is added.
+     @result The steps from the document element to `element`, or `nullptr` if the
+     element isn't part of the document.
+     */
+    const CFI::ComponentList* PathToElement(xmlNodePtr element, PathCache& cache) const;
+    
+};
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__cfi_resolver__) */
@@ -25,6 +25,9 @@
 #include "archive_xml.h"
 #include "xpath_wrangler.h"
 #include "byte_stream.h"
+#include "font_obfuscation.h"
+#include "executor.h"
+#include <functional>
 
 EPUB3_BEGIN_NAMESPACE
 
@@ -34,10 +37,40 @@ static const char * gRootfilesXPath = "/ocf:container/ocf:rootfiles/ocf:rootfile
 static const char * gRootfilePathsXPath = "/ocf:container/ocf:rootfiles/ocf:rootfile/@full-path";
 static const char * gVersionXPath = "/ocf:container/@version";
 
-Container::Container() : _archive(nullptr), _ocf(nullptr), _packages(), _encryption()
+static inline int _HexDigitValue(char ch)
 {
+    if ( ch >= '0' && ch <= '9' )
+        return ch - '0';
+    if ( ch >= 'a' && ch <= 'f' )
+        return ch - 'a' + 10;
+    if ( ch >= 'A' && ch <= 'F' )
+        return ch - 'A' + 10;
+    return -1;
 }
-Container::Container(Container&& o) : _archive(std::move(o._archive)), _ocf(o._ocf), _packages(std::move(o._packages))
+
+// true if a path has a leading slash, empty components, or '.'/'..' components
+static bool _NeedsResolution(const std::string& path)
+{
+    if ( path.empty() )
+        return false;
+    if ( path[0] == '/' || path.find("//") != std::string::npos || path.find("./") != std::string::npos )
+        return true;
+    
+    std::string::size_type tail = path.rfind('/');
+    tail = (tail == std::string::npos ? 0 : tail+1);
+    return path.compare(tail, std::string::npos, ".") == 0 || path.compare(tail, std::string::npos, "..") == 0;
+}
+
+// true if NormalizedPath() would return the path unchanged
+static inline bool _IsNormalized(const std::string& path)
+{
+    return path.find('%') == std::string::npos && !_NeedsResolution(path);
+}
+
+Container::Container() : _archive(nullptr), _ocf(nullptr), _packages(), _encryption(), _obfuscationKeys(), _encryptionIndex()
+{
+}
+Container::Container(Container&& o) : _archive(std::move(o._archive)), _ocf(o._ocf), _packages(std::move(o._packages)), _encryption(std::move(o._encryption)), _obfuscationKeys(std::move(o._obfuscationKeys)), _encryptionIndex(std::move(o._encryptionIndex))
 {
     o._ocf = nullptr;
 }
@@ -46,12 +79,43 @@ Container::~Container()
     if ( _ocf != nullptr )
         xmlFreeDoc(_ocf);
 }
+size_t Container::EstimatedMemoryUsage() const
+{
+    size_t total = sizeof(Container) + XMLDocumentFootprint(_ocf);
+    for ( auto& pkg : _packages )
+    {
+        total += pkg->EstimatedMemoryUsage();
+    }
+    
+    total += _encryption.size() * sizeof(EncryptionInfo);
+    total += _encryptionIndex.size() * (sizeof(std::string) + sizeof(shared_ptr<EncryptionInfo>));
+    return total;
+}
 bool Container::Open(const string& path)
 {
-    ContainerPtr sharedThis(shared_from_this());
+    OpenArchive(path);
+    
+    PackageList parsed;
+    if ( !ParsePackageDocuments(parsed) )
+        return false;
+    
+    UnpackPackages(parsed);
+    for ( auto& pkg : _packages )
+    {
+        pkg->InstallNavigationTables(pkg->LoadNavigationTables());
+    }
+    
+    return true;
+}
+void Container::OpenArchive(const string& path)
+{
     _archive = std::move(Archive::Open(path.stl_str()));
     if ( _archive == nullptr )
         throw std::invalid_argument(_Str("Path does not point to a recognised archive file: '", path, "'"));
+}
+bool Container::ParsePackageDocuments(PackageList& packages)
+{
+    ContainerPtr sharedThis(shared_from_this());
     
     // TODO: Initialize lazily? Doing so would make initialization faster, but require
     // PackageLocations() to become non-const, like Packages().
@@ -84,12 +148,27 @@ bool Container::Open(const string& path)
             continue;
         
         auto pkg = std::make_shared<Package>(sharedThis, type);
-        if ( pkg->Open(_path) )
+        if ( pkg->PackageBase::Open(_path) )
+            packages.push_back(pkg);
+    }
+    
+    return true;
+}
+void Container::UnpackPackages(const PackageList& packages)
+{
+    for ( auto& pkg : packages )
+    {
+        if ( pkg->UnpackContents() )
             _packages.push_back(pkg);
     }
 
     LoadEncryption();
-    return true;
+    
+    // filter applicability depends upon encryption information, so refresh it now
+    for ( auto& pkg : _packages )
+    {
+        pkg->ResolveContentFilters();
+    }
 }
 shared_ptr<Container> Container::OpenContainer(const string &path)
 {
@@ -98,6 +177,167 @@ shared_ptr<Container> Container::OpenContainer(const string &path)
         return nullptr;
     return container;
 }
+std::future<ContainerPtr> Container::OpenContainerAsync(const string& path)
+{
+    // libxml2 must be initialized before it's used from several threads
+    xmlInitParser();
+    
+    ErrorHandlerFn handler = ErrorHandler();
+    return Executor::Shared()->Submit([path, handler]() {
+        ErrorHandlerScope errors(handler);
+        return OpenContainer(path);
+    });
+}
+Container::AsyncOpenPtr Container::OpenContainerAsync(const string& path, RunLoop* runLoop, OpenProgressFn callback)
+{
+    // libxml2 must be initialized before it's used from several threads
+    xmlInitParser();
+    
+    AsyncOpenPtr op = std::make_shared<AsyncOpen>();
+    ErrorHandlerFn handler = ErrorHandler();
+    Executor::Shared()->Post([path, runLoop, callback, op, handler]() {
+        ErrorHandlerScope errors(handler);
+        ContainerPtr container;
+        
+        // once unpacked, the packages may already be in use, so they mustn't be left
+        //  waiting for navigation documents nobody will collect
+        auto discardNavigation = [&container]() {
+            if ( !bool(container) )
+                return;
+            for ( auto& pkg : container->Packages() )
+                pkg->DiscardPendingNavigation();
+        };
+        
+        try
+        {
+            container = std::make_shared<Container>();
+            
+            container->OpenArchive(path);
+            if ( op->IsCancelled() )
+                return ReportOpenStage(op, runLoop, callback, OpenStage::Cancelled, nullptr, nullptr);
+            ReportOpenStage(op, runLoop, callback, OpenStage::ArchiveIndexed, nullptr, nullptr);
+            
+            PackageList parsed;
+            if ( !container->ParsePackageDocuments(parsed) )
+                return ReportOpenStage(op, runLoop, callback, OpenStage::Failed, nullptr, nullptr);
+            if ( op->IsCancelled() )
+                return ReportOpenStage(op, runLoop, callback, OpenStage::Cancelled, nullptr, nullptr);
+            ReportOpenStage(op, runLoop, callback, OpenStage::PackagesParsed, nullptr, nullptr);
+            
+            container->UnpackPackages(parsed);
+            if ( op->IsCancelled() )
+            {
+                discardNavigation();
+                return ReportOpenStage(op, runLoop, callback, OpenStage::Cancelled, nullptr, nullptr);
+            }
+            ReportOpenStage(op, runLoop, callback, OpenStage::SpineReady, container, nullptr);
+            
+            // the tables are built here, but the packages may be in use on the run loop
+            //  by now, so they're installed there
+            auto tables = std::make_shared<std::vector<PackageBase::NavigationMap>>();
+            for ( auto& pkg : container->Packages() )
+            {
+                if ( op->IsCancelled() )
+                {
+                    discardNavigation();
+                    return ReportOpenStage(op, runLoop, callback, OpenStage::Cancelled, nullptr, nullptr);
+                }
+                tables->push_back(pkg->LoadNavigationTables());
+            }
+            
+            ReportOpenStage(op, runLoop, callback, OpenStage::NavigationReady, container, nullptr, [container, tables]() {
+                for ( size_t i = 0; i < tables->size(); i++ )
+                {
+                    container->Packages()[i]->InstallNavigationTables(std::move(tables->at(i)));
+                }
+            });
+        }
+        catch (...)
+        {
+            discardNavigation();
+            ReportOpenStage(op, runLoop, callback, OpenStage::Failed, nullptr, std::current_exception());
+        }
+    });
+    
+    return op;
+}
+void Container::ReportOpenStage(const AsyncOpenPtr& op, RunLoop* runLoop, const OpenProgressFn& callback, OpenStage stage, ContainerPtr container, std::exception_ptr error, std::function<void()> before)
+{
+    auto report = [op, callback, stage, container, error, before]() {
+        if ( op->_finished )
+            return;
+        
+        // a cancellation which arrives while a report is on its way replaces the report
+        if ( op->IsCancelled() || stage == OpenStage::Cancelled )
+        {
+            op->_finished = true;
+            callback(OpenStage::Cancelled, nullptr, nullptr);
+            return;
+        }
+        
+        if ( stage == OpenStage::NavigationReady || stage == OpenStage::Failed )
+            op->_finished = true;
+        if ( before )
+            before();
+        callback(stage, container, error);
+    };
+    
+    if ( runLoop != nullptr )
+        runLoop->PerformFunction(report);
+    else
+        report();
+}
+Container::PathList Container::PackageUniqueIDsAtPath(const string& path)
+{
+    unique_ptr<Archive> archive = Archive::Open(path.stl_str());
+    if ( archive == nullptr )
+        throw std::invalid_argument(_Str("Path does not point to a recognised archive file: '", path, "'"));
+    
+    PathList output;
+    unique_ptr<ArchiveReader> ocfReader = archive->ReaderAtPath(gContainerFilePath);
+    if ( !ocfReader )
+        return output;
+    
+    xmlDocPtr ocf = nullptr;
+    {
+        ArchiveXmlReader reader(std::move(ocfReader));
+        ocf = reader.xmlReadDocument(gContainerFilePath, nullptr, XML_PARSE_RECOVER|XML_PARSE_NOENT|XML_PARSE_DTDATTR);
+    }
+    if ( ocf == nullptr )
+        return output;
+    
+    PathList packagePaths;
+    {
+#if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
+        XPathWrangler xpath(ocf, {{"ocf", "urn:oasis:names:tc:opendocument:xmlns:container"}});
+#else
+        XPathWrangler::NamespaceList __ns;
+        __ns["ocf"] = "urn:oasis:names:tc:opendocument:xmlns:container";
+        XPathWrangler xpath(ocf, __ns);
+#endif
+        packagePaths = xpath.Strings(gRootfilePathsXPath);
+    }
+    xmlFreeDoc(ocf);
+    
+    for ( auto& packagePath : packagePaths )
+    {
+        unique_ptr<ArchiveReader> opfReader = archive->ReaderAtPath(packagePath);
+        if ( !opfReader )
+            continue;
+        
+        ArchiveXmlReader reader(std::move(opfReader));
+        xmlDocPtr opf = reader.xmlReadDocument(packagePath.c_str(), nullptr, XML_PARSE_RECOVER|XML_PARSE_NOENT|XML_PARSE_DTDATTR);
+        if ( opf == nullptr )
+            continue;
+        
+        string uid = Package::UniqueIDForPackageDocument(opf);
+        xmlFreeDoc(opf);
+        if ( !uid.empty() )
+            output.push_back(uid);
+    }
+    
+    return output;
+}
 Container::PathList Container::PackageLocations() const
 {
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
@@ -172,20 +412,130 @@ void Container::LoadEncryption()
     {
         auto encPtr = std::make_shared<EncryptionInfo>(sharedThis);
         if ( encPtr->ParseXML(nodes->nodeTab[i]) )
+        {
             _encryption.push_back(encPtr);
+            
+            // derive each obfuscation key just once, the first time its algorithm is seen
+            FontObfuscationKey::Algorithm alg;
+            if ( FontObfuscationKey::AlgorithmForIdentifier(encPtr->Algorithm(), &alg) && _obfuscationKeys.find(encPtr->Algorithm()) == _obfuscationKeys.end() )
+            {
+                FontObfuscationKeyPtr key = FontObfuscationKey::KeyForContainer(this, alg);
+                if ( key )
+                    _obfuscationKeys[encPtr->Algorithm()] = key;
+            }
+        }
     }
     
     xmlXPathFreeNodeSet(nodes);
+    BuildEncryptionIndex();
 }
-shared_ptr<EncryptionInfo> Container::EncryptionInfoForPath(const string &path) const
+void Container::BuildEncryptionIndex()
+{
+    _encryptionIndex.clear();
+    _encryptionIndex.reserve(_encryption.size());
+    for ( auto& item : _encryption )
+    {
+        std::string key = NormalizedPath(item->Path());
+        
+        // first entry for a path wins, as with the original linear search
+        _encryptionIndex.insert(EncryptionIndex::value_type(std::move(key), item));
+    }
+}
+std::string Container::NormalizedPath(const string& path)
 {
-    for ( auto item : _encryption )
+    const std::string& in = path.stl_str();
+    std::string decoded;
+    decoded.reserve(in.size());
+    
+    for ( std::string::size_type i = 0; i < in.size(); i++ )
+    {
+        char ch = in[i];
+        if ( ch == '%' && i+2 < in.size() )
+        {
+            int hi = _HexDigitValue(in[i+1]), lo = _HexDigitValue(in[i+2]);
+            // an escaped '/' is part of a name, not a separator, so it stays escaped
+            if ( hi >= 0 && lo >= 0 && ((hi << 4) | lo) != '/' )
+            {
+                decoded.push_back(static_cast<char>((hi << 4) | lo));
+                i += 2;
+                continue;
+            }
+        }
+        decoded.push_back(ch);
+    }
+    
+    // fast path: nothing to resolve
+    if ( !_NeedsResolution(decoded) )
+        return decoded;
+    
+    std::vector<std::string> components;
+    std::string::size_type start = 0;
+    while ( start <= decoded.size() )
+    {
+        std::string::size_type end = decoded.find('/', start);
+        if ( end == std::string::npos )
+            end = decoded.size();
+        
+        std::string component = decoded.substr(start, end-start);
+        if ( component == ".." )
+        {
+            if ( !components.empty() )
+                components.pop_back();
+        }
+        else if ( !component.empty() && component != "." )
+        {
+            components.push_back(std::move(component));
+        }
+        
+        start = end + 1;
+    }
+    
+    std::string result;
+    result.reserve(decoded.size());
+    for ( auto& component : components )
     {
-        if ( item->Path() == path )
-            return item;
+        if ( !result.empty() )
+            result.push_back('/');
+        result.append(component);
     }
     
-    return nullptr;
+    return result;
+}
+const shared_ptr<EncryptionInfo>* Container::FindEncryptionInfo(const string& path) const
+{
+    if ( _encryptionIndex.empty() )
+        return nullptr;
+    
+    // most lookups use the same form of the path as encryption.xml, so try that before normalizing
+    const std::string& raw = path.stl_str();
+    auto found = _encryptionIndex.find(raw);
+    if ( found != _encryptionIndex.end() )
+        return &found->second;
+    if ( _IsNormalized(raw) )
+        return nullptr;
+    
+    found = _encryptionIndex.find(NormalizedPath(path));
+    if ( found == _encryptionIndex.end() )
+        return nullptr;
+    return &found->second;
+}
+bool Container::IsEncrypted(const string &path) const
+{
+    return FindEncryptionInfo(path) != nullptr;
+}
+shared_ptr<EncryptionInfo> Container::EncryptionInfoForPath(const string &path) const
+{
+    const shared_ptr<EncryptionInfo>* found = FindEncryptionInfo(path);
+    if ( found == nullptr )
+        return nullptr;
+    return *found;
+}
+FontObfuscationKeyPtr Container::ObfuscationKeyForAlgorithm(const string& algorithm) const
+{
+    auto found = _obfuscationKeys.find(algorithm);
+    if ( found == _obfuscationKeys.end() )
+        return nullptr;
+    return found->second;
 }
 unique_ptr<ByteStream> Container::ReadStreamAtPath(const string &path) const
 {
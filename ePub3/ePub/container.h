@@ -30,11 +30,18 @@
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
 #include <vector>
+#include <map>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <unordered_map>
 
 EPUB3_BEGIN_NAMESPACE
 
 class Archive;
 class ByteStream;
+class RunLoop;
 
 class Container;
 typedef shared_ptr<Container>   ContainerPtr;
@@ -66,6 +73,61 @@ public:
     ///
     /// A list of encryption information.
     typedef shared_vector<EncryptionInfo>       EncryptionList;
+    ///
+    /// A lookup table of font obfuscation keys, indexed by algorithm identifier.
+    typedef std::map<string, FontObfuscationKeyPtr> ObfuscationKeyMap;
+    ///
+    /// A hashed lookup table of encryption information, indexed by normalized path.
+    typedef std::unordered_map<std::string, shared_ptr<EncryptionInfo>> EncryptionIndex;
+    
+    ///
+    /// The stages reported by OpenContainerAsync(), in order.
+    enum class OpenStage : uint8_t
+    {
+        ArchiveIndexed,     ///< The archive has been opened and its directory read.
+        PackagesParsed,     ///< The container document and each package document have been parsed.
+        SpineReady,         ///< Manifests, spines, metadata and encryption are loaded, so content may be read.
+        NavigationReady,    ///< The navigation tables are loaded: the container is fully open.
+        Cancelled,          ///< The open was cancelled before it completed.
+        Failed              ///< The container could not be opened.
+    };
+    
+    /**
+     Receives the progress of OpenContainerAsync().
+     
+     NavigationReady, Cancelled and Failed are final: exactly one of them is reported,
+     after which the function is not called again.
+     @param stage The stage which has been reached.
+     @param container The container, from SpineReady onward; `nullptr` otherwise.
+     @param error For Failed, the exception which caused the failure, if there was one.
+     */
+    typedef std::function<void(OpenStage stage, shared_ptr<Container> container, std::exception_ptr error)>    OpenProgressFn;
+    
+    /**
+     A handle on a container being opened by OpenContainerAsync().
+     */
+    class AsyncOpen
+    {
+    public:
+                    AsyncOpen() : _cancelled(false), _finished(false) {}
+        
+        ///
+        /// Asks the open to stop once it finishes its current stage. Unless it has
+        /// already finished, it then reports OpenStage::Cancelled.
+        void        Cancel()                    { _cancelled = true; }
+        ///
+        /// Whether Cancel() has been called.
+        bool        IsCancelled()       const   { return _cancelled; }
+        
+    private:
+                    AsyncOpen(const AsyncOpen&) _DELETED_;
+        
+        std::atomic<bool>   _cancelled;
+        bool                _finished;      ///< Set once a final stage is reported; only used by the reporting thread.
+        
+        friend class Container;
+    };
+    typedef shared_ptr<AsyncOpen>               AsyncOpenPtr;
 
 private:
     ///
@@ -91,6 +153,67 @@ public:
     /// Creates and returns a new Container instance.
     static shared_ptr<Container>    OpenContainer(const string& path);
     
+    /**
+     Creates and returns a new Container instance, opening it on the shared Executor.
+     
+     Errors raised while opening the container go to the error handler which is
+     current on the calling thread when this is called, so a handler installed with
+     an ErrorHandlerScope applies to the containers opened within it.
+     @param path The path of the archive.
+     @result A future for the new container, or for any exception thrown while
+     opening it.
+     @see Executor::Shared()
+     @see ErrorHandler()
+     */
+    EPUB3_EXPORT
+    static std::future<ContainerPtr>    OpenContainerAsync(const string& path);
+    
+    /**
+     Opens a container on the shared Executor, reporting each stage as it's reached.
+     
+     The archive is opened, then the container and package documents are parsed,
+     then the packages are unpacked and the encryption information loaded. The
+     container is then passed to the callback (OpenStage::SpineReady), so that its
+     content can be displayed while the navigation documents are still being parsed;
+     the navigation tables are installed just before OpenStage::NavigationReady is
+     reported.
+     
+     Cancellation is cooperative: the work stops at the end of its current stage.
+     
+     As with OpenContainerAsync(const string&), errors raised while opening the
+     container go to the error handler which is current on the calling thread when
+     this is called, rather than that of the worker thread.
+     @param path The path of the archive.
+     @param runLoop The RunLoop on which to call `callback`. The container must only
+     be used on that RunLoop's thread until NavigationReady is reported. If
+     `nullptr`, the callback is called on a worker thread, and the container must
+     not be used elsewhere before NavigationReady.
+     
+     Between SpineReady and NavigationReady the navigation documents are still being
+     read on a worker thread, so the packages must be treated as read-only: calling
+     Package::Open() meanwhile throws `std::logic_error`. Adding or removing content
+     filters is safe, as each change publishes a new, immutable filter set.
+     @param callback The function to receive progress.
+     @result A handle which may be used to cancel the open.
+     */
+    EPUB3_EXPORT
+    static AsyncOpenPtr             OpenContainerAsync(const string& path, RunLoop* runLoop, OpenProgressFn callback);
+    
+    /**
+     Reads the unique identifiers of a container's packages, without opening it.
+     
+     Only the container document and each package document are parsed; no Package
+     instances are created, so this is much cheaper than OpenContainer() when only
+     the identifiers are needed, e.g. when cataloguing a library.
+     @param path The path of the archive.
+     @result The unique identifier of each package, as returned by
+     Package::UniqueID(). Packages without one are skipped, and the result is empty
+     if the archive has no container document.
+     @throws std::invalid_argument if the path isn't a recognized archive.
+     */
+    EPUB3_EXPORT
+    static PathList                 PackageUniqueIDsAtPath(const string& path);
+    
     virtual         ~Container();
     
     ///
@@ -124,6 +247,41 @@ public:
      */
     virtual shared_ptr<EncryptionInfo>    EncryptionInfoForPath(const string& path)   const;
     
+    /**
+     Determines whether a resource is encrypted.
+     
+     This is equivalent to testing the result of EncryptionInfoForPath(), without
+     copying the shared pointer. Paths already in the form used by the encryption
+     information are looked up directly; only others are normalized.
+     @param path A container-relative path to the item to check.
+     @result Returns `true` if the container has encryption information for the resource.
+     */
+    virtual bool                    IsEncrypted(const string& path)             const;
+    
+    /**
+     Normalizes a container-relative path for use as a lookup key.
+     
+     Leading slashes are removed, percent-escapes are decoded, and any `.` or `..`
+     path components are resolved. An escaped slash (`%2F`) is left as it is, since
+     it names part of a file name rather than separating two components.
+     @param path The path to normalize.
+     @result The normalized path.
+     */
+    static std::string              NormalizedPath(const string& path);
+    
+    /**
+     Retrieves the font obfuscation key for this container.
+     
+     Keys are derived once, when the container's encryption information is loaded,
+     for each obfuscation algorithm referenced in META-INF/encryption.xml. The
+     returned key is immutable and may be shared freely between filters and threads.
+     @param algorithm The obfuscation algorithm identifier, as found in
+     EncryptionInfo::Algorithm().
+     @result The key for that algorithm, or `nullptr` if the container has no
+     resources obfuscated using the algorithm.
+     */
+    virtual FontObfuscationKeyPtr   ObfuscationKeyForAlgorithm(const string& algorithm) const;
+    
     /**
      Obtains a pointer to a ReadStream for a specific file within the container.
      @param path A container-relative path to the file whose data to read.
@@ -132,6 +290,16 @@ public:
      */
     virtual unique_ptr<ByteStream>  ReadStreamAtPath(const string& path)        const;
     
+    /**
+     Estimates the memory used by the container and its packages.
+     
+     This covers the parsed OCF and package documents and the objects built from
+     them, but not the buffers of the underlying archive.
+     @result The estimated size in bytes.
+     */
+    EPUB3_EXPORT
+    size_t                          EstimatedMemoryUsage()  const;
+    
     ///
     /// The underlying archive.
     shared_ptr<Archive>             GetArchive()            const   { return _archive; }
@@ -142,10 +310,41 @@ protected:
     xmlDocPtr           _ocf;
     PackageList         _packages;
     EncryptionList      _encryption;
+    ObfuscationKeyMap   _obfuscationKeys;
+    EncryptionIndex     _encryptionIndex;
+    
+    ///
+    /// Opens the archive at a given path.
+    /// @throws std::invalid_argument if the path isn't a recognized archive.
+    void            OpenArchive(const string& path);
+    
+    /**
+     Parses the container document and the package documents it lists.
+     @param packages Receives the packages whose documents were parsed.
+     @result Returns `false` if there is no container document, or it lists no packages.
+     */
+    bool            ParsePackageDocuments(PackageList& packages);
+    
+    ///
+    /// Unpacks all but the navigation tables of the given packages, keeping those which
+    /// succeed, then loads the encryption information.
+    void            UnpackPackages(const PackageList& packages);
+    
+    ///
+    /// Calls an OpenContainerAsync() callback, on the run loop if there is one.
+    static void     ReportOpenStage(const AsyncOpenPtr& op, RunLoop* runLoop, const OpenProgressFn& callback, OpenStage stage, shared_ptr<Container> container, std::exception_ptr error, std::function<void()> before=nullptr);
     
     ///
     /// Parses the file META-INF/encryption.xml into an EncryptionList.
     void            LoadEncryption();
+    
+    ///
+    /// Builds the encryption index from the EncryptionList.
+    void            BuildEncryptionIndex();
+    
+    ///
+    /// Looks up a path in the encryption index, normalizing it only if it isn't found as-is.
+    const shared_ptr<EncryptionInfo>*   FindEncryptionInfo(const string& path)  const;
 };
 
 EPUB3_END_NAMESPACE
@@ -0,0 +1,371 @@
+//
+//  decryption.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// OpenSSL APIs are deprecated on OS X and iOS
+#if EPUB_OS(DARWIN)
+#include <CommonCrypto/CommonCryptor.h>
+#elif !EPUB_PLATFORM(WIN)
+#include <openssl/evp.h>
+#endif
+
+#include "decryption.h"
+#include <ePub3/utilities/error_handler.h>
+#include <algorithm>
+#include <cstring>
+
+EPUB3_BEGIN_NAMESPACE
+
+#if !EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
+const char * const DecryptionFilter::AES128CBCAlgorithmID = "http://www.w3.org/2001/04/xmlenc#aes128-cbc";
+const char * const DecryptionFilter::AES256CBCAlgorithmID = "http://www.w3.org/2001/04/xmlenc#aes256-cbc";
+#endif
+
+const size_t DecryptionFilter::BlockSize;
+
+DecryptionFilter::KeyProviderFn DecryptionFilter::gKeyProvider;
+std::mutex DecryptionFilter::gKeyProviderLock;
+
+// size of each output chunk produced by the inflater
+static const size_t gInflateChunkSize = 16*1024;
+
+/**
+ Wraps the platform's AES-CBC implementation.
+
+ Padding is always disabled: XML-ENC uses its own padding scheme, which the filter
+ removes from the final block itself.
+ */
+class DecryptionFilter::DecryptionContext::CipherContext
+{
+public:
+    static CipherContext* Create(const std::vector<uint8_t>& key, const uint8_t* iv)
+    {
+#if EPUB_OS(DARWIN)
+        CCCryptorRef ref = nullptr;
+        if ( CCCryptorCreate(kCCDecrypt, kCCAlgorithmAES128, 0, key.data(), key.size(), iv, &ref) != kCCSuccess )
+            return nullptr;
+        return new CipherContext(ref);
+#elif EPUB_PLATFORM(WIN)
+        return nullptr;
+#else
+        const EVP_CIPHER* cipher = (key.size() == 32 ? EVP_aes_256_cbc() : EVP_aes_128_cbc());
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        if ( ctx == nullptr )
+            return nullptr;
+        if ( EVP_DecryptInit_ex(ctx, cipher, nullptr, key.data(), iv) != 1 )
+        {
+            EVP_CIPHER_CTX_free(ctx);
+            return nullptr;
+        }
+        EVP_CIPHER_CTX_set_padding(ctx, 0);
+        return new CipherContext(ctx);
+#endif
+    }
+
+    ~CipherContext()
+    {
+#if EPUB_OS(DARWIN)
+        CCCryptorRelease(_ctx);
+#elif !EPUB_PLATFORM(WIN)
+        EVP_CIPHER_CTX_free(_ctx);
+#endif
+    }
+
+    // `len` must be a multiple of the block size; `out` must hold `len` bytes
+    bool Update(const uint8_t* in, size_t len, uint8_t* out)
+    {
+#if EPUB_OS(DARWIN)
+        size_t moved = 0;
+        return CCCryptorUpdate(_ctx, in, len, out, len, &moved) == kCCSuccess && moved == len;
+#elif EPUB_PLATFORM(WIN)
+        return false;
+#else
+        int outLen = 0;
+        return EVP_DecryptUpdate(_ctx, out, &outLen, in, static_cast<int>(len)) == 1 && size_t(outLen) == len;
+#endif
+    }
+
+private:
+#if EPUB_OS(DARWIN)
+    typedef CCCryptorRef        context_type;
+#elif EPUB_PLATFORM(WIN)
+    typedef void*               context_type;
+#else
+    typedef EVP_CIPHER_CTX*     context_type;
+#endif
+
+    CipherContext(context_type ctx) : _ctx(ctx) {}
+
+    context_type                _ctx;
+};
+
+size_t DecryptionFilter::KeyLengthForAlgorithm(const string& algorithm)
+{
+    if ( algorithm == AES128CBCAlgorithmID )
+        return 16;
+    if ( algorithm == AES256CBCAlgorithmID )
+        return 32;
+    return 0;
+}
+bool DecryptionFilter::PlatformCanDecrypt()
+{
+#if EPUB_PLATFORM(WIN)
+    // no CryptoAPI implementation yet
+    return false;
+#else
+    return true;
+#endif
+}
+DecryptionFilter::KeyProviderFn DecryptionFilter::KeyProvider()
+{
+    std::lock_guard<std::mutex> _(gKeyProviderLock);
+    return gKeyProvider;
+}
+void DecryptionFilter::SetKeyProvider(KeyProviderFn fn)
+{
+    std::lock_guard<std::mutex> _(gKeyProviderLock);
+    gKeyProvider = fn;
+}
+
+DecryptionFilter::DecryptionContext::DecryptionContext() : FilterContext(), _key(), _path(), _pending(), _cipher(), _inflater(), _finished(false)
+{
+}
+DecryptionFilter::DecryptionContext::~DecryptionContext()
+{
+    if ( _inflater )
+        inflateEnd(_inflater.get());
+}
+DecryptionFilter::DecryptionFilter(KeyProviderFn keyProvider) : ContentFilter(DecryptionTypeSniffer), _keyProvider(keyProvider ? keyProvider : KeyProvider()), _encInfo()
+{
+}
+DecryptionFilter::DecryptionFilter(shared_ptr<EncryptionInfo> encInfo, KeyProviderFn keyProvider) : ContentFilter(DecryptionTypeSniffer), _keyProvider(keyProvider ? keyProvider : KeyProvider()), _encInfo(encInfo)
+{
+}
+unique_ptr<FilterContext> DecryptionFilter::MakeFilterContext(const ManifestItem* /*item*/, const EncryptionInfo* encInfo) const
+{
+    unique_ptr<DecryptionContext> ctx(new DecryptionContext);
+    if ( encInfo == nullptr )
+        encInfo = _encInfo.get();
+    if ( encInfo == nullptr )
+        return ctx;
+    
+    ctx->_path = encInfo->Path();
+    size_t keyLen = KeyLengthForAlgorithm(encInfo->Algorithm());
+    if ( keyLen == 0 )
+        return ctx;
+    
+    if ( !PlatformCanDecrypt() )
+    {
+        HandleError(std::errc::operation_not_supported, _Str("Unable to decrypt '", encInfo->Path(), "': AES-CBC decryption is not available on this platform"));
+        return ctx;
+    }
+    
+    if ( !_keyProvider || !_keyProvider(encInfo, ctx->_key) || ctx->_key.size() != keyLen )
+    {
+        ctx->_key.clear();
+        HandleError(std::errc::permission_denied, _Str("No key available to decrypt '", encInfo->Path(), "'"));
+        return ctx;
+    }
+    
+    if ( encInfo->Compression() == EncryptionInfo::CompressionMethod::Deflated )
+    {
+        ctx->_inflater.reset(new z_stream);
+        std::memset(ctx->_inflater.get(), 0, sizeof(z_stream));
+        
+        // raw deflate data, as stored in a zip archive
+        if ( inflateInit2(ctx->_inflater.get(), -MAX_WBITS) != Z_OK )
+        {
+            ctx->_inflater.reset();
+            ctx->_key.clear();
+            HandleError(std::errc::not_enough_memory, _Str("Unable to inflate '", encInfo->Path(), "'"));
+        }
+    }
+    
+    return ctx;
+}
+void DecryptionFilter::DecryptionContext::Fail(const char* reason)
+{
+    _finished = true;
+    HandleError(std::errc::illegal_byte_sequence, _Str("Unable to decrypt '", _path, "': ", reason));
+}
+bool DecryptionFilter::DecryptionContext::Decrypt(const uint8_t* cipher, size_t len, std::vector<uint8_t>& plain)
+{
+    if ( !_cipher )
+    {
+        // the first block is the initialization vector
+        size_t ivBytes = std::min(BlockSize - _pending.size(), len);
+        _pending.insert(_pending.end(), cipher, cipher + ivBytes);
+        cipher += ivBytes;
+        len -= ivBytes;
+
+        if ( _pending.size() < BlockSize )
+            return true;
+
+        _cipher.reset(CipherContext::Create(_key, _pending.data()));
+        _pending.clear();
+        if ( !_cipher )
+            return false;
+    }
+
+    // withhold the final block (complete or not), since it may hold the padding
+    size_t total = _pending.size() + len;
+    size_t withheld = total % BlockSize;
+    if ( withheld == 0 )
+        withheld = std::min(total, BlockSize);
+    size_t usable = total - withheld;
+
+    if ( usable == 0 )
+    {
+        _pending.insert(_pending.end(), cipher, cipher + len);
+        return true;
+    }
+
+    plain.resize(usable);
+    uint8_t* out = plain.data();
+
+    if ( !_pending.empty() )
+    {
+        // complete the pending block from the new data; this is always usable
+        size_t fill = BlockSize - _pending.size();
+        _pending.insert(_pending.end(), cipher, cipher + fill);
+        cipher += fill;
+        len -= fill;
+
+        if ( !_cipher->Update(_pending.data(), BlockSize, out) )
+            return false;
+
+        out += BlockSize;
+        usable -= BlockSize;
+        _pending.clear();
+    }
+
+    if ( usable != 0 && !_cipher->Update(cipher, usable, out) )
+        return false;
+
+    _pending.assign(cipher + usable, cipher + len);
+    return true;
+}
+bool DecryptionFilter::DecryptionContext::Inflate(std::vector<uint8_t>& plain, bool finish)
+{
+    if ( !_inflater )
+        return true;
+
+    std::vector<uint8_t> output;
+    _inflater->next_in = plain.data();
+    _inflater->avail_in = static_cast<uInt>(plain.size());
+
+    int status = Z_OK;
+    do
+    {
+        size_t used = output.size();
+        output.resize(used + gInflateChunkSize);
+        _inflater->next_out = output.data() + used;
+        _inflater->avail_out = static_cast<uInt>(gInflateChunkSize);
+
+        status = inflate(_inflater.get(), finish ? Z_FINISH : Z_NO_FLUSH);
+        output.resize(used + gInflateChunkSize - _inflater->avail_out);
+
+        if ( status == Z_STREAM_END )
+            break;
+        if ( status != Z_OK && status != Z_BUF_ERROR )
+            return false;
+
+    } while ( _inflater->avail_in != 0 || _inflater->avail_out == 0 );
+
+    if ( finish && status != Z_STREAM_END )
+        return false;
+
+    plain.swap(output);
+    return true;
+}
+void* DecryptionFilter::FilterData(FilterContext* context, void *data, size_t len, size_t *outputLen) const
+{
+    *outputLen = 0;
+    DecryptionContext* ctx = dynamic_cast<DecryptionContext*>(context);
+    if ( ctx == nullptr || !ctx->HasKey() || ctx->_finished )
+        return nullptr;
+    
+    std::vector<uint8_t> plain;
+    if ( !ctx->Decrypt(reinterpret_cast<const uint8_t*>(data), len, plain) || !ctx->Inflate(plain, false) )
+    {
+        ctx->Fail("the data could not be decrypted");
+        return nullptr;
+    }
+    
+    *outputLen = plain.size();
+    if ( plain.size() <= len )
+    {
+        // use the incoming buffer directly
+        if ( !plain.empty() )
+            std::memcpy(data, plain.data(), plain.size());
+        return data;
+    }
+    
+    uint8_t* result = new uint8_t[plain.size()];
+    std::memcpy(result, plain.data(), plain.size());
+    return result;
+}
+void* DecryptionFilter::FinishFilter(FilterContext* context, size_t *outputLen) const
+{
+    *outputLen = 0;
+    DecryptionContext* ctx = dynamic_cast<DecryptionContext*>(context);
+    if ( ctx == nullptr || !ctx->HasKey() || ctx->_finished )
+        return nullptr;
+    
+    // the IV and at least one block of ciphertext
+    if ( !ctx->_cipher || ctx->_pending.size() != BlockSize )
+    {
+        ctx->Fail("the ciphertext is truncated");
+        return nullptr;
+    }
+    
+    ctx->_finished = true;
+    std::vector<uint8_t> plain(BlockSize);
+    if ( !ctx->_cipher->Update(ctx->_pending.data(), BlockSize, plain.data()) )
+    {
+        ctx->Fail("the data could not be decrypted");
+        return nullptr;
+    }
+    ctx->_pending.clear();
+    
+    // XML-ENC padding: the last byte holds the number of padding bytes, including itself
+    size_t padding = plain.back();
+    if ( padding == 0 || padding > BlockSize )
+    {
+        ctx->Fail("the padding is invalid");
+        return nullptr;
+    }
+    plain.resize(BlockSize - padding);
+    
+    if ( !ctx->Inflate(plain, true) )
+    {
+        ctx->Fail("the data could not be inflated");
+        return nullptr;
+    }
+    if ( plain.empty() )
+        return nullptr;
+    
+    uint8_t* result = new uint8_t[plain.size()];
+    std::memcpy(result, plain.data(), plain.size());
+    *outputLen = plain.size();
+    return result;
+}
+
+EPUB3_END_NAMESPACE
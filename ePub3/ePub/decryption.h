@@ -0,0 +1,239 @@
+//
+//  decryption.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __ePub3__decryption__
+#define __ePub3__decryption__
+
+#include <ePub3/filter.h>
+#include <ePub3/encryption.h>
+#include <zlib.h>
+#include <vector>
+#include <functional>
+#include <mutex>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ The DecryptionFilter class decrypts resources encrypted using the XML-ENC
+ AES-CBC block ciphers, as referenced from META-INF/encryption.xml.
+
+ The filter doesn't know anything about where keys come from: each resource's key
+ is requested from a KeyProviderFn, which is passed the resource's EncryptionInfo
+ (including its KeyName(), if any). A default key provider may be installed
+ globally using SetKeyProvider(), or one may be passed to each filter directly.
+
+ Data is decrypted as it arrives, one whole cipher block at a time, and only the
+ final block is withheld until FinishFilter() is called, at which point the XML-ENC
+ padding is removed. If the resource was compressed before it was encrypted, the
+ plaintext is inflated as it is produced, so neither the ciphertext nor the
+ plaintext is ever buffered in full.
+
+ As with FontObfuscator, the filter itself holds only its configuration: all
+ per-resource state lives in a DecryptionContext, so a single filter may decrypt
+ many resources concurrently.
+ @see http://www.w3.org/TR/xmlenc-core1/#sec-AES
+ @ingroup filters
+ */
+class DecryptionFilter : public ContentFilter
+{
+public:
+    /**
+     The key-provider function must match this prototype.
+     @param encInfo The encryption information for the resource being decrypted.
+     @param key Storage for the raw key bytes: 16 bytes for AES-128, 32 for AES-256.
+     @result Return `true` if a key was provided, `false` otherwise.
+     */
+    typedef std::function<bool(const EncryptionInfo* encInfo, std::vector<uint8_t>& key)> KeyProviderFn;
+
+    CONSTEXPR static EPUB3_EXPORT const char * const   AES128CBCAlgorithmID
+#if EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
+            = "http://www.w3.org/2001/04/xmlenc#aes128-cbc"
+#endif
+              ;
+    CONSTEXPR static EPUB3_EXPORT const char * const   AES256CBCAlgorithmID
+#if EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
+            = "http://www.w3.org/2001/04/xmlenc#aes256-cbc"
+#endif
+              ;
+
+    ///
+    /// The AES block size; the initialization vector is one block long.
+    static const size_t         BlockSize = 16;
+
+    /**
+     Returns the key length required by an algorithm.
+     @param algorithm An XML-ENC algorithm URI.
+     @result The key length in bytes, or zero if the algorithm is not recognized.
+     */
+    EPUB3_EXPORT
+    static size_t               KeyLengthForAlgorithm(const string& algorithm);
+    
+    ///
+    /// Returns `true` if AES-CBC decryption is implemented on this platform.
+    EPUB3_EXPORT
+    static bool                 PlatformCanDecrypt();
+
+    /**
+     The type-sniffer for decryption applicability.
+
+     Any resource whose encryption information specifies an AES-CBC algorithm will
+     be matched, regardless of its media type. This includes platforms where
+     PlatformCanDecrypt() returns `false`: there the filter reports an error rather
+     than letting the ciphertext through as content.
+     */
+    static bool DecryptionTypeSniffer(const ManifestItem* /*item*/, const EncryptionInfo* encInfo) {
+        return encInfo != nullptr && KeyLengthForAlgorithm(encInfo->Algorithm()) != 0;
+    }
+    
+    /**
+     The per-resource decryption state: the resource's key, the cipher, any
+     ciphertext withheld from the last chunk, and the inflater.
+     */
+    class DecryptionContext : public FilterContext
+    {
+    public:
+        EPUB3_EXPORT            DecryptionContext();
+        EPUB3_EXPORT virtual    ~DecryptionContext();
+        
+        ///
+        /// Returns `true` if a usable key was obtained for this resource.
+        bool                    HasKey()                const   { return !_key.empty(); }
+        
+    protected:
+        class CipherContext;
+        
+        std::vector<uint8_t>        _key;
+        string                      _path;          ///< The resource's path, for error messages.
+        std::vector<uint8_t>        _pending;       ///< Ciphertext not yet decrypted, at most one block.
+        unique_ptr<CipherContext>   _cipher;        ///< Created once the IV has been read.
+        unique_ptr<z_stream>        _inflater;      ///< Used only for compressed resources.
+        bool                        _finished;
+        
+        ///
+        /// Decrypts whole blocks from `cipher` into `plain`, consuming the IV first.
+        bool                    Decrypt(const uint8_t* cipher, size_t len, std::vector<uint8_t>& plain);
+        ///
+        /// Passes plaintext through the inflater, if the resource was compressed.
+        bool                    Inflate(std::vector<uint8_t>& plain, bool finish);
+        ///
+        /// Stops decrypting the resource and reports the reason using HandleError().
+        void                    Fail(const char* reason);
+        
+        friend class DecryptionFilter;
+    };
+    
+    /**
+     Create a decryption filter.
+     
+     The filter may be shared between threads; each resource's key is requested
+     when its context is created, so the key provider must be thread-safe.
+     @param keyProvider The function used to obtain each resource's key. If this is
+     empty, the global provider set using SetKeyProvider() is used.
+     */
+    EPUB3_EXPORT explicit       DecryptionFilter(KeyProviderFn keyProvider=KeyProviderFn());
+    /**
+     Create a decryption filter for a single resource.
+     
+     The encryption information is used whenever MakeFilterContext() is called
+     without any, which allows the single-resource FilterData(void*, size_t, size_t*)
+     convenience method to be used.
+     @param encInfo The encryption information for the resource to decrypt.
+     @param keyProvider The function used to obtain the resource's key. If this is
+     empty, the global provider set using SetKeyProvider() is used.
+     */
+    EPUB3_EXPORT                DecryptionFilter(shared_ptr<EncryptionInfo> encInfo, KeyProviderFn keyProvider=KeyProviderFn());
+    ///
+    /// Copy constructor.
+                                DecryptionFilter(const DecryptionFilter& o) : ContentFilter(o), _keyProvider(o._keyProvider), _encInfo(o._encInfo) {}
+    ///
+    /// Move constructor.
+                                DecryptionFilter(DecryptionFilter&& o) : ContentFilter(std::move(o)), _keyProvider(std::move(o._keyProvider)), _encInfo(std::move(o._encInfo)) {}
+    virtual                     ~DecryptionFilter() {}
+    
+    /**
+     Creates a DecryptionContext for a resource, obtaining its key from the key
+     provider.
+     
+     If the resource can't be decrypted, because no key was provided or because
+     this platform has no AES-CBC implementation, the failure is passed to
+     HandleError(). The default handler throws; if the handler lets processing
+     continue, the context has no key and the resource produces no data.
+     @param item The manifest item for the resource, if known.
+     @param encInfo The resource's encryption information. If `nullptr`, the
+     encryption information passed to the constructor is used instead.
+     @result A new DecryptionContext; check its HasKey() method to see whether the
+     resource can be decrypted.
+     */
+    EPUB3_EXPORT
+    virtual unique_ptr<FilterContext>   MakeFilterContext(const ManifestItem* item, const EncryptionInfo* encInfo) const;
+    
+    /**
+     Decrypts (and if necessary inflates) a chunk of resource data.
+     
+     If the output fits, it is written into `data`, which is then returned;
+     otherwise a new buffer is allocated using `new uint8_t[]`. Less data may be
+     returned than was passed in, since the last cipher block of each chunk may be
+     withheld until more data arrives. If no key could be obtained, nothing is
+     returned. Ciphertext which fails to decrypt or inflate is reported using
+     HandleError().
+     @param context A DecryptionContext created by MakeFilterContext().
+     @param data The data to process.
+     @param len The number of bytes in `data`.
+     @param outputLen Storage for the count of bytes being returned.
+     @result The decrypted bytes.
+     */
+    virtual void * FilterData(FilterContext* context, void *data, size_t len, size_t *outputLen) const;
+    
+    /**
+     Decrypts the final cipher block and removes its padding.
+     
+     Truncated ciphertext and invalid padding are reported using HandleError().
+     @param context A DecryptionContext created by MakeFilterContext().
+     @param outputLen Storage for the count of bytes being returned.
+     @result The remaining plaintext, allocated using `new uint8_t[]`, or `nullptr`.
+     */
+    virtual void * FinishFilter(FilterContext* context, size_t *outputLen) const;
+    
+    using ContentFilter::FilterData;
+    using ContentFilter::FinishFilter;
+    
+    ///
+    /// Returns the global default key provider.
+    EPUB3_EXPORT
+    static KeyProviderFn        KeyProvider();
+    ///
+    /// Installs a global default key provider, used by filters created afterwards.
+    /// Filters which already exist keep the provider they were created with.
+    EPUB3_EXPORT
+    static void                 SetKeyProvider(KeyProviderFn fn);
+    
+protected:
+    KeyProviderFn               _keyProvider;
+    shared_ptr<EncryptionInfo>  _encInfo;       ///< Used only when no other encryption information is supplied.
+    
+    static KeyProviderFn        gKeyProvider;
+    static std::mutex           gKeyProviderLock;
+    
+};
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__decryption__) */
@@ -21,17 +21,19 @@
 
 #include "encryption.h"
 #include "xpath_wrangler.h"
+#include <cstdlib>
 
 EPUB3_BEGIN_NAMESPACE
 
 bool EncryptionInfo::ParseXML(xmlNodePtr node)
 {
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
-    XPathWrangler xpath(node->doc, {{"enc", XMLENCNamespaceURI}, {"dsig", XMLDSigNamespaceURI}});
+    XPathWrangler xpath(node->doc, {{"enc", XMLENCNamespaceURI}, {"dsig", XMLDSigNamespaceURI}, {"comp", OCFCompressionNamespaceURI}});
 #else
     XPathWrangler::NamespaceList nsList;
     nsList["enc"] = XMLENCNamespaceURI;
     nsList["dsig"] = XMLDSigNamespaceURI;
+    nsList["comp"] = OCFCompressionNamespaceURI;
     XPathWrangler xpath(node->doc, nsList);
 #endif
     
@@ -46,6 +48,23 @@ bool EncryptionInfo::ParseXML(xmlNodePtr node)
         return false;
     
     _path = strings[0];
+    
+    // the remaining details are optional
+    strings = xpath.Strings("./dsig:KeyInfo/dsig:KeyName", node);
+    if ( strings.empty() )
+        strings = xpath.Strings("./dsig:KeyInfo/dsig:RetrievalMethod/@URI", node);
+    if ( !strings.empty() )
+        _keyName = strings[0];
+    
+    strings = xpath.Strings("./enc:EncryptionProperties/enc:EncryptionProperty/comp:Compression/@Method", node);
+    if ( !strings.empty() && strings[0] == "8" )
+    {
+        _compression = CompressionMethod::Deflated;
+        strings = xpath.Strings("./enc:EncryptionProperties/enc:EncryptionProperty/comp:Compression/@OriginalLength", node);
+        if ( !strings.empty() )
+            _originalLength = static_cast<size_t>(strtoull(strings[0].c_str(), nullptr, 10));
+    }
+    
     return true;
 }
 
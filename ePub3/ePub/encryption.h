@@ -28,13 +28,19 @@
 EPUB3_BEGIN_NAMESPACE
 
 class Container;
+class FontObfuscationKey;
+
+///
+/// Font obfuscation key material is immutable once built, and is shared between filters.
+typedef shared_ptr<const FontObfuscationKey>    FontObfuscationKeyPtr;
 
 /**
  Contains details on the encryption of a single resource.
  
- At present this class holds only two pieces of information: A resource path and an
- encyption algorithm identifier (a URI string). This is all that's needed to support
- EPUB font obfuscation.
+ At present this class holds a resource path and an encyption algorithm identifier
+ (a URI string), which is all that's needed to support EPUB font obfuscation. It
+ also records the name of the key used to encrypt the resource, if any, and whether
+ the resource was compressed before it was encrypted, which DecryptionFilter needs.
  
  In future, this class will grow to encapsulate all information from the XML-ENC
  specification.
@@ -50,16 +56,24 @@ public:
     /// Encryption algorithms are URIs compared as strings.
     typedef string                  algorithm_type;
     
+    ///
+    /// Compression methods which may be applied before encryption, as per zip.
+    enum class CompressionMethod : uint16_t
+    {
+        Stored      = 0,        ///< The resource was not compressed.
+        Deflated    = 8         ///< The resource was compressed using raw Deflate.
+    };
+    
 public:
     ///
     /// Creates a new EncryptionInfo with no details filled in.
-                    EncryptionInfo(shared_ptr<Container>& owner) : OwnedBy(owner), _algorithm(), _path() {}
+                    EncryptionInfo(shared_ptr<Container>& owner) : OwnedBy(owner), _algorithm(), _path(), _keyName(), _compression(CompressionMethod::Stored), _originalLength(0) {}
     ///
     /// Copy constructor.
-                    EncryptionInfo(const EncryptionInfo& o) : OwnedBy(o), _algorithm(o._algorithm), _path(o._path) {}
+                    EncryptionInfo(const EncryptionInfo& o) : OwnedBy(o), _algorithm(o._algorithm), _path(o._path), _keyName(o._keyName), _compression(o._compression), _originalLength(o._originalLength) {}
     ///
     /// Move constructor.
-                    EncryptionInfo(EncryptionInfo&& o) : OwnedBy(std::move(o)), _algorithm(std::move(o._algorithm)), _path(std::move(o._path)) {}
+                    EncryptionInfo(EncryptionInfo&& o) : OwnedBy(std::move(o)), _algorithm(std::move(o._algorithm)), _path(std::move(o._path)), _keyName(std::move(o._keyName)), _compression(o._compression), _originalLength(o._originalLength) {}
     virtual         ~EncryptionInfo() {}
     
     
@@ -91,9 +105,30 @@ public:
     virtual void                    SetPath(const string& path)                     { _path = path; }
     virtual void                    SetPath(string&& path)                          { _path = path; }
     
+    ///
+    /// Returns the name of the key used to encrypt the resource, from `ds:KeyInfo`.
+    /// This is either a `ds:KeyName` value or a `ds:RetrievalMethod` URI.
+    virtual const string&           KeyName()                               const   { return _keyName; }
+    ///
+    /// Assigns the name of the key used to encrypt the resource.
+    virtual void                    SetKeyName(const string& name)                  { _keyName = name; }
+    
+    ///
+    /// Returns the compression applied to the resource before it was encrypted.
+    virtual CompressionMethod       Compression()                           const   { return _compression; }
+    ///
+    /// Returns the length of the resource before compression and encryption, if known.
+    virtual size_t                  OriginalLength()                        const   { return _originalLength; }
+    ///
+    /// Records the compression applied to the resource before it was encrypted.
+    virtual void                    SetCompression(CompressionMethod method, size_t originalLength=0)   { _compression = method; _originalLength = originalLength; }
+    
 protected:
     algorithm_type  _algorithm;     ///< The algorithm identifier, as per XML-ENC or OCF.
     string          _path;          ///< The Container-relative path to an encrypted resource.
+    string          _keyName;       ///< The name or retrieval URI of the encryption key.
+    CompressionMethod   _compression;   ///< Compression applied prior to encryption.
+    size_t          _originalLength;    ///< The uncompressed length of the resource, or zero.
 
 };
 
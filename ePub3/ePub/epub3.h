@@ -39,6 +39,7 @@
 #define OCFNamespaceURI "urn:oasis:names:tc:opendocument:xmlns:container"
 #define XMLENCNamespaceURI "http://www.w3.org/2001/04/xmlenc#"
 #define XMLDSigNamespaceURI "http://www.w3.org/2000/09/xmldsig#"
+#define OCFCompressionNamespaceURI "http://www.idpf.org/2016/encryption#compression"
 
 EPUB3_BEGIN_NAMESPACE
 
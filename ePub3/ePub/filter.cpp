@@ -0,0 +1,177 @@
+//
+//  filter.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "filter.h"
+#include <algorithm>
+#include <stdexcept>
+
+EPUB3_BEGIN_NAMESPACE
+
+// clears ContentFilter::_forwardingToLegacy however the legacy call ends
+class __LegacyForwarding
+{
+public:
+    __LegacyForwarding(std::atomic<bool>& flag) : _flag(flag) { _flag = true; }
+    ~__LegacyForwarding() { _flag = false; }
+    
+private:
+    std::atomic<bool>&  _flag;
+};
+
+void* ContentFilter::FilterData(FilterContext* /*context*/, void *data, size_t len, size_t *outputLen) const
+{
+    // a filter written without contexts; it keeps its own state, so isn't really const
+    __LegacyForwarding forwarding(_forwardingToLegacy);
+    return const_cast<ContentFilter*>(this)->FilterData(data, len, outputLen);
+}
+void* ContentFilter::FilterData(void *data, size_t len, size_t *outputLen)
+{
+    // reached from the default of the other overload, so neither was overridden
+    if ( _forwardingToLegacy )
+        throw std::logic_error("ContentFilter subclasses must override FilterData()");
+    return FilterData(DefaultContext(), data, len, outputLen);
+}
+
+FilterPipeline::FilterPipeline(const FilterList& filters, const ManifestItem* item, const EncryptionInfo* encInfo) : _stages()
+{
+    _stages.reserve(filters.size());
+    for ( auto& filter : filters )
+    {
+        if ( !filter )
+            continue;
+        
+        unique_ptr<Stage> stage(new Stage);
+        stage->filter = filter;
+        stage->context = filter->MakeFilterContext(item, encInfo);
+        _stages.push_back(std::move(stage));
+    }
+}
+FilterPipeline::~FilterPipeline()
+{
+}
+uint8_t* FilterPipeline::RunStages(size_t first, uint8_t *data, size_t len, bool owned, size_t *outputLen)
+{
+    uint8_t* cur = data;
+    size_t curLen = len;
+    
+    for ( size_t i = first; i < _stages.size() && cur != nullptr; i++ )
+    {
+        Stage* stage = _stages[i].get();
+        if ( stage->filter->RequiresCompleteData() )
+        {
+            // hold onto it until FinishFilter()
+            stage->buffer.insert(stage->buffer.end(), cur, cur + curLen);
+            if ( owned )
+                delete [] cur;
+            cur = nullptr;
+            curLen = 0;
+            break;
+        }
+        
+        if ( curLen == 0 )
+            continue;
+        
+        size_t outLen = 0;
+        uint8_t* out = nullptr;
+        try
+        {
+            out = reinterpret_cast<uint8_t*>(stage->filter->FilterData(stage->context.get(), cur, curLen, &outLen));
+        }
+        catch (...)
+        {
+            if ( owned )
+                delete [] cur;
+            throw;
+        }
+        if ( out != cur )
+        {
+            if ( owned )
+                delete [] cur;
+            owned = true;
+        }
+        
+        cur = out;
+        curLen = (out == nullptr ? 0 : outLen);
+    }
+    
+    *outputLen = curLen;
+    return cur;
+}
+void* FilterPipeline::FilterData(void *data, size_t len, size_t *outputLen)
+{
+    uint8_t* result = RunStages(0, reinterpret_cast<uint8_t*>(data), len, false, outputLen);
+    if ( result == nullptr )
+    {
+        *outputLen = 0;
+        return data;
+    }
+    return result;
+}
+void* FilterPipeline::FinishFilter(size_t *outputLen)
+{
+    std::vector<uint8_t> output;
+    
+    // appends and releases the result of running some data through the pipeline
+    auto append = [&output](uint8_t* bytes, size_t len, const uint8_t* unowned) {
+        if ( bytes == nullptr )
+            return;
+        output.insert(output.end(), bytes, bytes + len);
+        if ( bytes != unowned )
+            delete [] bytes;
+    };
+    
+    for ( size_t i = 0; i < _stages.size(); i++ )
+    {
+        Stage* stage = _stages[i].get();
+        size_t len = 0;
+        
+        if ( stage->filter->RequiresCompleteData() )
+        {
+            // some filters treat their input as a C string, so add a terminator
+            size_t bufLen = stage->buffer.size();
+            stage->buffer.push_back(0);
+            
+            uint8_t* buf = stage->buffer.data();
+            uint8_t* out = reinterpret_cast<uint8_t*>(stage->filter->FilterData(stage->context.get(), buf, bufLen, &len));
+            if ( out != nullptr )
+            {
+                uint8_t* result = RunStages(i+1, out, len, out != buf, &len);
+                append(result, len, buf);
+            }
+            
+            stage->buffer.clear();
+        }
+        
+        uint8_t* remainder = reinterpret_cast<uint8_t*>(stage->filter->FinishFilter(stage->context.get(), &len));
+        if ( remainder != nullptr )
+            append(RunStages(i+1, remainder, len, true, &len), len, nullptr);
+    }
+    
+    *outputLen = output.size();
+    if ( output.empty() )
+        return nullptr;
+    
+    uint8_t* result = new uint8_t[output.size()];
+    std::copy(output.begin(), output.end(), result);
+    return result;
+}
+
+EPUB3_END_NAMESPACE
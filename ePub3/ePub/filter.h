@@ -27,39 +27,79 @@
 #include <ePub3/manifest.h>
 #include <ePub3/encryption.h>
 #include <string>
+#include <vector>
 #include <functional>
+#include <atomic>
 
 EPUB3_BEGIN_NAMESPACE
 
 class Package;
 class Container;
 
+/**
+ FilterContext is the base class for any state a ContentFilter needs to keep while
+ processing a single resource.
+ 
+ A filter object is only configuration: it never changes while data is being
+ filtered. Anything which changes as a resource is read (a position within the
+ resource, cipher state, buffered data) lives in a FilterContext instead, created
+ by ContentFilter::MakeFilterContext(). This means a single filter instance can be
+ installed once and shared between any number of threads, each filtering its own
+ resources using its own contexts, without any locking.
+ 
+ @ingroup filters
+ */
+class FilterContext
+{
+private:
+    ///
+    /// Contexts are never copied.
+                    FilterContext(const FilterContext&)     _DELETED_;
+    
+public:
+                    FilterContext()                             {}
+    virtual         ~FilterContext()                            {}
+};
+
 /**
  ContentFilter is an abstract base class from which all content filters must be
  derived.
  
  It implements default handling for all the methods in its interface with
- the exception of the core data-modification method FilterData().
+ the exception of the core data-modification method FilterData(), one form of which
+ subclasses must override.
  
  Content filters are typically invoked with multiple chunks of data while an item
  is loaded from its container. Subclasses can override RequiresCompleteData() if
  they reqire access to all the data at once in order to function, but it is
  preferred if they support streaming, for performance reasons.
  
- Content filters are *chained*, similar to a singly-linked list. When a content
- filter is installed into a Package, it goes at the head of the list. Any existing
- filter is passed to the new one's SetNextFilter() method. In this way, multiple
- filters may be installed for a single content type, with processing proceeding in
- LIFO order.
+ A filter instance holds only immutable configuration, and acts as a factory for
+ FilterContext objects which hold the state for a single resource. The core
+ processing methods are `const` and receive the resource's context, so filters may
+ be shared freely between threads. Filters which need no per-resource state simply
+ use the default MakeFilterContext(), which returns `nullptr`.
+ 
+ Filters written before contexts existed override FilterData(void*, size_t, size_t*)
+ instead, and keep any state in the filter object itself. These still work, since
+ the default implementation of the context-taking FilterData() calls that method,
+ but such a filter can only process one resource at a time.
+ 
+ When a content filter is installed into a Package using Package::AddContentFilter(),
+ it goes at the head of the package's filter list. In this way, multiple filters may
+ be installed for a single content type, with processing proceeding in LIFO order.
+ A FilterPipeline runs a resource's data through the applicable filters in turn.
+ 
+ The Package asks each filter's type-sniffer about every manifest item once, when
+ the filter is installed, and caches the results as a bitmask on each item; reads
+ then go straight to the applicable filters. Type-sniffers must therefore be
+ deterministic for any given item. Package::FilterPipelineForItem() assembles the
+ applicable filters and a fresh set of contexts into a FilterPipeline.
  
  The implementation *always* queries every filter in the chain: if one filter
  modifies the data, that modified data will be seen by a later filter. This means
  that a later-added filter will not 'replace' one that was added earlier.
  
- @note The next filter is contained in a std::unique_ptr; this means each filter
- in the chain 'owns' the reference to the next, and is solely responsible for
- deleting it.
- 
  @ingroup filters
  */
 class ContentFilter
@@ -82,17 +122,17 @@ private:
 public:
     ///
     /// Copy constructor.
-    ContentFilter(const ContentFilter& o) : _sniffer(o._sniffer), _next(nullptr) {}
+    ContentFilter(const ContentFilter& o) : _sniffer(o._sniffer), _defaultContext(nullptr), _forwardingToLegacy(false) {}
     ///
     /// C++11 move constructor.
-    ContentFilter(ContentFilter&& o) : _sniffer(std::move(o._sniffer)), _next(std::move(o._next)) {}
+    ContentFilter(ContentFilter&& o) : _sniffer(std::move(o._sniffer)), _defaultContext(std::move(o._defaultContext)), _forwardingToLegacy(false) {}
     
     /**
      Create a new content filter with a (required) type sniffer.
      @param sniffer The TypeSnifferFn used to determine whether to pass certain data
      through this filter.
      */
-    ContentFilter(TypeSnifferFn sniffer) : _sniffer(sniffer) {}
+    ContentFilter(TypeSnifferFn sniffer) : _sniffer(sniffer), _defaultContext(nullptr), _forwardingToLegacy(false) {}
     virtual ~ContentFilter() {}
     
     ///
@@ -107,13 +147,18 @@ public:
     /// Assigns a new type-sniffer to this filter.
     virtual void SetTypeSniffer(TypeSnifferFn fn) { _sniffer = fn; }
     
-    ///
-    /// Fetches the next content filter in the chain.
-    virtual ContentFilter* Next() const { return _next.get(); }
-    
-    ///
-    /// Assigns the filter following this one in the chain.
-    virtual void SetNextFilter(ContentFilter* next) { _next.reset(next); }
+    /**
+     Creates the state needed to filter a single resource.
+     
+     A new context must be created for each resource; it is then passed to every
+     call to FilterData() and FinishFilter() for that resource. The default
+     implementation returns `nullptr`, which is appropriate for filters with no
+     per-resource state.
+     @param item The manifest item for the resource, if known.
+     @param encInfo Any encryption information applicable to the resource.
+     @result A new context, or `nullptr` if the filter needs none.
+     */
+    virtual unique_ptr<FilterContext> MakeFilterContext(const ManifestItem* /*item*/, const EncryptionInfo* /*encInfo*/) const { return nullptr; }
     
     /**
      The core processing function.
@@ -125,20 +170,149 @@ public:
      
      The data passed in is not guaranteed to be the entire resource unless the filter
      overrides RequiresCompleteData() to return `true`.
+     
+     This method must not modify the filter itself; any state must be kept in
+     `context`, so that it may be called concurrently for different resources.
+     
+     The default implementation calls FilterData(void*, size_t, size_t*), for filters
+     which override that instead. A subclass must override one or the other; if it
+     overrides neither, filtering throws `std::logic_error`.
+     @param context The resource's context, as returned from MakeFilterContext().
      @param data The data to process.
      @param len The number of bytes in `data`.
      @param outputLen Storage for the count of bytes being returned.
-     @result The filtered bytes.
+     @result The filtered bytes: either `data` itself, or a buffer allocated using
+     `new uint8_t[]`, which the caller must delete.
      @see ePub3::FontObfuscator for an example of a filter which handles data in a
      piecemeal fashion.
      @see ePub3::SwitchPreprocessor or ePub3::ObjectPreprocessor for full-data
      examples.
      */
-    virtual void * FilterData(void *data, size_t len, size_t *outputLen) = 0;
+    EPUB3_EXPORT
+    virtual void * FilterData(FilterContext* context, void *data, size_t len, size_t *outputLen) const;
+    
+    /**
+     Called once all of a resource's data has been passed to FilterData().
+     
+     Filters which must withhold some data until the end of the resource is known
+     (for instance, block ciphers, which need to see the final block before removing
+     its padding) return their remaining bytes here. The default implementation
+     returns nothing.
+     @param context The resource's context, as returned from MakeFilterContext().
+     @param outputLen Storage for the count of bytes being returned.
+     @result The remaining filtered bytes, allocated using `new uint8_t[]` and owned
+     by the caller, or `nullptr` if there are none.
+     */
+    virtual void * FinishFilter(FilterContext* /*context*/, size_t *outputLen) const { *outputLen = 0; return nullptr; }
+    
+    /**
+     Filters data using a context private to this filter object.
+     
+     This is a convenience for filtering a single resource with a dedicated filter
+     instance; the context is created by calling `MakeFilterContext(nullptr, nullptr)`
+     the first time this is called. It is not safe to call this concurrently.
+     
+     This was the core processing method before filters had contexts, and filters
+     written that way may still override it in place of the context-taking form.
+     @deprecated New filters should override FilterData(FilterContext*, void*, size_t, size_t*).
+     @see FilterData(FilterContext*, void*, size_t, size_t*)
+     */
+    EPUB3_EXPORT
+    virtual void * FilterData(void *data, size_t len, size_t *outputLen);
+    
+    /**
+     Finishes filtering using the context private to this filter object.
+     @see FilterData(void*, size_t, size_t*)
+     @see FinishFilter(FilterContext*, size_t*)
+     */
+    void * FinishFilter(size_t *outputLen) { return FinishFilter(DefaultContext(), outputLen); }
     
 protected:
     TypeSnifferFn       _sniffer;
-    unique_ptr<ContentFilter> _next;
+    
+private:
+    unique_ptr<FilterContext>   _defaultContext;    ///< Used only by the single-resource convenience methods.
+    mutable std::atomic<bool>   _forwardingToLegacy;    ///< Set while the default FilterData() overloads call one another.
+    
+    FilterContext* DefaultContext() {
+        if ( !_defaultContext )
+            _defaultContext = MakeFilterContext(nullptr, nullptr);
+        return _defaultContext.get();
+    }
+};
+
+/**
+ A FilterPipeline passes the data for a single resource through a sequence of
+ content filters.
+ 
+ The pipeline owns one FilterContext for each of its filters, so creating one is
+ cheap, and any number of pipelines may run concurrently using the same (shared)
+ filter instances.
+ 
+ Filters which require complete data have their input accumulated by the pipeline,
+ and are run when FinishFilter() is called.
+ 
+ @see Package::FilterPipelineForItem()
+ @ingroup filters
+ */
+class FilterPipeline
+{
+public:
+    ///
+    /// A list of filters, in the order they are to be applied.
+    typedef shared_vector<ContentFilter>            FilterList;
+    
+private:
+                            FilterPipeline()                        _DELETED_;
+                            FilterPipeline(const FilterPipeline&)   _DELETED_;
+    
+public:
+    /**
+     Creates a pipeline for a single resource.
+     @param filters The filters to apply, in order.
+     @param item The manifest item for the resource, passed to each filter's
+     MakeFilterContext().
+     @param encInfo Any encryption information for the resource.
+     */
+    EPUB3_EXPORT            FilterPipeline(const FilterList& filters, const ManifestItem* item, const EncryptionInfo* encInfo);
+    EPUB3_EXPORT            ~FilterPipeline();
+    
+    ///
+    /// Returns `true` if no filters apply; data passes through unchanged.
+    bool                    Empty()                 const   { return _stages.empty(); }
+    
+    /**
+     Passes a chunk of data through every filter in turn.
+     @param data The data to process. This may be modified in-place.
+     @param len The number of bytes in `data`.
+     @param outputLen Storage for the count of bytes being returned.
+     @result The filtered bytes: either `data` itself, or a buffer allocated using
+     `new uint8_t[]`, which the caller must delete.
+     */
+    EPUB3_EXPORT
+    void *                  FilterData(void *data, size_t len, size_t *outputLen);
+    
+    /**
+     Flushes any data held by the filters, once the whole resource has been read.
+     @param outputLen Storage for the count of bytes being returned.
+     @result The remaining bytes, allocated using `new uint8_t[]`, or `nullptr`.
+     */
+    EPUB3_EXPORT
+    void *                  FinishFilter(size_t *outputLen);
+    
+protected:
+    struct Stage
+    {
+        shared_ptr<ContentFilter>   filter;
+        unique_ptr<FilterContext>   context;
+        std::vector<uint8_t>        buffer;         ///< Input accumulated for complete-data filters.
+    };
+    
+    std::vector<unique_ptr<Stage>>  _stages;
+    
+    ///
+    /// Runs data through the stages starting at `first`, taking ownership of it if `owned`.
+    uint8_t *               RunStages(size_t first, uint8_t* data, size_t len, bool owned, size_t *outputLen);
 };
 
 EPUB3_END_NAMESPACE
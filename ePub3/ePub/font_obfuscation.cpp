@@ -33,44 +33,28 @@
 #include "font_obfuscation.h"
 #include "container.h"
 #include "package.h"
+#include <algorithm>
+#include <cctype>
 
 EPUB3_BEGIN_NAMESPACE
 
 #if !EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
 const char * const FontObfuscator::FontObfuscationAlgorithmID = "http://www.idpf.org/2008/embedding";
+const char * const FontObfuscator::AdobeFontObfuscationAlgorithmID = "http://ns.adobe.com/pdf/enc#RC";
 #endif
 
 const REGEX_NS::regex FontObfuscator::TypeCheck("(?:font/.*|application/(?:x-font-.*|vnd.ms-(?:opentype|fontobject)))");
 
-void * FontObfuscator::FilterData(void *data, size_t len, size_t *outputLen)
-{
-    uint8_t *buf = static_cast<uint8_t*>(data);
-    for ( size_t i = 0; i < len && (i + _bytesFiltered) < 1040; i++)
-    {
-        // XOR each of the first 1040 bytes of the font with the key, circling around the keybuf
-        buf[i] ^= _key[(i+_bytesFiltered)%20];
-    }
-    
-    _bytesFiltered += len;
-    *outputLen = len;
-    return buf;
-}
-bool FontObfuscator::BuildKey(const Container* container)
-{
-    REGEX_NS::regex re("\\s+");
-    std::stringstream ss;
-    
-    for ( auto pkg : container->Packages() )
-    {
-        if ( ss.tellp() > 0 )
-            ss << ' ';
-        
-        // we use a C++11 regex to remove all whitespace in the value
-        ss << REGEX_NS::regex_replace(pkg->PackageID().stl_str(), re, "");
-    }
+const size_t FontObfuscationKey::IDPFKeySize;
+const size_t FontObfuscationKey::IDPFObfuscatedLength;
+const size_t FontObfuscationKey::AdobeKeySize;
+const size_t FontObfuscationKey::AdobeObfuscatedLength;
+const size_t FontObfuscationKey::MaxKeySize;
 
-    auto str = ss.str();
-    
+std::atomic<bool> FontObfuscationKey::gPreExpandMasks(false);
+
+static bool _SHA1(const std::string& str, uint8_t* digest)
+{
 #if EPUB_PLATFORM(WIN)
     HCRYPTPROV csp;
     if ( ::CryptAcquireContext(&csp, NULL, NULL, PROV_DSS, CRYPT_VERIFYCONTEXT) == FALSE )
@@ -88,8 +72,8 @@ bool FontObfuscator::BuildKey(const Container* container)
     DWORD winerr = NO_ERROR;
     if ( ::CryptHashData(hasher, reinterpret_cast<const BYTE*>(str.data()), str.length(), 0) == TRUE )
     {
-        DWORD len = KeySize;
-        if ( ::CryptGetHashParam(hasher, HP_HASHVAL, _key, &len, 0) == FALSE )
+        DWORD len = FontObfuscationKey::IDPFKeySize;
+        if ( ::CryptGetHashParam(hasher, HP_HASHVAL, digest, &len, 0) == FALSE )
             winerr = ::GetLastError();
     }
     else
@@ -107,9 +91,159 @@ bool FontObfuscator::BuildKey(const Container* container)
     SHA_CTX ctx;
     SHA1_Init(&ctx);
     SHA1_Update(&ctx, str.data(), str.length());
-    SHA1_Final(_key, &ctx);
+    SHA1_Final(digest, &ctx);
 #endif
     return true;
 }
+static inline int _HexValue(char ch)
+{
+    if ( ch >= '0' && ch <= '9' )
+        return ch - '0';
+    if ( ch >= 'a' && ch <= 'f' )
+        return ch - 'a' + 10;
+    if ( ch >= 'A' && ch <= 'F' )
+        return ch - 'A' + 10;
+    return -1;
+}
+
+FontObfuscationKey::FontObfuscationKey(Algorithm algorithm, const uint8_t* key, size_t keyLen, bool expandMask) : _algorithm(algorithm), _keySize(std::min(keyLen, MaxKeySize)), _obfuscatedLength(algorithm == Algorithm::Adobe ? AdobeObfuscatedLength : IDPFObfuscatedLength), _mask(nullptr)
+{
+    if ( _keySize == 0 )
+        throw std::invalid_argument("Font obfuscation keys cannot be empty");
+    
+    std::memcpy(_key, key, _keySize);
+    
+    if ( expandMask )
+    {
+        _mask.reset(new uint8_t[_obfuscatedLength]);
+        for ( size_t i = 0; i < _obfuscatedLength; i++ )
+            _mask[i] = _key[i % _keySize];
+    }
+}
+FontObfuscationKeyPtr FontObfuscationKey::KeyForContainer(const Container* container, Algorithm algorithm)
+{
+    if ( container == nullptr )
+        return nullptr;
+    
+    if ( algorithm == Algorithm::Adobe )
+    {
+        // the Adobe key is the 128-bit UUID from the default package's unique identifier
+        auto pkg = container->DefaultPackage();
+        if ( !pkg )
+            return nullptr;
+        
+        std::string ident = pkg->PackageID().stl_str();
+        if ( ident.compare(0, 9, "urn:uuid:") == 0 )
+            ident.erase(0, 9);
+        
+        uint8_t key[AdobeKeySize];
+        size_t nibbles = 0;
+        for ( char ch : ident )
+        {
+            if ( ch == '-' || std::isspace(static_cast<unsigned char>(ch)) )
+                continue;
+            
+            int v = _HexValue(ch);
+            if ( v < 0 || nibbles == AdobeKeySize*2 )
+                return nullptr;
+            
+            if ( (nibbles & 1) == 0 )
+                key[nibbles/2] = uint8_t(v << 4);
+            else
+                key[nibbles/2] |= uint8_t(v);
+            nibbles++;
+        }
+        
+        if ( nibbles != AdobeKeySize*2 )
+            return nullptr;
+        
+        return std::make_shared<FontObfuscationKey>(algorithm, key, AdobeKeySize);
+    }
+    
+    std::string str;
+    for ( auto pkg : container->Packages() )
+    {
+        if ( !str.empty() )
+            str += ' ';
+        
+        // remove all whitespace in the value
+        string packageID = pkg->PackageID();
+        for ( char ch : packageID.stl_str() )
+        {
+            if ( !std::isspace(static_cast<unsigned char>(ch)) )
+                str += ch;
+        }
+    }
+    
+    uint8_t key[IDPFKeySize];
+    _SHA1(str, key);
+    return std::make_shared<FontObfuscationKey>(algorithm, key, IDPFKeySize);
+}
+bool FontObfuscationKey::AlgorithmForIdentifier(const string& algorithmID, Algorithm* pAlgorithm)
+{
+    if ( algorithmID == FontObfuscator::FontObfuscationAlgorithmID )
+    {
+        if ( pAlgorithm != nullptr )
+            *pAlgorithm = Algorithm::IDPF;
+        return true;
+    }
+    if ( algorithmID == FontObfuscator::AdobeFontObfuscationAlgorithmID )
+    {
+        if ( pAlgorithm != nullptr )
+            *pAlgorithm = Algorithm::Adobe;
+        return true;
+    }
+    return false;
+}
+const char* FontObfuscationKey::IdentifierForAlgorithm(Algorithm algorithm)
+{
+    if ( algorithm == Algorithm::Adobe )
+        return FontObfuscator::AdobeFontObfuscationAlgorithmID;
+    return FontObfuscator::FontObfuscationAlgorithmID;
+}
+void FontObfuscationKey::Apply(uint8_t* buf, size_t len, size_t offset) const
+{
+    if ( offset >= _obfuscatedLength )
+        return;
+    
+    size_t count = std::min(len, _obfuscatedLength - offset);
+    if ( _mask )
+    {
+        const uint8_t* mask = _mask.get() + offset;
+        for ( size_t i = 0; i < count; i++ )
+            buf[i] ^= mask[i];
+    }
+    else
+    {
+        // XOR each byte of the obfuscated range with the key, circling around the keybuf
+        for ( size_t i = 0; i < count; i++ )
+            buf[i] ^= _key[(i+offset)%_keySize];
+    }
+}
+
+void * FontObfuscator::FilterData(FilterContext* context, void *data, size_t len, size_t *outputLen) const
+{
+    FontObfuscationContext* ctx = dynamic_cast<FontObfuscationContext*>(context);
+    if ( ctx == nullptr )
+        throw std::invalid_argument("FontObfuscator requires a context created by its MakeFilterContext()");
+    
+    uint8_t *buf = static_cast<uint8_t*>(data);
+    if ( _key )
+        _key->Apply(buf, len, ctx->bytesFiltered);
+    
+    ctx->bytesFiltered += len;
+    *outputLen = len;
+    return buf;
+}
+bool FontObfuscator::BuildKey(const Container* container)
+{
+    if ( container == nullptr )
+        return false;
+    
+    _key = container->ObfuscationKeyForAlgorithm(FontObfuscationKey::IdentifierForAlgorithm(_algorithm));
+    if ( !_key )
+        _key = FontObfuscationKey::KeyForContainer(container, _algorithm);
+    return bool(_key);
+}
 
 EPUB3_END_NAMESPACE
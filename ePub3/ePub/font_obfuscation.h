@@ -25,10 +25,132 @@
 #include <ePub3/filter.h>
 #include <ePub3/encryption.h>
 #include REGEX_INCLUDE
+#include <atomic>
 #include <cstring>
 
 EPUB3_BEGIN_NAMESPACE
 
+/**
+ The FontObfuscationKey class holds the immutable key material used to obfuscate or
+ de-obfuscate the fonts within a single Container.
+ 
+ Deriving a key requires walking every Package in the container and hashing their
+ identifiers, so keys are built once by the Container when it loads its encryption
+ information and are then shared by every FontObfuscator created for that container.
+ 
+ Both the IDPF algorithm (OCF 3.0 §4) and the older Adobe algorithm are supported.
+ 
+ If requested, the key may also be *expanded* into a mask covering the entire
+ obfuscated range of a font, turning the per-byte modulo operation into a simple
+ linear XOR.
+ @see http://www.idpf.org/epub/30/spec/epub30-ocf.html#fobfus-keygen
+ */
+class FontObfuscationKey
+{
+public:
+    ///
+    /// The obfuscation algorithms supported.
+    enum class Algorithm : uint8_t
+    {
+        IDPF,       ///< http://www.idpf.org/2008/embedding
+        Adobe       ///< http://ns.adobe.com/pdf/enc#RC
+    };
+    
+    static const size_t         IDPFKeySize = 20;           // SHA-1 key size = 20 bytes
+    static const size_t         IDPFObfuscatedLength = 1040;
+    static const size_t         AdobeKeySize = 16;          // 128-bit UUID
+    static const size_t         AdobeObfuscatedLength = 1024;
+    static const size_t         MaxKeySize = IDPFKeySize;
+    
+private:
+                                FontObfuscationKey()                            _DELETED_;
+                                FontObfuscationKey(const FontObfuscationKey&)   _DELETED_;
+    
+public:
+    /**
+     Creates a key from raw key bytes.
+     @param algorithm The obfuscation algorithm to which the key applies.
+     @param key The raw key bytes. At most MaxKeySize bytes are used.
+     @param keyLen The number of bytes in `key`.
+     @param expandMask If `true`, the XOR mask for the complete obfuscated range is
+     built immediately.
+     */
+    EPUB3_EXPORT                FontObfuscationKey(Algorithm algorithm, const uint8_t* key, size_t keyLen, bool expandMask=PreExpandsMasks());
+                                ~FontObfuscationKey() {}
+    
+    /**
+     Derives the key for a given container.
+     @param container The container whose packages' identifiers are used to build
+     the key.
+     @param algorithm The obfuscation algorithm whose key to derive.
+     @result A new key, or `nullptr` if no key could be derived (for instance, if an
+     Adobe key is requested for a package whose unique identifier is not a UUID).
+     */
+    EPUB3_EXPORT
+    static FontObfuscationKeyPtr    KeyForContainer(const Container* container, Algorithm algorithm);
+    
+    /**
+     Maps an algorithm identifier URI onto an Algorithm value.
+     @param algorithmID An XML-ENC/OCF algorithm URI.
+     @param pAlgorithm Storage for the corresponding algorithm.
+     @result Returns `true` if the URI identifies a font obfuscation algorithm.
+     */
+    EPUB3_EXPORT
+    static bool                 AlgorithmForIdentifier(const string& algorithmID, Algorithm* pAlgorithm);
+    
+    ///
+    /// Returns the algorithm identifier URI for a given Algorithm value.
+    EPUB3_EXPORT
+    static const char*          IdentifierForAlgorithm(Algorithm algorithm);
+    
+    ///
+    /// The algorithm to which this key applies.
+    Algorithm                   KeyAlgorithm()                  const   { return _algorithm; }
+    ///
+    /// The raw key bytes.
+    const uint8_t*              Key()                           const   { return _key; }
+    ///
+    /// The number of bytes in the raw key.
+    size_t                      KeySize()                       const   { return _keySize; }
+    ///
+    /// The number of bytes at the start of a font to which the algorithm applies.
+    size_t                      ObfuscatedLength()              const   { return _obfuscatedLength; }
+    ///
+    /// Whether the XOR mask has been expanded to cover the whole obfuscated range.
+    bool                        HasExpandedMask()               const   { return bool(_mask); }
+    
+    /**
+     Applies the key to a chunk of font data, in-place.
+     @param buf The data to process.
+     @param len The number of bytes in `buf`.
+     @param offset The offset of `buf` from the start of the font resource.
+     */
+    EPUB3_EXPORT
+    void                        Apply(uint8_t* buf, size_t len, size_t offset)  const;
+    
+protected:
+    Algorithm                   _algorithm;
+    size_t                      _keySize;
+    size_t                      _obfuscatedLength;
+    uint8_t                     _key[MaxKeySize];
+    unique_ptr<uint8_t[]>       _mask;                  ///< Expanded XOR mask, or `nullptr`.
+    
+    EPUB3_EXPORT
+    static std::atomic<bool>    gPreExpandMasks;
+    
+public:
+    ///
+    /// Whether newly-built keys expand their XOR mask up-front (default is `false`).
+    static bool                 PreExpandsMasks()                       { return gPreExpandMasks.load(std::memory_order_relaxed); }
+    ///
+    /// Enable or disable up-front expansion of the XOR mask for newly-built keys.
+    ///
+    /// This may be called while other threads are building keys; keys already built
+    /// are unaffected.
+    static void                 SetPreExpandsMasks(bool expand)         { gPreExpandMasks.store(expand, std::memory_order_relaxed); }
+    
+};
+
 /**
  The FontObfuscator class implements font obfuscation algorithm as defined in
  Open Container Format 3.0 §4.
@@ -36,16 +158,26 @@ EPUB3_BEGIN_NAMESPACE
  The underlying algorithm is bidirectional, so this filter can actually be used both
  to obfuscate and de-obfuscate resources; as such, this filter may be applied when
  loading or when storing content.
+ 
+ The key material is owned by the Container and shared between all obfuscators
+ created for it, so constructing a FontObfuscator is cheap. The obfuscator itself is
+ immutable: the position within each font is tracked by a FilterContext, so one
+ instance may process any number of fonts at once.
  @see http://www.idpf.org/epub/30/spec/epub30-ocf.html#font-obfuscation
  */
 class FontObfuscator : public ContentFilter
 {
 protected:
-    static const size_t         KeySize = 20;       // SHA-1 key size = 20 bytes
+    static const size_t         KeySize = FontObfuscationKey::IDPFKeySize;
     static const REGEX_NS::regex     TypeCheck;
     CONSTEXPR static EPUB3_EXPORT const char * const   FontObfuscationAlgorithmID
 #if EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
             = "http://www.idpf.org/2008/embedding"
+#endif
+              ;
+    CONSTEXPR static EPUB3_EXPORT const char * const   AdobeFontObfuscationAlgorithmID
+#if EPUB_COMPILER_SUPPORTS(CXX_NONSTATIC_MEMBER_INIT)
+            = "http://ns.adobe.com/pdf/enc#RC"
 #endif
               ;
     
@@ -64,6 +196,16 @@ protected:
         return REGEX_NS::regex_match(item->MediaType().stl_str(), TypeCheck);
     }
     
+    /**
+     The type-sniffer for Adobe font obfuscation applicability.
+     @see FontTypeSniffer()
+     */
+    static bool AdobeFontTypeSniffer(const ManifestItem* item, const EncryptionInfo* encInfo) {
+        if ( encInfo == nullptr || encInfo->Algorithm() != AdobeFontObfuscationAlgorithmID )
+            return false;
+        return REGEX_NS::regex_match(item->MediaType().stl_str(), TypeCheck);
+    }
+    
 private:
     ///
     /// There is no default constructor.
@@ -74,23 +216,29 @@ public:
      Create a font obfuscation filter.
      
      The obfuscation key is built using data from every manifestation within an EPUB
-     container, so the Container instance is passed in for that purpose. This is
-     only used during construction.
+     container, so the Container instance is passed in for that purpose. The
+     container caches the key, so this is only expensive the first time.
+     @param container The container from which the fonts will be read.
+     @param algorithm The obfuscation algorithm to apply; defaults to the IDPF
+     algorithm.
      @see BuildKey(const Container*)
      */
-    FontObfuscator(const Container* container) : ContentFilter(FontTypeSniffer), _bytesFiltered(0) {
+    FontObfuscator(const Container* container, FontObfuscationKey::Algorithm algorithm=FontObfuscationKey::Algorithm::IDPF)
+        : ContentFilter(algorithm == FontObfuscationKey::Algorithm::Adobe ? AdobeFontTypeSniffer : FontTypeSniffer), _algorithm(algorithm), _key() {
         BuildKey(container);
     }
+    /**
+     Create a font obfuscation filter using existing key material.
+     @param key The key to use. This must not be `nullptr`.
+     */
+    FontObfuscator(FontObfuscationKeyPtr key)
+        : ContentFilter(key->KeyAlgorithm() == FontObfuscationKey::Algorithm::Adobe ? AdobeFontTypeSniffer : FontTypeSniffer), _algorithm(key->KeyAlgorithm()), _key(key) {}
     ///
     /// Copy constructor.
-    FontObfuscator(const FontObfuscator& o) : ContentFilter(o), _bytesFiltered(o._bytesFiltered) {
-        std::memcpy(_key, o._key, KeySize);
-    }
+    FontObfuscator(const FontObfuscator& o) : ContentFilter(o), _algorithm(o._algorithm), _key(o._key) {}
     ///
     /// Move constructor.
-    FontObfuscator(FontObfuscator&& o) : ContentFilter(std::move(o)), _bytesFiltered(o._bytesFiltered) {
-        std::memcpy(_key, o._key, KeySize);
-    }
+    FontObfuscator(FontObfuscator&& o) : ContentFilter(std::move(o)), _algorithm(o._algorithm), _key(std::move(o._key)) {}
     
     /**
      Applies the font obfuscation algorithm to the resource data.
@@ -100,21 +248,48 @@ public:
      @param outputLen Storage for the count of bytes being returned.
      @result The obfuscated or de-obfuscated bytes.
      */
-    virtual void * FilterData(void * data, size_t len, size_t *outputLen);
+    virtual void * FilterData(FilterContext* context, void * data, size_t len, size_t *outputLen) const;
+    
+    using ContentFilter::FilterData;
+    
+    ///
+    /// Creates a context which tracks the position within a single font.
+    virtual unique_ptr<FilterContext> MakeFilterContext(const ManifestItem* /*item*/, const EncryptionInfo* /*encInfo*/) const {
+        return unique_ptr<FilterContext>(new FontObfuscationContext);
+    }
+    
+    ///
+    /// The shared key material used by this filter.
+    FontObfuscationKeyPtr   ObfuscationKey()            const   { return _key; }
     
 protected:
-    uint8_t             _key[KeySize];
-    size_t              _bytesFiltered;     // NOT copied
+    FontObfuscationKey::Algorithm   _algorithm;
+    FontObfuscationKeyPtr           _key;
+    
+    ///
+    /// The per-font state: the offset of the next byte to be filtered.
+    class FontObfuscationContext : public FilterContext
+    {
+    public:
+        FontObfuscationContext() : FilterContext(), bytesFiltered(0) {}
+        size_t  bytesFiltered;
+    };
     
     /**
-     Builds the obfuscaton key using data from the container.
+     Obtains the obfuscaton key using data from the container.
+     
+     The key is fetched from the container's cache where possible, and is only
+     derived from scratch if the container didn't declare any resources using this
+     filter's algorithm.
      @param container The container for the resources to which this filter will
      apply.
-     @result Always returns `true`.
+     @result Returns `true` if a key was obtained.
      @see http://www.idpf.org/epub/30/spec/epub30-ocf.html#fobfus-keygen
      */
     EPUB3_EXPORT
     bool BuildKey(const Container* container);
+    
+    friend class FontObfuscationKey;
 };
 
 EPUB3_END_NAMESPACE
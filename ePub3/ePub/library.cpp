@@ -19,6 +19,7 @@
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+
 #include "library.h"
 #include "container.h"
 #include "manifest.h"
@@ -27,14 +28,117 @@
 #include <sstream>
 #include <fstream>
 #include <list>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <libxml/parser.h>
+#if EPUB_PLATFORM(WIN)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#endif
 
 // file format is CSV, unencrypted
 
 EPUB3_BEGIN_NAMESPACE
 
+const size_t Library::ShardCount;
+
+// appends the paths of all EPUB files within a directory tree
+static void _FindEPubFiles(const std::string& directory, std::vector<string>& paths)
+{
+#if EPUB_PLATFORM(WIN)
+    WIN32_FIND_DATAA data;
+    HANDLE find = ::FindFirstFileA((directory + "\\*").c_str(), &data);
+    if ( find == INVALID_HANDLE_VALUE )
+        return;
+    
+    do
+    {
+        std::string name(data.cFileName);
+        if ( name == "." || name == ".." )
+            continue;
+        
+        std::string path(directory + "\\" + name);
+        if ( (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 )
+            _FindEPubFiles(path, paths);
+        else if ( name.size() > 5 && _stricmp(name.c_str() + name.size() - 5, ".epub") == 0 )
+            paths.emplace_back(path);
+        
+    } while ( ::FindNextFileA(find, &data) );
+    
+    ::FindClose(find);
+#else
+    DIR* dir = ::opendir(directory.c_str());
+    if ( dir == nullptr )
+        return;
+    
+    while ( struct dirent* entry = ::readdir(dir) )
+    {
+        std::string name(entry->d_name);
+        if ( name == "." || name == ".." )
+            continue;
+        
+        std::string path(directory + "/" + name);
+        struct stat sb;
+        if ( ::stat(path.c_str(), &sb) != 0 )
+            continue;
+        
+        if ( S_ISDIR(sb.st_mode) )
+            _FindEPubFiles(path, paths);
+        else if ( name.size() > 5 && strcasecmp(name.c_str() + name.size() - 5, ".epub") == 0 )
+            paths.emplace_back(path);
+    }
+    
+    ::closedir(dir);
+#endif
+}
+
 unique_ptr<Library> Library::_singleton(nullptr);
 
-Library::Library(const string& path)
+Library::Library() : _shards(), _maxContainers(0), _maxBytes(0), _loads(0), _evictions(0), _residentContainers(0), _residentBytes(0), _catalog()
+{
+}
+Library::Library(const Library& o) : _shards(), _maxContainers(o._maxContainers.load()), _maxBytes(o._maxBytes.load()), _loads(0), _evictions(0), _residentContainers(0), _residentBytes(0), _catalog(o._catalog)
+{
+    for ( size_t i = 0; i < ShardCount; i++ )
+    {
+        ShardLock _(o._shards[i].lock);
+        _shards[i].containers = o._shards[i].containers;
+        _shards[i].packages = o._shards[i].packages;
+        _shards[i].packageIDs = o._shards[i].packageIDs;
+        
+        for ( auto& pair : _shards[i].containers )
+        {
+            if ( pair.second.container )
+            {
+                _residentContainers++;
+                _residentBytes += pair.second.bytes;
+            }
+        }
+    }
+}
+Library::Library(Library&& o) : _shards(), _maxContainers(o._maxContainers.load()), _maxBytes(o._maxBytes.load()), _loads(o._loads.load()), _evictions(o._evictions.load()), _residentContainers(0), _residentBytes(0), _catalog(std::move(o._catalog))
+{
+    for ( size_t i = 0; i < ShardCount; i++ )
+    {
+        ShardLock _(o._shards[i].lock);
+        _shards[i].containers = std::move(o._shards[i].containers);
+        _shards[i].packages = std::move(o._shards[i].packages);
+        _shards[i].packageIDs = std::move(o._shards[i].packageIDs);
+        o._shards[i].containers.clear();
+        o._shards[i].packages.clear();
+        o._shards[i].packageIDs.clear();
+    }
+    
+    _residentContainers = o._residentContainers.exchange(0);
+    _residentBytes = o._residentBytes.exchange(0);
+}
+Library::Library(const string& path) : _shards(), _maxContainers(0), _maxBytes(0), _loads(0), _evictions(0), _residentContainers(0), _residentBytes(0), _catalog()
 {
     if ( !Load(path) )
         throw std::invalid_argument("The provided Locator doesn't appear to contain library data.");
@@ -42,8 +146,18 @@ Library::Library(const string& path)
 Library::~Library()
 {
 }
+Library::Shard& Library::ShardForKey(const string& key) const
+{
+    return _shards[std::hash<std::string>()(key.stl_str()) % ShardCount];
+}
 bool Library::Load(const string& path)
 {
+    if ( LibraryCatalog::IsCatalogFile(path) )
+    {
+        _catalog = LibraryCatalog::Open(path);
+        return bool(_catalog);
+    }
+    
     std::ifstream stream(path.stl_str());
     
     std::stringstream ss;
@@ -71,10 +185,24 @@ bool Library::Load(const string& path)
                 }
             }
             
-            _containers[thisPath] = nullptr;
+            {
+                Shard& shard = ShardForKey(thisPath);
+                ShardLock _(shard.lock);
+                shard.containers[thisPath.stl_str()];
+            }
+            
             for ( auto uid : uidList )
             {
-                _packages[uid] = std::make_pair(thisPath, nullptr);
+                {
+                    Shard& shard = ShardForKey(uid);
+                    ShardLock _(shard.lock);
+                    shard.packages[uid] = thisPath;
+                }
+                
+                std::string packageID = LibraryCatalog::PackageIDForUniqueID(uid);
+                Shard& shard = ShardForKey(packageID);
+                ShardLock _(shard.lock);
+                shard.packageIDs.insert(std::make_pair(packageID, thisPath));
             }
         }
         catch (...)
@@ -93,44 +221,416 @@ Library* Library::MainLibrary(const string& path)
 }
 string Library::PathForEPubWithUniqueID(const string &uniqueID) const
 {
-    auto found = _packages.find(uniqueID);
-    if ( found == _packages.end() )
-        return string::EmptyString;
+    {
+        Shard& shard = ShardForKey(uniqueID);
+        ShardLock _(shard.lock);
+        
+        auto found = shard.packages.find(uniqueID.stl_str());
+        if ( found != shard.packages.end() )
+            return found->second;
+    }
     
-    return found->second.first;
+    if ( _catalog )
+        return _catalog->PathForUniqueID(uniqueID);
+    return string::EmptyString;
 }
 string Library::PathForEPubWithPackageID(const string &packageID) const
 {
-    string uniqueIDStart(packageID + "@");
-    for ( auto &pair : _packages )
     {
-        if ( pair.first == packageID || pair.first.find(uniqueIDStart) == 0 )
-            return pair.second.first;
+        Shard& shard = ShardForKey(packageID);
+        ShardLock _(shard.lock);
+        
+        auto found = shard.packageIDs.find(packageID.stl_str());
+        if ( found != shard.packageIDs.end() )
+            return found->second;
     }
     
-    return string::EmptyString;
+    if ( _catalog )
+    {
+        string path = _catalog->PathForPackageID(packageID);
+        if ( !path.empty() )
+            return path;
+    }
+    
+    // without a modification date, the unique ID is just the package ID
+    return PathForEPubWithUniqueID(packageID);
 }
-void Library::AddPublicationsInContainer(shared_ptr<Container> container, const string& path)
+void Library::RegisterPackages(shared_ptr<Container> container, const string& path)
 {
-    // store the container
-    auto existing = _containers.find(path);
-    if ( existing == _containers.end() )
-        _containers[path] = container;
-    
+    LibraryCatalog::IdentifierList uniqueIDs;
     for ( auto pkg : container->Packages() )
     {
-#if EPUB_HAVE(CXX_MAP_EMPLACE)
-        _packages.emplace(pkg->UniqueID(), LookupEntry(std::make_pair(path, pkg)));
-#else
-        _packages[pkg->UniqueID()] = LookupEntry({path, pkg});
-#endif
+        uniqueIDs.push_back(pkg->UniqueID().stl_str());
     }
+    
+    RegisterIdentifiers(uniqueIDs, path);
+}
+size_t Library::RegisterIdentifiers(const LibraryCatalog::IdentifierList& uniqueIDs, const string& path)
+{
+    // identifiers the catalog doesn't yet know about
+    LibraryCatalog::IdentifierList unrecorded;
+    size_t added = 0;
+    
+    for ( auto& uid : uniqueIDs )
+    {
+        {
+            Shard& shard = ShardForKey(uid);
+            ShardLock _(shard.lock);
+            if ( !shard.packages.insert(std::make_pair(uid, path)).second )
+                continue;
+        }
+        
+        added++;
+        
+        {
+            std::string packageID = LibraryCatalog::PackageIDForUniqueID(uid);
+            Shard& shard = ShardForKey(packageID);
+            ShardLock _(shard.lock);
+            shard.packageIDs.insert(std::make_pair(packageID, path));
+        }
+        
+        if ( _catalog && _catalog->PathForUniqueID(uid) != path )
+            unrecorded.push_back(uid);
+    }
+    
+    if ( !unrecorded.empty() )
+        _catalog->Append(path, unrecorded);
+    
+    return added;
+}
+void Library::AddPublicationsInContainer(shared_ptr<Container> container, const string& path)
+{
+    // store the container, unless one is already loaded from that path
+    size_t bytes = container->EstimatedMemoryUsage();
+    {
+        Shard& shard = ShardForKey(path);
+        ShardLock _(shard.lock);
+        ContainerEntry& entry = shard.containers[path.stl_str()];
+        if ( entry.container == nullptr )
+            SetEntryContainer(entry, container, bytes);
+        entry.lastUsed = Clock::now();
+    }
+    
+    RegisterPackages(container, path);
 }
 void Library::AddPublicationsInContainerAtPath(const ePub3::string &path)
 {
-    ContainerPtr p = Container::OpenContainer(path);
-    if ( p )
-        AddPublicationsInContainer(p, path);
+    ContainerAtPath(path, true);
+}
+Library::IngestionProgress Library::AddPublicationsInDirectory(const string& directory, IngestionProgressFn progress, size_t threadCount)
+{
+    std::vector<string> paths;
+    _FindEPubFiles(directory.stl_str(), paths);
+    
+    // directory order is arbitrary, so make the result predictable
+    std::sort(paths.begin(), paths.end());
+    return AddPublicationsAtPaths(paths, progress, threadCount);
+}
+Library::IngestionProgress Library::AddPublicationsAtPaths(const std::vector<string>& paths, IngestionProgressFn progress, size_t threadCount)
+{
+    IngestionProgress state = { paths.size(), 0, 0, 0 };
+    if ( threadCount == 0 )
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    threadCount = std::min(threadCount, paths.size());
+    
+    // libxml2 must be initialized before it's used from several threads
+    xmlInitParser();
+    
+    // workers claim one path at a time, so a slow container never holds up others
+    std::atomic<size_t> next(0), added(0), failed(0);
+    std::mutex lock;
+    std::condition_variable completion;
+    size_t completed = 0;
+    
+    auto worker = [&]() {
+        for ( size_t i = next++; i < paths.size(); i = next++ )
+        {
+            try
+            {
+                LibraryCatalog::IdentifierList uniqueIDs;
+                for ( auto& uid : Container::PackageUniqueIDsAtPath(paths[i]) )
+                {
+                    uniqueIDs.push_back(uid.stl_str());
+                }
+                
+                if ( uniqueIDs.empty() )
+                {
+                    failed++;
+                }
+                else
+                {
+                    {
+                        // known, but not loaded
+                        Shard& shard = ShardForKey(paths[i]);
+                        ShardLock _(shard.lock);
+                        shard.containers[paths[i].stl_str()];
+                    }
+                    added += RegisterIdentifiers(uniqueIDs, paths[i]);
+                }
+            }
+            catch (...)
+            {
+                failed++;
+            }
+            
+            {
+                std::unique_lock<std::mutex> _(lock);
+                completed++;
+            }
+            completion.notify_one();
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    for ( size_t i = 0; i < threadCount; i++ )
+    {
+        threads.emplace_back(worker);
+    }
+    
+    {
+        std::unique_lock<std::mutex> _(lock);
+        while ( completed < paths.size() )
+        {
+            completion.wait(_);
+            if ( !progress || completed == paths.size() )
+                continue;
+            
+            state.completed = completed;
+            state.added = added;
+            state.failed = failed;
+            
+            // report without blocking the workers
+            _.unlock();
+            progress(state);
+            _.lock();
+        }
+    }
+    
+    for ( auto& thread : threads )
+    {
+        thread.join();
+    }
+    
+    state.completed = paths.size();
+    state.added = added;
+    state.failed = failed;
+    if ( progress )
+        progress(state);
+    return state;
+}
+shared_ptr<Container> Library::ContainerAtPath(const string& path, bool allowLoad)
+{
+    Shard& shard = ShardForKey(path);
+    std::promise<ContainerPtr> promise;
+    std::shared_future<ContainerPtr> loading;
+    bool known = false;
+    
+    {
+        ShardLock _(shard.lock);
+        auto found = shard.containers.find(path.stl_str());
+        known = (found != shard.containers.end());
+        if ( known && found->second.container )
+        {
+            found->second.lastUsed = Clock::now();
+            return found->second.container;
+        }
+        if ( !allowLoad )
+            return nullptr;
+        
+        if ( known && found->second.loading.valid() )
+        {
+            // someone else is opening it: wait for their result
+            loading = found->second.loading;
+        }
+        else
+        {
+            promise = std::promise<ContainerPtr>();
+            shard.containers[path.stl_str()].loading = promise.get_future().share();
+        }
+    }
+    
+    if ( loading.valid() )
+        return loading.get();
+    
+    // we're responsible for opening it, which happens without any locks held
+    ContainerPtr container;
+    size_t bytes = 0;
+    try
+    {
+        container = Container::OpenContainer(path);
+        if ( container )
+            bytes = container->EstimatedMemoryUsage();
+    }
+    catch (...)
+    {
+        {
+            ShardLock _(shard.lock);
+            if ( known )
+                shard.containers[path.stl_str()].loading = std::shared_future<ContainerPtr>();
+            else
+                shard.containers.erase(path.stl_str());
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    
+    {
+        ShardLock _(shard.lock);
+        if ( container || known )
+        {
+            ContainerEntry& entry = shard.containers[path.stl_str()];
+            entry.loading = std::shared_future<ContainerPtr>();
+            entry.lastUsed = Clock::now();
+            if ( container )
+            {
+                _loads++;
+                SetEntryContainer(entry, container, bytes);
+            }
+        }
+        else
+        {
+            // don't remember paths which never opened
+            shard.containers.erase(path.stl_str());
+        }
+    }
+    
+    // packages are registered before any waiters are woken, so they'll find them
+    if ( container )
+        RegisterPackages(container, path);
+    
+    promise.set_value(container);
+    
+    // our reference keeps the new container from being chosen
+    if ( container )
+        EnforceResidencyLimits();
+    
+    return container;
+}
+void Library::SetEntryContainer(ContainerEntry& entry, shared_ptr<Container> container, size_t bytes)
+{
+    UnloadEntry(entry);
+    if ( !container )
+        return;
+    
+    entry.container = container;
+    entry.bytes = bytes;
+    _residentContainers++;
+    _residentBytes += entry.bytes;
+}
+shared_ptr<Container> Library::UnloadEntry(ContainerEntry& entry)
+{
+    ContainerPtr result = std::move(entry.container);
+    entry.container = nullptr;
+    if ( result )
+    {
+        _residentContainers--;
+        _residentBytes -= entry.bytes;
+    }
+    entry.bytes = 0;
+    return result;
+}
+bool Library::IsEvictable(const ContainerEntry& entry)
+{
+    // the only references must be ours, and the container's own
+    if ( !entry.container || entry.container.use_count() != 1 )
+        return false;
+    
+    for ( auto& pkg : entry.container->Packages() )
+    {
+        if ( pkg.use_count() != 1 )
+            return false;
+    }
+    
+    return true;
+}
+bool Library::WithinResidencyLimits() const
+{
+    size_t maxContainers = _maxContainers, maxBytes = _maxBytes;
+    return (maxContainers == 0 || _residentContainers <= maxContainers) && (maxBytes == 0 || _residentBytes <= maxBytes);
+}
+void Library::SetResidencyLimits(size_t maxContainers, size_t maxBytes)
+{
+    _maxContainers = maxContainers;
+    _maxBytes = maxBytes;
+    EnforceResidencyLimits();
+}
+size_t Library::EnforceResidencyLimits()
+{
+    if ( WithinResidencyLimits() )
+        return 0;
+    
+    struct Candidate
+    {
+        Clock::time_point   lastUsed;
+        Shard*              shard;
+        std::string         path;
+    };
+    
+    // shards are locked one at a time, so a candidate may have been used (or
+    //  unloaded) by the time it's reached; each is checked again under its lock
+    std::vector<Candidate> candidates;
+    for ( auto& shard : _shards )
+    {
+        ShardLock _(shard.lock);
+        for ( auto& pair : shard.containers )
+        {
+            if ( IsEvictable(pair.second) )
+                candidates.push_back({pair.second.lastUsed, &shard, pair.first});
+        }
+    }
+    
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    
+    // released outside the locks, since destroying a container can be expensive
+    std::vector<ContainerPtr> evicted;
+    for ( auto& candidate : candidates )
+    {
+        if ( WithinResidencyLimits() )
+            break;
+        
+        ShardLock _(candidate.shard->lock);
+        auto found = candidate.shard->containers.find(candidate.path);
+        if ( found == candidate.shard->containers.end() || found->second.lastUsed != candidate.lastUsed || !IsEvictable(found->second) )
+            continue;
+        
+        evicted.push_back(UnloadEntry(found->second));
+        _evictions++;
+    }
+    
+    return evicted.size();
+}
+Library::Statistics Library::GetStatistics() const
+{
+    Statistics result;
+    result.loads = _loads;
+    result.evictions = _evictions;
+    result.residentContainers = _residentContainers;
+    result.residentBytes = _residentBytes;
+    return result;
+}
+size_t Library::EvictIdleContainers(Clock::duration maxIdle)
+{
+    Clock::time_point cutoff = Clock::now() - maxIdle;
+    
+    // released outside the locks, since destroying a container can be expensive
+    std::vector<ContainerPtr> evicted;
+    for ( auto& shard : _shards )
+    {
+        ShardLock _(shard.lock);
+        for ( auto& pair : shard.containers )
+        {
+            ContainerEntry& entry = pair.second;
+            if ( entry.lastUsed > cutoff || !IsEvictable(entry) )
+                continue;
+            
+            evicted.push_back(UnloadEntry(entry));
+            _evictions++;
+        }
+    }
+    
+    return evicted.size();
 }
 IRI Library::EPubURLForPublication(shared_ptr<Package> package) const
 {
@@ -140,24 +640,31 @@ IRI Library::EPubURLForPublicationID(const string &identifier) const
 {
     return IRI(IRI::gEPUBScheme, identifier, "/");
 }
-shared_ptr<Package> Library::PackageForEPubURL(const IRI &url, bool allowLoad)
+shared_ptr<Package> Library::PackageWithUniqueID(const string& uniqueID, bool allowLoad)
 {
-    // is it an epub URL?
-    if ( url.Scheme() != IRI::gEPUBScheme )
+    string path = PathForEPubWithUniqueID(uniqueID);
+    if ( path.empty() )
         return nullptr;
     
-    string ident = url.Host();
-    auto entry = _packages.find(ident);
-    if ( entry == _packages.end() )
+    ContainerPtr container = ContainerAtPath(path, allowLoad);
+    if ( !container )
         return nullptr;
     
-    if ( entry->second.second != nullptr || !allowLoad )
-        return entry->second.second;
+    for ( auto pkg : container->Packages() )
+    {
+        if ( pkg->UniqueID() == uniqueID )
+            return pkg;
+    }
     
-    AddPublicationsInContainerAtPath(entry->second.first);
+    return nullptr;
+}
+shared_ptr<Package> Library::PackageForEPubURL(const IRI &url, bool allowLoad)
+{
+    // is it an epub URL?
+    if ( url.Scheme() != IRI::gEPUBScheme )
+        return nullptr;
     
-    // returns a package ptr or nullptr
-    return entry->second.second;
+    return PackageWithUniqueID(url.Host(), allowLoad);
 }
 IRI Library::EPubCFIURLForManifestItem(ManifestItemPtr item) const
 {
@@ -196,23 +703,52 @@ unique_ptr<ByteStream> Library::ReadStreamForEPubURL(const IRI &url, CFI *pRemai
     
     return nullptr;
 }
+LibraryCatalog::Contents Library::AllContents() const
+{
+    LibraryCatalog::Contents contents;
+    if ( _catalog )
+        contents = _catalog->AllContents();
+    
+    // anything registered since the catalog was loaded takes precedence
+    std::unordered_map<std::string, std::string> registered;
+    for ( auto& shard : _shards )
+    {
+        ShardLock _(shard.lock);
+        for ( auto& pair : shard.containers )
+            contents[pair.first];
+        for ( auto& pair : shard.packages )
+            registered[pair.first] = pair.second.stl_str();
+    }
+    
+    if ( _catalog && !registered.empty() )
+    {
+        for ( auto& pair : contents )
+        {
+            LibraryCatalog::IdentifierList& uids = pair.second;
+            uids.erase(std::remove_if(uids.begin(), uids.end(), [&](const std::string& uid) {
+                return registered.find(uid) != registered.end();
+            }), uids.end());
+        }
+    }
+    
+    for ( auto& pair : registered )
+        contents[pair.second].push_back(pair.first);
+    
+    return contents;
+}
 bool Library::WriteToFile(const string& path) const
 {
+    // the package table already holds every known identifier, so nothing needs to
+    //  be opened here
+    LibraryCatalog::Contents contents = AllContents();
+    
     std::ofstream stream(path.stl_str());
-    for ( auto item : _containers )
+    for ( auto& item : contents )
     {
-        // works like an auto_ptr, scoping the allocation
-        ContainerPtr pContainer = item.second;
-        
-        if ( !pContainer )
-            pContainer = Container::OpenContainer(item.first);
-        if ( !pContainer )
-            continue;
-        
         stream << item.first;
-        for ( auto pkg : pContainer->Packages() )
+        for ( auto& uid : item.second )
         {
-            stream << "," << pkg->UniqueID();
+            stream << "," << uid;
         }
         
         stream << std::endl;
@@ -220,5 +756,9 @@ bool Library::WriteToFile(const string& path) const
     
     return true;
 }
+bool Library::WriteCatalog(const string& path) const
+{
+    return LibraryCatalog::Write(path, AllContents());
+}
 
 EPUB3_END_NAMESPACE
@@ -26,9 +26,16 @@
 #include <ePub3/container.h>
 #include <ePub3/package.h>
 #include <ePub3/cfi.h>
+#include <ePub3/library_catalog.h>
 #include <ePub3/utilities/utfstring.h>
 #include <ePub3/utilities/byte_stream.h>
-#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 EPUB3_BEGIN_NAMESPACE
 
@@ -44,6 +51,21 @@ EPUB3_BEGIN_NAMESPACE
 //  at application startup. Once the singleton instance has been created,
 //  MainLibrary() will ignore its argument and always return that instance.
 //
+// The library may be used from any number of threads at once. Its tables are split
+//  into hash-selected shards, each with its own lock, so lookups of different
+//  publications rarely contend, and no lock is ever held while a container is being
+//  opened. If several threads ask for the same unloaded container at once, only
+//  one of them opens it; the others wait for, and share, its result. Loaded
+//  containers which have gone unused for a while can be dropped again using
+//  EvictIdleContainers(), and will be reopened on demand. Limits may also be placed
+//  on the number and estimated size of the loaded containers, in which case the
+//  least-recently-used ones are unloaded whenever a load exceeds them.
+//
+// For large libraries, the library can also be saved as a binary LibraryCatalog
+//  using WriteCatalog(). When a catalog is loaded, its identifiers are looked up
+//  directly from the mapped file rather than being read into memory, and any
+//  publications added later are appended to its journal.
+//
 // Thoughts: OCF allows for multiple packages to be specified, but I don't see any
 //  handling of that in ePub3 CFI?
 
@@ -54,13 +76,36 @@ class Library
 {
 public:
     typedef string      EPubIdentifier;
+    typedef std::chrono::steady_clock   Clock;
+    
+    // number of independently-locked partitions of the library's tables
+    static const size_t ShardCount = 16;
+    
+    // counters describing the library's loading activity
+    struct Statistics
+    {
+        size_t          loads;                  // containers opened by the library
+        size_t          evictions;              // loaded containers since unloaded
+        size_t          residentContainers;     // containers currently loaded
+        size_t          residentBytes;          // their estimated memory usage
+    };
+    
+    // progress of a bulk addition of publications
+    struct IngestionProgress
+    {
+        size_t          total;                  // containers to examine
+        size_t          completed;              // containers examined so far
+        size_t          added;                  // packages newly registered
+        size_t          failed;                 // containers which couldn't be read
+    };
+    typedef std::function<void(const IngestionProgress&)>   IngestionProgressFn;
     
 protected:
-                        Library() : _containers(), _packages() {}
-                        Library(const Library& o) : _containers(o._containers), _packages(o._packages) {}
-                        Library(Library&& o) : _containers(std::move(o._containers)), _packages(std::move(o._packages)) {}
+    EPUB3_EXPORT        Library();
+    EPUB3_EXPORT        Library(const Library& o);
+    EPUB3_EXPORT        Library(Library&& o);
     
-    // load a library from a file generated using WriteToFile()
+    // load a library from a file generated using WriteToFile() or WriteCatalog()
     EPUB3_EXPORT        Library(const string& path);
     EPUB3_EXPORT bool   Load(const string& path);
     
@@ -80,6 +125,49 @@ public:
     EPUB3_EXPORT
     void                AddPublicationsInContainerAtPath(const string& path);
     
+    // registers the publications in many containers at once, using a pool of
+    //  `threadCount` worker threads (zero means one per hardware thread)
+    // only each container's package identifiers are read, using
+    //  Container::PackageUniqueIDsAtPath(), so no containers are loaded and memory use
+    //  doesn't grow with the number of containers examined
+    // `progress` is called on the calling thread as work completes, and once more
+    //  at the end; the final progress is also returned
+    EPUB3_EXPORT
+    IngestionProgress   AddPublicationsAtPaths(const std::vector<string>& paths, IngestionProgressFn progress=IngestionProgressFn(), size_t threadCount=0);
+    
+    // as above, for every `.epub` file within a directory and its subdirectories
+    EPUB3_EXPORT
+    IngestionProgress   AddPublicationsInDirectory(const string& directory, IngestionProgressFn progress=IngestionProgressFn(), size_t threadCount=0);
+    
+    // returns the container at a path, opening it if necessary (and if allowed)
+    // concurrent calls for the same path share a single open; any exception thrown
+    //  while opening it is rethrown to each of them
+    EPUB3_EXPORT
+    shared_ptr<Container>   ContainerAtPath(const string& path, bool allowLoad=true);
+    
+    // unloads containers which haven't been used for at least `maxIdle`, provided
+    //  nothing outside the library still references them or their packages
+    // the containers remain known, and will be reloaded when next needed
+    // returns the number of containers unloaded
+    EPUB3_EXPORT
+    size_t              EvictIdleContainers(Clock::duration maxIdle);
+    
+    // limits the number of loaded containers, and their total estimated memory
+    //  usage; a limit of zero means no limit
+    // the limits are applied after each load, and only ever unload containers
+    //  which nothing outside the library references, so they can be exceeded
+    //  while many containers are in use
+    EPUB3_EXPORT
+    void                SetResidencyLimits(size_t maxContainers, size_t maxBytes);
+    
+    // unloads least-recently-used containers until the residency limits are met,
+    //  returning the number unloaded
+    EPUB3_EXPORT
+    size_t              EnforceResidencyLimits();
+    
+    EPUB3_EXPORT
+    Statistics          GetStatistics()                                     const;
+    
     // returns an epub3:// url for the package with a given identifier
     EPUB3_EXPORT
     IRI                 EPubURLForPublication(shared_ptr<Package> package)       const;
@@ -88,6 +176,8 @@ public:
     
     // may load a container/package, so non-const
     EPUB3_EXPORT
+    shared_ptr<Package> PackageWithUniqueID(const string& uniqueID, bool allowLoad=true);
+    EPUB3_EXPORT
     shared_ptr<Package> PackageForEPubURL(const IRI& url, bool allowLoad=true);
 
     EPUB3_EXPORT
@@ -106,19 +196,77 @@ public:
     EPUB3_EXPORT
     bool                WriteToFile(const string& path)                     const;
     
+    // writes a binary LibraryCatalog, which can be loaded without reading its
+    //  entire contents
+    EPUB3_EXPORT
+    bool                WriteCatalog(const string& path)                    const;
+    
+    // the catalog from which the library was loaded, if any
+    shared_ptr<LibraryCatalog>  Catalog()                                   const   { return _catalog; }
+    
 protected:
-    // list of known (but not necessarily loaded) containers
-    typedef std::map<string, shared_ptr<Container>>     ContainerLookup;
+    // a known (but not necessarily loaded) container
+    struct ContainerEntry
+    {
+        shared_ptr<Container>                       container;  // nullptr until loaded
+        std::shared_future<shared_ptr<Container>>   loading;    // valid while being opened
+        Clock::time_point                           lastUsed;
+        size_t                                      bytes;      // estimated size, once loaded
+        
+        ContainerEntry() : container(), loading(), lastUsed(), bytes(0) {}
+    };
+    
+    // both tables are keyed by std::string, since ePub3::string has no std::hash
+    // containers are sharded by path, packages by unique or package identifier
+    typedef std::unordered_map<std::string, ContainerEntry>     ContainerLookup;
+    
+    // maps a package's unique (or package) identifier to the path of its container
+    // the Package itself is obtained from the container once it's loaded
+    typedef std::unordered_map<std::string, string>             PackageLookup;
+    
+    struct Shard
+    {
+        std::mutex                  lock;
+        ContainerLookup             containers;
+        PackageLookup               packages;
+        PackageLookup               packageIDs;     // the first package registered with each package ID
+    };
     
-    // if container is loaded, LookupEntry will contain a Package
-    // otherwise, the locator is used to load the Container
-    typedef std::pair<string, shared_ptr<Package>>      LookupEntry;
-    typedef std::map<EPubIdentifier, LookupEntry>       PackageLookup;
+    typedef std::unique_lock<std::mutex>    ShardLock;
     
-    ContainerLookup                 _containers;
-    PackageLookup                   _packages;
+    mutable std::array<Shard, ShardCount>   _shards;
+    
+    std::atomic<size_t>             _maxContainers;
+    std::atomic<size_t>             _maxBytes;
+    std::atomic<size_t>             _loads;
+    std::atomic<size_t>             _evictions;
+    std::atomic<size_t>             _residentContainers;
+    std::atomic<size_t>             _residentBytes;
+    
+    // set only while loading, so it may be read without locking
+    shared_ptr<LibraryCatalog>      _catalog;
     
     static unique_ptr<Library>      _singleton;
+    
+    Shard&              ShardForKey(const string& key)                      const;
+    
+    // install or remove an entry's container, keeping the counters up to date
+    // the entry's shard must be locked
+    void                SetEntryContainer(ContainerEntry& entry, shared_ptr<Container> container, size_t bytes);
+    shared_ptr<Container>   UnloadEntry(ContainerEntry& entry);
+    
+    // whether an entry's container is loaded and referenced only by the library
+    static bool         IsEvictable(const ContainerEntry& entry);
+    bool                WithinResidencyLimits()                             const;
+    
+    // records the unique identifiers of a loaded container's packages
+    void                RegisterPackages(shared_ptr<Container> container, const string& path);
+    
+    // records a container's package identifiers, returning the number which were new
+    size_t              RegisterIdentifiers(const LibraryCatalog::IdentifierList& uniqueIDs, const string& path);
+    
+    // every known container path, with the identifiers of its packages
+    LibraryCatalog::Contents    AllContents()                               const;
 };
 
 EPUB3_END_NAMESPACE
@@ -0,0 +1,612 @@
+//
+//  library_catalog.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "library_catalog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#if EPUB_OS(UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif EPUB_PLATFORM(WIN)
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#endif
+
+EPUB3_BEGIN_NAMESPACE
+
+const char LibraryCatalog::Signature[8] = { 'E', 'P', 'U', 'B', 'L', 'I', 'B', '\x01' };
+
+// header layout: all fields are little-endian uint32_t following the signature
+enum
+{
+    kVersionField           = 8,
+    kImageSizeField         = 12,   // offset at which the journal begins
+    kPathCountField         = 16,
+    kRecordCountField       = 20,
+    kBucketCountField       = 24,   // per hash table; always a power of two
+    kPathTableField         = 28,   // { offset, length } per path
+    kRecordTableField       = 32,   // { uid offset, uid length, package-id length, path index } per package
+    kUIDBucketsField        = 36,   // record index + 1, or zero if empty
+    kPIDBucketsField        = 40,
+    kHeaderSize             = 44,
+    
+    kPathEntrySize          = 8,
+    kRecordSize             = 16,
+    kCatalogVersion         = 1,
+};
+
+static inline uint32_t _ReadUInt32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+static inline void _AppendUInt32(std::string& buf, uint32_t value)
+{
+    char bytes[4] = { char(value & 0xFF), char((value >> 8) & 0xFF), char((value >> 16) & 0xFF), char((value >> 24) & 0xFF) };
+    buf.append(bytes, 4);
+}
+static inline void _StoreUInt32(std::string& buf, size_t offset, uint32_t value)
+{
+    for ( int i = 0; i < 4; i++ )
+        buf[offset+i] = char((value >> (i*8)) & 0xFF);
+}
+
+// 32-bit FNV-1a: stable across platforms, unlike std::hash
+static uint32_t _Hash(const char* p, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for ( size_t i = 0; i < len; i++ )
+    {
+        hash ^= uint8_t(p[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// cuts a file off after its first `size` bytes
+static bool _TruncateFile(const string& path, uint64_t size)
+{
+#if EPUB_OS(UNIX)
+    return ::truncate(path.c_str(), off_t(size)) == 0;
+#elif EPUB_PLATFORM(WIN)
+    int fd = -1;
+    if ( ::_sopen_s(&fd, path.c_str(), _O_RDWR|_O_BINARY, _SH_DENYNO, 0) != 0 )
+        return false;
+    bool ok = (::_chsize_s(fd, static_cast<__int64>(size)) == 0);
+    ::_close(fd);
+    return ok;
+#else
+    std::string bytes;
+    {
+        std::ifstream stream(path.stl_str(), std::ios::in|std::ios::binary);
+        bytes.resize(size_t(size));
+        if ( !stream.read(&bytes[0], bytes.size()) )
+            return false;
+    }
+    std::ofstream stream(path.stl_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+    return bool(stream.write(bytes.data(), bytes.size()).flush());
+#endif
+}
+
+/**
+ A read-only view of the catalog file's bytes.
+ 
+ On POSIX systems the file is mapped into memory; elsewhere it is read in.
+ */
+class LibraryCatalog::Mapping
+{
+public:
+    static Mapping* Create(const string& path)
+    {
+#if EPUB_OS(UNIX)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if ( fd < 0 )
+            return nullptr;
+        
+        struct stat sb;
+        void* addr = MAP_FAILED;
+        if ( ::fstat(fd, &sb) == 0 && sb.st_size > 0 )
+            addr = ::mmap(nullptr, size_t(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);        // the mapping remains valid
+        
+        if ( addr == MAP_FAILED )
+            return nullptr;
+        return new Mapping(reinterpret_cast<const uint8_t*>(addr), size_t(sb.st_size));
+#else
+        std::ifstream stream(path.stl_str(), std::ios::in|std::ios::binary);
+        if ( !stream )
+            return nullptr;
+        
+        Mapping* result = new Mapping(nullptr, 0);
+        result->_buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        if ( result->_buffer.empty() )
+        {
+            delete result;
+            return nullptr;
+        }
+        result->_data = result->_buffer.data();
+        result->_size = result->_buffer.size();
+        return result;
+#endif
+    }
+    
+    ~Mapping()
+    {
+#if EPUB_OS(UNIX)
+        if ( _data != nullptr )
+            ::munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+    }
+    
+    const uint8_t*  Data()      const   { return _data; }
+    size_t          Size()      const   { return _size; }
+    
+    uint32_t        Field(size_t offset)    const   { return _ReadUInt32(_data + offset); }
+    
+private:
+    Mapping(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+    
+    const uint8_t*          _data;
+    size_t                  _size;
+#if !EPUB_OS(UNIX)
+    std::vector<uint8_t>    _buffer;
+#endif
+};
+
+LibraryCatalog::LibraryCatalog(const string& path) : _path(path), _image(), _journalLock(), _journalUIDs(), _journalPIDs(), _journalPaths(), _journalEnd(0), _journalDamaged(false)
+{
+}
+LibraryCatalog::~LibraryCatalog()
+{
+}
+std::string LibraryCatalog::PackageIDForUniqueID(const std::string& uniqueID)
+{
+    // package IDs may themselves contain '@' (e.g. `mailto:` URIs), but dates don't
+    return uniqueID.substr(0, uniqueID.rfind('@'));
+}
+bool LibraryCatalog::IsCatalogFile(const string& path)
+{
+    std::ifstream stream(path.stl_str(), std::ios::in|std::ios::binary);
+    char sig[sizeof(Signature)];
+    if ( !stream.read(sig, sizeof(sig)) )
+        return false;
+    return std::memcmp(sig, Signature, sizeof(Signature)) == 0;
+}
+shared_ptr<LibraryCatalog> LibraryCatalog::Open(const string& path)
+{
+    shared_ptr<LibraryCatalog> result(new LibraryCatalog(path));
+    if ( !result->Load() )
+        return nullptr;
+    return result;
+}
+bool LibraryCatalog::Load()
+{
+    std::unique_lock<std::mutex> _(_journalLock);
+    return LoadLocked();
+}
+bool LibraryCatalog::LoadLocked()
+{
+    shared_ptr<Mapping> image(Mapping::Create(_path));
+    if ( !image || image->Size() < kHeaderSize || std::memcmp(image->Data(), Signature, sizeof(Signature)) != 0 )
+        return false;
+    if ( image->Field(kVersionField) != kCatalogVersion )
+        return false;
+    
+    // check that every table lies within the image; strings are bounds-checked as they're read
+    uint64_t imageSize = image->Field(kImageSizeField);
+    uint64_t bucketCount = image->Field(kBucketCountField);
+    if ( imageSize > image->Size() || bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 )
+        return false;
+    if ( image->Field(kPathTableField) + uint64_t(image->Field(kPathCountField)) * kPathEntrySize > imageSize )
+        return false;
+    if ( image->Field(kRecordTableField) + uint64_t(image->Field(kRecordCountField)) * kRecordSize > imageSize )
+        return false;
+    if ( image->Field(kUIDBucketsField) + bucketCount * 4 > imageSize || image->Field(kPIDBucketsField) + bucketCount * 4 > imageSize )
+        return false;
+    
+    _journalUIDs.clear();
+    _journalPIDs.clear();
+    _journalPaths.clear();
+    
+    const uint8_t* end = image->Data() + image->Size();
+    const uint8_t* validEnd = ReadJournal(image->Data() + imageSize, end);
+    _journalEnd = uint64_t(validEnd - image->Data());
+    _journalDamaged = (validEnd != end);
+    
+    std::atomic_store(&_image, MappingPtr(image));
+    return true;
+}
+const uint8_t* LibraryCatalog::ReadJournal(const uint8_t* p, const uint8_t* end)
+{
+    // each record: payload size, payload checksum, then the path and identifiers,
+    //  each as a length followed by bytes
+    const uint8_t* validEnd = p;
+    while ( end - p >= 8 )
+    {
+        uint32_t size = _ReadUInt32(p);
+        uint32_t checksum = _ReadUInt32(p+4);
+        if ( uint64_t(end - p - 8) < size )
+            break;      // truncated by an interrupted append
+        
+        const uint8_t* payload = p + 8;
+        const uint8_t* payloadEnd = payload + size;
+        p = payloadEnd;
+        
+        if ( _Hash(reinterpret_cast<const char*>(payload), size) != checksum )
+            break;
+        
+        std::string path;
+        IdentifierList uniqueIDs;
+        uint32_t count = 0;
+        bool valid = false;
+        
+        // a path, then the identifier count and the identifiers
+        if ( payloadEnd - payload >= 4 )
+        {
+            uint32_t len = _ReadUInt32(payload);
+            payload += 4;
+            if ( uint64_t(payloadEnd - payload) >= uint64_t(len) + 4 )
+            {
+                path.assign(reinterpret_cast<const char*>(payload), len);
+                payload += len;
+                count = _ReadUInt32(payload);
+                payload += 4;
+                valid = true;
+            }
+        }
+        
+        for ( uint32_t i = 0; valid && i < count; i++ )
+        {
+            if ( payloadEnd - payload < 4 )
+            {
+                valid = false;
+                break;
+            }
+            uint32_t len = _ReadUInt32(payload);
+            payload += 4;
+            if ( uint64_t(payloadEnd - payload) < len )
+            {
+                valid = false;
+                break;
+            }
+            uniqueIDs.emplace_back(reinterpret_cast<const char*>(payload), len);
+            payload += len;
+        }
+        
+        if ( !valid )
+            break;
+        
+        ApplyJournalEntry(path, uniqueIDs);
+        validEnd = p;
+    }
+    
+    return validEnd;
+}
+void LibraryCatalog::ApplyJournalEntry(const std::string& path, const IdentifierList& uniqueIDs)
+{
+    _journalPaths.insert(path);
+    for ( auto& uid : uniqueIDs )
+    {
+        _journalUIDs[uid] = path;
+        _journalPIDs[PackageIDForUniqueID(uid)] = path;
+    }
+}
+bool LibraryCatalog::LookupInImage(const Mapping* image, const std::string& key, bool packageID, std::string& path)
+{
+    if ( image == nullptr )
+        return false;
+    
+    const uint8_t* data = image->Data();
+    size_t imageSize = image->Field(kImageSizeField);
+    uint32_t mask = image->Field(kBucketCountField) - 1;
+    uint32_t recordCount = image->Field(kRecordCountField);
+    uint32_t pathCount = image->Field(kPathCountField);
+    const uint8_t* buckets = data + image->Field(packageID ? kPIDBucketsField : kUIDBucketsField);
+    const uint8_t* records = data + image->Field(kRecordTableField);
+    const uint8_t* paths = data + image->Field(kPathTableField);
+    
+    for ( uint32_t probe = 0, i = _Hash(key.data(), key.size()) & mask; probe <= mask; probe++, i = (i + 1) & mask )
+    {
+        uint32_t slot = _ReadUInt32(buckets + i*4);
+        if ( slot == 0 )
+            return false;
+        if ( slot > recordCount )
+            return false;       // corrupt
+        
+        const uint8_t* record = records + (slot-1) * kRecordSize;
+        uint32_t offset = _ReadUInt32(record);
+        uint32_t length = _ReadUInt32(record + (packageID ? 8 : 4));
+        if ( length != key.size() || uint64_t(offset) + length > imageSize )
+            continue;
+        if ( std::memcmp(data + offset, key.data(), length) != 0 )
+            continue;
+        
+        uint32_t pathIndex = _ReadUInt32(record + 12);
+        if ( pathIndex >= pathCount )
+            return false;
+        
+        const uint8_t* entry = paths + pathIndex * kPathEntrySize;
+        uint32_t pathOffset = _ReadUInt32(entry), pathLength = _ReadUInt32(entry + 4);
+        if ( uint64_t(pathOffset) + pathLength > imageSize )
+            return false;
+        
+        path.assign(reinterpret_cast<const char*>(data + pathOffset), pathLength);
+        return true;
+    }
+    
+    return false;
+}
+string LibraryCatalog::PathForUniqueID(const string& uniqueID) const
+{
+    // the image is taken while the journal is locked, so the two are consistent
+    MappingPtr image;
+    {
+        std::unique_lock<std::mutex> _(_journalLock);
+        auto found = _journalUIDs.find(uniqueID.stl_str());
+        if ( found != _journalUIDs.end() )
+            return found->second;
+        image = CurrentImage();
+    }
+    
+    std::string path;
+    if ( LookupInImage(image.get(), uniqueID.stl_str(), false, path) )
+        return path;
+    return string::EmptyString;
+}
+string LibraryCatalog::PathForPackageID(const string& packageID) const
+{
+    // the image is taken while the journal is locked, so the two are consistent
+    MappingPtr image;
+    {
+        std::unique_lock<std::mutex> _(_journalLock);
+        auto found = _journalPIDs.find(packageID.stl_str());
+        if ( found != _journalPIDs.end() )
+            return found->second;
+        image = CurrentImage();
+    }
+    
+    std::string path;
+    if ( LookupInImage(image.get(), packageID.stl_str(), true, path) )
+        return path;
+    return string::EmptyString;
+}
+bool LibraryCatalog::Append(const string& containerPath, const IdentifierList& uniqueIDs)
+{
+    std::string payload;
+    _AppendUInt32(payload, uint32_t(containerPath.utf8_size()));
+    payload.append(containerPath.stl_str());
+    _AppendUInt32(payload, uint32_t(uniqueIDs.size()));
+    for ( auto& uid : uniqueIDs )
+    {
+        _AppendUInt32(payload, uint32_t(uid.size()));
+        payload.append(uid);
+    }
+    
+    std::string record;
+    _AppendUInt32(record, uint32_t(payload.size()));
+    _AppendUInt32(record, _Hash(payload.data(), payload.size()));
+    record.append(payload);
+    
+    std::unique_lock<std::mutex> _(_journalLock);
+    
+    // anything after the last valid record would hide this one from the next Load()
+    if ( _journalDamaged )
+    {
+        if ( !_TruncateFile(_path, _journalEnd) )
+            return false;
+        _journalDamaged = false;
+    }
+    
+    std::ofstream stream(_path.stl_str(), std::ios::out|std::ios::binary|std::ios::app);
+    if ( !stream.write(record.data(), record.size()).flush() )
+    {
+        _journalDamaged = true;
+        return false;
+    }
+    
+    _journalEnd += record.size();
+    ApplyJournalEntry(containerPath.stl_str(), uniqueIDs);
+    return true;
+}
+LibraryCatalog::Contents LibraryCatalog::AllContents() const
+{
+    std::unique_lock<std::mutex> _(_journalLock);
+    MappingPtr image = CurrentImage();
+    return AllContentsLocked(image.get());
+}
+LibraryCatalog::Contents LibraryCatalog::AllContentsLocked(const Mapping* image) const
+{
+    Contents result;
+    
+    if ( image != nullptr )
+    {
+        const uint8_t* data = image->Data();
+        size_t imageSize = image->Field(kImageSizeField);
+        uint32_t pathCount = image->Field(kPathCountField);
+        uint32_t recordCount = image->Field(kRecordCountField);
+        const uint8_t* paths = data + image->Field(kPathTableField);
+        const uint8_t* records = data + image->Field(kRecordTableField);
+        
+        std::vector<Contents::iterator> pathEntries;
+        pathEntries.reserve(pathCount);
+        for ( uint32_t i = 0; i < pathCount; i++ )
+        {
+            uint32_t offset = _ReadUInt32(paths + i*kPathEntrySize), length = _ReadUInt32(paths + i*kPathEntrySize + 4);
+            if ( uint64_t(offset) + length > imageSize )
+                return Contents();
+            pathEntries.push_back(result.insert(std::make_pair(std::string(reinterpret_cast<const char*>(data + offset), length), IdentifierList())).first);
+        }
+        
+        for ( uint32_t i = 0; i < recordCount; i++ )
+        {
+            const uint8_t* record = records + i*kRecordSize;
+            uint32_t offset = _ReadUInt32(record), length = _ReadUInt32(record + 4), pathIndex = _ReadUInt32(record + 12);
+            if ( uint64_t(offset) + length > imageSize || pathIndex >= pathCount )
+                return Contents();
+            pathEntries[pathIndex]->second.emplace_back(reinterpret_cast<const char*>(data + offset), length);
+        }
+    }
+    
+    if ( _journalUIDs.empty() && _journalPaths.empty() )
+        return result;
+    
+    // journaled identifiers replace any in the image
+    for ( auto& pair : result )
+    {
+        IdentifierList& uids = pair.second;
+        uids.erase(std::remove_if(uids.begin(), uids.end(), [&](const std::string& uid) {
+            return _journalUIDs.find(uid) != _journalUIDs.end();
+        }), uids.end());
+    }
+    for ( auto& path : _journalPaths )
+        result[path];
+    for ( auto& pair : _journalUIDs )
+        result[pair.second].push_back(pair.first);
+    
+    return result;
+}
+bool LibraryCatalog::Write(const string& path, const Contents& contents)
+{
+    std::string strings;
+    std::string pathTable, recordTable;
+    
+    struct Record
+    {
+        uint32_t    uidOffset;
+        uint32_t    uidLength;
+        uint32_t    pidLength;
+    };
+    std::vector<Record> records;
+    std::unordered_set<std::string> seen;
+    
+    uint32_t pathIndex = 0;
+    for ( auto& pair : contents )
+    {
+        _AppendUInt32(pathTable, uint32_t(kHeaderSize + strings.size()));
+        _AppendUInt32(pathTable, uint32_t(pair.first.size()));
+        strings.append(pair.first);
+        
+        for ( auto& uid : pair.second )
+        {
+            if ( !seen.insert(uid).second )
+                continue;
+            
+            Record record = { uint32_t(kHeaderSize + strings.size()), uint32_t(uid.size()), uint32_t(PackageIDForUniqueID(uid).size()) };
+            records.push_back(record);
+            strings.append(uid);
+            
+            _AppendUInt32(recordTable, record.uidOffset);
+            _AppendUInt32(recordTable, record.uidLength);
+            _AppendUInt32(recordTable, record.pidLength);
+            _AppendUInt32(recordTable, pathIndex);
+        }
+        
+        pathIndex++;
+    }
+    
+    // keep the tables at most half full
+    uint32_t bucketCount = 8;
+    while ( bucketCount < records.size() * 2 )
+        bucketCount <<= 1;
+    
+    std::vector<uint32_t> uidBuckets(bucketCount, 0), pidBuckets(bucketCount, 0);
+    std::unordered_set<std::string> packageIDs;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        const char* uid = strings.data() + records[i].uidOffset - kHeaderSize;
+        
+        uint32_t slot = _Hash(uid, records[i].uidLength) & (bucketCount - 1);
+        while ( uidBuckets[slot] != 0 )
+            slot = (slot + 1) & (bucketCount - 1);
+        uidBuckets[slot] = uint32_t(i + 1);
+        
+        // only the first package with any given package ID is indexed by it
+        if ( !packageIDs.insert(std::string(uid, records[i].pidLength)).second )
+            continue;
+        slot = _Hash(uid, records[i].pidLength) & (bucketCount - 1);
+        while ( pidBuckets[slot] != 0 )
+            slot = (slot + 1) & (bucketCount - 1);
+        pidBuckets[slot] = uint32_t(i + 1);
+    }
+    
+    std::string image(Signature, sizeof(Signature));
+    image.resize(kHeaderSize, '\0');
+    image.append(strings);
+    
+    // keep the tables four-byte aligned within the file
+    image.resize((image.size() + 3) & ~size_t(3), '\0');
+    
+    _StoreUInt32(image, kPathTableField, uint32_t(image.size()));
+    image.append(pathTable);
+    _StoreUInt32(image, kRecordTableField, uint32_t(image.size()));
+    image.append(recordTable);
+    _StoreUInt32(image, kUIDBucketsField, uint32_t(image.size()));
+    for ( auto slot : uidBuckets )
+        _AppendUInt32(image, slot);
+    _StoreUInt32(image, kPIDBucketsField, uint32_t(image.size()));
+    for ( auto slot : pidBuckets )
+        _AppendUInt32(image, slot);
+    
+    _StoreUInt32(image, kVersionField, kCatalogVersion);
+    _StoreUInt32(image, kImageSizeField, uint32_t(image.size()));
+    _StoreUInt32(image, kPathCountField, uint32_t(contents.size()));
+    _StoreUInt32(image, kRecordCountField, uint32_t(records.size()));
+    _StoreUInt32(image, kBucketCountField, bucketCount);
+    
+    // write alongside, then replace, so an open catalog is never seen half-written
+    std::string tmpPath(path.stl_str() + ".tmp");
+    {
+        std::ofstream stream(tmpPath, std::ios::out|std::ios::binary|std::ios::trunc);
+        if ( !stream.write(image.data(), image.size()).flush() )
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    
+#if EPUB_PLATFORM(WIN)
+    std::remove(path.c_str());
+#endif
+    if ( std::rename(tmpPath.c_str(), path.c_str()) != 0 )
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    
+    return true;
+}
+bool LibraryCatalog::Compact()
+{
+    // held throughout, so nothing can be appended to the file being replaced
+    std::unique_lock<std::mutex> _(_journalLock);
+    MappingPtr image = CurrentImage();
+    if ( !Write(_path, AllContentsLocked(image.get())) )
+        return false;
+    
+    return LoadLocked();
+}
+
+EPUB3_END_NAMESPACE
@@ -0,0 +1,210 @@
+//
+//  library_catalog.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__library_catalog__
+#define __ePub3__library_catalog__
+
+#include <ePub3/epub3.h>
+#include <ePub3/utilities/utfstring.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ A binary index of a library's publications, mapping their unique identifiers
+ (and package identifiers) to the paths of their containers.
+ 
+ The file begins with an immutable image: a header, a table of container paths, a
+ table of package records, and two open-addressed hash tables keyed on the unique
+ and package identifiers respectively. The image is memory-mapped where the
+ platform allows, and lookups read it directly, so opening a catalog costs the
+ same regardless of its size, and each lookup is a single hash probe sequence.
+ 
+ Updates are appended to a journal following the image, so recording a newly-added
+ publication never rewrites the file. The journal is read into memory when the
+ catalog is opened, and takes precedence over the image. Compact() folds the journal
+ back into a new image.
+ 
+ All integers are stored little-endian, and identifiers are hashed using 32-bit
+ FNV-1a, so catalogs can be moved between platforms. A partially-written journal
+ record (from an interrupted append), and anything following it, is ignored, and is
+ cut off the file before the next record is appended.
+ 
+ Lookups, appends and Compact() may be made from any thread. Compact() publishes its
+ new image atomically, so lookups already reading the old one finish safely. Only
+ one LibraryCatalog should write to a given file at a time.
+ @ingroup utilities
+ */
+class LibraryCatalog
+{
+public:
+    typedef std::vector<std::string>                IdentifierList;
+    
+    ///
+    /// Container paths mapped to the unique identifiers of their packages.
+    typedef std::map<std::string, IdentifierList>   Contents;
+    
+    ///
+    /// The first bytes of every catalog file.
+    static EPUB3_EXPORT const char                  Signature[8];
+    
+private:
+                            LibraryCatalog(const LibraryCatalog&)   _DELETED_;
+    LibraryCatalog&         operator=(const LibraryCatalog&)        _DELETED_;
+    
+protected:
+                            LibraryCatalog(const string& path);
+    
+public:
+    virtual                 ~LibraryCatalog();
+    
+    /**
+     Opens an existing catalog file.
+     @param path The path of the catalog.
+     @result The catalog, or `nullptr` if the file couldn't be read or isn't a valid
+     catalog.
+     */
+    EPUB3_EXPORT
+    static shared_ptr<LibraryCatalog>   Open(const string& path);
+    
+    /**
+     Determines whether a file is a catalog, by checking its signature.
+     */
+    EPUB3_EXPORT
+    static bool             IsCatalogFile(const string& path);
+    
+    /**
+     Writes a new catalog file, with an empty journal.
+     @param path The path at which to write the catalog. Any existing file is
+     replaced.
+     @param contents The containers and identifiers to store.
+     @result Returns `true` if the file was written successfully.
+     */
+    EPUB3_EXPORT
+    static bool             Write(const string& path, const Contents& contents);
+    
+    ///
+    /// The path of the catalog file.
+    const string&           Path()                                  const   { return _path; }
+    
+    /**
+     Looks up the container holding a package.
+     @param uniqueID The unique identifier of the package.
+     @result The container's path, or an empty string if the package is unknown.
+     */
+    EPUB3_EXPORT
+    string                  PathForUniqueID(const string& uniqueID)   const;
+    
+    /**
+     Looks up the container holding a package, ignoring its modification date.
+     @param packageID The package identifier, i.e. the unique identifier without any
+     trailing `@` and date.
+     @result The container's path, or an empty string if the package is unknown.
+     */
+    EPUB3_EXPORT
+    string                  PathForPackageID(const string& packageID) const;
+    
+    /**
+     Records a container's packages by appending them to the journal.
+     
+     Any identifiers already known are remapped to the new path.
+     @param containerPath The path of the container.
+     @param uniqueIDs The unique identifiers of the container's packages.
+     @result Returns `true` if the journal record was written successfully.
+     */
+    EPUB3_EXPORT
+    bool                    Append(const string& containerPath, const IdentifierList& uniqueIDs);
+    
+    /**
+     Returns everything in the catalog, including journaled updates.
+     */
+    EPUB3_EXPORT
+    Contents                AllContents()                           const;
+    
+    /**
+     Rewrites the catalog file with an empty journal, then reopens it.
+     
+     Appends wait until the new file is in place, so none are lost.
+     @result Returns `true` if the catalog was rewritten and reopened.
+     */
+    EPUB3_EXPORT
+    bool                    Compact();
+    
+    /**
+     The package identifier portion of a unique identifier, i.e. everything before
+     its last `@`.
+     */
+    static std::string      PackageIDForUniqueID(const std::string& uniqueID);
+    
+protected:
+    class Mapping;
+    typedef shared_ptr<const Mapping>   MappingPtr;
+    
+    string                          _path;
+    MappingPtr                      _image;         ///< Use CurrentImage(); replaced by Compact().
+    
+    mutable std::mutex              _journalLock;
+    std::unordered_map<std::string, std::string>    _journalUIDs;   ///< Unique ID to path.
+    std::unordered_map<std::string, std::string>    _journalPIDs;   ///< Package ID to path.
+    std::unordered_set<std::string>                 _journalPaths;  ///< All journaled container paths.
+    uint64_t                        _journalEnd;    ///< The file offset just past the last valid journal record.
+    bool                            _journalDamaged;    ///< Whether anything invalid follows `_journalEnd`.
+    
+    ///
+    /// Returns the current image, which remains valid for as long as it's held.
+    MappingPtr              CurrentImage()                          const   { return std::atomic_load(&_image); }
+    
+    ///
+    /// Maps the file and reads its journal.
+    bool                    Load();
+    
+    ///
+    /// Maps the file, checks its image and reads its journal. The journal lock must be held.
+    bool                    LoadLocked();
+    
+    ///
+    /// Reads any journal records following the image. The journal lock must be held.
+    /// @result The end of the last valid record.
+    const uint8_t*          ReadJournal(const uint8_t* p, const uint8_t* end);
+    
+    ///
+    /// Records one journal entry in the in-memory tables. The journal lock must be held.
+    void                    ApplyJournalEntry(const std::string& path, const IdentifierList& uniqueIDs);
+    
+    ///
+    /// Looks up a string in one of the image's hash tables.
+    static bool             LookupInImage(const Mapping* image, const std::string& key, bool packageID, std::string& path);
+    
+    ///
+    /// Returns everything in an image plus the journal. The journal lock must be held.
+    Contents                AllContentsLocked(const Mapping* image)     const;
+    
+};
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__library_catalog__) */
@@ -22,6 +22,7 @@
 #include "manifest.h"
 #include "package.h"
 #include "byte_stream.h"
+#include "executor.h"
 #include REGEX_INCLUDE
 #include <sstream>
 
@@ -146,10 +147,10 @@ string ItemProperties::str() const
     return builder.str();
 }
 
-ManifestItem::ManifestItem(const shared_ptr<Package>& owner) : OwnedBy(owner), PropertyHolder(owner), _href(), _mediaType(), _mediaOverlayID(), _fallbackID(), _parsedProperties(0)
+ManifestItem::ManifestItem(const shared_ptr<Package>& owner) : OwnedBy(owner), PropertyHolder(owner), _href(), _absolutePath(), _mediaType(), _mediaOverlayID(), _fallbackID(), _parsedProperties(0), _contentFilterMask(0)
 {
 }
-ManifestItem::ManifestItem(ManifestItem&& o) : OwnedBy(std::move(o)), PropertyHolder(std::move(o)), XMLIdentifiable(std::move(o)), _href(std::move(o._href)), _mediaType(std::move(o._mediaType)), _mediaOverlayID(std::move(o._mediaOverlayID)), _fallbackID(std::move(o._fallbackID)), _parsedProperties(std::move(o._parsedProperties))
+ManifestItem::ManifestItem(ManifestItem&& o) : OwnedBy(std::move(o)), PropertyHolder(std::move(o)), XMLIdentifiable(std::move(o)), _href(std::move(o._href)), _absolutePath(std::move(o._absolutePath)), _mediaType(std::move(o._mediaType)), _mediaOverlayID(std::move(o._mediaOverlayID)), _fallbackID(std::move(o._fallbackID)), _parsedProperties(std::move(o._parsedProperties)), _contentFilterMask(o._contentFilterMask.load())
 {
 }
 ManifestItem::~ManifestItem()
@@ -165,6 +166,10 @@ bool ManifestItem::ParseXML(ManifestItemPtr& sharedMe, xmlNodePtr node)
     if ( _href.empty() )
         return false;
     
+    auto package = this->Owner();
+    if ( package )
+        _absolutePath = PackageBase::ResolvePath(package->BasePath(), _href);
+    
     _mediaType = _getProp(node, "media-type");
     if ( _href.empty() )
         return false;
@@ -174,10 +179,6 @@ bool ManifestItem::ParseXML(ManifestItemPtr& sharedMe, xmlNodePtr node)
     _parsedProperties = ItemProperties(_getProp(node, "properties"));
     return true;
 }
-string ManifestItem::AbsolutePath() const
-{
-    return _Str(this->Owner()->BasePath(), BaseHref());
-}
 shared_ptr<ManifestItem> ManifestItem::MediaOverlay() const
 {
     auto package = this->Owner();
@@ -198,11 +199,11 @@ string ManifestItem::BaseHref() const
 {
     // get base part of href
     string path;
-    size_t s = _href.find_first_of("#?");
+    size_t s = _href.str().find_first_of("#?");
     if ( s == string::npos )
         path = _href;
     else
-        path = path.substr(0, s);
+        path = _href.str().substr(0, s);
     return path;
 }
 bool ManifestItem::HasProperty(const std::vector<IRI>& properties) const
@@ -236,6 +237,19 @@ xmlDocPtr ManifestItem::ReferencedDocument() const
     
     return result;
 }
+std::future<xmlDocPtr> ManifestItem::ReferencedDocumentAsync() const
+{
+    // libxml2 must be initialized before it's used from several threads
+    xmlInitParser();
+    
+    // ReferencedDocument() holds the package, and hence its archive, while it reads
+    shared_ptr<const ManifestItem> self = shared_from_this();
+    ErrorHandlerFn handler = ErrorHandler();
+    return Executor::Shared()->Submit([self, handler]() {
+        ErrorHandlerScope errors(handler);
+        return self->ReferencedDocument();
+    });
+}
 unique_ptr<ByteStream> ManifestItem::Reader() const
 {
     auto package = this->Owner();
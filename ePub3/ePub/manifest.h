@@ -24,10 +24,13 @@
 
 #include <ePub3/epub3.h>
 #include <ePub3/utilities/utfstring.h>
+#include <ePub3/utilities/shared_string.h>
 #include <ePub3/utilities/iri.h>
 #include <ePub3/property_holder.h>
 #include <ePub3/utilities/xml_identifiable.h>
 #include <map>
+#include <atomic>
+#include <future>
 #include <libxml/tree.h>
 
 EPUB3_BEGIN_NAMESPACE
@@ -264,8 +267,10 @@ public:
     
     virtual bool                ParseXML(shared_ptr<ManifestItem>& sharedMe, xmlNodePtr node);
 
-    EPUB3_EXPORT
-    string                      AbsolutePath()                      const;
+    ///
+    /// The item's location within the container, normalized as per
+    /// Container::NormalizedPath(). This is resolved once, when the item is parsed.
+    const string&               AbsolutePath()                      const   { return _absolutePath; }
     
     const string&               Identifier()                        const   { return XMLIdentifier(); }
     const string&               Href()                              const   { return _href; }
@@ -290,16 +295,26 @@ public:
     EPUB3_EXPORT
     xmlDocPtr                   ReferencedDocument()                const;
     
+    // loads the document on the shared Executor, reporting errors to the calling
+    //  thread's current handler; the future throws any exception ReferencedDocument()
+    //  would have thrown
+    EPUB3_EXPORT
+    std::future<xmlDocPtr>      ReferencedDocumentAsync()           const;
+    
     // stream the data
     EPUB3_EXPORT
     unique_ptr<ByteStream>      Reader()                            const;
     
 protected:
-    string                  _href;
-    MimeType                _mediaType;
-    string                  _mediaOverlayID;
-    string                  _fallbackID;
+    SharedString            _href;
+    SharedString            _absolutePath;
+    SharedString            _mediaType;
+    SharedString            _mediaOverlayID;
+    SharedString            _fallbackID;
     ItemProperties          _parsedProperties;
+    std::atomic<uint64_t>   _contentFilterMask;     ///< Cached by the owning Package, tagged with its filter set's generation; see Package::ContentFilterMaskForItem().
+    
+    friend class Package;
 };
 
 EPUB3_END_NAMESPACE
@@ -74,7 +74,7 @@ ObjectPreprocessor::ObjectPreprocessor(const Package* pkg, const string& buttonT
 #endif
     }
 }
-void* ObjectPreprocessor::FilterData(void *data, size_t len, size_t *outputLen)
+void* ObjectPreprocessor::FilterData(FilterContext* /*context*/, void *data, size_t len, size_t *outputLen) const
 {
     char* input = reinterpret_cast<char*>(data);
     // find each `object` tag
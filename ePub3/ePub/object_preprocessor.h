@@ -97,7 +97,9 @@ public:
      is our intention that these rules will make it possible for content authors to
      anticipate these substitutions and build CSS or JavaScript rules directly.
      */
-    virtual void*   FilterData(void* data, size_t len, size_t* outputLen);
+    virtual void*   FilterData(FilterContext* context, void* data, size_t len, size_t* outputLen) const;
+    
+    using ContentFilter::FilterData;
     
 protected:
     /**
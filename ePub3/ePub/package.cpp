@@ -25,13 +25,20 @@
 #include "archive_xml.h"
 #include "xpath_wrangler.h"
 #include "nav_table.h"
+#include "nav_point.h"
 #include "glossary.h"
 #include "iri.h"
 #include "basic.h"
 #include "byte_stream.h"
+#include "filter.h"
+#include "executor.h"
 #include <ePub3/utilities/error_handler.h>
+#include <unordered_map>
 #include <sstream>
 #include <list>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
 #include REGEX_INCLUDE
 #include <libxml/xpathInternals.h>
 
@@ -79,7 +86,7 @@ PackageBase::PackageBase(const shared_ptr<Container>& owner, const string& type)
     if ( !_archive )
         throw std::invalid_argument("Owner doesn't have an archive!");
 }
-PackageBase::PackageBase(PackageBase&& o) : _archive(o._archive), _opf(o._opf), _pathBase(std::move(o._pathBase)), _type(std::move(o._type)), _manifest(std::move(o._manifest)), _spine(std::move(o._spine))
+PackageBase::PackageBase(PackageBase&& o) : _archive(o._archive), _opf(o._opf), _pathBase(std::move(o._pathBase)), _type(std::move(o._type)), _manifest(std::move(o._manifest)), _spine(std::move(o._spine)), _manifestPaths(std::move(o._manifestPaths))
 {
     o._archive = nullptr;
     o._opf = nullptr;
@@ -121,6 +128,54 @@ shared_ptr<SpineItem> PackageBase::SpineItemAt(size_t idx) const
     }
     return item;
 }
+// a navigation element's points, and all their descendants
+static size_t _NavigationFootprint(const NavigationElement* element)
+{
+    size_t total = 0;
+    for ( auto& child : element->Children() )
+    {
+        total += sizeof(NavigationPoint) + child->Title().size() + _NavigationFootprint(child.get());
+    }
+    return total;
+}
+size_t PackageBase::EstimatedMemoryUsage() const
+{
+    size_t total = XMLDocumentFootprint(_opf);
+    
+    for ( auto& pair : _manifest )
+    {
+        const ManifestItemPtr& item = pair.second;
+        total += sizeof(ManifestItem) + pair.first.size() + item->Href().size() + item->AbsolutePath().size() + item->MediaType().size();
+    }
+    
+    // the path index shares its items with the manifest, so only the keys count
+    for ( auto& pair : _manifestPaths )
+    {
+        total += sizeof(ManifestPathIndex::value_type) + pair.first.size();
+    }
+    
+    for ( shared_ptr<SpineItem> item = _spine; item != nullptr; item = item->Next() )
+    {
+        total += sizeof(SpineItem) + item->Idref().size();
+    }
+    
+    // the href cache also shares its items with the manifest
+    for ( auto& stripe : _hrefCache )
+    {
+        std::lock_guard<std::mutex> _(stripe.lock);
+        for ( auto& pair : stripe.items )
+        {
+            total += sizeof(pair) + pair.first.second.size();
+        }
+    }
+    
+    for ( auto& pair : _navigation )
+    {
+        total += sizeof(class NavigationTable) + pair.first.size() + _NavigationFootprint(pair.second.get());
+    }
+    
+    return total;
+}
 size_t PackageBase::IndexOfSpineItemWithIDRef(const string &idref) const
 {
     shared_ptr<SpineItem> item = FirstSpineItem();
@@ -140,6 +195,86 @@ shared_ptr<ManifestItem> PackageBase::ManifestItemWithID(const string &ident) co
     
     return found->second;
 }
+shared_ptr<ManifestItem> PackageBase::ManifestItemAtPath(const string &path) const
+{
+    auto found = _manifestPaths.find(Container::NormalizedPath(path));
+    if ( found == _manifestPaths.end() )
+        return nullptr;
+    
+    return found->second;
+}
+shared_ptr<ManifestItem> PackageBase::ManifestItemForHref(const string &href, const shared_ptr<ManifestItem>& relativeTo) const
+{
+    HrefCacheKey key(relativeTo.get(), href.stl_str());
+    HrefCacheStripe& stripe = _hrefCache[HrefCacheKeyHash()(key) % kHrefCacheStripes];
+    {
+        std::lock_guard<std::mutex> _(stripe.lock);
+        auto found = stripe.items.find(key);
+        if ( found != stripe.items.end() )
+            return found->second;
+    }
+    
+    // first time we've seen this link (or it has been forgotten), so resolve it properly
+    shared_ptr<ManifestItem> result;
+    string path = ResolvePath((relativeTo ? relativeTo->AbsolutePath() : _pathBase), href);
+    if ( !path.empty() )
+    {
+        auto item = _manifestPaths.find(path.stl_str());
+        if ( item != _manifestPaths.end() )
+            result = item->second;
+    }
+    else if ( relativeTo && !href.empty() && (href[0] == '#' || href[0] == '?') )
+    {
+        // a link within the same document
+        result = relativeTo;
+    }
+    
+    // only links to manifest items are kept, so arbitrary hrefs can't fill the cache
+    if ( result )
+    {
+        std::lock_guard<std::mutex> _(stripe.lock);
+        if ( stripe.items.size() >= kMaxCachedHrefs / kHrefCacheStripes )
+            stripe.items.clear();
+        stripe.items.emplace(std::move(key), result);
+    }
+    return result;
+}
+static bool _HasURLScheme(const std::string& href)
+{
+    // RFC 3986: scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ), followed by ':'
+    if ( href.empty() || !isalpha(static_cast<unsigned char>(href[0])) )
+        return false;
+    
+    for ( std::string::size_type i = 1; i < href.size(); i++ )
+    {
+        char ch = href[i];
+        if ( ch == ':' )
+            return true;
+        if ( !isalnum(static_cast<unsigned char>(ch)) && ch != '+' && ch != '-' && ch != '.' )
+            return false;
+    }
+    return false;
+}
+string PackageBase::ResolvePath(const string &basePath, const string &href)
+{
+    const std::string& in = href.stl_str();
+    std::string::size_type end = in.find_first_of("#?");
+    if ( in.empty() || end == 0 || _HasURLScheme(in) )
+        return string();
+    
+    std::string path;
+    if ( in[0] != '/' )
+    {
+        // everything up to and including the base's last slash
+        const std::string& base = basePath.stl_str();
+        std::string::size_type slash = base.rfind('/');
+        if ( slash != std::string::npos )
+            path.assign(base, 0, slash+1);
+    }
+    path.append(in, 0, end);
+    
+    return Container::NormalizedPath(path);
+}
 string PackageBase::CFISubpathForManifestItemWithID(const string &ident) const
 {
     size_t sz = IndexOfSpineItemWithIDRef(ident);
@@ -187,6 +322,7 @@ shared_ptr<SpineItem> PackageBase::ConfirmOrCorrectSpineItemQualifier(shared_ptr
             }
             
             pItem = pItem->Next();
+            idx += 2;
         }
     }
     else if ( pComponent->HasQualifier() == false )
@@ -198,55 +334,90 @@ shared_ptr<SpineItem> PackageBase::ConfirmOrCorrectSpineItemQualifier(shared_ptr
 }
 NavigationList PackageBase::NavTablesFromManifestItem(shared_ptr<PackageBase> owner, shared_ptr<ManifestItem> pItem)
 {
-    PackagePtr sharedPkg = std::dynamic_pointer_cast<Package>(owner);
-    if ( !sharedPkg )
-        return NavigationList();
-    
     if ( pItem == nullptr )
         return NavigationList();
     
-    xmlDocPtr doc = pItem->ReferencedDocument();
+    return NavTablesFromDocument(owner, pItem, pItem->ReferencedDocument());
+}
+NavigationList PackageBase::NavTablesFromDocument(shared_ptr<PackageBase> owner, shared_ptr<ManifestItem> pItem, xmlDocPtr doc)
+{
     if ( doc == nullptr )
         return NavigationList();
     
-    // find each <nav> node
-#if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
-    XPathWrangler xpath(doc, {{"epub", ePub3NamespaceURI}}); // goddamn I love C++11 initializer list constructors
-#else
-    XPathWrangler::NamespaceList __m;
-    __m["epub"] = ePub3NamespaceURI;
-    XPathWrangler xpath(doc, __m);
-#endif
-    xpath.NameDefaultNamespace("html");
-    
-    xmlNodeSetPtr nodes = xpath.Nodes("//html:nav");
+    PackagePtr sharedPkg = std::dynamic_pointer_cast<Package>(owner);
+    if ( !sharedPkg || pItem == nullptr )
+    {
+        xmlFreeDoc(doc);
+        return NavigationList();
+    }
     
     NavigationList tables;
-    for ( int i = 0; i < nodes->nodeNr; i++ )
     {
-        xmlNodePtr navNode = nodes->nodeTab[i];
-        auto navTablePtr = std::make_shared<class NavigationTable>(sharedPkg, pItem->Href());
-        if ( navTablePtr->ParseXML(navNode) )
-            tables.push_back(navTablePtr);
+        // find each <nav> node
+#if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
+        XPathWrangler xpath(doc, {{"epub", ePub3NamespaceURI}}); // goddamn I love C++11 initializer list constructors
+#else
+        XPathWrangler::NamespaceList __m;
+        __m["epub"] = ePub3NamespaceURI;
+        XPathWrangler xpath(doc, __m);
+#endif
+        xpath.NameDefaultNamespace("html");
+        
+        xmlNodeSetPtr nodes = xpath.Nodes("//html:nav");
+        
+        for ( int i = 0; i < nodes->nodeNr; i++ )
+        {
+            xmlNodePtr navNode = nodes->nodeTab[i];
+            auto navTablePtr = std::make_shared<class NavigationTable>(sharedPkg, pItem->Href());
+            if ( navTablePtr->ParseXML(navNode) )
+                tables.push_back(navTablePtr);
+        }
+        
+        xmlXPathFreeNodeSet(nodes);
+        
+        // now look for any <dl> nodes with an epub:type of "glossary"
+        nodes = xpath.Nodes("//html:dl[epub:type='glossary']");
+        if ( nodes != nullptr )
+            xmlXPathFreeNodeSet(nodes);
     }
     
-    xmlXPathFreeNodeSet(nodes);
-    
-    // now look for any <dl> nodes with an epub:type of "glossary"
-    nodes = xpath.Nodes("//html:dl[epub:type='glossary']");
-    
+    // the tables keep none of the document's nodes
+    xmlFreeDoc(doc);
     return tables;
 }
 
+// waits for and frees navigation documents which were never used, e.g. because
+//  unpacking failed part-way through
+static void _DiscardNavDocuments(std::vector<std::pair<ManifestItemPtr, std::future<xmlDocPtr>>>& documents)
+{
+    for ( auto& pending : documents )
+    {
+        if ( !pending.second.valid() )
+            continue;
+        
+        try
+        {
+            xmlDocPtr doc = Executor::Shared()->Wait(pending.second);
+            if ( doc != nullptr )
+                xmlFreeDoc(doc);
+        }
+        catch (...)
+        {
+        }
+    }
+    documents.clear();
+}
+
 #if 0
 #pragma mark - Package High-Level API
 #endif
 
-Package::Package(const shared_ptr<Container>& owner, const string& type) : PropertyHolder(), OwnedBy(owner), PackageBase(owner, type)
+Package::Package(const shared_ptr<Container>& owner, const string& type) : PropertyHolder(), OwnedBy(owner), PackageBase(owner, type), _contentFilters(std::make_shared<ContentFilterSet>()), _contentFilterLock(), _loadingNavigation(false)
 {
 }
 bool Package::Open(const string& path)
 {
+    RequireNavigationLoaded(__PRETTY_FUNCTION__);
     return PackageBase::Open(path) && Unpack();
 }
 bool Package::_OpenForTest(xmlDocPtr doc, const string& basePath)
@@ -255,9 +426,24 @@ bool Package::_OpenForTest(xmlDocPtr doc, const string& basePath)
     _pathBase = basePath;
     return Unpack();
 }
+Package::~Package()
+{
+    _DiscardNavDocuments(_pendingNavDocuments);
+}
 bool Package::Unpack()
 {
+    if ( !UnpackContents() )
+        return false;
+    
+    InstallNavigationTables(LoadNavigationTables());
+    return true;
+}
+bool Package::UnpackContents()
+{
+    RequireNavigationLoaded(__PRETTY_FUNCTION__);
+    
     PackagePtr sharedMe = shared_from_this();
+    ErrorLocation location("package document");
     
     // very basic sanity check
     xmlNodePtr root = xmlDocGetRootElement(_opf);
@@ -349,6 +535,9 @@ bool Package::Unpack()
                 _manifest[p->Identifier()] = p;
 #endif
                 StoreXMLIdentifiable(p);
+                
+                // the first item claiming a given path wins, as it would when scanning the manifest
+                _manifestPaths.insert(ManifestPathIndex::value_type(p->AbsolutePath().stl_str(), p));
             }
             else
             {
@@ -356,6 +545,16 @@ bool Package::Unpack()
             }
         }
         
+        // the navigation documents aren't needed until the very end, so they're read
+        //  and parsed in the background while the rest of the package is unpacked
+        _DiscardNavDocuments(_pendingNavDocuments);
+        for ( auto& item : _manifest )
+        {
+            if ( item.second->HasProperty(ItemProperties::Navigation) )
+                _pendingNavDocuments.emplace_back(item.second, item.second->ReferencedDocumentAsync());
+        }
+        _loadingNavigation = !_pendingNavDocuments.empty();
+        
         // check fallback chains
         typedef std::map<string, bool> IdentSet;
         IdentSet idents;
@@ -726,29 +925,63 @@ bool Package::Unpack()
     
     xmlXPathFreeNodeSet(bindingNodes);
     
-    // now the navigation tables
-    for ( auto item : _manifest )
+    // lastly, let's set the media support information
+    InitMediaSupport();
+    
+    return true;
+}
+Package::NavigationMap Package::LoadNavigationTables()
+{
+    PackagePtr sharedMe = shared_from_this();
+    ErrorLocation location("navigation document");
+    NavigationMap result;
+    
+    std::vector<PendingNavDocument> documents;
+    documents.swap(_pendingNavDocuments);
+    
+    try
     {
-        if ( !item.second->HasProperty(ItemProperties::Navigation) )
-            continue;
-        
-        NavigationList tables = NavTablesFromManifestItem(sharedMe, item.second);
-        for ( auto table : tables )
+        for ( auto& pending : documents )
         {
-            // have to dynamic_cast these guys to get the right pointer type
-            shared_ptr<class NavigationTable> navTable = std::dynamic_pointer_cast<class NavigationTable>(table);
+            NavigationList tables = NavTablesFromDocument(sharedMe, pending.first, Executor::Shared()->Wait(pending.second));
+            for ( auto table : tables )
+            {
+                // have to dynamic_cast these guys to get the right pointer type
+                shared_ptr<class NavigationTable> navTable = std::dynamic_pointer_cast<class NavigationTable>(table);
 #if EPUB_HAVE(CXX_MAP_EMPLACE)
-            _navigation.emplace(navTable->Type(), navTable);
+                result.emplace(navTable->Type(), navTable);
 #else
-            _navigation[navTable->Type()] = navTable;
+                result[navTable->Type()] = navTable;
 #endif
+            }
         }
     }
+    catch (...)
+    {
+        _DiscardNavDocuments(documents);
+        _loadingNavigation = false;
+        throw;
+    }
     
-    // lastly, let's set the media support information
-    InitMediaSupport();
-    
-    return true;
+    _loadingNavigation = false;
+    return result;
+}
+void Package::DiscardPendingNavigation()
+{
+    _DiscardNavDocuments(_pendingNavDocuments);
+    _loadingNavigation = false;
+}
+void Package::RequireNavigationLoaded(const char* fn) const
+{
+    if ( _loadingNavigation )
+        throw std::logic_error(_Str(fn, ": the package can't be changed while its navigation documents are loading"));
+}
+void Package::InstallNavigationTables(NavigationMap&& tables)
+{
+    if ( _navigation.empty() )
+        _navigation = std::move(tables);
+    else
+        _navigation.insert(tables.begin(), tables.end());
 }
 void Package::InstallPrefixesFromAttributeValue(const string& attrValue)
 {
@@ -833,6 +1066,29 @@ string Package::PackageID() const
         return string::EmptyString;
     return strings[0];
 }
+string Package::UniqueIDForPackageDocument(xmlDocPtr opf)
+{
+    if ( opf == nullptr )
+        return string::EmptyString;
+    
+#if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
+    XPathWrangler xpath(opf, {{"opf", OPFNamespace}, {"dc", DCNamespace}});
+#else
+    XPathWrangler::NamespaceList __m;
+    __m["opf"] = OPFNamespace;
+    __m["dc"] = DCNamespace;
+    XPathWrangler xpath(opf, __m);
+#endif
+    XPathWrangler::StringList ids = xpath.Strings("//*[@id=/opf:package/@unique-identifier]/text()");
+    if ( ids.empty() )
+        return string::EmptyString;
+    
+    XPathWrangler::StringList dates = xpath.Strings("/opf:package/opf:metadata/opf:meta[@property='dcterms:modified' and not(@refines)]/text()");
+    if ( dates.empty() || dates[0].empty() )
+        return ids[0];
+    
+    return _Str(ids[0], "@", dates[0]);
+}
 string Package::Version() const
 {
     return _getProp(xmlDocGetRootElement(_opf), "version");
@@ -882,6 +1138,7 @@ const CFI Package::CFIForSpineItem(shared_ptr<SpineItem> item) const
 shared_ptr<ManifestItem> Package::ManifestItemForCFI(ePub3::CFI &cfi, CFI* pRemainingCFI) const
 {
     ManifestItemPtr result;
+    ErrorLocation location("CFI");
     
     // NB: Package is a friend of CFI, so it can access the components directly
     if ( cfi._components.size() < 2 )
@@ -935,6 +1192,84 @@ shared_ptr<ManifestItem> Package::ManifestItemForCFI(ePub3::CFI &cfi, CFI* pRema
     
     return result;
 }
+Package::CFIResolutionList Package::ManifestItemsForCFIs(const std::vector<CFI>& cfis) const
+{
+    CFIResolutionList results(cfis.size());
+    
+    // walk the spine once, then look up each item's manifest entry only when first needed
+    std::vector<SpineItemPtr> spineItems;
+    for ( SpineItemPtr item = _spine; item != nullptr; item = item->Next() )
+        spineItems.push_back(item);
+    std::vector<ManifestItemPtr> manifestItems(spineItems.size());
+    std::unordered_map<std::string, size_t> idrefIndex;    // built only if a qualifier needs correcting
+    
+    for ( size_t i = 0; i < cfis.size(); i++ )
+    {
+        const CFI& cfi = cfis[i];
+        CFIResolution& result = results[i];
+        
+        if ( cfi._components.size() < 2 )
+        {
+            result.error = EPUBError::CFITooShort;
+            continue;
+        }
+        if ( cfi._components[0].nodeIndex != _spineCFIIndex )
+        {
+            result.error = EPUBError::CFIInvalidSpineLocation;
+            continue;
+        }
+        
+        const CFI::Component& component = cfi._components[1];
+        if ( !component.IsIndirector() )
+        {
+            result.error = EPUBError::CFIUnexpectedComponent;
+            continue;
+        }
+        if ( component.nodeIndex == 0 || (component.nodeIndex % 2) == 1 )
+        {
+            result.error = EPUBError::CFIStepOutOfBounds;
+            continue;
+        }
+        
+        size_t idx = (component.nodeIndex / 2) - 1;
+        if ( component.HasQualifier() && (idx >= spineItems.size() || spineItems[idx]->Idref() != component.qualifier) )
+        {
+            // the qualifier wins, as in ConfirmOrCorrectSpineItemQualifier()
+            if ( idrefIndex.empty() )
+            {
+                for ( size_t n = spineItems.size(); n > 0; n-- )
+                    idrefIndex[spineItems[n-1]->Idref().stl_str()] = n-1;   // first occurrence wins
+            }
+            
+            auto found = idrefIndex.find(component.qualifier.stl_str());
+            if ( found == idrefIndex.end() )
+            {
+                result.error = EPUBError::CFIIndirectionTargetMissing;
+                continue;
+            }
+            idx = found->second;
+        }
+        else if ( idx >= spineItems.size() )
+        {
+            result.error = EPUBError::CFIStepOutOfBounds;
+            continue;
+        }
+        
+        if ( !manifestItems[idx] )
+            manifestItems[idx] = ManifestItemWithID(spineItems[idx]->Idref());
+        result.item = manifestItems[idx];
+        if ( !result.item )
+        {
+            result.error = EPUBError::CFIIndirectionTargetNotFound;
+            continue;
+        }
+        
+        if ( cfi._components.size() > 2 )
+            result.remainingCFI.Assign(cfi, 2);
+    }
+    
+    return results;
+}
 unique_ptr<ByteStream> Package::ReadStreamForRelativePath(const string &path) const
 {
     return _archive->ByteStreamAtPath(path.stl_str());
@@ -1122,12 +1457,21 @@ const string Package::FullTitle(bool localized) const
     
     return string(ss.str());
 }
+// copies the values out of a list of shared names
+static Package::AttributionList _UnsharedNames(const Package::SharedAttributionList& names)
+{
+    return Package::AttributionList(names.begin(), names.end());
+}
 const Package::AttributionList Package::AuthorNames(bool localized) const
 {
-    AttributionList result;
+    return _UnsharedNames(SharedAuthorNames(localized));
+}
+const Package::SharedAttributionList Package::SharedAuthorNames(bool localized) const
+{
+    SharedAttributionList result;
     for ( auto item : PropertiesMatching(DCType::Creator) )
     {
-        result.emplace_back((localized? item->LocalizedValue() : item->Value()));
+        result.emplace_back((localized? item->SharedLocalizedValue() : item->SharedValue()));
     }
     
     if ( result.empty() )
@@ -1135,7 +1479,7 @@ const Package::AttributionList Package::AuthorNames(bool localized) const
         // maybe they're using dcterms:creator instead?
         for ( auto item : PropertiesMatching(MakePropertyIRI("creator", "dcterms")) )
         {
-            result.emplace_back((localized? item->LocalizedValue() : item->Value()));
+            result.emplace_back((localized? item->SharedLocalizedValue() : item->SharedValue()));
         }
     }
     
@@ -1143,22 +1487,26 @@ const Package::AttributionList Package::AuthorNames(bool localized) const
 }
 const Package::AttributionList Package::AttributionNames(bool localized) const
 {
-    AttributionList result;
+    return _UnsharedNames(SharedAttributionNames(localized));
+}
+const Package::SharedAttributionList Package::SharedAttributionNames(bool localized) const
+{
+    SharedAttributionList result;
     IRI fileAsIRI(MakePropertyIRI("file-as"));
     for ( auto item : PropertiesMatching(DCType::Creator) )
     {
         auto extension = item->ExtensionWithIdentifier(fileAsIRI);
         if ( extension )
-            result.emplace_back(extension->Value());
+            result.emplace_back(extension->SharedValue());
         else
-            result.emplace_back((localized? item->LocalizedValue() : item->Value()));
+            result.emplace_back((localized? item->SharedLocalizedValue() : item->SharedValue()));
     }
     return result;
 }
 const string Package::Authors(bool localized) const
 {
     // TODO: handle localization of the word 'and'
-    AttributionList authors = AuthorNames(localized);
+    SharedAttributionList authors = SharedAuthorNames(localized);
     if ( authors.empty() )
         return string::EmptyString;
     if ( authors.size() == 1 )
@@ -1179,17 +1527,21 @@ const string Package::Authors(bool localized) const
 }
 const Package::AttributionList Package::ContributorNames(bool localized) const
 {
-    AttributionList result;
+    return _UnsharedNames(SharedContributorNames(localized));
+}
+const Package::SharedAttributionList Package::SharedContributorNames(bool localized) const
+{
+    SharedAttributionList result;
     for ( auto item : PropertiesMatching(MakePropertyIRI("contributor", "dcterms")) )
     {
-        result.emplace_back((localized? item->LocalizedValue() : item->Value()));
+        result.emplace_back((localized? item->SharedLocalizedValue() : item->SharedValue()));
     }
     return result;
 }
 const string Package::Contributors(bool localized) const
 {
     // TODO: handle localization of the word 'and'
-    AttributionList contributors = ContributorNames(localized);
+    SharedAttributionList contributors = SharedContributorNames(localized);
     if ( contributors.empty() )
         return string::EmptyString;
     if ( contributors.size() == 1 )
@@ -1370,5 +1722,139 @@ void Package::InitMediaSupport()
         }
     }
 }
+const size_t Package::MaxContentFilters;
+
+// the mask cached on an item, tagged in the upper half with the generation of its filter set
+static inline uint64_t _TaggedFilterMask(uint32_t generation, Package::ContentFilterMask mask)
+{
+    return (uint64_t(generation) << 32) | mask;
+}
+
+void Package::AddContentFilter(shared_ptr<ContentFilter> filter)
+{
+    if ( !filter )
+        return;
+    
+    std::lock_guard<std::mutex> _(_contentFilterLock);
+    ContentFilterList filters = _contentFilters->filters;
+    if ( filters.size() == MaxContentFilters )
+        throw std::length_error(_Str("A package supports at most ", MaxContentFilters, " content filters"));
+    
+    filters.insert(filters.begin(), filter);
+    InstallContentFilters(std::move(filters));
+}
+bool Package::RemoveContentFilter(const shared_ptr<ContentFilter>& filter)
+{
+    std::lock_guard<std::mutex> _(_contentFilterLock);
+    ContentFilterList filters = _contentFilters->filters;
+    auto pos = std::find(filters.begin(), filters.end(), filter);
+    if ( pos == filters.end() )
+        return false;
+    
+    filters.erase(pos);
+    InstallContentFilters(std::move(filters));
+    return true;
+}
+Package::ContentFilterList Package::ContentFilters() const
+{
+    return CurrentContentFilters()->filters;
+}
+Package::ContentFilterMask Package::ContentFilterMaskForItem(const ManifestItem* item) const
+{
+    if ( item == nullptr )
+        return 0;
+    return ContentFilterMaskForItem(*CurrentContentFilters(), item);
+}
+Package::ContentFilterMask Package::ContentFilterMaskForItem(const ContentFilterSet& set, const ManifestItem* item) const
+{
+    uint64_t tagged = item->_contentFilterMask.load(std::memory_order_acquire);
+    if ( uint32_t(tagged >> 32) == set.generation )
+        return ContentFilterMask(tagged);
+    
+    // the filters are being replaced, and this item's mask is for another set
+    ContentFilterMask mask = 0;
+    if ( set.filters.empty() )
+        return mask;
+    
+    shared_ptr<EncryptionInfo> encInfo;
+    ContainerPtr container = Owner();
+    if ( container )
+        encInfo = container->EncryptionInfoForPath(item->AbsolutePath());
+    
+    for ( size_t i = 0; i < set.filters.size(); i++ )
+    {
+        ContentFilter::TypeSnifferFn sniffer = set.filters[i]->TypeSniffer();
+        if ( sniffer && sniffer(item, encInfo.get()) )
+            mask |= (ContentFilterMask(1) << i);
+    }
+    return mask;
+}
+Package::ContentFilterList Package::ContentFiltersForItem(const ManifestItem* item) const
+{
+    ContentFilterList result;
+    if ( item == nullptr )
+        return result;
+    
+    // the mask and the list must come from the same set
+    ContentFilterSetPtr set = CurrentContentFilters();
+    ContentFilterMask mask = ContentFilterMaskForItem(*set, item);
+    for ( size_t i = 0; mask != 0; i++, mask >>= 1 )
+    {
+        if ( (mask & 1) != 0 )
+            result.push_back(set->filters[i]);
+    }
+    
+    return result;
+}
+unique_ptr<FilterPipeline> Package::FilterPipelineForItem(const ManifestItem* item) const
+{
+    ContentFilterList filters = ContentFiltersForItem(item);
+    shared_ptr<EncryptionInfo> encInfo;
+    
+    ContainerPtr container = Owner();
+    if ( container && !filters.empty() )
+        encInfo = container->EncryptionInfoForPath(item->AbsolutePath());
+    
+    return unique_ptr<FilterPipeline>(new FilterPipeline(filters, item, encInfo.get()));
+}
+void Package::ResolveContentFilters()
+{
+    std::lock_guard<std::mutex> _(_contentFilterLock);
+    ContentFilterList filters = _contentFilters->filters;
+    InstallContentFilters(std::move(filters));
+}
+void Package::InstallContentFilters(ContentFilterList&& filters)
+{
+    shared_ptr<ContentFilterSet> set = std::make_shared<ContentFilterSet>();
+    set->filters = std::move(filters);
+    set->generation = _contentFilters->generation + 1;
+    
+    ContainerPtr container = Owner();
+    for ( auto& pair : _manifest )
+    {
+        ManifestItem* item = pair.second.get();
+        ContentFilterMask mask = 0;
+        
+        if ( !set->filters.empty() )
+        {
+            // only look up encryption details for items which might have some
+            shared_ptr<EncryptionInfo> encInfo;
+            if ( container )
+                encInfo = container->EncryptionInfoForPath(item->AbsolutePath());
+            
+            for ( size_t i = 0; i < set->filters.size(); i++ )
+            {
+                ContentFilter::TypeSnifferFn sniffer = set->filters[i]->TypeSniffer();
+                if ( sniffer && sniffer(item, encInfo.get()) )
+                    mask |= (ContentFilterMask(1) << i);
+            }
+        }
+        
+        item->_contentFilterMask.store(_TaggedFilterMask(set->generation, mask), std::memory_order_release);
+    }
+    
+    // readers still using the old set will find these masks don't match it, and sniff instead
+    std::atomic_store(&_contentFilters, ContentFilterSetPtr(set));
+}
 
 EPUB3_END_NAMESPACE
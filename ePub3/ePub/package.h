@@ -27,6 +27,10 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <unordered_map>
 #include <libxml/tree.h>
 #include <ePub3/utilities/owned_by.h>
 #include <ePub3/spine.h>
@@ -40,6 +44,7 @@
 #include <ePub3/media_support_info.h>
 #include <ePub3/property_holder.h>
 #include <ePub3/utilities/xml_identifiable.h>
+#include <ePub3/utilities/error_handler.h>
 
 EPUB3_BEGIN_NAMESPACE
 
@@ -50,6 +55,8 @@ class ByteStream;
 class Container;
 class PackageBase;
 class Package;
+class ContentFilter;
+class FilterPipeline;
 
 typedef shared_ptr<Package>     PackagePtr;
 
@@ -84,6 +91,9 @@ public:
     ///
     /// An XML-ID lookup table for relevant types
     typedef std::map<string, shared_ptr<XMLIdentifiable>>   XMLIDLookup;
+    ///
+    /// Manifest items indexed by their normalized container-relative path.
+    typedef std::unordered_map<std::string, shared_ptr<ManifestItem>>   ManifestPathIndex;
     
 private:
     /** There is no default constructor for PackageBase. */
@@ -200,8 +210,52 @@ public:
     EPUB3_EXPORT
     const shared_vector<ManifestItem> ManifestItemsWithProperties(PropertyIRIList properties) const;
     
+    /**
+     Looks up a manifest item by its location within the container.
+     @param path A container-relative path, as returned by ManifestItem::AbsolutePath().
+     The path is normalized first, so leading slashes, percent-escapes and `.` or `..`
+     components are acceptable.
+     @result The item stored at that path, or `nullptr` if the manifest has no such item.
+     */
+    EPUB3_EXPORT
+    shared_ptr<ManifestItem>    ManifestItemAtPath(const string& path)          const;
+    
+    /**
+     Resolves a link from one publication resource to another.
+     
+     The href is resolved relative to the location of `relativeTo`, or to that of the
+     package document if `relativeTo` is `nullptr`, and any query or fragment is
+     ignored. Links which resolve to a manifest item are remembered, so a reading
+     system resolving the same link again pays only for a hash lookup; at most
+     kMaxCachedHrefs are kept, and failures aren't remembered at all.
+     
+     ~~~{.cpp}
+     auto chapter = pkg.ManifestItemWithID("ch1");       // EPUB/text/ch1.xhtml
+     auto image = pkg.ManifestItemForHref("../images/figure1.png#xywh=0,0,10,10", chapter);
+     // image->AbsolutePath() == "EPUB/images/figure1.png"
+     ~~~
+     @param href The href value, as found in a content document or the package.
+     @param relativeTo The item containing the link, if any.
+     @result The manifest item referenced by the link, or `nullptr` if the href refers
+     to a resource outside the container or one which isn't in the manifest.
+     */
+    EPUB3_EXPORT
+    shared_ptr<ManifestItem>    ManifestItemForHref(const string& href, const shared_ptr<ManifestItem>& relativeTo=nullptr) const;
+    
     /// @}
     
+    /**
+     Resolves an href against a base path within the container.
+     @param basePath The path of the referring file or, if it ends with a slash, of
+     the directory containing it.
+     @param href The relative or container-absolute href to resolve.
+     @result The normalized path of the referenced resource, as per
+     Container::NormalizedPath(), or an empty string if the href has a URL scheme or
+     refers only to a fragment of the referring file.
+     */
+    EPUB3_EXPORT
+    static string           ResolvePath(const string& basePath, const string& href);
+    
     /**
      Returns a navigation table identified by type.
      @param type An `epub:type` attribute value, such as `"toc"` or `"lot"`.
@@ -224,6 +278,16 @@ public:
     /// document.
     uint32_t                SpineCFIIndex()                 const   { return _spineCFIIndex; }
     
+    /**
+     Estimates the memory used by the package.
+     
+     This includes the parsed package document along with the manifest, spine and
+     navigation objects built from it, but not any content documents.
+     @result The estimated size in bytes.
+     */
+    EPUB3_EXPORT
+    size_t                  EstimatedMemoryUsage()          const;
+    
 protected:
     shared_ptr<Archive>     _archive;           ///< The archive from which the package was loaded.
     xmlDocPtr               _opf;               ///< The XML document representing the package.
@@ -234,6 +298,32 @@ protected:
     ContentHandlerMap       _contentHandlers;   ///< All installed content handlers, indexed by media-type.
     shared_ptr<SpineItem>   _spine;             ///< The first item in the spine (SpineItems are a linked list).
     XMLIDLookup             _xmlIDLookup;       ///< Lookup table for all items with XML ID values.
+    ManifestPathIndex       _manifestPaths;     ///< All manifest items, indexed by normalized path.
+    
+    ///
+    /// The most links remembered by ManifestItemForHref().
+    static const size_t     kMaxCachedHrefs = 4096;
+    ///
+    /// The number of independently-locked parts into which the href cache is split.
+    static const size_t     kHrefCacheStripes = 8;
+    
+    ///
+    /// A link: the item containing it (`nullptr` for the package) and its href.
+    typedef std::pair<const ManifestItem*, std::string> HrefCacheKey;
+    struct HrefCacheKeyHash
+    {
+        size_t operator()(const HrefCacheKey& key) const
+            { return std::hash<std::string>()(key.second) ^ std::hash<const ManifestItem*>()(key.first); }
+    };
+    ///
+    /// Part of the cache of links resolved to manifest items. Each part is emptied
+    /// once it holds its share of kMaxCachedHrefs.
+    struct HrefCacheStripe
+    {
+        std::mutex      lock;
+        std::unordered_map<HrefCacheKey, shared_ptr<ManifestItem>, HrefCacheKeyHash>   items;
+    };
+    mutable HrefCacheStripe _hrefCache[kHrefCacheStripes];
     
     // used to verify/correct CFIs
     uint32_t                _spineCFIIndex;     ///< The CFI index for the `<spine>` element in the package document.
@@ -252,6 +342,11 @@ protected:
     ///
     /// Loads navigation tables from a given manifest item (which has the `"nav"` property).
     static NavigationList   NavTablesFromManifestItem(shared_ptr<PackageBase> owner, shared_ptr<ManifestItem> pItem);
+    
+    ///
+    /// Loads navigation tables from an item's document, which has already been read,
+    /// and which is freed once loaded.
+    static NavigationList   NavTablesFromDocument(shared_ptr<PackageBase> owner, shared_ptr<ManifestItem> pItem, xmlDocPtr doc);
 
 #if EPUB_COMPILER_SUPPORTS(CXX_DEFAULT_TEMPLATE_ARGS)
     template <class _Tp, class = typename std::enable_if
@@ -307,14 +402,29 @@ public:
      */
     typedef std::map<string, MediaSupportInfo>      MediaSupportList;
     
+    ///
+    /// A list of content filters, in the order they are applied.
+    typedef shared_vector<ContentFilter>            ContentFilterList;
+    
+    /**
+     A set of content filters, as a bitmask of indices into ContentFilters().
+     
+     Bit `n` is set if the filter at index `n` applies to an item.
+     */
+    typedef uint32_t                                ContentFilterMask;
+    
+    ///
+    /// The maximum number of content filters which may be installed in a package.
+    static const size_t                             MaxContentFilters = sizeof(ContentFilterMask)*8;
+    
 private:
                             Package()                                   _DELETED_;
                             Package(const Package&)                     _DELETED_;
 
 public:
     EPUB3_EXPORT            Package(const shared_ptr<Container>& owner, const string& type);
-                            Package(Package&& o) : OwnedBy(std::move(o)), PackageBase(std::move(o)) {}
-    virtual                 ~Package() {}
+                            Package(Package&& o) : OwnedBy(std::move(o)), PackageBase(std::move(o)), _contentFilters(std::move(o._contentFilters)), _contentFilterLock(), _pendingNavDocuments(std::move(o._pendingNavDocuments)), _loadingNavigation(o._loadingNavigation.load()) {}
+    virtual                 ~Package();
     
     virtual bool            Open(const string& path);
     bool                    _OpenForTest(xmlDocPtr doc, const string& basePath);
@@ -328,6 +438,17 @@ public:
     ///
     /// The package's unique-id on its own, without the revision modifier.
     virtual string          PackageID()             const;
+    
+    /**
+     Determines the Unique Identifier of a package document without unpacking it.
+     
+     The result matches what UniqueID() would return for a Package opened from the
+     same document, but only the two metadata items involved are examined.
+     @param opf A parsed package document.
+     @result The unique identifier, or an empty string if there is none.
+     */
+    EPUB3_EXPORT
+    static string           UniqueIDForPackageDocument(xmlDocPtr opf);
     ///
     /// MIME type of this package document (usually `application/oebps-package+xml`).
     virtual const string&   Type()                  const       { return _type; }
@@ -405,6 +526,34 @@ public:
     EPUB3_EXPORT
     shared_ptr<ManifestItem>    ManifestItemForCFI(CFI& cfi, CFI* pRemainingCFI) const;
     
+    ///
+    /// The outcome of resolving one CFI with ManifestItemsForCFIs().
+    struct CFIResolution
+    {
+        shared_ptr<ManifestItem>    item;           ///< The referenced item, or `nullptr` on failure.
+        CFI                         remainingCFI;   ///< The document-relative part of the CFI, as from ManifestItemForCFI().
+        EPUBError                   error;          ///< `EPUBError::NoError`, or the reason the CFI couldn't be resolved.
+        
+        CFIResolution() : item(), remainingCFI(), error(EPUBError::NoError) {}
+    };
+    typedef std::vector<CFIResolution>  CFIResolutionList;
+    
+    /**
+     Obtains the ManifestItems referenced by a batch of CFIs.
+     
+     This performs the same lookup as ManifestItemForCFI(), but the spine is walked
+     only once for the whole batch, and each spine step (and any `idref` correction)
+     is resolved only once no matter how many CFIs refer to it.
+     
+     The error handler is not invoked: instead each result carries its own error
+     code, and failures don't prevent the rest of the batch from being resolved.
+     Missing `idref` assertions, which are only warnings, are not reported.
+     @param cfis The CFIs to resolve. These are not modified.
+     @result One result per input CFI, in the same order.
+     */
+    EPUB3_EXPORT
+    CFIResolutionList           ManifestItemsForCFIs(const std::vector<CFI>& cfis) const;
+    
     /**
      A convenience method used to obtain a libxml2 `xmlDocPtr` from a CFI.
      
@@ -559,6 +708,11 @@ public:
     /// A simple type which lists the names of a publication's creators.
     typedef std::vector<string>                 AttributionList;
     
+    ///
+    /// A list of creators' names which share storage with the package's metadata,
+    /// so building one doesn't copy them.
+    typedef SharedStringList                    SharedAttributionList;
+    
     /**
      Retrieves the names of all authors/creators credited for this publication.
      @param localized Set to `true` (the default) to obtain localized values if
@@ -569,6 +723,12 @@ public:
     EPUB3_EXPORT
     const AttributionList   AuthorNames(bool localized=true)        const;
     
+    ///
+    /// Retrieves the names of all authors/creators, sharing storage with the metadata.
+    /// @see AuthorNames()
+    EPUB3_EXPORT
+    const SharedAttributionList SharedAuthorNames(bool localized=true)  const;
+    
     /**
      Retrieves the names of all authors/creators in sortable format.
      
@@ -583,6 +743,12 @@ public:
     EPUB3_EXPORT
     const AttributionList   AttributionNames(bool localized=true)   const;
     
+    ///
+    /// Retrieves the sortable names of all authors/creators, sharing storage with the metadata.
+    /// @see AttributionNames()
+    EPUB3_EXPORT
+    const SharedAttributionList SharedAttributionNames(bool localized=true) const;
+    
     /**
      Retrieves a display-ready string listing all authors.
      @param localized Set to `true` (the default) to obtain a localized value if
@@ -603,6 +769,12 @@ public:
     EPUB3_EXPORT
     const AttributionList   ContributorNames(bool localized=true)   const;
     
+    ///
+    /// Retrieves the names of all contributors, sharing storage with the metadata.
+    /// @see ContributorNames()
+    EPUB3_EXPORT
+    const SharedAttributionList SharedContributorNames(bool localized=true) const;
+    
     /**
      Retrieves a display-ready string listing all contributors.
      @param localized Set to `true` (the default) to obtain a localized value if
@@ -744,10 +916,148 @@ public:
     
     /// @}
     
+    /// @{
+    /// @name Content Filters
+    
+    /**
+     Installs a content filter.
+     
+     The new filter goes at the head of the package's filter list, so filters are
+     applied in LIFO order. Every manifest item is checked against the filter's
+     type-sniffer immediately, and the result is cached, so a filter's sniffer must
+     give the same answer each time it's asked about a given item.
+     
+     Filters may be added and removed while other threads are reading items: the
+     installed filters are published as an immutable set, so each read sees either
+     the old set or the new one, never a mixture.
+     @param filter The filter to install.
+     @throws std::length_error if MaxContentFilters filters are already installed.
+     */
+    EPUB3_EXPORT
+    void                    AddContentFilter(shared_ptr<ContentFilter> filter);
+    
+    /**
+     Removes a previously-installed content filter.
+     @param filter The filter to remove.
+     @result Returns `true` if the filter was found and removed.
+     */
+    EPUB3_EXPORT
+    bool                    RemoveContentFilter(const shared_ptr<ContentFilter>& filter);
+    
+    ///
+    /// All installed content filters, in the order they are applied.
+    EPUB3_EXPORT
+    ContentFilterList       ContentFilters()                const;
+    
+    /**
+     Obtains the set of filters applicable to a manifest item.
+     
+     No type-sniffers are called, unless the filters are changing at the time: this
+     uses the mask cached when the filters were installed or the package's encryption
+     information was loaded.
+     @param item A manifest item belonging to this package.
+     @result A bitmask of indices into ContentFilters().
+     */
+    EPUB3_EXPORT
+    ContentFilterMask       ContentFilterMaskForItem(const ManifestItem* item) const;
+    
+    /**
+     Obtains the filters applicable to a manifest item, in the order they are applied.
+     @param item A manifest item belonging to this package.
+     @result A list of filters to apply to the item's data; this may be empty.
+     @see ContentFilterMaskForItem()
+     */
+    EPUB3_EXPORT
+    ContentFilterList       ContentFiltersForItem(const ManifestItem* item)  const;
+    
+    /**
+     Creates a pipeline to filter the data of a single manifest item.
+     
+     The pipeline holds fresh per-resource contexts for each applicable filter, so
+     any number of items may be read and filtered concurrently.
+     @param item A manifest item belonging to this package.
+     @result A new pipeline. If no filters apply, the pipeline will be empty.
+     @see ContentFiltersForItem()
+     */
+    EPUB3_EXPORT
+    unique_ptr<FilterPipeline>  FilterPipelineForItem(const ManifestItem* item)    const;
+    
+    /**
+     Recomputes the cached filter mask for every manifest item.
+     
+     This is called automatically when filters are added or removed, and by the
+     Container once it has loaded its encryption information. It only needs to be
+     called explicitly if something else a type-sniffer depends upon has changed.
+     */
+    EPUB3_EXPORT
+    void                    ResolveContentFilters();
+    
+    /// @}
+    
 protected:
+    /**
+     An immutable set of installed content filters.
+     
+     Each set has a generation number, which tags the masks cached on manifest items
+     for it; a mask with another generation belongs to a set which is being replaced.
+     */
+    struct ContentFilterSet
+    {
+        ContentFilterList   filters;
+        uint32_t            generation;
+    };
+    typedef shared_ptr<const ContentFilterSet>      ContentFilterSetPtr;
+    
+    ///
+    /// Returns the current filter set, without locking.
+    ContentFilterSetPtr     CurrentContentFilters()         const   { return std::atomic_load(&_contentFilters); }
+    
+    ///
+    /// Returns the mask of filters in `set` applicable to an item, sniffing if it isn't cached.
+    ContentFilterMask       ContentFilterMaskForItem(const ContentFilterSet& set, const ManifestItem* item) const;
+    
+    ///
+    /// Caches the masks for a new set of filters, then makes it current. Called with _contentFilterLock held.
+    void                    InstallContentFilters(ContentFilterList&& filters);
+    
+
+    friend class Container;
+    
     ///
     /// Extracts information from the OPF XML document.
     virtual bool            Unpack();
+    
+    /**
+     Extracts everything but the navigation tables from the OPF XML document.
+     
+     The navigation documents are read and parsed on the shared Executor meanwhile;
+     LoadNavigationTables() collects them.
+     */
+    bool                    UnpackContents();
+    
+    /**
+     Builds the navigation tables from the documents started by UnpackContents().
+     
+     The tables aren't installed, so this may run on another thread while the rest of
+     the package is in use. Until it returns, the documents are read using the
+     package's archive, base path and manifest, so the package must be treated as
+     read-only: Open() and Unpack() throw `std::logic_error` meanwhile. Content filters
+     are the exception, since the filter set is replaced atomically.
+     */
+    NavigationMap           LoadNavigationTables();
+    
+    ///
+    /// Frees the documents started by UnpackContents() without building any tables.
+    void                    DiscardPendingNavigation();
+    
+    ///
+    /// Throws `std::logic_error` if navigation documents are still being loaded.
+    void                    RequireNavigationLoaded(const char* fn) const;
+    
+    ///
+    /// Adds navigation tables built by LoadNavigationTables() to the package.
+    void                    InstallNavigationTables(NavigationMap&& tables);
+    
     ///
     /// Used to handle the `prefix` attribute of the OPF `<package>` element.
     void                    InstallPrefixesFromAttributeValue(const string& attrValue);
@@ -767,6 +1077,12 @@ public:
 protected:
     LoadEventHandler        _loadEventHandler;      ///< The current handler for load events.
     MediaSupportList        _mediaSupport;          ///< A list of media types with their support details.
+    ContentFilterSetPtr     _contentFilters;        ///< Installed content filters, in the order they're applied. Use CurrentContentFilters().
+    std::mutex              _contentFilterLock;     ///< Serializes changes to the installed filters.
+    
+    typedef std::pair<shared_ptr<ManifestItem>, std::future<xmlDocPtr>>   PendingNavDocument;
+    std::vector<PendingNavDocument> _pendingNavDocuments;   ///< Navigation documents being loaded for LoadNavigationTables().
+    std::atomic<bool>       _loadingNavigation;     ///< Set from UnpackContents() until LoadNavigationTables() returns.
     
     void                    InitMediaSupport();
 };
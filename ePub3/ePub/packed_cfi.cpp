@@ -0,0 +1,322 @@
+//
+//  packed_cfi.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "packed_cfi.h"
+#include <stdexcept>
+
+EPUB3_BEGIN_NAMESPACE
+
+const size_t PackedCFI::MaxSize;
+
+// Marker bytes. Step values are encoded with a first byte of at least kFirstStepByte,
+// so that a location sorts before its offset tail, which sorts before its children.
+static const uint8_t kCharacterOffsetMarker     = 0x01;
+static const uint8_t kIndirectorMarker          = 0x02;
+static const uint8_t kSpatialTemporalMarker     = 0x03;
+static const uint8_t kFirstStepByte             = 0x04;
+
+// Order-preserving variable-length integers: the first byte determines the length,
+// and each longer form starts with a greater first byte than any shorter form.
+static const uint32_t kOneByteLimit     = 0xE0 - kFirstStepByte;           // first byte 0x04..0xDF
+static const uint32_t kTwoByteLimit     = kOneByteLimit + (16 << 8);        // first byte 0xE0..0xEF
+static const uint32_t kThreeByteLimit   = kTwoByteLimit + (8 << 16);        // first byte 0xF0..0xF7
+static const uint8_t  kFiveByteMarker   = 0xF8;
+
+// Writes to a buffer, counting (but discarding) anything which doesn't fit.
+class _Writer
+{
+public:
+    _Writer(uint8_t* buf, size_t len) : _buf(buf), _len(len), _count(0) {}
+    
+    void Put(uint8_t byte)
+    {
+        if ( _count < _len )
+            _buf[_count] = byte;
+        ++_count;
+    }
+    void PutVarint(uint32_t value)
+    {
+        if ( value < kOneByteLimit )
+        {
+            Put(static_cast<uint8_t>(kFirstStepByte + value));
+        }
+        else if ( value < kTwoByteLimit )
+        {
+            value -= kOneByteLimit;
+            Put(static_cast<uint8_t>(0xE0 | (value >> 8)));
+            Put(static_cast<uint8_t>(value));
+        }
+        else if ( value < kThreeByteLimit )
+        {
+            value -= kTwoByteLimit;
+            Put(static_cast<uint8_t>(0xF0 | (value >> 16)));
+            Put(static_cast<uint8_t>(value >> 8));
+            Put(static_cast<uint8_t>(value));
+        }
+        else
+        {
+            Put(kFiveByteMarker);
+            PutUInt32(value);
+        }
+    }
+    void PutUInt32(uint32_t value)
+    {
+        Put(static_cast<uint8_t>(value >> 24));
+        Put(static_cast<uint8_t>(value >> 16));
+        Put(static_cast<uint8_t>(value >> 8));
+        Put(static_cast<uint8_t>(value));
+    }
+    void PutFloat(float value)
+    {
+        // flip the sign bit of positive values and every bit of negative ones, so the
+        // big-endian bytes sort in numeric order
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits = ((bits & 0x80000000) != 0 ? ~bits : (bits | 0x80000000));
+        PutUInt32(bits);
+    }
+    
+    size_t Count() const { return _count; }
+    
+private:
+    uint8_t*    _buf;
+    size_t      _len;
+    size_t      _count;
+};
+
+// Reads from a buffer, failing once its end is reached.
+class _Reader
+{
+public:
+    _Reader(const uint8_t* buf, size_t len) : _pos(buf), _end(buf + len) {}
+    
+    bool AtEnd() const { return _pos == _end; }
+    uint8_t Peek() const { return *_pos; }
+    
+    bool Get(uint8_t& byte)
+    {
+        if ( _pos == _end )
+            return false;
+        byte = *_pos++;
+        return true;
+    }
+    bool GetVarint(uint32_t& value)
+    {
+        uint8_t first = 0, b1 = 0, b2 = 0;
+        if ( !Get(first) || first < kFirstStepByte )
+            return false;
+        
+        if ( first < 0xE0 )
+        {
+            value = first - kFirstStepByte;
+            return true;
+        }
+        if ( first < 0xF0 )
+        {
+            if ( !Get(b1) )
+                return false;
+            value = kOneByteLimit + ((uint32_t(first & 0x0F) << 8) | b1);
+            return true;
+        }
+        if ( first < kFiveByteMarker )
+        {
+            if ( !Get(b1) || !Get(b2) )
+                return false;
+            value = kTwoByteLimit + ((uint32_t(first & 0x07) << 16) | (uint32_t(b1) << 8) | b2);
+            return true;
+        }
+        return first == kFiveByteMarker && GetUInt32(value);
+    }
+    bool GetUInt32(uint32_t& value)
+    {
+        if ( _end - _pos < 4 )
+            return false;
+        value = (uint32_t(_pos[0]) << 24) | (uint32_t(_pos[1]) << 16) | (uint32_t(_pos[2]) << 8) | uint32_t(_pos[3]);
+        _pos += 4;
+        return true;
+    }
+    bool GetFloat(float& value)
+    {
+        uint32_t bits = 0;
+        if ( !GetUInt32(bits) )
+            return false;
+        bits = ((bits & 0x80000000) != 0 ? (bits & ~0x80000000) : ~bits);
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+    
+private:
+    const uint8_t*  _pos;
+    const uint8_t*  _end;
+};
+
+PackedCFI::PackedCFI(const CFI& cfi, Endpoint which) : _size(0)
+{
+    size_t size = Encode(cfi, which, _bytes, MaxSize);
+    if ( size > MaxSize )
+        throw std::length_error(_Str("Encoded CFI requires ", size, " bytes, but at most ", MaxSize, " are available"));
+    _size = static_cast<uint8_t>(size);
+}
+PackedCFI::PackedCFI(const uint8_t* bytes, size_t len) : _size(0)
+{
+    if ( len > MaxSize )
+        throw std::length_error(_Str("Encoded CFI of ", len, " bytes exceeds the maximum of ", MaxSize));
+    std::memcpy(_bytes, bytes, len);
+    _size = static_cast<uint8_t>(len);
+}
+size_t PackedCFI::Encode(const CFI& cfi, Endpoint which, uint8_t* buf, size_t bufLen)
+{
+    _Writer writer(buf, bufLen);
+    
+    const CFI::ComponentList* lists[2] = { &cfi._components, nullptr };
+    if ( cfi.IsRangeTriplet() )
+        lists[1] = (which == Endpoint::Start ? &cfi._rangeStart : &cfi._rangeEnd);
+    
+    const CFI::Component* last = nullptr;
+    for ( auto list : lists )
+    {
+        if ( list == nullptr )
+            continue;
+        
+        for ( auto& component : *list )
+        {
+            if ( last != nullptr && (last->flags & CFI::Component::OffsetsMask) != 0 )
+                throw CFI::InvalidCFI("Only the last step of a CFI may contain an offset");
+            
+            writer.PutVarint(component.nodeIndex);
+            if ( component.IsIndirector() )
+                writer.Put(kIndirectorMarker);
+            last = &component;
+        }
+    }
+    
+    if ( last == nullptr )
+        return 0;
+    
+    if ( last->HasCharacterOffset() )
+    {
+        writer.Put(kCharacterOffsetMarker);
+        writer.PutVarint(last->characterOffset);
+        
+        // no bias sorts first, then before, then after
+        if ( last->sideBias == CFI::SideBias::Before )
+            writer.Put(1);
+        else if ( last->sideBias == CFI::SideBias::After )
+            writer.Put(2);
+    }
+    else if ( (last->flags & CFI::Component::OffsetsMask) != 0 )
+    {
+        writer.Put(kSpatialTemporalMarker);
+        writer.Put(last->flags & (CFI::Component::TemporalOffset|CFI::Component::SpatialOffset));
+        if ( last->HasTemporalOffset() )
+            writer.PutFloat(last->temporalOffset);
+        if ( last->HasSpatialOffset() )
+        {
+            writer.PutFloat(last->spatialOffset.x);
+            writer.PutFloat(last->spatialOffset.y);
+        }
+    }
+    
+    return writer.Count();
+}
+bool PackedCFI::Decode(const uint8_t* buf, size_t len, CFI& cfi)
+{
+    CFI::ComponentList components;
+    _Reader reader(buf, len);
+    
+    while ( !reader.AtEnd() )
+    {
+        uint8_t marker = reader.Peek();
+        if ( marker >= kFirstStepByte )
+        {
+            uint32_t nodeIndex = 0;
+            if ( !reader.GetVarint(nodeIndex) )
+                return false;
+            components.emplace_back(nodeIndex);
+            continue;
+        }
+        
+        reader.Get(marker);
+        if ( components.empty() )
+            return false;
+        
+        CFI::Component& last = components.back();
+        if ( marker == kIndirectorMarker )
+        {
+            last.flags |= CFI::Component::Indirector;
+            continue;
+        }
+        
+        // an offset tail ends the encoding
+        if ( marker == kCharacterOffsetMarker )
+        {
+            if ( !reader.GetVarint(last.characterOffset) )
+                return false;
+            last.flags |= CFI::Component::CharacterOffset;
+            
+            uint8_t bias = 0;
+            if ( reader.Get(bias) )
+            {
+                if ( bias == 1 )
+                    last.sideBias = CFI::SideBias::Before;
+                else if ( bias == 2 )
+                    last.sideBias = CFI::SideBias::After;
+                else
+                    return false;
+            }
+        }
+        else if ( marker == kSpatialTemporalMarker )
+        {
+            uint8_t flags = 0;
+            if ( !reader.Get(flags) || (flags & ~(CFI::Component::TemporalOffset|CFI::Component::SpatialOffset)) != 0 )
+                return false;
+            if ( (flags & CFI::Component::TemporalOffset) != 0 && !reader.GetFloat(last.temporalOffset) )
+                return false;
+            if ( (flags & CFI::Component::SpatialOffset) != 0 &&
+                 (!reader.GetFloat(last.spatialOffset.x) || !reader.GetFloat(last.spatialOffset.y)) )
+                return false;
+            last.flags |= flags;
+        }
+        else
+        {
+            return false;
+        }
+        
+        if ( !reader.AtEnd() )
+            return false;
+    }
+    
+    cfi.Clear();
+    cfi._components = std::move(components);
+    cfi._rangeStart.clear();
+    cfi._rangeEnd.clear();
+    cfi._options = 0;
+    return true;
+}
+CFI PackedCFI::ToCFI() const
+{
+    CFI result;
+    Decode(_bytes, _size, result);
+    return result;
+}
+
+EPUB3_END_NAMESPACE
@@ -0,0 +1,168 @@
+//
+//  packed_cfi.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__packed_cfi__
+#define __ePub3__packed_cfi__
+
+#include <ePub3/epub3.h>
+#include <ePub3/cfi.h>
+#include <cstring>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ A compact binary encoding of a CFI location, whose bytes sort in document order.
+ 
+ Each step is stored as an order-preserving variable-length integer (one byte for
+ indices below 220), with marker bytes for indirection steps and for the offset
+ tail at the end. Because the encoding preserves order, two encoded CFIs can be
+ compared using `memcmp()` on their bytes (with a shorter encoding sorting first
+ when one is a prefix of the other), which allows them to be sorted, de-duplicated
+ and range-searched without decoding, whether in memory or in an on-disk index.
+ 
+ Locations sort as follows:
+ - An ancestor sorts before all of its descendants.
+ - A step without an offset sorts before the same step with an offset.
+ - Character offsets sort numerically, with a side-bias of `Before` sorting before
+   one of `After`.
+ 
+ The encoding only captures the information required to identify a location: `id`
+ and text qualifiers are not stored, and so decoding yields a CFI without any
+ assertions. A ranged CFI is encoded as either its start or its end location.
+ 
+ A PackedCFI stores its bytes inline and never allocates memory.
+ @ingroup epub-model
+ */
+class PackedCFI
+{
+public:
+    ///
+    /// The maximum number of bytes in an encoded CFI.
+    static const size_t         MaxSize = 63;
+    
+    ///
+    /// Selects which location of a ranged CFI is encoded.
+    enum class Endpoint : uint8_t
+    {
+        Start,          ///< The start of the range.
+        End,            ///< The end of the range.
+    };
+    
+public:
+    ///
+    /// Creates an empty encoding, which sorts before all others.
+                        PackedCFI() : _size(0) {}
+    /**
+     Encodes a CFI.
+     @param cfi The CFI to encode.
+     @param which For a ranged CFI, the location to encode; ignored otherwise.
+     @throws CFI::InvalidCFI if the CFI places an offset on anything but its final
+     step.
+     @throws std::length_error if the encoding would exceed MaxSize bytes.
+     */
+    EPUB3_EXPORT explicit PackedCFI(const CFI& cfi, Endpoint which=Endpoint::Start);
+    /**
+     Wraps an existing encoding, such as one read from an on-disk index.
+     @param bytes The encoded bytes. These are not validated; use Decode() to check
+     an untrusted encoding.
+     @param len The number of bytes.
+     @throws std::length_error if `len` exceeds MaxSize.
+     */
+    EPUB3_EXPORT        PackedCFI(const uint8_t* bytes, size_t len);
+    ///
+    /// Copy constructor.
+                        PackedCFI(const PackedCFI& o) : _size(o._size) { std::memcpy(_bytes, o._bytes, _size); }
+                        ~PackedCFI() {}
+    
+    PackedCFI&          operator=(const PackedCFI& o)           { _size = o._size; std::memcpy(_bytes, o._bytes, _size); return *this; }
+    
+    /**
+     Encodes a CFI into a caller-supplied buffer.
+     @param cfi The CFI to encode.
+     @param which For a ranged CFI, the location to encode.
+     @param buf The buffer into which to write the encoding. May be `nullptr` if
+     `bufLen` is zero.
+     @param bufLen The size of `buf`.
+     @result The number of bytes in the encoding, which may exceed `bufLen`, in which
+     case only `bufLen` bytes were written.
+     @throws CFI::InvalidCFI if the CFI places an offset on anything but its final
+     step.
+     */
+    EPUB3_EXPORT
+    static size_t       Encode(const CFI& cfi, Endpoint which, uint8_t* buf, size_t bufLen);
+    
+    /**
+     Decodes an encoded CFI.
+     @param buf The encoded bytes.
+     @param len The number of bytes in `buf`.
+     @param cfi Storage for the decoded CFI, which will have no qualifiers.
+     @result `true` if the bytes were a valid encoding, `false` otherwise.
+     */
+    EPUB3_EXPORT
+    static bool         Decode(const uint8_t* buf, size_t len, CFI& cfi);
+    
+    /**
+     Compares two encodings.
+     @result A value less than, equal to, or greater than zero as `a` sorts before,
+     with, or after `b`.
+     */
+    static int          Compare(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen) _NOEXCEPT
+    {
+        int result = std::memcmp(a, b, (aLen < bLen ? aLen : bLen));
+        if ( result != 0 )
+            return result;
+        return (aLen < bLen ? -1 : (aLen > bLen ? 1 : 0));
+    }
+    
+    ///
+    /// Decodes the location into a CFI.
+    EPUB3_EXPORT
+    CFI                 ToCFI()                         const;
+    
+    ///
+    /// The encoded bytes.
+    const uint8_t*      Data()                          const _NOEXCEPT { return _bytes; }
+    ///
+    /// The number of encoded bytes.
+    size_t              Size()                          const _NOEXCEPT { return _size; }
+    ///
+    /// Returns `true` if nothing is encoded.
+    bool                Empty()                         const _NOEXCEPT { return _size == 0; }
+    
+    int                 Compare(const PackedCFI& o)     const _NOEXCEPT { return Compare(_bytes, _size, o._bytes, o._size); }
+    
+    bool                operator==(const PackedCFI& o)  const _NOEXCEPT { return _size == o._size && std::memcmp(_bytes, o._bytes, _size) == 0; }
+    bool                operator!=(const PackedCFI& o)  const _NOEXCEPT { return !(*this == o); }
+    bool                operator<(const PackedCFI& o)   const _NOEXCEPT { return Compare(o) < 0; }
+    bool                operator<=(const PackedCFI& o)  const _NOEXCEPT { return Compare(o) <= 0; }
+    bool                operator>(const PackedCFI& o)   const _NOEXCEPT { return Compare(o) > 0; }
+    bool                operator>=(const PackedCFI& o)  const _NOEXCEPT { return Compare(o) >= 0; }
+    
+protected:
+    uint8_t             _bytes[MaxSize];
+    uint8_t             _size;
+    
+};
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__packed_cfi__) */
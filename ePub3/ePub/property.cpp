@@ -252,12 +252,12 @@ void Property::SetPropertyIdentifier(const IRI& iri)
         SetValue(found->second.second);
     }
 }
-const string& Property::LocalizedValue(const std::locale& locale) const
+const SharedString& Property::SharedLocalizedValue(const std::locale& locale) const
 {
     string llang = __lang_from_locale(locale);
     
     // does this match the main value?
-    if ( llang.find(_language) == 0 || _language.find(llang) == 0 )
+    if ( llang.find(Language()) == 0 || Language().find(llang) == 0 )
     {
         // main value is explicitly in this language
         return _value;
@@ -273,7 +273,7 @@ const string& Property::LocalizedValue(const std::locale& locale) const
         if ( llang.find(script->Language()) == 0 || script->Language().find(llang) == 0 )
         {
             // they match
-            return script->Value();
+            return script->SharedValue();
         }
     }
     
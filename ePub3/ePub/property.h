@@ -27,6 +27,7 @@
 #include <ePub3/utilities/owned_by.h>
 #include <ePub3/utilities/iri.h>
 #include <ePub3/utilities/utfstring.h>
+#include <ePub3/utilities/shared_string.h>
 #include <ePub3/property_extension.h>
 #include <ePub3/utilities/epub_locale.h>
 #include <ePub3/utilities/xml_identifiable.h>
@@ -149,8 +150,8 @@ public:
     
 private:
     DCType          _type;
-    string          _value;
-    string          _language;
+    SharedString    _value;
+    SharedString    _language;
     ExtensionList   _extensions;
     IRI             _identifier;
     
@@ -197,7 +198,10 @@ public:
     
     ///
     /// The value of this metadata item.
-    const string&           Value()                 const           { return _value; }
+    const string&           Value()                 const           { return _value.str(); }
+    ///
+    /// The value of this metadata item, as a handle sharing its storage.
+    const SharedString&     SharedValue()           const           { return _value; }
     
     /**
      Sets the value of this property.
@@ -207,7 +211,10 @@ public:
     
     ///
     /// The language in which the metadata value is rendered, if specified.
-    const string&           Language()              const           { return _language; }
+    const string&           Language()              const           { return _language.str(); }
+    ///
+    /// The language of the metadata value, as a handle sharing its storage.
+    const SharedString&     SharedLanguage()        const           { return _language; }
     
     /**
      Sets an explicit language for this property, to be serialized as an xml:lang attribute.
@@ -242,7 +249,17 @@ public:
      returns the non-localized value as returned from the Value() method.
      */
     EPUB3_EXPORT
-    const string&           LocalizedValue(const std::locale& locale)   const;
+    const string&           LocalizedValue(const std::locale& locale)   const   { return SharedLocalizedValue(locale).str(); }
+    
+    /**
+     Obtains the value according to a given locale, as a handle sharing its storage.
+     @see LocalizedValue(const std::locale&)
+     */
+    EPUB3_EXPORT
+    const SharedString&     SharedLocalizedValue(const std::locale& locale) const;
+    ///
+    /// Calls SharedLocalizedValue(const std::locale&) passing the result of CurrentLocale().
+    const SharedString&     SharedLocalizedValue()  const           { return SharedLocalizedValue(CurrentLocale()); }
     
     /// @}
     
@@ -25,6 +25,7 @@
 #include <ePub3/utilities/basic.h>
 #include <ePub3/utilities/owned_by.h>
 #include <ePub3/utilities/utfstring.h>
+#include <ePub3/utilities/shared_string.h>
 #include <ePub3/utilities/iri.h>
 #include <ePub3/utilities/xml_identifiable.h>
 #include <libxml/tree.h>
@@ -87,7 +88,10 @@ public:
     
     ///
     /// The extension's value.
-    const string&   Value()                 const       { return _value; }
+    const string&   Value()                 const       { return _value.str(); }
+    ///
+    /// The extension's value, as a handle sharing its storage.
+    const SharedString& SharedValue()       const       { return _value; }
     
     /**
      Sets the property's string value.
@@ -97,7 +101,10 @@ public:
     
     ///
     /// The language of the item (if applicable).
-    const string&   Language()              const       { return _language; }
+    const string&   Language()              const       { return _language.str(); }
+    ///
+    /// The language, as a handle sharing its storage.
+    const SharedString& SharedLanguage()    const       { return _language; }
     
     /**
      Sets the property's language, encoded in XML as an `xml:lang` attribute.
@@ -106,10 +113,10 @@ public:
     void            SetLanguage(const string& lang)     { _language = lang; }
     
 private:
-    string      _value;
-    string      _scheme;
-    string      _language;
-    IRI         _identifier;
+    SharedString    _value;
+    string          _scheme;
+    SharedString    _language;
+    IRI             _identifier;
 };
 
 EPUB3_END_NAMESPACE
@@ -24,6 +24,7 @@
 
 #include <ePub3/epub3.h>
 #include <ePub3/utilities/utfstring.h>
+#include <ePub3/utilities/shared_string.h>
 #include <ePub3/utilities/xml_identifiable.h>
 #include <ePub3/property_holder.h>
 #include <vector>
@@ -195,7 +196,7 @@ public:
     /// @}
     
 protected:
-    string                  _idref;             ///< The `idref` value targetting a ManifestItem.
+    SharedString            _idref;             ///< The `idref` value targetting a ManifestItem.
     bool                    _linear;            ///< `true` if the item is linear (the default).
     
     weak_ptr<SpineItem>     _prev;              ///< The SpineItem preceding this one in the spine.
@@ -35,7 +35,7 @@ bool SwitchPreprocessor::SniffSwitchableContent(const ManifestItem *item, const
 {
     return (item->MediaType() == "application/xhtml+xml" && item->HasProperty(ItemProperties::ContainsSwitch));
 }
-void * SwitchPreprocessor::FilterData(void *data, size_t len, size_t *outputLen)
+void * SwitchPreprocessor::FilterData(FilterContext* /*context*/, void *data, size_t len, size_t *outputLen) const
 {
     char* input = reinterpret_cast<char*>(data);
     
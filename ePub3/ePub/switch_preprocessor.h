@@ -96,7 +96,9 @@ public:
      matching epub:case statement will be output in place of the entire switch
      compound.
      */
-    virtual void * FilterData(void *data, size_t len, size_t *outputLen);
+    virtual void * FilterData(FilterContext* context, void *data, size_t len, size_t *outputLen) const;
+    
+    using ContentFilter::FilterData;
     
 protected:
     ///
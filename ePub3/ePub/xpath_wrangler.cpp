@@ -137,4 +137,69 @@ void XPathWrangler::NameDefaultNamespace(const string& name)
         xmlXPathRegisterNs(_ctx, name.xml_str(), defNs->href);
 }
 
+// the node itself, plus anything it owns which isn't a child node
+static size_t _NodeFootprint(xmlNodePtr node, bool interned)
+{
+    // declarations aren't laid out like nodes; count only the DTD itself
+    if ( node->type == XML_DTD_NODE )
+        return sizeof(xmlDtd);
+    
+    size_t total = sizeof(xmlNode);
+    if ( node->content != nullptr )
+        total += xmlStrlen(node->content) + 1;
+    if ( !interned && node->name != nullptr )
+        total += xmlStrlen(node->name) + 1;
+    
+    if ( node->type != XML_ELEMENT_NODE )
+        return total;
+    
+    for ( xmlNsPtr ns = node->nsDef; ns != nullptr; ns = ns->next )
+    {
+        total += sizeof(xmlNs) + xmlStrlen(ns->href) + 1;
+        if ( ns->prefix != nullptr )
+            total += xmlStrlen(ns->prefix) + 1;
+    }
+    
+    for ( xmlAttrPtr attr = node->properties; attr != nullptr; attr = attr->next )
+    {
+        total += sizeof(xmlAttr);
+        for ( xmlNodePtr value = attr->children; value != nullptr; value = value->next )
+            total += _NodeFootprint(value, interned);
+    }
+    
+    return total;
+}
+size_t XMLDocumentFootprint(xmlDocPtr doc)
+{
+    if ( doc == nullptr )
+        return 0;
+    
+    size_t total = sizeof(xmlDoc);
+    bool interned = (doc->dict != nullptr);
+    
+    // walk the tree iteratively; content documents can nest deeply
+    xmlNodePtr node = doc->children;
+    while ( node != nullptr )
+    {
+        total += _NodeFootprint(node, interned);
+        
+        if ( node->children != nullptr && node->type != XML_ENTITY_REF_NODE && node->type != XML_DTD_NODE )
+        {
+            node = node->children;
+            continue;
+        }
+        
+        while ( node != nullptr && node->next == nullptr )
+        {
+            node = node->parent;
+            if ( node == reinterpret_cast<xmlNodePtr>(doc) )
+                node = nullptr;
+        }
+        if ( node != nullptr )
+            node = node->next;
+    }
+    
+    return total;
+}
+
 EPUB3_END_NAMESPACE
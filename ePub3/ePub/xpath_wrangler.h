@@ -170,6 +170,19 @@ protected:
     xmlXPathContextPtr  _ctx;   ///< The libxml2 XPath context object.
 };
 
+/**
+ Estimates the memory occupied by a parsed libxml2 document.
+ 
+ This counts every node, attribute and namespace definition, along with all text
+ content. Names interned in the document's dictionary are shared, and aren't
+ counted.
+ @param doc The document to measure.
+ @result The estimated size in bytes, or zero if `doc` is `nullptr`.
+ @ingroup utilities
+ */
+EPUB3_EXPORT
+size_t XMLDocumentFootprint(xmlDocPtr doc);
+
 EPUB3_END_NAMESPACE
 
 #endif /* defined(__ePub3__xpath_wrangler__) */
@@ -82,18 +82,66 @@ static string GetTempFilePath(const string& ext)
 #endif
 }
 
+// a libzip archive, closed once the ZipArchive and everything reading from it are gone
+struct __SharedZip
+{
+    struct zip*     zip;
+    std::mutex      lock;
+    
+    __SharedZip(struct zip* z) : zip(z) {}
+    ~__SharedZip() {
+        if (zip != nullptr)
+            zip_close(zip);
+    }
+};
+
 class ZipReader : public ArchiveReader
 {
 public:
-    ZipReader(struct zip_file* file) : _file(file) {}
-    ZipReader(ZipReader&& o) : _file(o._file) { o._file = nullptr; }
-    virtual ~ZipReader() { if (_file != nullptr) zip_fclose(_file); }
+    ZipReader(struct zip_file* file, const shared_ptr<__SharedZip>& shared) : _file(file), _shared(shared) {}
+    ZipReader(ZipReader&& o) : _file(o._file), _shared(std::move(o._shared)) { o._file = nullptr; }
+    virtual ~ZipReader() {
+        if (_file != nullptr) {
+            std::lock_guard<std::mutex> _(_shared->lock);
+            zip_fclose(_file);
+        }
+    }
     
     virtual bool operator !() const { return _file == nullptr || _file->bytes_left == 0; }
-    virtual ssize_t read(void* p, size_t len) const { return zip_fread(_file, p, len); }
+    virtual ssize_t read(void* p, size_t len) const {
+        std::lock_guard<std::mutex> _(_shared->lock);
+        return zip_fread(_file, p, len);
+    }
+    
+private:
+    struct zip_file *       _file;
+    shared_ptr<__SharedZip> _shared;
+};
+
+// a stream which takes its archive's lock around each call into libzip
+class LockedZipFileByteStream : public ZipFileByteStream
+{
+public:
+    LockedZipFileByteStream(const shared_ptr<__SharedZip>& shared, const string& path) : ZipFileByteStream(), _shared(shared) {
+        Open(shared->zip, path);
+    }
+    virtual ~LockedZipFileByteStream() { Close(); }
+    
+    virtual bool Open(struct zip* archive, const string& path, int zipFlags=0) {
+        std::lock_guard<std::mutex> _(_shared->lock);
+        return ZipFileByteStream::Open(archive, path, zipFlags);
+    }
+    virtual void Close() {
+        std::lock_guard<std::mutex> _(_shared->lock);
+        ZipFileByteStream::Close();
+    }
+    virtual size_type ReadBytes(void* buf, size_type len) {
+        std::lock_guard<std::mutex> _(_shared->lock);
+        return ZipFileByteStream::ReadBytes(buf, len);
+    }
     
 private:
-    struct zip_file * _file;
+    shared_ptr<__SharedZip> _shared;
 };
 
 class ZipWriter : public ArchiveWriter
@@ -166,26 +214,30 @@ ZipArchive::ZipArchive(const string & path)
     if ( _zip == nullptr )
         throw std::runtime_error(std::string("zip_open() failed: ") + zError(zerr));
     _path = path;
+    _shared = std::make_shared<__SharedZip>(_zip);
+}
+ZipArchive::ZipArchive(struct zip * aZip) : _zip(aZip), _shared(std::make_shared<__SharedZip>(aZip))
+{
 }
 ZipArchive::~ZipArchive()
 {
-    if ( _zip != nullptr )
-        zip_close(_zip);
+    // _shared closes _zip, once any readers and streams are done with it
 }
 Archive & ZipArchive::operator = (ZipArchive &&o)
 {
-    if ( _zip != nullptr )
-        zip_close(_zip);
+    _shared = std::move(o._shared);
     _zip = o._zip;
     o._zip = nullptr;
     return dynamic_cast<Archive&>(*this);
 }
 bool ZipArchive::ContainsItem(const string & path) const
 {
+    std::lock_guard<std::mutex> _(_shared->lock);
     return (zip_name_locate(_zip, Sanitized(path).c_str(), 0) >= 0);
 }
 bool ZipArchive::DeleteItem(const string & path)
 {
+    std::lock_guard<std::mutex> _(_shared->lock);
     int idx = zip_name_locate(_zip, Sanitized(path).c_str(), 0);
     if ( idx >= 0 )
         return (zip_delete(_zip, idx) >= 0);
@@ -193,28 +245,34 @@ bool ZipArchive::DeleteItem(const string & path)
 }
 bool ZipArchive::CreateFolder(const string & path)
 {
+    std::lock_guard<std::mutex> _(_shared->lock);
     return (zip_add_dir(_zip, Sanitized(path).c_str()) >= 0);
 }
 unique_ptr<ByteStream> ZipArchive::ByteStreamAtPath(const string &path) const
 {
-    return unique_ptr<ByteStream>(new ZipFileByteStream(_zip, path));
+    if (_zip == nullptr)
+        return nullptr;
+    
+    return unique_ptr<ByteStream>(new LockedZipFileByteStream(_shared, path));
 }
 unique_ptr<ArchiveReader> ZipArchive::ReaderAtPath(const string & path) const
 {
     if (_zip == nullptr)
         return nullptr;
     
+    std::lock_guard<std::mutex> _(_shared->lock);
     struct zip_file* file = zip_fopen(_zip, Sanitized(path).c_str(), 0);
     if (file == nullptr)
         return nullptr;
     
-    return unique_ptr<ZipReader>(new ZipReader(file));
+    return unique_ptr<ZipReader>(new ZipReader(file, _shared));
 }
 unique_ptr<ArchiveWriter> ZipArchive::WriterAtPath(const string & path, bool compressed, bool create)
 {
     if (_zip == nullptr)
         return nullptr;
     
+    std::lock_guard<std::mutex> _(_shared->lock);
     int idx = zip_name_locate(_zip, Sanitized(path).c_str(), (create ? ZIP_CREATE : 0));
     if (idx == -1)
         return nullptr;
@@ -230,6 +288,7 @@ unique_ptr<ArchiveWriter> ZipArchive::WriterAtPath(const string & path, bool com
 }
 ArchiveItemInfo ZipArchive::InfoAtPath(const string & path) const
 {
+    std::lock_guard<std::mutex> _(_shared->lock);
     struct zip_stat sbuf;
     if ( zip_stat(_zip, Sanitized(path).c_str(), 0, &sbuf) < 0 )
         throw std::runtime_error(std::string("zip_stat("+path.stl_str()+") - " + zip_strerror(_zip)));
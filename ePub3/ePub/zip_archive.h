@@ -25,9 +25,12 @@
 #include <ePub3/archive.h>
 #include <libzip/zip.h>
 #include <list>
+#include <mutex>
 
 EPUB3_BEGIN_NAMESPACE
 
+struct __SharedZip;
+
 /**
  An Archive implementation for ZIP files, as used by the OCF 3.0 standard.
  
@@ -35,6 +38,9 @@ EPUB3_BEGIN_NAMESPACE
  @note The underlying implementation, `libzip`, writes data only when the archive
  is closed. Any data written to a zip file will therefore be kept in temporary
  storage until the archive object is closed.
+ @note `libzip` reads every item through the archive's single file handle, so the
+ archive serializes its own calls into `libzip`, allowing readers and streams for
+ different items to be used from different threads at once.
  @see http://www.idpf.org/epub/30/spec/epub30-ocf.html#physical-container-zip
  @ingroup archives
  */
@@ -56,10 +62,11 @@ public:
     ZipArchive(const string & path="");
     ///
     /// move constructos.
-    ZipArchive(ZipArchive &&o) : _zip(o._zip) { o._zip = nullptr; }
+    ZipArchive(ZipArchive &&o) : _zip(o._zip), _shared(std::move(o._shared)) { o._zip = nullptr; }
     ///
     /// Initialize directly from a `libzip` internal structure.
-    explicit ZipArchive(struct zip * aZip) : _zip(aZip) {}
+    EPUB3_EXPORT
+    explicit ZipArchive(struct zip * aZip);
     virtual ~ZipArchive();
     
     ///
@@ -85,6 +92,12 @@ protected:
     typedef std::list<zip_source*>  ZipSourceList;
     ZipSourceList   _liveSources;   ///< A list of live zip sources, which must be cleaned up upon closing.
     
+    ///
+    /// Owns `_zip`, along with the lock which guards every use of it. Each reader and
+    /// stream holds a reference too, so `_zip` stays open until the last of them
+    /// is gone, even if the archive goes first.
+    shared_ptr<__SharedZip> _shared;
+    
     ///
     /// Sanitizes a path string, since `libzip` can be finnicky about them.
     string Sanitized(const string& path) const;
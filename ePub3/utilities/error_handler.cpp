@@ -20,14 +20,27 @@
 //
 
 #include "error_handler.h"
-#include <map>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #if EPUB_HAVE(STD_STRINGSTREAM)
 # include <sstream>
 #else
 # include <strstream>
 #endif
 
+#if EPUB_OS(WINDOWS)
+# include <windows.h>
+# include <stdio.h>
+// fiber-local storage, unlike TlsAlloc(), calls a destructor when each thread exits
+# define TLS_GET(key)       FlsGetValue(key)
+# define TLS_SET(key, data) FlsSetValue(key, data)
+#else
+# include <pthread.h>
+# define TLS_GET(key)       pthread_getspecific(key)
+# define TLS_SET(key, data) pthread_setspecific(key, data)
+#endif
+
 #if EPUB_COMPILER_SUPPORTS(CXX_UNICODE_LITERALS)
 # define kSectionMarker u8"§"
 #else
@@ -57,6 +70,18 @@ static std::array<std::string, 4> gSeverityStrings = {
 
 #include "error_lookup_table.cpp"
 
+static const ErrorInfo* _LookupErrorInfo(EPUBError err) _NOEXCEPT
+{
+    const ErrorInfo* first = std::begin(gErrorLookupTable);
+    const ErrorInfo* last = std::end(gErrorLookupTable);
+    const ErrorInfo* pos = std::lower_bound(first, last, err, [](const ErrorInfo& info, EPUBError e) {
+        return info.Error() < e;
+    });
+    if ( pos == last || pos->Error() != err )
+        return nullptr;
+    return pos;
+}
+
 class _LIBCPP_HIDDEN __epub_spec_category : public std::error_category
 {
 public:
@@ -78,11 +103,10 @@ const char* __epub_spec_category::name() const _NOEXCEPT
 }
 std::string __epub_spec_category::message(int __ev) const
 {
-    EPUBError err = static_cast<EPUBError>(__ev);
-    auto pos = gErrorLookupTable.find(err);
-    if ( pos == gErrorLookupTable.end() )
+    const ErrorInfo* info = _LookupErrorInfo(static_cast<EPUBError>(__ev));
+    if ( info == nullptr )
         return std::string("Unspecified EPUB specification error");
-    return pos->second.Message();
+    return info->Message();
 }
 
 EPUB3_EXPORT
@@ -100,13 +124,12 @@ const std::error_code ErrorCodeForEPUBError(EPUBError ev) _NOEXCEPT
 EPUB3_EXPORT
 const std::string DetailedErrorMessage(EPUBError err)
 {
-    auto pos = gErrorLookupTable.find(err);
-    if ( pos == gErrorLookupTable.end() )
+    const ErrorInfo* info = _LookupErrorInfo(err);
+    if ( info == nullptr )
         return std::string("<unknown epub spec error>");
-    const ErrorInfo& info = pos->second;
     std::stringstream ss;
-    ss << SeverityString(info.Severity()) << " violation of " << EPUBSpecNames[static_cast<std::size_t>(info.Spec())] << " (" << EPUBSpecURLs[static_cast<std::size_t>(info.Spec())] << ") " << kSectionMarker << " " << info.Section() << ":" << std::endl;
-    ss << "  " << info.Message();
+    ss << SeverityString(info->Severity()) << " violation of " << EPUBSpecNames[static_cast<std::size_t>(info->Spec())] << " (" << EPUBSpecURLs[static_cast<std::size_t>(info->Spec())] << ") " << kSectionMarker << " " << info->Section() << ":" << std::endl;
+    ss << "  " << info->Message();
     return ss.str();
 }
 
@@ -146,11 +169,10 @@ epub_spec_error::~epub_spec_error() _NOEXCEPT
 }
 ViolationSeverity epub_spec_error::Severity() const
 {
-    EPUBError err = static_cast<EPUBError>(__ec.value());
-    auto pos = gErrorLookupTable.find(err);
-    if ( pos == gErrorLookupTable.end() )
+    const ErrorInfo* info = _LookupErrorInfo(static_cast<EPUBError>(__ec.value()));
+    if ( info == nullptr )
         return ViolationSeverity::Minor;
-    return pos->second.Severity();
+    return info->Severity();
 }
 
 #if 0
@@ -181,17 +203,192 @@ bool DefaultErrorHandler(const std::runtime_error& err)
 }
 
 static ErrorHandlerFn   gErrorHandler = ePub3::DefaultErrorHandler;
+static std::mutex       gErrorHandlerLock;
+
+#if 0
+#pragma mark - Per-thread Scopes
+#endif
+
+#if EPUB_OS(WINDOWS)
+static DWORD ErrorScopesTLSKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t ErrorScopesTLSKey;
+#endif
+
+// everything a thread knows about its error handling; created on first use
+struct __ThreadErrorState
+{
+    ErrorHandlerScope*  scope;          ///< The innermost scope.
+    const char*         location;       ///< The innermost ErrorLocation's name.
+};
+
+#if EPUB_OS(WINDOWS)
+static void WINAPI _DestroyTLSErrorState(PVOID data)
+#else
+static void _DestroyTLSErrorState(void* data)
+#endif
+{
+    delete reinterpret_cast<__ThreadErrorState*>(data);
+}
+#if EPUB_OS(WINDOWS)
+static void KillErrorScopesTLSKey()
+{
+    if ( ErrorScopesTLSKey != FLS_OUT_OF_INDEXES )
+        FlsFree(ErrorScopesTLSKey);
+}
+#endif
+INITIALIZER(InitErrorScopesTLSKey)
+{
+#if EPUB_OS(WINDOWS)
+    ErrorScopesTLSKey = FlsAlloc(_DestroyTLSErrorState);
+    if ( ErrorScopesTLSKey == FLS_OUT_OF_INDEXES )
+    {
+        fprintf(stderr, "No TLS Indexes for error handlers!\n");
+        ExitProcess(0);
+    }
+    atexit(KillErrorScopesTLSKey);
+#else
+    pthread_key_create(&ErrorScopesTLSKey, _DestroyTLSErrorState);
+#endif
+}
+
+class __ErrorScopes
+{
+public:
+    static __ThreadErrorState* State(bool create)
+    {
+        __ThreadErrorState* state = reinterpret_cast<__ThreadErrorState*>(TLS_GET(ErrorScopesTLSKey));
+        if ( state == nullptr && create )
+        {
+            state = new __ThreadErrorState();
+            TLS_SET(ErrorScopesTLSKey, reinterpret_cast<void*>(state));
+        }
+        return state;
+    }
+
+    // the innermost scope holding a handler, skipping any recorders
+    static const ErrorHandlerScope* HandlerScope()
+    {
+        __ThreadErrorState* state = State(false);
+        for ( const ErrorHandlerScope* scope = (state != nullptr ? state->scope : nullptr); scope != nullptr; scope = scope->_outer )
+        {
+            if ( scope->_recorder == nullptr )
+                return scope;
+        }
+        return nullptr;
+    }
+
+    static const ErrorHandlerFn& Handler(const ErrorHandlerScope* scope)
+    {
+        return scope->_handler;
+    }
+
+    static bool Record(EPUBError code) _NOEXCEPT
+    {
+        __ThreadErrorState* state = State(false);
+        if ( state == nullptr || state->scope == nullptr || state->scope->_recorder == nullptr )
+            return false;
+        state->scope->_recorder->Add(code, state->location);
+        
+        // a critical error means the publication can't be used, so it's handled as well
+        const ErrorInfo* info = _LookupErrorInfo(code);
+        return (info == nullptr || info->Severity() != ViolationSeverity::Critical);
+    }
+
+    static void Push(ErrorHandlerScope* scope)
+    {
+        __ThreadErrorState* state = State(true);
+        scope->_outer = state->scope;
+        state->scope = scope;
+    }
+    static void Pop(ErrorHandlerScope* scope)
+    {
+        State(true)->scope = scope->_outer;
+    }
+
+};
 
 EPUB3_EXPORT
 ErrorHandlerFn ErrorHandler()
 {
+    const ErrorHandlerScope* scope = __ErrorScopes::HandlerScope();
+    if ( scope != nullptr )
+        return __ErrorScopes::Handler(scope);
+
+    std::lock_guard<std::mutex> _(gErrorHandlerLock);
     return gErrorHandler;
 }
 
 EPUB3_EXPORT
 void SetErrorHandler(ErrorHandlerFn fn)
 {
+    std::lock_guard<std::mutex> _(gErrorHandlerLock);
     gErrorHandler = fn;
 }
 
+EPUB3_EXPORT
+bool __CallErrorHandler(const std::runtime_error& __err)
+{
+    // a scope's handler lives as long as the scope, so it can be called in place
+    const ErrorHandlerScope* scope = __ErrorScopes::HandlerScope();
+    if ( scope != nullptr )
+        return __ErrorScopes::Handler(scope)(__err);
+    return ErrorHandler()(__err);
+}
+
+EPUB3_EXPORT
+bool __RecordError(EPUBError __code) _NOEXCEPT
+{
+    return __ErrorScopes::Record(__code);
+}
+
+ErrorHandlerScope::ErrorHandlerScope(ErrorHandlerFn fn) : _handler(fn), _recorder(nullptr), _outer(nullptr)
+{
+    __ErrorScopes::Push(this);
+}
+ErrorHandlerScope::ErrorHandlerScope(ErrorRecorder* recorder) : _handler(), _recorder(recorder), _outer(nullptr)
+{
+    __ErrorScopes::Push(this);
+}
+ErrorHandlerScope::~ErrorHandlerScope()
+{
+    __ErrorScopes::Pop(this);
+}
+
+ErrorRecorder::ErrorRecorder(std::size_t capacity) : _records(new Record[capacity]), _capacity(capacity), _size(0), _dropped(0), _scope(this)
+{
+}
+ErrorRecorder::~ErrorRecorder()
+{
+}
+std::size_t ErrorRecorder::Count(EPUBError code) const
+{
+    return static_cast<std::size_t>(std::count_if(begin(), end(), [code](const Record& record) {
+        return record.code == code;
+    }));
+}
+void ErrorRecorder::Add(EPUBError code, const char* location) _NOEXCEPT
+{
+    if ( _size == _capacity )
+    {
+        _dropped++;
+        return;
+    }
+
+    Record& record = _records[_size++];
+    record.code = code;
+    record.location = location;
+}
+
+ErrorLocation::ErrorLocation(const char* name)
+{
+    __ThreadErrorState* state = __ErrorScopes::State(true);
+    _outer = state->location;
+    state->location = name;
+}
+ErrorLocation::~ErrorLocation()
+{
+    __ErrorScopes::State(true)->location = _outer;
+}
+
 EPUB3_END_NAMESPACE
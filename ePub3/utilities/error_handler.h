@@ -41,15 +41,51 @@ EPUB3_EXPORT
 bool            DefaultErrorHandler(const std::runtime_error& err);
 
 ///
-/// Retrieves the current error handler function.
+/// Retrieves the current error handler function for the calling thread: that of
+/// its innermost ErrorHandlerScope, or the global handler if it has none.
 EPUB3_EXPORT
 ErrorHandlerFn  ErrorHandler();
 
 ///
-/// Sets the current error hander function.
+/// Sets the global error hander function, used by threads with no ErrorHandlerScope.
 EPUB3_EXPORT
 void            SetErrorHandler(ErrorHandlerFn fn);
 
+class ErrorRecorder;
+
+/**
+ Installs an error handler for the calling thread while the scope exists.
+
+ Scopes nest: errors raised on a thread go to the handler of its innermost scope,
+ and a thread with no scope uses the global handler set by SetErrorHandler(). A
+ scope must be destroyed on the thread which created it, and scopes must be
+ destroyed in the reverse order of their creation, so they belong on the stack.
+
+ @ingroup utilities
+ */
+class ErrorHandlerScope
+{
+public:
+    EPUB3_EXPORT    ErrorHandlerScope(ErrorHandlerFn fn);
+    EPUB3_EXPORT    ~ErrorHandlerScope();
+
+private:
+                        ErrorHandlerScope(const ErrorHandlerScope&)     _DELETED_;
+    ErrorHandlerScope&  operator=(const ErrorHandlerScope&)             _DELETED_;
+
+    ///
+    /// Installs a recorder in place of a handler.
+                        ErrorHandlerScope(ErrorRecorder* recorder);
+
+    ErrorHandlerFn      _handler;       ///< Empty when `_recorder` is set.
+    ErrorRecorder*      _recorder;
+    ErrorHandlerScope*  _outer;
+
+    friend class ErrorRecorder;
+    friend class __ErrorScopes;
+
+};
+
 enum class EPUBSpec
 {
     OpenContainerFormat,                        // 0x00
@@ -391,21 +427,131 @@ private:
     
 };
 
+/**
+ Records the EPUB specification errors raised on the calling thread while it
+ exists, instead of handling them.
+
+ Each error is stored as its code and the ErrorLocation in which it was raised,
+ in a buffer allocated along with the recorder. No exception object is created,
+ no message is looked up or formatted, and no handler is called, so a reading
+ system can cheaply tally the violations in a sloppy book; processing carries on
+ as though a handler had chosen to ignore every error. Once the buffer is full,
+ further errors are only counted. Errors other than EPUB specification errors
+ still go to the handler of the enclosing ErrorHandlerScope (or the global one).
+ So do Critical violations, after they're recorded, since processing can't carry
+ on past them: with the default handler, they're thrown as usual.
+
+ A recorder installs itself on the calling thread like an ErrorHandlerScope, and
+ the same rules apply to its lifetime.
+
+ @ingroup utilities
+ */
+class ErrorRecorder
+{
+public:
+    struct Record
+    {
+        EPUBError       code;
+        const char*     location;   ///< The innermost ErrorLocation's name, or `nullptr`.
+    };
+    typedef const Record*       const_iterator;
+
+    ///
+    /// The default number of records the buffer can hold.
+    static const std::size_t    DefaultCapacity = 256;
+
+    EPUB3_EXPORT    ErrorRecorder(std::size_t capacity=DefaultCapacity);
+    EPUB3_EXPORT    ~ErrorRecorder();
+
+    ///
+    /// The number of errors stored.
+    std::size_t     Size()                              const   { return _size; }
+    ///
+    /// The number of errors the buffer can hold.
+    std::size_t     Capacity()                          const   { return _capacity; }
+    ///
+    /// The number of errors raised after the buffer filled up.
+    std::size_t     Dropped()                           const   { return _dropped; }
+    ///
+    /// The number of errors raised, whether stored or not.
+    std::size_t     TotalCount()                        const   { return _size + _dropped; }
+
+    ///
+    /// The number of stored errors with the given code.
+    EPUB3_EXPORT
+    std::size_t     Count(EPUBError code)               const;
+
+    const Record&   operator[](std::size_t i)           const   { return _records[i]; }
+    const_iterator  begin()                             const   { return _records.get(); }
+    const_iterator  end()                               const   { return _records.get() + _size; }
+
+    ///
+    /// Discards the stored errors, keeping the buffer.
+    void            Clear()                                     { _size = _dropped = 0; }
+
+private:
+                    ErrorRecorder(const ErrorRecorder&) _DELETED_;
+    ErrorRecorder&  operator=(const ErrorRecorder&)     _DELETED_;
+
+    void            Add(EPUBError code, const char* location)   _NOEXCEPT;
+
+    std::unique_ptr<Record[]>   _records;
+    std::size_t                 _capacity;
+    std::size_t                 _size;
+    std::size_t                 _dropped;
+    ErrorHandlerScope           _scope;     ///< Declared last, so the buffer is ready before it's installed.
+
+    friend class __ErrorScopes;
+
+};
+
+/**
+ Names what the calling thread is working on while it exists, so an ErrorRecorder
+ can note where each error was raised.
+
+ Records keep a pointer to the name, so it must outlive them; a string literal is
+ the usual choice.
+
+ @ingroup utilities
+ */
+class ErrorLocation
+{
+public:
+    EPUB3_EXPORT    ErrorLocation(const char* name);
+    EPUB3_EXPORT    ~ErrorLocation();
+
+private:
+                    ErrorLocation(const ErrorLocation&) _DELETED_;
+    ErrorLocation&  operator=(const ErrorLocation&)     _DELETED_;
+
+    const char*     _outer;
+
+};
+
 EPUB3_EXPORT const std::string&         SeverityString(ViolationSeverity __s);
 EPUB3_EXPORT const std::error_code      ErrorCodeForEPUBError(EPUBError ev)  _NOEXCEPT;
 EPUB3_EXPORT const std::string          DetailedErrorMessage(EPUBError ev);
 EPUB3_EXPORT const std::error_category& epub_spec_category() _NOEXCEPT;
 
+///
+/// Passes an error to the calling thread's current handler, without copying it.
+EPUB3_EXPORT bool                       __CallErrorHandler(const std::runtime_error& __err);
+///
+/// Stores an error if the calling thread's innermost scope is an ErrorRecorder.
+/// Returns `true` if it was stored and needs no handling; Critical errors always
+/// need handling.
+EPUB3_EXPORT bool                       __RecordError(EPUBError __code)  _NOEXCEPT;
+
 static inline FORCE_INLINE
 void __DispatchError(const std::runtime_error& __err)
 {
-    if ( ErrorHandler()(__err) == false )
+    if ( __CallErrorHandler(__err) == false )
         throw __err;
 }
 static inline FORCE_INLINE
 void __DispatchError(const epub_spec_error& __err)
 {
-    if ( ErrorHandler()(__err) == false )
+    if ( __CallErrorHandler(__err) == false )
         throw __err;
 }
 
@@ -448,18 +594,24 @@ void HandleError(std::errc __code, const char* __msg)
 static inline FORCE_INLINE
 void HandleError(EPUBError __code)
 {
+    if ( __RecordError(__code) )
+        return;
     epub_spec_error __err(__code);
     __DispatchError(__err);
 }
 static inline FORCE_INLINE
 void HandleError(EPUBError __code, const std::string& __msg)
 {
+    if ( __RecordError(__code) )
+        return;
     epub_spec_error __err(__code, __msg);
     __DispatchError(__err);
 }
 static inline FORCE_INLINE
 void HandleError(EPUBError __code, const char* __msg)
 {
+    if ( __RecordError(__code) )
+        return;
     epub_spec_error __err(__code, __msg);
     __DispatchError(__err);
 }
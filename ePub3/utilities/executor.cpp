@@ -0,0 +1,243 @@
+//
+//  executor.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "executor.h"
+#include <algorithm>
+#include <iterator>
+
+#if EPUB_OS(WINDOWS)
+# include <windows.h>
+# include <stdio.h>
+# define TLS_GET(key)       TlsGetValue(key)
+# define TLS_SET(key, data) TlsSetValue(key, data)
+#else
+# include <pthread.h>
+# define TLS_GET(key)       pthread_getspecific(key)
+# define TLS_SET(key, data) pthread_setspecific(key, data)
+#endif
+
+EPUB3_BEGIN_NAMESPACE
+
+static const std::size_t gNoWorker = static_cast<std::size_t>(-1);
+
+static std::once_flag   gSharedExecutorOnce;
+static Executor*        gSharedExecutor = nullptr;
+
+// lives on the stack of WorkerMain(), so it needs no destructor
+struct Executor::WorkerState
+{
+    const Executor*     executor;
+    std::size_t         index;
+};
+
+#if EPUB_OS(WINDOWS)
+static DWORD WorkerStateTLSKey = TLS_OUT_OF_INDEXES;
+static void KillWorkerStateTLSKey()
+{
+    if ( WorkerStateTLSKey != TLS_OUT_OF_INDEXES )
+        TlsFree(WorkerStateTLSKey);
+}
+#else
+static pthread_key_t WorkerStateTLSKey;
+#endif
+INITIALIZER(InitWorkerStateTLSKey)
+{
+#if EPUB_OS(WINDOWS)
+    WorkerStateTLSKey = TlsAlloc();
+    if ( WorkerStateTLSKey == TLS_OUT_OF_INDEXES )
+    {
+        fprintf(stderr, "No TLS Indexes for Executor!\n");
+        ExitProcess(0);
+    }
+    atexit(KillWorkerStateTLSKey);
+#else
+    pthread_key_create(&WorkerStateTLSKey, nullptr);
+#endif
+}
+
+Executor::Executor(std::size_t threadCount) : _workers(), _nextWorker(0), _queued(0), _sleeping(0), _idleLock(), _idle(), _stopping(false)
+{
+    if ( threadCount == 0 )
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // every queue must exist before any worker goes looking for work to steal
+    for ( std::size_t i = 0; i < threadCount; i++ )
+    {
+        _workers.emplace_back(new Worker);
+    }
+    for ( std::size_t i = 0; i < threadCount; i++ )
+    {
+        _workers[i]->thread = std::thread(&Executor::WorkerMain, this, i);
+    }
+}
+Executor::~Executor()
+{
+    {
+        std::lock_guard<std::mutex> _(_idleLock);
+        _stopping = true;
+    }
+    _idle.notify_all();
+
+    for ( auto& worker : _workers )
+    {
+        if ( worker->thread.joinable() )
+            worker->thread.join();
+    }
+}
+Executor* Executor::Shared()
+{
+    // never destroyed: tasks may still be running while static destructors are
+    std::call_once(gSharedExecutorOnce, []() {
+        gSharedExecutor = new Executor();
+    });
+    return gSharedExecutor;
+}
+std::size_t Executor::CurrentWorkerIndex() const
+{
+    const WorkerState* state = reinterpret_cast<const WorkerState*>(TLS_GET(WorkerStateTLSKey));
+    if ( state == nullptr || state->executor != this )
+        return gNoWorker;
+    return state->index;
+}
+bool Executor::IsWorkerThread() const
+{
+    return CurrentWorkerIndex() != gNoWorker;
+}
+void Executor::Post(Task&& task)
+{
+    std::size_t index = CurrentWorkerIndex();
+    bool local = (index != gNoWorker);
+    if ( !local )
+        index = _nextWorker++ % _workers.size();
+
+    // counted before it's queued, so the count never drops below zero; a worker
+    //  about to sleep counts itself before it checks `_queued`, and this checks for
+    //  sleepers after bumping `_queued`, so one of them always sees the other
+    _queued.fetch_add(1, std::memory_order_seq_cst);
+    {
+        Worker& worker = *_workers[index];
+        std::lock_guard<std::mutex> _(worker.lock);
+        worker.tasks.push_back(QueuedTask{std::move(task), local});
+    }
+
+    if ( _sleeping.load(std::memory_order_seq_cst) != 0 )
+    {
+        std::lock_guard<std::mutex> _(_idleLock);
+        _idle.notify_one();
+    }
+}
+bool Executor::TakeTask(std::size_t index, Task& task)
+{
+    // our own newest task first...
+    {
+        Worker& worker = *_workers[index];
+        std::lock_guard<std::mutex> _(worker.lock);
+        if ( !worker.tasks.empty() )
+        {
+            task = std::move(worker.tasks.back().task);
+            worker.tasks.pop_back();
+            _queued--;
+            return true;
+        }
+    }
+
+    // ...otherwise the oldest task of whoever has one
+    for ( std::size_t i = 1; i < _workers.size(); i++ )
+    {
+        Worker& victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> _(victim.lock);
+        if ( !victim.tasks.empty() )
+        {
+            task = std::move(victim.tasks.front().task);
+            victim.tasks.pop_front();
+            _queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+bool Executor::RunLocalTask()
+{
+    std::size_t index = CurrentWorkerIndex();
+    if ( index == gNoWorker )
+        return false;
+
+    // never a stolen task, nor one handed in from outside the pool
+    Task task;
+    {
+        Worker& worker = *_workers[index];
+        std::lock_guard<std::mutex> _(worker.lock);
+        auto pos = std::find_if(worker.tasks.rbegin(), worker.tasks.rend(), [](const QueuedTask& queued) { return queued.local; });
+        if ( pos == worker.tasks.rend() )
+            return false;
+
+        task = std::move(pos->task);
+        worker.tasks.erase(std::next(pos).base());
+        _queued--;
+    }
+
+    try
+    {
+        task();
+    }
+    catch (...)
+    {
+    }
+    return true;
+}
+void Executor::WorkerMain(std::size_t index)
+{
+    // set here, rather than by the constructor, so no other thread ever touches it
+    WorkerState state = { this, index };
+    TLS_SET(WorkerStateTLSKey, reinterpret_cast<void*>(&state));
+
+    Task task;
+    for (;;)
+    {
+        if ( TakeTask(index, task) )
+        {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+            }
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_idleLock);
+        _sleeping.fetch_add(1, std::memory_order_seq_cst);
+        _idle.wait(lock, [this]() { return _queued.load(std::memory_order_seq_cst) != 0 || _stopping; });
+        _sleeping.fetch_sub(1, std::memory_order_seq_cst);
+
+        // tasks queued before the executor stopped are still run
+        if ( _stopping && _queued.load() == 0 )
+        {
+            TLS_SET(WorkerStateTLSKey, nullptr);
+            return;
+        }
+    }
+}
+
+EPUB3_END_NAMESPACE
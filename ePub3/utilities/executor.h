@@ -0,0 +1,271 @@
+//
+//  executor.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __ePub3__executor__
+#define __ePub3__executor__
+
+#include <ePub3/utilities/basic.h>
+#include <ePub3/utilities/run_loop.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ A pool of threads for running CPU-bound work such as parsing, inflating or
+ indexing.
+
+ Each worker thread has its own queue of tasks. Tasks submitted from a worker go
+ onto that worker's queue, and it runs the most recently queued first, while they
+ are still warm in its cache; tasks submitted from any other thread are dealt out
+ to the workers in turn. A worker whose queue is empty steals the oldest task from
+ another worker's queue, so one long task never holds up the tasks queued behind it.
+
+ Results are returned through a `std::future`. Alternatively, a completion function
+ may be supplied, which is passed the (ready) future, and which can be run on a
+ given RunLoop in the manner of EventTargetRunLoop.
+
+ @ingroup utilities
+ */
+class Executor
+{
+public:
+    typedef std::function<void()>       Task;
+
+    /**
+     Creates an executor.
+     @param threadCount The number of worker threads to start. If zero, one worker
+     is started for each hardware thread.
+     */
+    EPUB3_EXPORT    Executor(std::size_t threadCount=0);
+
+    ///
+    /// Runs any tasks still queued, then stops the worker threads.
+    EPUB3_EXPORT    ~Executor();
+
+    ///
+    /// The executor used by the library's asynchronous APIs. It's created on first
+    /// use, and lives as long as the process does.
+    EPUB3_EXPORT
+    static Executor*    Shared();
+
+    ///
+    /// The number of worker threads.
+    std::size_t     ThreadCount()                       const   { return _workers.size(); }
+
+    ///
+    /// Whether the calling thread is one of this executor's workers.
+    EPUB3_EXPORT
+    bool            IsWorkerThread()                    const;
+
+    /**
+     Queues a task to run on one of the worker threads.
+
+     Any exception thrown by the task is discarded; use Submit() to receive it.
+     */
+    EPUB3_EXPORT
+    void            Post(Task&& task);
+
+    /**
+     Queues a function to run on one of the worker threads.
+     @param fn The function to call.
+     @result A future for the function's result, or for any exception it throws.
+     */
+    template <class _Fn>
+    std::future<typename std::result_of<_Fn()>::type>
+                    Submit(_Fn fn)
+    {
+        typedef typename std::result_of<_Fn()>::type    result_type;
+        auto invocation = std::make_shared<Invocation<result_type>>(std::move(fn));
+        std::future<result_type> result = std::move(invocation->future);
+        Post([invocation]() { (*invocation)(); });
+        return result;
+    }
+
+    /**
+     Queues a function to run on one of the worker threads, then passes its result
+     to a completion function.
+     @param fn The function to call.
+     @param target The RunLoop on which to call `completion`. If `nullptr`, it's
+     called on the worker thread, as soon as `fn` returns.
+     @param completion A function taking a `std::future` for the result of `fn`. The
+     future is ready, so `get()` will not block, and throws any exception which
+     was thrown by `fn`.
+     */
+    template <class _Fn, class _Cn>
+    void            Submit(_Fn fn, RunLoop* target, _Cn completion)
+    {
+        typedef typename std::result_of<_Fn()>::type    result_type;
+        auto invocation = std::make_shared<Invocation<result_type>>(std::move(fn));
+        Post([invocation, target, completion]() {
+            (*invocation)();
+            if ( target == nullptr )
+            {
+                completion(std::move(invocation->future));
+                return;
+            }
+
+            // the RunLoop only holds copyable functions, so the future travels inside
+            //  the invocation
+            target->PerformFunction([invocation, completion]() {
+                completion(std::move(invocation->future));
+            });
+        });
+    }
+
+    /**
+     Waits for a future's result.
+
+     When called on one of the executor's own worker threads, the worker first runs
+     the tasks which were queued from that thread and not yet taken by another
+     worker, since those include any the caller submitted, so tasks may wait upon
+     the tasks they submit without tying up every worker. Tasks queued from
+     elsewhere are left alone. Once there are none left it blocks until the future
+     is ready, as the result is then being computed by another worker.
+
+     A task should only wait for the results of tasks it submitted itself, or which
+     were submitted from outside the pool: waiting for one queued behind it by
+     another busy worker may hold up both.
+     */
+    template <class _Rp>
+    _Rp             Wait(std::future<_Rp>& future)
+    {
+        if ( IsWorkerThread() )
+        {
+            while ( future.wait_for(std::chrono::seconds(0)) != std::future_status::ready && RunLocalTask() )
+                ;
+        }
+        return future.get();
+    }
+
+private:
+                    Executor(const Executor&)           _DELETED_;
+                    Executor(Executor&&)                _DELETED_;
+    Executor&       operator=(const Executor&)          _DELETED_;
+
+    /**
+     A function whose result is passed on through a promise.
+
+     Unlike a `std::packaged_task`, the function (and anything it captured) is
+     destroyed before its result is made ready, so a caller which has the result
+     knows the executor no longer holds anything the function referenced.
+     */
+    template <class _Rp>
+    struct Invocation
+    {
+        std::function<_Rp()>    fn;
+        std::promise<_Rp>       promise;
+        std::future<_Rp>        future;
+
+        template <class _Fn>
+        Invocation(_Fn&& f) : fn(std::forward<_Fn>(f)), promise(), future(promise.get_future()) {}
+
+        void operator()()
+        {
+            try
+            {
+                _Rp result = Call();
+                promise.set_value(std::move(result));
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+        }
+        _Rp Call()
+        {
+            std::function<_Rp()> local(std::move(fn));
+            fn = nullptr;
+            return local();
+        }
+    };
+
+    struct QueuedTask
+    {
+        Task                task;
+        bool                local;  ///< Whether it was queued from the worker which owns the queue.
+    };
+
+    struct Worker
+    {
+        std::mutex              lock;
+        std::deque<QueuedTask>  tasks;
+        std::thread             thread;
+    };
+
+    ///
+    /// What each worker thread keeps in thread-local storage.
+    struct WorkerState;
+
+    ///
+    /// The index of the calling thread's worker, or `-1` if it isn't a worker.
+    std::size_t     CurrentWorkerIndex()                const;
+
+    ///
+    /// Takes a task from the given worker's queue, or steals one from another worker.
+    bool            TakeTask(std::size_t index, Task& task);
+
+    ///
+    /// Runs the newest task queued from the calling worker thread and still on its queue.
+    EPUB3_EXPORT
+    bool            RunLocalTask();
+
+    ///
+    /// The body of each worker thread.
+    void            WorkerMain(std::size_t index);
+
+    std::vector<std::unique_ptr<Worker>>    _workers;
+    std::atomic<std::size_t>    _nextWorker;    ///< The worker to be given the next task from outside the pool.
+    std::atomic<std::size_t>    _queued;        ///< The number of tasks queued and not yet taken.
+    std::atomic<std::size_t>    _sleeping;      ///< The number of workers waiting for tasks.
+    std::mutex                  _idleLock;
+    std::condition_variable     _idle;
+    bool                        _stopping;      ///< Guarded by `_idleLock`.
+
+};
+
+template <>
+inline void Executor::Invocation<void>::operator()()
+{
+    try
+    {
+        Call();
+        promise.set_value();
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__executor__) */
@@ -24,6 +24,7 @@
 #include "cfi.h"
 #include "make_unique.h"
 #include REGEX_INCLUDE
+#include <functional>
 
 EPUB3_BEGIN_NAMESPACE
 
@@ -39,39 +40,246 @@ inline const url_parse::Component ComponentForString(const string& str)
 {
     return url_parse::Component(0, str.empty() ? -1 : static_cast<int>(str.utf8_size()));
 }
+inline size_t HashForSpec(const std::string& spec)
+{
+    return (spec.empty() ? 0 : std::hash<std::string>()(spec));
+}
+
+// characters which the canonicalizer copies unchanged into a path, query or fragment
+static inline bool IsCanonicalURLChar(char ch)
+{
+    if ( (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') )
+        return true;
+    
+    switch ( ch )
+    {
+        case '-': case '.': case '_': case '~': case '!': case '$': case '&': case '(':
+        case ')': case '*': case '+': case ',': case ';': case '=': case ':': case '@':
+        case '/':
+            return true;
+        default:
+            return false;
+    }
+}
+static inline bool IsHexChar(char ch)
+{
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
 
-IRI::IRI(const string& iriStr) : _url(make_unique<GURL>(iriStr.stl_str())), _pureIRI(iriStr)
+/**
+ Parses a URL which is already in canonical form, such as `epub3://id/path` or
+ `http://idpf.org/epub/vocab/package/#title-type`.
+ 
+ Only URLs using a standard scheme, with a plain lowercase hostname and no
+ credentials, port, percent-escapes or dot-segments are accepted; this is enough to
+ be sure that the canonicalizer would leave them as they are, save for adding a
+ `/` path where there is none.
+ @result Returns `false` if the URL may not be in canonical form.
+ */
+static bool ParseCanonicalURL(const std::string& str, std::string& spec, url_parse::Parsed& parsed)
 {
+    const char* p = str.data();
+    const int len = static_cast<int>(str.size());
+    
+    // scheme: lowercase, and one that GURL treats as standard
+    int i = 0;
+    while ( i < len && ((p[i] >= 'a' && p[i] <= 'z') || (i != 0 && ((p[i] >= '0' && p[i] <= '9') || p[i] == '+' || p[i] == '-' || p[i] == '.'))) )
+        i++;
+    if ( i == 0 || len - i < 3 || p[i] != ':' || p[i+1] != '/' || p[i+2] != '/' )
+        return false;
+    
+    url_parse::Component scheme(0, i);
+    if ( !url_util::IsStandard(p, scheme) || url_util::LowerCaseEqualsASCII(p, p+i, "file") || url_util::LowerCaseEqualsASCII(p, p+i, "filesystem") )
+        return false;
+    
+    // host: lowercase, and the last label must begin with a letter, or it might be an IP address
+    i += 3;
+    int hostBegin = i, labelBegin = i;
+    while ( i < len && p[i] != '/' && p[i] != '?' && p[i] != '#' )
+    {
+        char ch = p[i];
+        if ( ch == '.' )
+        {
+            if ( i == labelBegin )
+                return false;
+            labelBegin = i + 1;
+        }
+        else if ( !((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '-') )
+        {
+            return false;
+        }
+        i++;
+    }
+    if ( labelBegin == i )
+        return false;       // empty host, or a trailing dot
+    if ( p[labelBegin] < 'a' || p[labelBegin] > 'z' )
+        return false;
+    
+    url_parse::Component host(hostBegin, i - hostBegin);
+    
+    // path: no dot-segments
+    int pathBegin = i;
+    while ( i < len && p[i] != '?' && p[i] != '#' )
+    {
+        if ( !IsCanonicalURLChar(p[i]) )
+            return false;
+        if ( p[i] == '.' && p[i-1] == '/' )
+        {
+            int next = (i+1 < len && p[i+1] == '.' ? i+2 : i+1);
+            if ( next == len || p[next] == '/' || p[next] == '?' || p[next] == '#' )
+                return false;
+        }
+        i++;
+    }
+    
+    // query and fragment
+    int queryBegin = -1, refBegin = -1;
+    for ( int j = i; j < len; j++ )
+    {
+        if ( p[j] == '#' )
+        {
+            if ( refBegin != -1 )
+                return false;
+            refBegin = j + 1;
+        }
+        else if ( p[j] == '?' )
+        {
+            if ( refBegin == -1 && queryBegin == -1 )
+                queryBegin = j + 1;
+        }
+        else if ( !IsCanonicalURLChar(p[j]) )
+        {
+            return false;
+        }
+    }
+    
+    // the canonical form always has a path, even if it's only '/'
+    int inserted = 0;
+    if ( pathBegin == i )
+    {
+        spec.reserve(str.size() + 1);
+        spec.assign(str, 0, i);
+        spec.append(1, '/');
+        spec.append(str, i, std::string::npos);
+        inserted = 1;
+    }
+    else
+    {
+        spec = str;
+    }
+    
+    parsed = url_parse::Parsed();
+    parsed.scheme = scheme;
+    parsed.host = host;
+    parsed.path = url_parse::MakeRange(pathBegin, i + inserted);
+    if ( queryBegin != -1 )
+        parsed.query = url_parse::MakeRange(queryBegin + inserted, (refBegin == -1 ? len : refBegin - 1) + inserted);
+    if ( refBegin != -1 )
+        parsed.ref = url_parse::MakeRange(refBegin + inserted, len + inserted);
+    return true;
+}
+
+/**
+ Parses a reference with no scheme, such as `chapter2.xhtml#p3`.
+ 
+ References with an authority (`//host/path`) or invalid characters or
+ percent-escapes are rejected. Non-ASCII characters are percent-encoded.
+ @result Returns `false` if the reference is invalid.
+ */
+static bool ParseRelativeReference(const std::string& str, std::string& spec, url_parse::Parsed& parsed)
+{
+    if ( str.size() >= 2 && str[0] == '/' && str[1] == '/' )
+        return false;
+    
+    spec.clear();
+    spec.reserve(str.size());
+    parsed = url_parse::Parsed();
+    
+    int queryBegin = -1, refBegin = -1;
+    for ( std::string::size_type i = 0, len = str.size(); i < len; i++ )
+    {
+        char ch = str[i];
+        if ( static_cast<unsigned char>(ch) >= 0x80 )
+        {
+            static const char kHex[] = "0123456789ABCDEF";
+            unsigned char byte = static_cast<unsigned char>(ch);
+            spec.append(1, '%');
+            spec.append(1, kHex[byte >> 4]);
+            spec.append(1, kHex[byte & 0xF]);
+            continue;
+        }
+        
+        if ( ch == '%' )
+        {
+            if ( i + 2 >= len || !IsHexChar(str[i+1]) || !IsHexChar(str[i+2]) )
+                return false;
+        }
+        else if ( ch == '#' )
+        {
+            if ( refBegin != -1 )
+                return false;
+            refBegin = static_cast<int>(spec.size()) + 1;
+        }
+        else if ( ch == '?' )
+        {
+            if ( refBegin == -1 && queryBegin == -1 )
+                queryBegin = static_cast<int>(spec.size()) + 1;
+        }
+        else if ( !IsCanonicalURLChar(ch) && ch != '\'' )
+        {
+            return false;
+        }
+        
+        spec.append(1, ch);
+    }
+    
+    int end = static_cast<int>(spec.size());
+    int pathEnd = (queryBegin != -1 ? queryBegin - 1 : (refBegin != -1 ? refBegin - 1 : end));
+    parsed.path = url_parse::MakeRange(0, pathEnd);
+    if ( queryBegin != -1 )
+        parsed.query = url_parse::MakeRange(queryBegin, (refBegin == -1 ? end : refBegin - 1));
+    if ( refBegin != -1 )
+        parsed.ref = url_parse::MakeRange(refBegin, end);
+    return true;
+}
+
+IRI::IRI(const string& iriStr) : _urnComponents(), _spec(), _parsed(), _hash(0), _valid(false), _pureIRI(iriStr)
+{
+    _Parse(iriStr.stl_str());
 }
 IRI::IRI(const string& nameID, const string& namespacedString) :
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
     _urnComponents{gURNScheme, nameID, namespacedString},
 #endif
-    _pureIRI(_Str("urn:", nameID, ":", namespacedString)),
-    _url(make_unique<GURL>(_pureIRI.stl_str()))
+    _spec(), _parsed(), _hash(0), _valid(false),
+    _pureIRI(_Str("urn:", nameID, ":", namespacedString))
 {
 #if !EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
     _urnComponents.push_back(gURNScheme);
     _urnComponents.push_back(nameID);
     _urnComponents.push_back(namespacedString);
 #endif
+    _Parse(_pureIRI.stl_str());
 }
-IRI::IRI(const string& scheme, const string& host, const string& path, const string& query, const string& fragment) : _urnComponents(), _url(make_unique<GURL>())
+IRI::IRI(const string& scheme, const string& host, const string& path, const string& query, const string& fragment) : _urnComponents(), _spec(), _parsed(), _hash(0), _valid(false), _pureIRI()
 {
-    _pureIRI = _Str(scheme, "://", host);
+    std::string iri;
+    iri.reserve(scheme.utf8_size() + host.utf8_size() + path.utf8_size() + query.utf8_size() + fragment.utf8_size() + 6);
+    iri.append(scheme.stl_str()).append("://").append(host.stl_str());
     if ( path.empty() )
-        _pureIRI += '/';
+        iri.append(1, '/');
     else if ( path.find(gPathSeparator) != 0 )
-        _pureIRI += ("/" + path);
+        iri.append(1, '/').append(path.stl_str());
     else
-        _pureIRI += path;
+        iri.append(path.stl_str());
     
     if ( !query.empty() )
-        _pureIRI += _Str("?", query);
+        iri.append(1, '?').append(query.stl_str());
     if ( !fragment.empty() )
-        _pureIRI += _Str("#", fragment);
+        iri.append(1, '#').append(fragment.stl_str());
     
-    _url = make_unique<GURL>(_pureIRI.stl_str());
+    _Parse(iri);
+    _pureIRI = std::move(iri);
 }
 IRI::~IRI()
 {
@@ -79,58 +287,116 @@ IRI::~IRI()
 IRI& IRI::operator=(const IRI& o)
 {
     _urnComponents = o._urnComponents;
+    _spec = o._spec;
+    _parsed = o._parsed;
+    _hash = o._hash;
+    _valid = o._valid;
     _pureIRI = o._pureIRI;
-    if ( _url != nullptr )
-        *_url = *o._url;
-    else
-        _url = make_unique<GURL>(*o._url);
     return *this;
 }
 IRI& IRI::operator=(IRI &&o)
 {
     _urnComponents = std::move(o._urnComponents);
+    _spec = std::move(o._spec);
+    _parsed = o._parsed;
+    _hash = o._hash;
+    _valid = o._valid;
     _pureIRI = std::move(o._pureIRI);
-    _url = std::move(o._url);
-    o._url = nullptr;
+    o._Clear();
     return *this;
 }
 bool IRI::operator==(const IRI &o) const
 {
     if ( IsURN() )
         return _urnComponents == o._urnComponents;
-    else if ( _url == nullptr || o._url == nullptr )
-        return false;
-    return *_url == *o._url;
+    return _hash == o._hash && _spec == o._spec;
 }
 bool IRI::operator!=(const IRI& o) const
 {
     if ( IsURN() )
         return _urnComponents != o._urnComponents;
-    return *_url != *o._url;
+    return _hash != o._hash || _spec != o._spec;
 }
 bool IRI::operator<(const IRI& o) const
 {
     if ( IsURN() )
         return _urnComponents < o._urnComponents;
-    return *_url < *o._url;
+    return _spec < o._spec;
+}
+void IRI::_Parse(const std::string& str)
+{
+    url_parse::Component scheme;
+    if ( ParseCanonicalURL(str, _spec, _parsed) )
+    {
+        _valid = true;
+    }
+    else if ( !url_parse::ExtractScheme(str.data(), static_cast<int>(str.size()), &scheme) )
+    {
+        if ( !ParseRelativeReference(str, _spec, _parsed) )
+        {
+            _spec.clear();
+            _parsed = url_parse::Parsed();
+        }
+        _valid = false;
+    }
+    else
+    {
+        // the slow way
+        _spec.clear();
+        _spec.reserve(str.size() + 32);
+        url_canon::StdStringCanonOutput output(&_spec);
+        _valid = url_util::Canonicalize(str.data(), static_cast<int>(str.size()), nullptr, &output, &_parsed);
+        output.Complete();
+    }
+    
+    _hash = HashForSpec(_spec);
+}
+bool IRI::_Replace(const url_canon::Replacements<char>& replacements)
+{
+    // not allowed for invalid URLs
+    if ( !_valid )
+        return false;
+    
+    std::string spec;
+    spec.reserve(_spec.size() + 32);
+    url_canon::StdStringCanonOutput output(&spec);
+    url_parse::Parsed parsed;
+    
+    bool valid = url_util::ReplaceComponents(_spec.data(), static_cast<int>(_spec.size()), _parsed, replacements, nullptr, &output, &parsed);
+    output.Complete();
+    if ( !valid )
+        return false;
+    
+    _spec.swap(spec);
+    _parsed = parsed;
+    _hash = HashForSpec(_spec);
+    return true;
 }
 IRI::IRICredentials IRI::Credentials() const
 {
     string u, p;
-    if ( _url->has_username() )
+    if ( _parsed.username.len >= 0 )
     {
-        u = _url->username();
+        u = _Component(_parsed.username);
     }
-    if ( _url->has_password() )
+    if ( _parsed.password.len >= 0 )
     {
-        p = _url->password();
+        p = _Component(_parsed.password);
     }
     
     return IRICredentials(u, p);
 }
+int IRI::Port() const
+{
+    if ( _parsed.port.is_nonempty() )
+        return url_parse::ParsePort(_spec.data(), _parsed.port);
+    if ( url_util::IsStandard(_spec.data(), _parsed.scheme) )
+        return url_canon::DefaultPortForScheme(_spec.data() + _parsed.scheme.begin, _parsed.scheme.len);
+    return url_parse::PORT_UNSPECIFIED;
+}
 const string IRI::Path(bool urlEncoded) const
 {
-    std::string encodedPath(_url->path());
+    std::string encodedPath(_Component(_parsed.path).stl_str());
     if ( urlEncoded )
         return encodedPath;
     
@@ -138,9 +404,15 @@ const string IRI::Path(bool urlEncoded) const
     url_util::DecodeURLEscapeSequences(encodedPath.c_str(), static_cast<int>(encodedPath.size()), &output);
     return string(output.data(), output.length());
 }
+const string IRI::LastPathComponent() const
+{
+    url_parse::Component file;
+    url_parse::ExtractFileName(_spec.data(), _parsed.path, &file);
+    return _Component(file);
+}
 const CFI IRI::ContentFragmentIdentifier() const
 {
-    if ( !_url->has_ref() )
+    if ( _parsed.ref.len < 0 )
         return CFI();
     
     string ref = Fragment();
@@ -153,7 +425,7 @@ void IRI::SetScheme(const string& scheme)
 {
     url_canon::Replacements<char> rep;
     rep.SetScheme(scheme.c_str(), ComponentForString(scheme));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
     // can't keep the IRI up to date
     _pureIRI.clear();
@@ -162,7 +434,7 @@ void IRI::SetHost(const string& host)
 {
     url_canon::Replacements<char> rep;
     rep.SetHost(host.c_str(), ComponentForString(host));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
     // can't keep the IRI up to date
     _pureIRI.clear();
@@ -173,23 +445,23 @@ void IRI::SetCredentials(const string& user, const string& pass)
     url_parse::Component invalid(0, -1);
     rep.SetUsername(user.c_str(), ComponentForString(user));
     rep.SetPassword(pass.c_str(), ComponentForString(pass));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
     // can't keep the IRI up to date
     _pureIRI.clear();
 }
 void IRI::AddPathComponent(const string& component)
 {
-    std::string path(_url->path());
-    if ( path[path.size()-1] != '/' )
+    std::string path(_Component(_parsed.path).stl_str());
+    if ( path.empty() || path[path.size()-1] != '/' )
         path += '/';
     path += component.stl_str();
     
     url_canon::Replacements<char> rep;
     rep.SetPath(path.c_str(), url_parse::Component(0, static_cast<int>(path.size())));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
-    if ( !_pureIRI.empty() && !_url->has_query() && !_url->has_ref() )
+    if ( !_pureIRI.empty() && _parsed.query.len < 0 && _parsed.ref.len < 0 )
     {
         if ( _pureIRI[_pureIRI.size()-1] != char32_t('/') )
             _pureIRI += '/';
@@ -205,7 +477,7 @@ void IRI::SetQuery(const string& query)
 {
     url_canon::Replacements<char> rep;
     rep.SetQuery(query.c_str(), ComponentForString(query));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
     if ( _pureIRI.empty() )
         return;
@@ -235,7 +507,7 @@ void IRI::SetFragment(const string& fragment)
 {
     url_canon::Replacements<char> rep;
     rep.SetRef(fragment.c_str(), ComponentForString(fragment));
-    _url->ReplaceComponentsInline(rep);
+    _Replace(rep);
     
     string::size_type pos = _pureIRI.rfind('#');
     if ( pos != string::npos )
@@ -290,7 +562,7 @@ string IRI::IDNEncodeHostname(const string& str)
     url_canon::RawCanonOutputW<256> output;
     const string16 src = str.utf16string();
     if ( url_canon::IDNToASCII(src.c_str(), static_cast<int>(src.size()), &output) )
-        return output.data();
+        return string(output.data(), output.length());
     return string::EmptyString;
 }
 string IRI::IRIString() const
@@ -298,22 +570,27 @@ string IRI::IRIString() const
     if ( !_pureIRI.empty() )
         return _pureIRI;
     
-    if ( !_url )
+    if ( _spec.empty() )
         return string::EmptyString;
     
     // we'll have to reverse-engineer it, grr
-    string uri(URIString());
-    std::string plainHost(_url->host());
+    std::string uri(_spec);
+    std::string plainHost(Host().stl_str());
     
     url_canon::RawCanonOutputW<256> idnDecoded;
     const string16 idnSrc = string(plainHost).utf16string();
-    if ( url_canon::IDNToUnicode(idnSrc.c_str(), static_cast<int>(idnSrc.size()), &idnDecoded) && idnSrc != idnDecoded.data() )
+    if ( url_canon::IDNToUnicode(idnSrc.c_str(), static_cast<int>(idnSrc.size()), &idnDecoded) )
     {
-        // swap out the IDN-encoded hostname
-        string::size_type pos = uri.find(plainHost);
-        if ( pos != string::npos )
+        // the output isn't NUL-terminated
+        const string16 decoded(idnDecoded.data(), idnDecoded.length());
+        if ( decoded != idnSrc )
         {
-            uri.replace(pos, plainHost.size(), idnDecoded.data());
+            // swap out the IDN-encoded hostname
+            std::string::size_type pos = uri.find(plainHost);
+            if ( pos != std::string::npos )
+            {
+                uri.replace(pos, plainHost.size(), string(decoded.c_str()).stl_str());
+            }
         }
     }
     
@@ -322,9 +599,7 @@ string IRI::IRIString() const
 }
 string IRI::URIString() const
 {
-    if ( !_url )
-        return string::EmptyString;
-    return _url->spec();
+    return _spec;
 }
 
 EPUB3_END_NAMESPACE
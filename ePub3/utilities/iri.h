@@ -39,6 +39,18 @@ class CFI;
  identifiers. This class provides URN support internally, URL support through
  Google's GURL library, and Unicode IRI support is wrapped around GURL.
  
+ Each IRI keeps its canonical form in a single buffer, along with the location of
+ each component within it and a hash of the whole, which is compared first when
+ testing two IRIs for equality. The IRIs built most often-- `epub3://` URLs,
+ vocabulary IRIs such as those used for metadata properties, and references
+ relative to the current document-- are usually in canonical form already, and
+ are parsed directly; the GURL canonicalizer is only run on anything else.
+ 
+ Relative references are kept as written (with any non-ASCII characters
+ percent-encoded), so their path, query and fragment are available, but they are
+ never canonicalized: setters which would require a canonical URL have no effect
+ upon them.
+ 
  @ingroup utilities
  */
 class IRI
@@ -64,7 +76,7 @@ public:
 public:
     ///
     /// Initializes an empty (and thus invalid) IRI.
-    IRI() : _urnComponents(), _url(make_unique<GURL>()), _pureIRI() {}
+    IRI() : _urnComponents(), _spec(), _parsed(), _hash(0), _valid(false), _pureIRI() {}
     
     /**
      Create a new IRI.
@@ -104,11 +116,11 @@ public:
     
     ///
     /// Create a copy of an existing IRI.
-    IRI(const IRI& o) : _urnComponents(o._urnComponents), _url(new GURL(*o._url)), _pureIRI(o._pureIRI) {}
+    IRI(const IRI& o) : _urnComponents(o._urnComponents), _spec(o._spec), _parsed(o._parsed), _hash(o._hash), _valid(o._valid), _pureIRI(o._pureIRI) {}
     
     ///
     /// C++11 move-constructor.
-    IRI(IRI&& o) : _urnComponents(std::move(o._urnComponents)), _url(std::move(o._url)), _pureIRI(std::move(o._pureIRI)) { o._url = nullptr; }
+    IRI(IRI&& o) : _urnComponents(std::move(o._urnComponents)), _spec(std::move(o._spec)), _parsed(o._parsed), _hash(o._hash), _valid(o._valid), _pureIRI(std::move(o._pureIRI)) { o._Clear(); }
     
     virtual ~IRI();
     
@@ -164,18 +176,18 @@ public:
     
     ///
     /// Returns `true` if the IRI is a URL referencing a relative location.
-    bool            IsRelative() const { return !_url->has_host(); }
+    bool            IsRelative() const { return _parsed.host.len <= 0; }
     
     ///
     /// Returns `true` if the IRI is empty.
-    bool            IsEmpty() const { return _url->is_empty(); }
+    bool            IsEmpty() const { return _spec.empty(); }
     
     /// @{
     /// @name Component Introspection
     
     ///
     /// Obtains the IRI's scheme component.
-    const string    Scheme() const { return (IsURN() ? _urnComponents[0] : _url->scheme()); }    // simple, because it must ALWAYS be present (even if empty, as for pure fragment IRIs)
+    const string    Scheme() const { return (IsURN() ? _urnComponents[0] : _Component(_parsed.scheme)); }    // simple, because it must ALWAYS be present (even if empty, as for pure fragment IRIs)
     
     ///
     /// Obtains the name-id component of a URN IRI.
@@ -183,7 +195,7 @@ public:
     
     ///
     /// Retrieves the nost component of a URL IRI.
-    const string    Host() const { return _url->host(); }
+    const string    Host() const { return _Component(_parsed.host); }
     
     ///
     /// Retrieves any credentials attached to an IRI.
@@ -196,7 +208,8 @@ public:
     
     ///
     /// Obtains the port number associated with a URL IRI.
-    int             Port() const { return _url->EffectiveIntPort(); }
+    EPUB3_EXPORT
+    int             Port() const;
     
     /**
      Obtains the path component of a URL IRI.
@@ -208,15 +221,16 @@ public:
     
     ///
     /// Retrieves the query portion of a URL IRI, if any.
-    const string    Query() const { return _url->query(); }
+    const string    Query() const { return _Component(_parsed.query); }
     
     ///
     /// Retrieves any fragment part of a URL IRI.
-    const string    Fragment() const { return _url->ref(); }
+    const string    Fragment() const { return _Component(_parsed.ref); }
     
     ///
     /// Obtains the last path component of a URL IRI.
-    const string    LastPathComponent() const { return _url->ExtractFileName(); }
+    EPUB3_EXPORT
+    const string    LastPathComponent() const;
     
     /**
      Returns any CFI present in a URL IRI.
@@ -329,9 +343,37 @@ public:
     
 protected:
     ComponentList           _urnComponents;     ///< The components of a URN.
-    std::unique_ptr<GURL>   _url;               ///< The underlying URL object.
+    std::string             _spec;              ///< The canonical ASCII URL, or a relative reference.
+    url_parse::Parsed       _parsed;            ///< The location of each component within `_spec`.
+    size_t                  _hash;              ///< A hash of `_spec`.
+    bool                    _valid;             ///< Whether `_spec` is a valid absolute URL.
     string                  _pureIRI;           ///< A cache of the Unicode IRI string. May be empty.
     
+    ///
+    /// Returns the text of a component of `_spec`.
+    string          _Component(const url_parse::Component& comp) const {
+        return (comp.len <= 0 ? string::EmptyString : string(_spec.data() + comp.begin, comp.len));
+    }
+    
+    ///
+    /// Parses a URL or relative reference into `_spec` and `_parsed`.
+    void            _Parse(const std::string& str);
+    
+    ///
+    /// Applies some replacements to the components of a canonical URL.
+    bool            _Replace(const url_canon::Replacements<char>& replacements);
+    
+    ///
+    /// Resets to an empty IRI.
+    void            _Clear() {
+        _urnComponents.clear();
+        _spec.clear();
+        _parsed = url_parse::Parsed();
+        _hash = 0;
+        _valid = false;
+        _pureIRI.clear();
+    }
+    
 };
 
 template <class _CharT, class _Traits>
@@ -42,9 +42,13 @@ struct ALooper;
 #include <ePub3/utilities/utfstring.h>
 #include <chrono>
 #include <list>
+#include <vector>
+#include <deque>
+#include <unordered_set>
 #include <mutex>
 #include <atomic>
 #include <ePub3/utilities/ref_counted.h>
+#include <ePub3/utilities/task_queue.h>
 
 #if EPUB_USE(CF)
 #include "cf_helpers.h"
@@ -169,6 +173,8 @@ public:
 #else
         std::atomic<bool>                   _signalled; ///< Whether the source has been signalled.
         bool                                _cancelled; ///< Whether the source is cancelled.
+        std::vector<RunLoop*>               _runLoops;  ///< The RunLoops with which this source is registered.
+        std::mutex                          _loopsLock; ///< Guards `_runLoops`.
 #endif
         
         EventHandlerFn              _fn;    ///< The function to invoke when the event fires.
@@ -261,6 +267,8 @@ public:
         TimerFn                         _fn;        ///< The function to call when the timer fires.
         Clock::duration                 _interval;  ///< The interval at which the timer repeats (if any)
         bool                            _cancelled; ///< Set to `true` when the timer is cancelled.
+        std::atomic<RunLoop*>           _runLoop;   ///< The RunLoop on which the timer is scheduled, if any.
+        size_t                          _heapIndex; ///< The timer's position in its RunLoop's timer heap.
 #endif
         
         friend class RunLoop;
@@ -407,7 +415,8 @@ public:
     void            PerformFunction(std::function<void()> fn);
     
     ///
-    /// Adds a timer to the run loop.
+    /// Adds a timer to the run loop. A timer can be scheduled on only one run loop
+    /// at a time.
     EPUB3_EXPORT
     void            AddTimer(Timer* timer);
     ///
@@ -513,7 +522,7 @@ private:
     
 #if !EPUB_OS(ANDROID) && !EPUB_OS(WINDOWS) && !EPUB_USE(CF)
     ///
-    /// Collects all timers ready to fire
+    /// Removes all timers ready to fire from the timer heap
     std::vector<Timer*>         CollectFiringTimers();
     ///
     /// Collects all sources that have been signalled
@@ -521,6 +530,22 @@ private:
     ///
     /// If a timer will fire before the given timeout, returns a new timeout
     std::chrono::system_clock::time_point   TimeoutOrTimer(std::chrono::system_clock::time_point& timeout);
+    
+    ///
+    /// Inserts a timer into the timer heap
+    void            PushTimer(Timer* timer);
+    ///
+    /// Removes the timer at a given position in the timer heap
+    void            RemoveTimerAtIndex(size_t idx);
+    ///
+    /// Restores the heap ordering after the fire date of the timer at `idx` changed
+    void            SiftTimer(size_t idx);
+    ///
+    /// Sets the fire date of a timer scheduled on this RunLoop
+    void            TimerRescheduled(Timer* timer, Timer::Clock::time_point& when);
+    ///
+    /// Called by an EventSource when it's signalled or cancelled
+    void            SourceSignalled(EventSource* source);
 #elif EPUB_OS(WINDOWS)
     ///
     /// Process a firing timer
@@ -556,16 +581,19 @@ private:
     std::atomic<bool>                           _resetHandles;
     Observer::Activity                          _observerMask;
 #else
-    std::list<RefCounted<Timer>>        _timers;
+    std::vector<Timer*>                 _timers;        ///< A binary min-heap of retained timers, ordered by fire date.
     std::list<RefCounted<Observer>>     _observers;
-    std::list<RefCounted<EventSource>>  _sources;
+    std::unordered_set<EventSource*>    _sources;       ///< All retained event sources.
+    std::deque<EventSource*>            _readySources;  ///< Sources which have been signalled or cancelled, in order.
+    TaskQueue                           _tasks;         ///< Functions posted through PerformFunction().
     std::recursive_mutex                _listLock;
+    std::mutex                          _readyLock;     ///< Guards `_readySources` only; never held while taking another lock.
     std::mutex                          _conditionLock;
     std::condition_variable             _wakeUp;
     std::atomic<bool>                   _waiting;
     std::atomic<bool>                   _stop;
+    std::atomic<bool>                   _wakePending;   ///< Set by WakeUp(), so a wake-up issued just before waiting isn't lost.
     Observer::Activity                  _observerMask;
-    const Timer*                        _waitingUntilTimer;
 #endif
 
 };
@@ -21,6 +21,7 @@
 
 // Common pieces used by all platforms
 #include "run_loop_common.ipp"
+#include <algorithm>
 
 #if EPUB_USE(CF)
 # error Please use run_loop_cf.cpp for this platform
@@ -34,32 +35,67 @@ EPUB3_BEGIN_NAMESPACE
 
 using StackLock = std::lock_guard<std::recursive_mutex>;
 
-RunLoop::RunLoop() : _timers(), _observers(), _sources(), _listLock(), _conditionLock(), _wakeUp(), _waiting(false), _stop(false), _observerMask(0), _waitingUntilTimer(nullptr)
+// A single wait never lasts longer than this, which keeps its deadline well clear of
+// the limits of the clock when running without a timeout.
+static const std::chrono::hours gMaxWaitInterval(24);
+
+// The `_heapIndex` of a timer which isn't in a timer heap.
+static const size_t gNotInHeap = size_t(-1);
+
+// Drops the run loop's reference to a timer or event source, in the same way that
+// removing it from one of the RefCounted<> lists used to.
+template <class _Tp>
+static inline void _ReleaseRef(_Tp* __p)
+{
+    RefCounted<_Tp> __r(__p, adopt_ref);
+}
+
+RunLoop::RunLoop() : _timers(), _observers(), _sources(), _readySources(), _tasks(), _listLock(), _readyLock(), _conditionLock(), _wakeUp(), _waiting(false), _stop(false), _wakePending(false), _observerMask(0)
 {
 }
 RunLoop::~RunLoop()
 {
     if ( _waiting )
         Stop();
+    
+    StackLock lock(_listLock);
+    for ( Timer* timer : _timers )
+    {
+        timer->_runLoop = nullptr;
+        timer->_heapIndex = gNotInHeap;
+        _ReleaseRef(timer);
+    }
+    for ( EventSource* source : _sources )
+    {
+        {
+            std::lock_guard<std::mutex> _(source->_loopsLock);
+            auto& loops = source->_runLoops;
+            loops.erase(std::remove(loops.begin(), loops.end(), this), loops.end());
+        }
+        _ReleaseRef(source);
+    }
 }
 void RunLoop::PerformFunction(std::function<void ()> fn)
 {
-    EventSource* ev = new EventSource([fn](EventSource& __e) {
-        fn();
-    });
-    AddEventSource(ev);
-    ev->Signal();
+    _tasks.Post(std::move(fn));
+    
+    // pairs with the fence in RunInternal(): either we see that the loop is waiting,
+    //  or it sees our task before it decides to wait
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ( _waiting )
+        WakeUp();
 }
 void RunLoop::AddTimer(Timer* timer)
 {
     StackLock lock(_listLock);
-    if ( ContainsTimer(timer) )
-        return;
+    RunLoop* current = nullptr;
+    if ( !timer->_runLoop.compare_exchange_strong(current, this) )
+        return;     // already scheduled, here or elsewhere
     
-    _timers.push_back(timer);
-    _timers.sort();
+    timer->retain();
+    PushTimer(timer);
     
-    if ( _waiting && _waitingUntilTimer != nullptr && _waitingUntilTimer->GetNextFireDate() < timer->GetNextFireDate() )
+    if ( _waiting && timer->_heapIndex == 0 )
     {
         // signal a Run() invocation that it needs to adjust its timeout to the fire
         // date of this new timer
@@ -68,33 +104,28 @@ void RunLoop::AddTimer(Timer* timer)
 }
 bool RunLoop::ContainsTimer(Timer* timer) const
 {
-    StackLock lock(const_cast<RunLoop*>(this)->_listLock);
-    for ( const Timer* t : _timers )
-    {
-        if ( timer == t )
-            return true;
-    }
-    return false;
+    return timer->_runLoop == this;
 }
 void RunLoop::RemoveTimer(Timer* timer)
 {
     StackLock lock(_listLock);
-    for ( auto iter = _timers.begin(), end = _timers.end(); iter != end; ++iter )
-    {
-        if ( *iter == timer )
-        {
-            _timers.erase(iter);
-            break;
-        }
-    }
+    if ( timer->_runLoop != this )
+        return;
+    
+    timer->_runLoop = nullptr;
+    if ( timer->_heapIndex == gNotInHeap )
+        return;     // it's being fired right now; RunInternal() will release it
+    
+    bool wasNext = (timer->_heapIndex == 0);
+    RemoveTimerAtIndex(timer->_heapIndex);
+    _ReleaseRef(timer);
     
     if ( _waiting )
     {
-        if ( _waitingUntilTimer == timer )
+        if ( wasNext )
         {
             // a Run() invocation is waiting until the removed timer's fire date
             // wake up the runloop so it can adjust its timeout accordingly
-            _waitingUntilTimer = nullptr;
             WakeUp();
         }
         else if ( _timers.empty() && _sources.empty() )
@@ -138,32 +169,36 @@ void RunLoop::RemoveObserver(Observer* obs)
 void RunLoop::AddEventSource(EventSource* ev)
 {
     StackLock lock(_listLock);
-    if ( ContainsEventSource(ev) )
+    if ( !_sources.insert(ev).second )
         return;
     
-    _sources.push_back(ev);
+    ev->retain();
+    {
+        std::lock_guard<std::mutex> _(ev->_loopsLock);
+        ev->_runLoops.push_back(this);
+    }
+    
+    // it may have been signalled before it was added
+    if ( ev->_signalled )
+        SourceSignalled(ev);
 }
 bool RunLoop::ContainsEventSource(EventSource* ev) const
 {
     StackLock lock(const_cast<RunLoop*>(this)->_listLock);
-    for ( const EventSource* e : _sources )
-    {
-        if ( ev == e )
-            return true;
-    }
-    return false;
+    return _sources.find(ev) != _sources.end();
 }
 void RunLoop::RemoveEventSource(EventSource* ev)
 {
     StackLock lock(_listLock);
-    for ( auto iter = _sources.begin(), end = _sources.end(); iter != end; ++iter )
+    if ( _sources.erase(ev) == 0 )
+        return;
+    
     {
-        if ( *iter == ev )
-        {
-            _sources.erase(iter);
-            break;
-        }
+        std::lock_guard<std::mutex> _(ev->_loopsLock);
+        auto& loops = ev->_runLoops;
+        loops.erase(std::remove(loops.begin(), loops.end(), this), loops.end());
     }
+    _ReleaseRef(ev);
     
     if ( _waiting && _timers.empty() && _sources.empty() )
     {
@@ -193,16 +228,19 @@ bool RunLoop::IsWaiting() const
 }
 void RunLoop::WakeUp()
 {
-    if ( _conditionLock.try_lock() )
-    {
-        _wakeUp.notify_all();
-        _conditionLock.unlock();
-    }
+    // the flag catches a wake-up sent between deciding to wait and starting to do so
+    _wakePending = true;
+    std::lock_guard<std::mutex> _(_conditionLock);
+    _wakeUp.notify_all();
 }
 RunLoop::ExitReason RunLoop::RunInternal(bool returnAfterSourceHandled, std::chrono::nanoseconds &timeout)
 {
     using namespace std::chrono;
-    system_clock::time_point timeoutTime = system_clock::now() + duration_cast<system_clock::duration>(timeout);
+    system_clock::time_point timeoutTime;
+    if ( timeout >= gMaxWaitInterval )
+        timeoutTime = system_clock::time_point::max();      // i.e. forever
+    else
+        timeoutTime = system_clock::now() + duration_cast<system_clock::duration>(timeout);
     ExitReason reason(ExitReason::RunTimedOut);
     
     // catch a pending stop
@@ -222,18 +260,48 @@ RunLoop::ExitReason RunLoop::RunInternal(bool returnAfterSourceHandled, std::chr
             for ( auto timer : timersToFire )
             {
                 // we'll reset repeating timers after the callback returns, so it doesn't
-                // arm again while we're 
-                Timer::Clock::time_point date = timer->GetNextFireDate();
+                // arm again while we're firing it
+                Timer::Clock::time_point date = timer->_fireDate;
                 
-                // fire the callback now
-                timer->_fn(*timer);
+                // fire the callback now, unless an earlier callback removed or cancelled it
+                if ( timer->_runLoop == this && !timer->IsCancelled() )
+                    timer->_fn(*timer);
                 
-                // only reset a repeating timer if the fire date hasn't been changed
-                //  by the callback
-                if ( timer->Repeats() && timer->GetNextFireDate() == date )
+                if ( timer->_runLoop == this && timer->_heapIndex == gNotInHeap && !timer->IsCancelled() )
                 {
-                    timer->SetNextFireDate(timer->_interval);
+                    if ( timer->_fireDate != date )
+                    {
+                        // rescheduled by the callback
+                        PushTimer(timer);
+                        continue;
+                    }
+                    if ( timer->Repeats() )
+                    {
+                        timer->_fireDate = Timer::Clock::now() + timer->_interval;
+                        PushTimer(timer);
+                        continue;
+                    }
                 }
+                
+                // fired for the last time, or removed (and perhaps re-added) by the callback
+                if ( timer->_heapIndex == gNotInHeap )
+                {
+                    RunLoop* self = this;
+                    timer->_runLoop.compare_exchange_strong(self, nullptr);
+                }
+                _ReleaseRef(timer);
+            }
+        }
+        
+        // posted functions are run in batches of at most one ring's worth, so a function
+        //  which keeps posting more can't keep the loop from its timers and sources
+        if ( !_tasks.Empty() )
+        {
+            RunObservers(Observer::ActivityFlags::RunLoopBeforeSources);
+            if ( _tasks.Drain(_tasks.Capacity()) != 0 && returnAfterSourceHandled )
+            {
+                reason = ExitReason::RunHandledSource;
+                break;
             }
         }
         
@@ -243,7 +311,9 @@ RunLoop::ExitReason RunLoop::RunInternal(bool returnAfterSourceHandled, std::chr
             RunObservers(Observer::ActivityFlags::RunLoopBeforeSources);
             for ( auto source : sourcesToFire )
             {
-                source->_fn(*source);
+                // an earlier handler may have removed this source
+                if ( _sources.find(source) != _sources.end() )
+                    source->_fn(*source);
             }
             
             if ( returnAfterSourceHandled )
@@ -260,13 +330,14 @@ RunLoop::ExitReason RunLoop::RunInternal(bool returnAfterSourceHandled, std::chr
         }
         
         RunObservers(Observer::ActivityFlags::RunLoopBeforeWaiting);
-        _listLock.unlock();
         _waiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         
-        system_clock::time_point waitUntil = TimeoutOrTimer(timeoutTime);
+        system_clock::time_point waitUntil = std::min(TimeoutOrTimer(timeoutTime), system_clock::now() + duration_cast<system_clock::duration>(gMaxWaitInterval));
+        _listLock.unlock();
         
         std::unique_lock<std::mutex> _condLock(_conditionLock);
-        std::cv_status waitStatus = _wakeUp.wait_until(_condLock, waitUntil);
+        _wakeUp.wait_until(_condLock, waitUntil, [this]() { return _wakePending.exchange(false); });
         _condLock.unlock();
         
         _waiting = false;
@@ -274,14 +345,7 @@ RunLoop::ExitReason RunLoop::RunInternal(bool returnAfterSourceHandled, std::chr
         
         RunObservers(Observer::ActivityFlags::RunLoopAfterWaiting);
         
-        // why did we wake up?
-        if ( waitStatus == std::cv_status::timeout )
-        {
-            reason = ExitReason::RunTimedOut;
-            break;
-        }
-        
-        if ( _stop )
+        if ( _stop.exchange(false) )
         {
             reason = ExitReason::RunStopped;
             break;
@@ -327,51 +391,60 @@ std::vector<RunLoop::Timer*> RunLoop::CollectFiringTimers()
     auto currentTime = std::chrono::system_clock::now();
     std::vector<Timer*> result;
     
-    std::vector<Timer*> timersToRemove;
-    for ( Timer* timer : _timers )
+    // The root of the heap is always the next timer to fire, so we only ever look at
+    // timers which are due. Cancelled timers are discarded as they reach the root.
+    while ( !_timers.empty() )
     {
+        Timer* timer = _timers.front();
+        if ( !timer->IsCancelled() && timer->_fireDate > currentTime )
+            break;
+        
+        RemoveTimerAtIndex(0);
         if ( timer->IsCancelled() )
         {
-            timersToRemove.push_back(timer);
+            timer->_runLoop = nullptr;
+            _ReleaseRef(timer);
             continue;
         }
         
-        // Timers are sorted in ascending order, so as soon as we've encountered one
-        // which hasn't yet fired, we can stop searching.
-        if ( timer->GetNextFireDate() > currentTime )
-            break;
-        
+        // still retained by us, and still reporting this RunLoop from ContainsTimer()
         result.push_back(timer);
     }
     
-    for ( auto timer : timersToRemove )
-    {
-        RemoveTimer(timer);
-    }
-    
     return result;
 }
 std::vector<RunLoop::EventSource*> RunLoop::CollectFiringSources(bool onlyOne)
 {
     // _listLock MUST ALREADY BE HELD
     std::vector<EventSource*> result;
-    
     std::vector<EventSource*> cancelledSources;
-    for ( EventSource* source : _sources )
+    
     {
-        if ( source->IsCancelled() )
+        std::lock_guard<std::mutex> _(_readyLock);
+        while ( !_readySources.empty() )
         {
-            cancelledSources.push_back(source);
-            continue;
+            EventSource* source = _readySources.front();
+            _readySources.pop_front();
+            
+            // it may have been removed since it was queued
+            if ( _sources.find(source) == _sources.end() )
+                continue;
+            
+            if ( source->IsCancelled() )
+            {
+                cancelledSources.push_back(source);
+                continue;
+            }
+            
+            // we atomically set it to false while reading to ensure only one RunLoop
+            // picks up the source
+            if ( source->_signalled.exchange(false) )
+            {
+                result.push_back(source);
+                if ( onlyOne )
+                    break;      // leave any others queued for the next pass
+            }
         }
-        
-        // we atomically set it to false while reading to ensure only one RunLoop
-        // picks up the source
-        if ( source->_signalled.exchange(false) )
-            result.push_back(source);
-        
-        if ( onlyOne )
-            break;      // don't unset the signal on any other sources
     }
     
     for ( auto source : cancelledSources )
@@ -384,18 +457,99 @@ std::vector<RunLoop::EventSource*> RunLoop::CollectFiringSources(bool onlyOne)
 std::chrono::system_clock::time_point RunLoop::TimeoutOrTimer(std::chrono::system_clock::time_point& timeout)
 {
     // _listLock MUST ALREADY BE HELD
+    // don't wait at all if there are functions or sources left to handle
+    if ( !_tasks.Empty() )
+        return std::chrono::system_clock::now();
+    {
+        std::lock_guard<std::mutex> _(_readyLock);
+        if ( !_readySources.empty() )
+            return std::chrono::system_clock::now();
+    }
+    
     if ( _timers.empty() )
         return timeout;
     
-    std::chrono::system_clock::time_point fireDate = _timers.front()->GetNextFireDate();
+    std::chrono::system_clock::time_point fireDate = _timers.front()->_fireDate;
     if ( fireDate < timeout )
-    {
-        _waitingUntilTimer = _timers.front();
         return fireDate;
-    }
     
     return timeout;
 }
+void RunLoop::PushTimer(Timer* timer)
+{
+    // _listLock MUST ALREADY BE HELD
+    timer->_heapIndex = _timers.size();
+    _timers.push_back(timer);
+    SiftTimer(timer->_heapIndex);
+}
+void RunLoop::RemoveTimerAtIndex(size_t idx)
+{
+    // _listLock MUST ALREADY BE HELD
+    Timer* removed = _timers[idx];
+    Timer* last = _timers.back();
+    _timers.pop_back();
+    removed->_heapIndex = gNotInHeap;
+    
+    if ( last != removed )
+    {
+        _timers[idx] = last;
+        last->_heapIndex = idx;
+        SiftTimer(idx);
+    }
+}
+void RunLoop::SiftTimer(size_t idx)
+{
+    // _listLock MUST ALREADY BE HELD
+    Timer* timer = _timers[idx];
+    
+    // towards the root while it fires before its parent...
+    while ( idx > 0 )
+    {
+        size_t parent = (idx - 1) / 2;
+        if ( !(timer->_fireDate < _timers[parent]->_fireDate) )
+            break;
+        _timers[idx] = _timers[parent];
+        _timers[idx]->_heapIndex = idx;
+        idx = parent;
+    }
+    
+    // ...or towards the leaves while either child fires before it
+    size_t count = _timers.size();
+    for ( size_t child = idx*2 + 1; child < count; child = idx*2 + 1 )
+    {
+        if ( child+1 < count && _timers[child+1]->_fireDate < _timers[child]->_fireDate )
+            child++;
+        if ( !(_timers[child]->_fireDate < timer->_fireDate) )
+            break;
+        _timers[idx] = _timers[child];
+        _timers[idx]->_heapIndex = idx;
+        idx = child;
+    }
+    
+    _timers[idx] = timer;
+    timer->_heapIndex = idx;
+}
+void RunLoop::TimerRescheduled(Timer* timer, Timer::Clock::time_point& when)
+{
+    StackLock lock(_listLock);
+    timer->_fireDate = when;
+    if ( timer->_runLoop != this || timer->_heapIndex == gNotInHeap )
+        return;     // not ours, or being fired right now
+    
+    SiftTimer(timer->_heapIndex);
+    if ( _waiting )
+        WakeUp();
+}
+void RunLoop::SourceSignalled(EventSource* source)
+{
+    {
+        std::lock_guard<std::mutex> _(_readyLock);
+        _readySources.push_back(source);
+    }
+    
+    if ( _waiting )
+        WakeUp();
+}
 
 RunLoop::Observer::Observer(Activity activities, bool repeats, ObserverFn fn) : _fn(fn), _acts(activities), _repeats(repeats), _cancelled(false)
 {
@@ -485,22 +639,38 @@ bool RunLoop::EventSource::IsCancelled() const
 void RunLoop::EventSource::Cancel()
 {
     _cancelled = true;
+    
+    // queue it so that its RunLoops discard it promptly
+    std::lock_guard<std::mutex> _(_loopsLock);
+    for ( RunLoop* rl : _runLoops )
+    {
+        rl->SourceSignalled(this);
+    }
 }
 void RunLoop::EventSource::Signal()
 {
-    _signalled = true;
+    // only the first signal queues the source; later ones are coalesced with it
+    //  until a RunLoop handles it
+    if ( _signalled.exchange(true) )
+        return;
+    
+    std::lock_guard<std::mutex> _(_loopsLock);
+    for ( RunLoop* rl : _runLoops )
+    {
+        rl->SourceSignalled(this);
+    }
 }
 
-RunLoop::Timer::Timer(Clock::time_point& fireDate, Clock::duration& interval, TimerFn fn) : _fireDate(fireDate), _interval(interval), _fn(fn)
+RunLoop::Timer::Timer(Clock::time_point& fireDate, Clock::duration& interval, TimerFn fn) : _fireDate(fireDate), _interval(interval), _fn(fn), _cancelled(false), _runLoop(nullptr), _heapIndex(gNotInHeap)
 {
 }
-RunLoop::Timer::Timer(Clock::duration& interval, bool repeat, TimerFn fn) : _fireDate(Clock::now()+interval), _interval(interval), _fn(fn)
+RunLoop::Timer::Timer(Clock::duration& interval, bool repeat, TimerFn fn) : _fireDate(Clock::now()+interval), _interval(repeat ? interval : Clock::duration(0)), _fn(fn), _cancelled(false), _runLoop(nullptr), _heapIndex(gNotInHeap)
 {
 }
-RunLoop::Timer::Timer(const Timer& o) : _fireDate(o._fireDate), _interval(o._interval), _fn(o._fn)
+RunLoop::Timer::Timer(const Timer& o) : _fireDate(o._fireDate), _interval(o._interval), _fn(o._fn), _cancelled(o._cancelled), _runLoop(nullptr), _heapIndex(gNotInHeap)
 {
 }
-RunLoop::Timer::Timer(Timer&& o) : _fireDate(std::move(o._fireDate)), _interval(std::move(o._interval)), _fn(std::move(o._fn))
+RunLoop::Timer::Timer(Timer&& o) : _fireDate(std::move(o._fireDate)), _interval(std::move(o._interval)), _fn(std::move(o._fn)), _cancelled(o._cancelled), _runLoop(nullptr), _heapIndex(gNotInHeap)
 {
 }
 RunLoop::Timer::~Timer()
@@ -508,14 +678,16 @@ RunLoop::Timer::~Timer()
 }
 RunLoop::Timer& RunLoop::Timer::operator=(const Timer& o)
 {
-    _fireDate = o._fireDate;
+    Clock::time_point when = o._fireDate;
+    SetNextFireDateTime(when);
     _interval = o._interval;
     _fn = o._fn;
     return *this;
 }
 RunLoop::Timer& RunLoop::Timer::operator=(Timer&& o)
 {
-    _fireDate = std::move(o._fireDate);
+    Clock::time_point when = o._fireDate;
+    SetNextFireDateTime(when);
     _interval = std::move(o._interval);
     _fn = std::move(o._fn);
     return *this;
@@ -546,7 +718,12 @@ RunLoop::Timer::Clock::time_point RunLoop::Timer::GetNextFireDateTime() const
 }
 void RunLoop::Timer::SetNextFireDateTime(Clock::time_point& when)
 {
-    _fireDate = when;
+    // a scheduled timer has to be moved within its RunLoop's timer heap
+    RunLoop* rl = _runLoop;
+    if ( rl != nullptr )
+        rl->TimerRescheduled(this, when);
+    else
+        _fireDate = when;
 }
 RunLoop::Timer::Clock::duration RunLoop::Timer::GetNextFireDateDuration() const
 {
@@ -554,7 +731,8 @@ RunLoop::Timer::Clock::duration RunLoop::Timer::GetNextFireDateDuration() const
 }
 void RunLoop::Timer::SetNextFireDateDuration(Clock::duration& when)
 {
-    _fireDate = Clock::now() + when;
+    Clock::time_point date = Clock::now() + when;
+    SetNextFireDateTime(date);
 }
 
 EPUB3_END_NAMESPACE
@@ -0,0 +1,57 @@
+//
+//  shared_string.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "shared_string.h"
+
+EPUB3_BEGIN_NAMESPACE
+
+const string::size_type SharedString::InlineCapacity;
+
+SharedString::SharedString(const string& s) : _block(nullptr)
+{
+    _Init(string(s));
+}
+SharedString::SharedString(string&& s) : _block(nullptr)
+{
+    _Init(std::move(s));
+}
+void SharedString::_Init(string&& s)
+{
+    if ( s.utf8_size() <= InlineCapacity )
+        new (&_inline) string(std::move(s));
+    else
+        _block = new Block(std::move(s));
+}
+void SharedString::_Release() _NOEXCEPT
+{
+    if ( _block == nullptr )
+    {
+        reinterpret_cast<string*>(&_inline)->~string();
+        return;
+    }
+    
+    if ( _block->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1 )
+        delete _block;
+    _block = nullptr;
+}
+
+EPUB3_END_NAMESPACE
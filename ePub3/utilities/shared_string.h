@@ -0,0 +1,206 @@
+//
+//  shared_string.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__shared_string__
+#define __ePub3__shared_string__
+
+#include <ePub3/utilities/basic.h>
+#include <ePub3/utilities/utfstring.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ An immutable string with cheap copies, used to hold the values of the package
+ model (manifest hrefs and media types, spine idrefs, metadata values).
+ 
+ Short values are stored inline, where copying one is no more expensive than
+ copying the pointer would be. Longer values live in a single reference-counted
+ block shared by every copy, so a value parsed once from the OPF can be handed out
+ in lists, copied into other model objects or stored in caches without ever being
+ duplicated.
+ 
+ Since the value never changes, it's safe to read a SharedString from any number
+ of threads at once; the value itself is available as a `const string&` through
+ str() or by implicit conversion, so a SharedString can be passed to anything
+ expecting an ePub3::string.
+ 
+ @ingroup utilities
+ */
+class SharedString
+{
+public:
+    ///
+    /// Values of up to this many bytes are stored inline, within std::string's
+    /// own small-string buffer.
+    static const string::size_type  InlineCapacity = 15;
+    
+    ///
+    /// Creates an empty string.
+                        SharedString()                          _NOEXCEPT   : _block(nullptr)   { new (&_inline) string(); }
+    ///
+    /// Creates a string holding a copy of `s`.
+    EPUB3_EXPORT        SharedString(const string& s);
+    ///
+    /// Creates a string taking ownership of the contents of `s`.
+    EPUB3_EXPORT        SharedString(string&& s);
+                        SharedString(const string::__base& s)               : SharedString(string(s)) {}
+                        SharedString(const char* s)                         : SharedString(string(s)) {}
+    ///
+    /// As with string::assign(const xmlChar*), a `nullptr` value yields an empty string.
+                        SharedString(const xmlChar* s)                      : SharedString(string().assign(s, xmlStrlen(s))) {}
+    ///
+    /// Copies share the original's storage.
+                        SharedString(const SharedString& o)     _NOEXCEPT   : _block(o._block)  { _Retain(o); }
+                        SharedString(SharedString&& o)          _NOEXCEPT   : _block(o._block)  { _Steal(o); }
+                        ~SharedString()                                                         { _Release(); }
+    
+    SharedString&       operator=(const SharedString& o)        _NOEXCEPT;
+    SharedString&       operator=(SharedString&& o)             _NOEXCEPT;
+    SharedString&       operator=(const string& s)                          { return operator=(SharedString(s)); }
+    SharedString&       operator=(string&& s)                               { return operator=(SharedString(std::move(s))); }
+    SharedString&       operator=(const char* s)                            { return operator=(SharedString(s)); }
+    SharedString&       operator=(const xmlChar* s)                         { return operator=(SharedString(s)); }
+    
+    ///
+    /// The value, which is valid for as long as this object (or a copy of it) is.
+    const string&       str()                                   const _NOEXCEPT {
+        return (_block != nullptr ? _block->value : *reinterpret_cast<const string*>(&_inline));
+    }
+    operator const string& ()                                   const _NOEXCEPT { return str(); }
+    
+    const string::__base&   stl_str()                           const _NOEXCEPT { return str().stl_str(); }
+    const char*         c_str()                                 const _NOEXCEPT { return str().c_str(); }
+    const char*         data()                                  const _NOEXCEPT { return str().data(); }
+    const xmlChar*      utf8()                                  const _NOEXCEPT { return str().utf8(); }
+    
+    ///
+    /// The length in code points.
+    string::size_type   size()                                  const _NOEXCEPT { return str().size(); }
+    string::size_type   length()                                const _NOEXCEPT { return str().size(); }
+    string::size_type   utf8_size()                             const _NOEXCEPT { return str().utf8_size(); }
+    bool                empty()                                 const _NOEXCEPT { return str().empty(); }
+    
+    ///
+    /// Returns `true` if this string's value lives in a shared block.
+    bool                IsShared()                              const _NOEXCEPT { return _block != nullptr; }
+    ///
+    /// Returns `true` if both strings refer to the same shared storage.
+    bool                SharesStorageWith(const SharedString& o)    const _NOEXCEPT { return _block != nullptr && _block == o._block; }
+    
+    int                 compare(const SharedString& o)          const _NOEXCEPT {
+        return (SharesStorageWith(o) ? 0 : str().compare(o.str()));
+    }
+    
+    bool operator==(const SharedString& o)  const _NOEXCEPT { return SharesStorageWith(o) || str() == o.str(); }
+    bool operator!=(const SharedString& o)  const _NOEXCEPT { return !operator==(o); }
+    bool operator<(const SharedString& o)   const _NOEXCEPT { return compare(o) < 0; }
+    bool operator==(const string& s)        const _NOEXCEPT { return str() == s; }
+    bool operator!=(const string& s)        const _NOEXCEPT { return str() != s; }
+    bool operator<(const string& s)         const _NOEXCEPT { return str() < s; }
+    template <typename _CharT>
+    bool operator==(const _CharT* s)        const _NOEXCEPT { return str() == s; }
+    template <typename _CharT>
+    bool operator!=(const _CharT* s)        const _NOEXCEPT { return str() != s; }
+    
+protected:
+    struct Block
+    {
+        std::atomic<size_t> refcount;
+        const string        value;
+        
+        Block(string&& s) : refcount(1), value(std::move(s)) {}
+    };
+    
+    typedef std::aligned_storage<sizeof(string), std::alignment_of<string>::value>::type  InlineStorage;
+    
+    Block*              _block;         ///< The shared value, or `nullptr` if the value is inline.
+    InlineStorage       _inline;        ///< Constructed only while `_block` is `nullptr`.
+    
+    EPUB3_EXPORT void   _Init(string&& s);
+    void                _Retain(const SharedString& o)          _NOEXCEPT;
+    void                _Steal(SharedString& o)                 _NOEXCEPT;
+    EPUB3_EXPORT void   _Release()                              _NOEXCEPT;
+    
+};
+
+inline void SharedString::_Retain(const SharedString& o) _NOEXCEPT
+{
+    if ( _block != nullptr )
+        _block->refcount.fetch_add(1, std::memory_order_relaxed);
+    else
+        new (&_inline) string(o.str());     // fits the small-string buffer, so doesn't allocate
+}
+inline void SharedString::_Steal(SharedString& o) _NOEXCEPT
+{
+    if ( _block != nullptr )
+    {
+        o._block = nullptr;
+        new (&o._inline) string();
+    }
+    else
+    {
+        new (&_inline) string(std::move(*reinterpret_cast<string*>(&o._inline)));
+    }
+}
+inline SharedString& SharedString::operator=(const SharedString& o) _NOEXCEPT
+{
+    if ( this != &o )
+    {
+        _Release();
+        _block = o._block;
+        _Retain(o);
+    }
+    return *this;
+}
+inline SharedString& SharedString::operator=(SharedString&& o) _NOEXCEPT
+{
+    if ( this != &o )
+    {
+        _Release();
+        _block = o._block;
+        _Steal(o);
+    }
+    return *this;
+}
+
+// templates, so that nothing is implicitly converted to a SharedString to match them
+template <class _Shared>
+inline typename std::enable_if<std::is_same<_Shared, SharedString>::value, bool>::type
+operator==(const string& s, const _Shared& ss) _NOEXCEPT { return ss == s; }
+template <class _Shared>
+inline typename std::enable_if<std::is_same<_Shared, SharedString>::value, bool>::type
+operator!=(const string& s, const _Shared& ss) _NOEXCEPT { return ss != s; }
+template <class _Shared>
+inline typename std::enable_if<std::is_same<_Shared, SharedString>::value, bool>::type
+operator<(const string& s, const _Shared& ss) _NOEXCEPT { return s < ss.str(); }
+inline std::ostream& operator<<(std::ostream& o, const SharedString& ss) { return o << ss.str(); }
+
+///
+/// A list of shared values.
+typedef std::vector<SharedString>   SharedStringList;
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__shared_string__) */
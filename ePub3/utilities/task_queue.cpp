@@ -0,0 +1,142 @@
+//
+//  task_queue.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "task_queue.h"
+
+EPUB3_BEGIN_NAMESPACE
+
+// This is Dmitry Vyukov's bounded queue: each slot's sequence number says whether it
+// is free for the producer claiming a given position, or full and ready for the
+// consumer reading that position.
+
+TaskQueue::TaskQueue(std::size_t capacity) : _slots(nullptr), _mask(0), _postPos(0), _takePos(0), _overflowed(false), _overflowLock(), _overflow()
+{
+    std::size_t size = 2;
+    while ( size < capacity )
+        size <<= 1;
+
+    _slots = new Slot[size];
+    _mask = size - 1;
+    for ( std::size_t i = 0; i < size; i++ )
+    {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+TaskQueue::~TaskQueue()
+{
+    delete [] _slots;
+}
+void TaskQueue::Post(Task&& task)
+{
+    // once anything has overflowed, everything goes the same way until the consumer
+    //  has caught up, so that nothing overtakes the tasks waiting there
+    if ( !_overflowed.load(std::memory_order_acquire) )
+    {
+        std::size_t pos = _postPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = _slots[pos & _mask];
+            std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+
+            if ( diff == 0 )
+            {
+                if ( _postPos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed) )
+                {
+                    slot.task = std::move(task);
+                    slot.sequence.store(pos+1, std::memory_order_release);
+                    return;
+                }
+                // lost the race; `pos` now holds the current value
+            }
+            else if ( diff < 0 )
+            {
+                // the consumer hasn't emptied this slot yet: the ring is full
+                break;
+            }
+            else
+            {
+                pos = _postPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> _(_overflowLock);
+    _overflow.push_back(std::move(task));
+    _overflowed.store(true, std::memory_order_release);
+}
+bool TaskQueue::TakeFromRing(Task& task)
+{
+    Slot& slot = _slots[_takePos & _mask];
+    if ( slot.sequence.load(std::memory_order_acquire) != _takePos + 1 )
+        return false;       // empty, or claimed but not yet filled
+
+    task = std::move(slot.task);
+    slot.task = nullptr;
+
+    // free the slot for the producer which will claim it on the next lap
+    slot.sequence.store(_takePos + _mask + 1, std::memory_order_release);
+    _takePos++;
+    return true;
+}
+std::size_t TaskQueue::Drain(std::size_t maxTasks)
+{
+    std::size_t count = 0;
+    std::size_t end = _postPos.load(std::memory_order_acquire);
+    Task task;
+
+    while ( count < maxTasks && _takePos != end && TakeFromRing(task) )
+    {
+        task();
+        task = nullptr;
+        count++;
+    }
+
+    while ( count < maxTasks && _overflowed.load(std::memory_order_acquire) )
+    {
+        {
+            std::lock_guard<std::mutex> _(_overflowLock);
+            if ( !_overflow.empty() )
+            {
+                task = std::move(_overflow.front());
+                _overflow.pop_front();
+            }
+            if ( _overflow.empty() )
+                _overflowed.store(false, std::memory_order_release);
+        }
+
+        if ( task )
+        {
+            task();
+            task = nullptr;
+            count++;
+        }
+    }
+
+    return count;
+}
+bool TaskQueue::Empty() const
+{
+    const Slot& slot = _slots[_takePos & _mask];
+    return slot.sequence.load(std::memory_order_acquire) != _takePos + 1 && !_overflowed.load(std::memory_order_acquire);
+}
+
+EPUB3_END_NAMESPACE
@@ -0,0 +1,122 @@
+//
+//  task_queue.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __ePub3__task_queue__
+#define __ePub3__task_queue__
+
+#include <ePub3/utilities/basic.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ A queue of functions posted by any number of threads and run by a single consumer,
+ such as a RunLoop.
+
+ Tasks are stored in a fixed ring of slots allocated along with the queue. Posting a
+ task claims a slot with a single compare-and-swap and moves the function into it,
+ so it takes no locks and allocates nothing beyond whatever the `std::function`
+ itself needed (small callables are stored within the `std::function`). Should the
+ ring fill up, further tasks are kept in an overflow list under a lock until the
+ consumer catches up; tasks from any one thread are always run in the order they
+ were posted.
+
+ Only one thread may call Drain() at a time.
+
+ @ingroup utilities
+ */
+class TaskQueue
+{
+public:
+    typedef std::function<void()>   Task;
+
+    ///
+    /// The default number of slots in the ring.
+    static const std::size_t        DefaultCapacity = 256;
+
+    ///
+    /// Creates a queue. The capacity is rounded up to a power of two.
+    EPUB3_EXPORT    TaskQueue(std::size_t capacity=DefaultCapacity);
+    EPUB3_EXPORT    ~TaskQueue();
+
+    ///
+    /// Adds a task to the queue. This may be called from any thread.
+    EPUB3_EXPORT
+    void            Post(Task&& task);
+
+    /**
+     Runs the tasks in the queue.
+
+     Tasks posted while draining (including by the tasks themselves) may be left for
+     the next call, so that a task which keeps re-posting itself can't starve the
+     consumer.
+     @param maxTasks The maximum number of tasks to run.
+     @result The number of tasks which were run.
+     */
+    EPUB3_EXPORT
+    std::size_t     Drain(std::size_t maxTasks);
+
+    ///
+    /// Whether the queue has no tasks waiting. Only the consumer may call this, and
+    /// the result is only a snapshot while other threads are posting tasks.
+    EPUB3_EXPORT
+    bool            Empty()                             const;
+
+    ///
+    /// The number of slots in the ring.
+    std::size_t     Capacity()                          const   { return _mask + 1; }
+
+private:
+                    TaskQueue(const TaskQueue&)         _DELETED_;
+                    TaskQueue(TaskQueue&&)              _DELETED_;
+    TaskQueue&      operator=(const TaskQueue&)         _DELETED_;
+
+    struct Slot
+    {
+        std::atomic<std::size_t>    sequence;   ///< Equal to the claiming position while free, or position+1 while full.
+        Task                        task;
+    };
+
+    ///
+    /// Takes the next task from the ring, if there is one.
+    bool            TakeFromRing(Task& task);
+
+    Slot*                       _slots;
+    std::size_t                 _mask;
+
+    // producers and consumer each get their own cache line
+    char                        _pad0[64];
+    std::atomic<std::size_t>    _postPos;       ///< The next position to be claimed by a producer.
+    char                        _pad1[64];
+    std::size_t                 _takePos;       ///< The next position to be read by the consumer.
+
+    std::atomic<bool>           _overflowed;    ///< Set while the overflow list holds tasks.
+    std::mutex                  _overflowLock;
+    std::deque<Task>            _overflow;      ///< Tasks posted while the ring was full.
+
+};
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__task_queue__) */
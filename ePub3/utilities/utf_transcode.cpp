@@ -0,0 +1,420 @@
+//
+//  utf_transcode.cpp
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "utf_transcode.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define EPUB_UTF_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define EPUB_UTF_NEON 1
+#endif
+
+EPUB3_BEGIN_NAMESPACE
+
+// The chunk primitives: each examines `gChunkSize` bytes (or UTF-16 code units)
+//  at once. Callers guarantee that whole chunks are readable.
+
+#if EPUB_UTF_SSE2
+
+static const size_t gChunkSize = 16;
+
+static inline bool _IsASCIIChunk(const char* p)
+{
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0;
+}
+static inline size_t _CountContinuationBytes(const char* p, size_t chunks)
+{
+    // continuation bytes are 0x80-0xBF, which is -128 to -65 as signed chars; tally
+    //  them bytewise for up to 255 chunks at a time, then sum across the register
+    size_t total = 0;
+    while ( chunks != 0 )
+    {
+        size_t batch = (chunks < 255 ? chunks : 255);
+        __m128i tally = _mm_setzero_si128();
+        for ( size_t i = 0; i < batch; i++, p += gChunkSize )
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            tally = _mm_sub_epi8(tally, _mm_cmplt_epi8(v, _mm_set1_epi8(-64)));
+        }
+        __m128i sums = _mm_sad_epu8(tally, _mm_setzero_si128());
+        total += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+        chunks -= batch;
+    }
+    return total;
+}
+static inline void _WidenASCIIChunk(const char* p, char16_t* out)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i zero = _mm_setzero_si128();
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(v, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(v, zero));
+}
+static inline bool _NarrowASCIIChunk(const char16_t* p, char* out)
+{
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+    if ( _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF )
+        return false;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+    return true;
+}
+
+#elif EPUB_UTF_NEON
+
+static const size_t gChunkSize = 16;
+
+static inline bool _IsASCIIChunk(const char* p)
+{
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+    return (vget_lane_u64(vreinterpret_u64_u8(folded), 0) & 0x8080808080808080ULL) == 0;
+}
+static inline size_t _CountContinuationBytes(const char* p, size_t chunks)
+{
+    // continuation bytes are 0x80-0xBF, which is -128 to -65 as signed chars; tally
+    //  them bytewise for up to 255 chunks at a time, then sum across the register
+    size_t total = 0;
+    while ( chunks != 0 )
+    {
+        size_t batch = (chunks < 255 ? chunks : 255);
+        uint8x16_t tally = vdupq_n_u8(0);
+        for ( size_t i = 0; i < batch; i++, p += gChunkSize )
+        {
+            int8x16_t v = vld1q_s8(reinterpret_cast<const int8_t*>(p));
+            tally = vsubq_u8(tally, vcltq_s8(v, vdupq_n_s8(-64)));
+        }
+        uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(tally)));
+        total += static_cast<size_t>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+        chunks -= batch;
+    }
+    return total;
+}
+static inline void _WidenASCIIChunk(const char* p, char16_t* out)
+{
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    vst1q_u16(reinterpret_cast<uint16_t*>(out), vmovl_u8(vget_low_u8(v)));
+    vst1q_u16(reinterpret_cast<uint16_t*>(out + 8), vmovl_u8(vget_high_u8(v)));
+}
+static inline bool _NarrowASCIIChunk(const char16_t* p, char* out)
+{
+    uint16x8_t a = vld1q_u16(reinterpret_cast<const uint16_t*>(p));
+    uint16x8_t b = vld1q_u16(reinterpret_cast<const uint16_t*>(p + 8));
+    uint64x2_t folded = vreinterpretq_u64_u16(vorrq_u16(a, b));
+    uint64_t high = (vgetq_lane_u64(folded, 0) | vgetq_lane_u64(folded, 1)) & 0xFF80FF80FF80FF80ULL;
+    if ( high != 0 )
+        return false;
+    vst1q_u8(reinterpret_cast<uint8_t*>(out), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    return true;
+}
+
+#else
+
+// no vector unit: use a machine word as the chunk
+static const size_t gChunkSize = 8;
+
+static inline uint64_t _LoadWord(const char* p)
+{
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return w;
+}
+static inline bool _IsASCIIChunk(const char* p)
+{
+    return (_LoadWord(p) & 0x8080808080808080ULL) == 0;
+}
+static inline size_t _CountContinuationBytes(const char* p, size_t chunks)
+{
+    // a continuation byte has its top bit set and the next one clear
+    size_t total = 0;
+    for ( size_t i = 0; i < chunks; i++, p += gChunkSize )
+    {
+        uint64_t w = _LoadWord(p);
+        uint64_t m = ((w & ~(w << 1)) & 0x8080808080808080ULL) >> 7;
+        total += static_cast<size_t>((m * 0x0101010101010101ULL) >> 56);
+    }
+    return total;
+}
+static inline void _WidenASCIIChunk(const char* p, char16_t* out)
+{
+    for ( size_t i = 0; i < gChunkSize; i++ )
+        out[i] = static_cast<char16_t>(static_cast<unsigned char>(p[i]));
+}
+static inline bool _NarrowASCIIChunk(const char16_t* p, char* out)
+{
+    char16_t folded = 0;
+    for ( size_t i = 0; i < gChunkSize; i++ )
+        folded |= p[i];
+    if ( (folded & 0xFF80) != 0 )
+        return false;
+    for ( size_t i = 0; i < gChunkSize; i++ )
+        out[i] = static_cast<char>(p[i]);
+    return true;
+}
+
+#endif
+
+static inline bool _IsContinuation(unsigned char c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+/**
+ Decodes and validates the multibyte sequence at `p`.
+ @result The number of bytes in the sequence, or zero if it isn't well-formed.
+ */
+static size_t _DecodeUTF8Sequence(const unsigned char* p, const unsigned char* end, uint32_t& cp)
+{
+    unsigned char c = p[0];
+    if ( c < 0x80 )
+    {
+        cp = c;
+        return 1;
+    }
+    
+    size_t len = 0;
+    unsigned char lo = 0x80, hi = 0xBF;     // the valid range of the second byte
+    if ( c >= 0xC2 && c <= 0xDF )
+    {
+        len = 2;
+        cp = c & 0x1F;
+    }
+    else if ( c >= 0xE0 && c <= 0xEF )
+    {
+        len = 3;
+        cp = c & 0x0F;
+        if ( c == 0xE0 )
+            lo = 0xA0;      // overlong
+        else if ( c == 0xED )
+            hi = 0x9F;      // surrogates
+    }
+    else if ( c >= 0xF0 && c <= 0xF4 )
+    {
+        len = 4;
+        cp = c & 0x07;
+        if ( c == 0xF0 )
+            lo = 0x90;      // overlong
+        else if ( c == 0xF4 )
+            hi = 0x8F;      // beyond U+10FFFF
+    }
+    else
+    {
+        return 0;
+    }
+    
+    if ( static_cast<size_t>(end - p) < len || p[1] < lo || p[1] > hi )
+        return 0;
+    
+    cp = (cp << 6) | (p[1] & 0x3F);
+    for ( size_t i = 2; i < len; i++ )
+    {
+        if ( !_IsContinuation(p[i]) )
+            return 0;
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    
+    return len;
+}
+
+bool ValidateUTF8(const char* utf8, size_t len) _NOEXCEPT
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8);
+    const unsigned char* end = p + len;
+    while ( p < end )
+    {
+        if ( static_cast<size_t>(end - p) >= gChunkSize && _IsASCIIChunk(reinterpret_cast<const char*>(p)) )
+        {
+            p += gChunkSize;
+            continue;
+        }
+        
+        uint32_t cp = 0;
+        size_t n = _DecodeUTF8Sequence(p, end, cp);
+        if ( n == 0 )
+            return false;
+        p += n;
+    }
+    return true;
+}
+size_t ASCIIPrefixLength(const char* utf8, size_t len) _NOEXCEPT
+{
+    size_t i = 0;
+    while ( len - i >= gChunkSize && _IsASCIIChunk(utf8 + i) )
+        i += gChunkSize;
+    while ( i < len && static_cast<unsigned char>(utf8[i]) < 0x80 )
+        i++;
+    return i;
+}
+size_t CountUTF8CodePoints(const char* utf8, size_t len) _NOEXCEPT
+{
+    size_t chunks = len / gChunkSize;
+    size_t i = chunks * gChunkSize;
+    size_t count = i - _CountContinuationBytes(utf8, chunks);
+    for ( ; i < len; i++ )
+    {
+        if ( !_IsContinuation(static_cast<unsigned char>(utf8[i])) )
+            count++;
+    }
+    return count;
+}
+size_t UTF8OffsetOfCodePoint(const char* utf8, size_t len, size_t n) _NOEXCEPT
+{
+    // skip whole chunks while they can't contain the start of code point n
+    size_t count = 0, i = 0;
+    while ( len - i >= gChunkSize )
+    {
+        size_t inChunk = gChunkSize - _CountContinuationBytes(utf8 + i, 1);
+        if ( count + inChunk > n )
+            break;
+        count += inChunk;
+        i += gChunkSize;
+    }
+    
+    for ( ; i < len; i++ )
+    {
+        if ( _IsContinuation(static_cast<unsigned char>(utf8[i])) )
+            continue;
+        if ( count == n )
+            return i;
+        count++;
+    }
+    return len;
+}
+size_t TranscodeUTF8ToUTF16(const char* utf8, size_t len, char16_t* out) _NOEXCEPT
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8);
+    const unsigned char* end = p + len;
+    char16_t* o = out;
+    while ( p < end )
+    {
+        if ( static_cast<size_t>(end - p) >= gChunkSize && _IsASCIIChunk(reinterpret_cast<const char*>(p)) )
+        {
+            _WidenASCIIChunk(reinterpret_cast<const char*>(p), o);
+            p += gChunkSize;
+            o += gChunkSize;
+            continue;
+        }
+        
+        uint32_t cp = 0;
+        size_t n = _DecodeUTF8Sequence(p, end, cp);
+        if ( n == 0 )
+            return TranscodeError;
+        p += n;
+        
+        if ( cp < 0x10000 )
+        {
+            *o++ = static_cast<char16_t>(cp);
+        }
+        else
+        {
+            cp -= 0x10000;
+            *o++ = static_cast<char16_t>(0xD800 + (cp >> 10));
+            *o++ = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+        }
+    }
+    return static_cast<size_t>(o - out);
+}
+size_t TranscodeUTF16ToUTF8(const char16_t* utf16, size_t len, char* out) _NOEXCEPT
+{
+    const char16_t* p = utf16;
+    const char16_t* end = p + len;
+    char* o = out;
+    while ( p < end )
+    {
+        if ( static_cast<size_t>(end - p) >= gChunkSize && _NarrowASCIIChunk(p, o) )
+        {
+            p += gChunkSize;
+            o += gChunkSize;
+            continue;
+        }
+        
+        uint32_t cp = *p++;
+        if ( cp >= 0xD800 && cp <= 0xDFFF )
+        {
+            // must be a lead surrogate followed by a trail surrogate
+            if ( cp > 0xDBFF || p == end || *p < 0xDC00 || *p > 0xDFFF )
+                return TranscodeError;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (*p++ - 0xDC00);
+        }
+        
+        if ( cp < 0x80 )
+        {
+            *o++ = static_cast<char>(cp);
+        }
+        else if ( cp < 0x800 )
+        {
+            *o++ = static_cast<char>(0xC0 | (cp >> 6));
+            *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if ( cp < 0x10000 )
+        {
+            *o++ = static_cast<char>(0xE0 | (cp >> 12));
+            *o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            *o++ = static_cast<char>(0xF0 | (cp >> 18));
+            *o++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            *o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return static_cast<size_t>(o - out);
+}
+bool TranscodeToUTF16(const std::vector<string>& strings, std::u16string& buffer, std::vector<size_t>& offsets)
+{
+    // UTF-16 never needs more code units than UTF-8 needs bytes
+    size_t capacity = 0;
+    for ( auto& str : strings )
+        capacity += str.utf8_size();
+    
+    buffer.resize(capacity);
+    offsets.clear();
+    offsets.reserve(strings.size() + 1);
+    
+    size_t used = 0;
+    for ( auto& str : strings )
+    {
+        offsets.push_back(used);
+        if ( str.empty() )
+            continue;
+        
+        size_t n = TranscodeUTF8ToUTF16(str.data(), str.utf8_size(), &buffer[used]);
+        if ( n == TranscodeError )
+        {
+            buffer.clear();
+            offsets.clear();
+            return false;
+        }
+        used += n;
+    }
+    
+    offsets.push_back(used);
+    buffer.resize(used);
+    return true;
+}
+
+EPUB3_END_NAMESPACE
@@ -0,0 +1,128 @@
+//
+//  utf_transcode.h
+//  ePub3
+//
+//  Created on 2026-10-19.
+//  Copyright (c) 2026 The Readium Foundation and contributors.
+//  
+//  The Readium SDK is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//  
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//  
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __ePub3__utf_transcode__
+#define __ePub3__utf_transcode__
+
+#include <ePub3/utilities/basic.h>
+#include <ePub3/utilities/utfstring.h>
+#include <string>
+#include <vector>
+
+EPUB3_BEGIN_NAMESPACE
+
+/**
+ @defgroup transcoding UTF Transcoding
+ 
+ Bulk UTF-8 validation, counting and UTF-8/UTF-16 conversion over whole buffers.
+ 
+ These routines work through their input sixteen bytes at a time using SSE2 or
+ NEON where available (falling back to eight bytes at a time in a machine word
+ elsewhere), skipping straight over runs of ASCII, which make up the bulk of the
+ identifiers, paths and metadata found in a publication. Multibyte sequences are
+ decoded one at a time.
+ 
+ Unlike the iterator-based conversions in utf8-cpp, these never throw: invalid
+ input is reported through the return value.
+ 
+ @ingroup utilities
+ @{
+ */
+
+///
+/// Returned by the conversion functions when their input isn't well-formed.
+CONSTEXPR const size_t TranscodeError = size_t(-1);
+
+/**
+ Determines whether a buffer holds well-formed UTF-8.
+ 
+ Overlong forms, encoded surrogates and values beyond U+10FFFF are all rejected.
+ @param utf8 The bytes to check.
+ @param len The number of bytes in `utf8`.
+ */
+EPUB3_EXPORT bool   ValidateUTF8(const char* utf8, size_t len) _NOEXCEPT;
+
+/**
+ Returns the number of leading ASCII bytes in a buffer.
+ */
+EPUB3_EXPORT size_t ASCIIPrefixLength(const char* utf8, size_t len) _NOEXCEPT;
+
+/**
+ Counts the code points in a buffer of well-formed UTF-8.
+ 
+ This counts the bytes which aren't continuation bytes; its result is only
+ meaningful for input which passes ValidateUTF8().
+ */
+EPUB3_EXPORT size_t CountUTF8CodePoints(const char* utf8, size_t len) _NOEXCEPT;
+
+/**
+ Locates a code point within a buffer of well-formed UTF-8.
+ @param utf8 The UTF-8 bytes.
+ @param len The number of bytes in `utf8`.
+ @param n The zero-based index of the code point to find.
+ @result The byte offset at which code point `n` begins, or `len` if there are no
+ more than `n` code points in the buffer.
+ */
+EPUB3_EXPORT size_t UTF8OffsetOfCodePoint(const char* utf8, size_t len, size_t n) _NOEXCEPT;
+
+/**
+ Converts UTF-8 to UTF-16.
+ @param utf8 The UTF-8 bytes to convert.
+ @param len The number of bytes in `utf8`.
+ @param out Storage for the output, which must have room for `len` code units:
+ UTF-16 never needs more code units than UTF-8 needs bytes.
+ @result The number of code units written, or TranscodeError if the input isn't
+ well-formed UTF-8.
+ */
+EPUB3_EXPORT size_t TranscodeUTF8ToUTF16(const char* utf8, size_t len, char16_t* out) _NOEXCEPT;
+
+/**
+ Converts UTF-16 to UTF-8.
+ @param utf16 The UTF-16 code units to convert.
+ @param len The number of code units in `utf16`.
+ @param out Storage for the output, which must have room for `3 * len` bytes.
+ @result The number of bytes written, or TranscodeError if the input contains an
+ unpaired surrogate.
+ */
+EPUB3_EXPORT size_t TranscodeUTF16ToUTF8(const char16_t* utf16, size_t len, char* out) _NOEXCEPT;
+
+/**
+ Converts a batch of strings to UTF-16 in one pass.
+ 
+ All the strings are written into a single buffer, one after another, so that a
+ whole batch of metadata can be handed across a language binding (JNI, for
+ instance) with a single allocation on either side.
+ @param strings The strings to convert.
+ @param buffer Receives the converted strings, end to end. Any previous content is
+ replaced.
+ @param offsets Receives `strings.size() + 1` offsets into `buffer`: string `i`
+ occupies the code units from `offsets[i]` up to `offsets[i+1]`.
+ @result `true` on success, or `false` if any of the strings contains malformed
+ UTF-8, in which case the buffer and offsets are left empty.
+ */
+EPUB3_EXPORT bool   TranscodeToUTF16(const std::vector<string>& strings, std::u16string& buffer, std::vector<size_t>& offsets);
+
+/** @} */
+
+EPUB3_END_NAMESPACE
+
+#endif /* defined(__ePub3__utf_transcode__) */
@@ -20,7 +20,10 @@
 //
 
 #include "utfstring.h"
+#include "utf_transcode.h"
 #include <locale>
+#include <algorithm>
+#include <memory>
 //#include <codecvt>
 
 EPUB3_BEGIN_NAMESPACE
@@ -37,6 +40,8 @@ const size_t utf8_sizes[256] = {
 };
 
 const string::size_type string::npos = string::__base::npos;
+const string::__base::size_type string::IndexThreshold = 64;
+const string::size_type string::IndexStride = 64;
 const string string::EmptyString = string();
 
 string::string(const_u4pointer s)
@@ -54,11 +59,11 @@ string::string(size_type n, value_type c)
 }
 string::string(const char16_t* s)
 {
-    _base.append(_Convert<char16_t>::toUTF8(s));
+    _base.append(_utf16_to_utf8(s, npos));
 }
 string::string(const char16_t* s, size_type n)
 {
-    _base.append(_Convert<char16_t>::toUTF8(s, 0, n));
+    _base.append(_utf16_to_utf8(s, n));
 }
 string::string(size_type n, char16_t c)
 {
@@ -102,10 +107,14 @@ string::string(const xmlChar * pos, const xmlChar * end) : _base(reinterpret_cas
 }
 string::size_type string::size() const _NOEXCEPT
 {
+    const _CodePointIndex* __idx = _code_point_index();
+    if ( __idx != nullptr )
+        return __idx->length;
     return to_utf32_size(_base.size());
 }
 void string::resize(size_type n, value_type c)
 {
+    _IndexInvalidator __invalidator(this);
     size_type __s = size();
     if ( n > __s )
     {
@@ -120,6 +129,7 @@ void string::resize(size_type n, value_type c)
 }
 void string::resize(size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     size_type __s = size();
     if ( n > __s )
     {
@@ -142,44 +152,35 @@ void string::resize(size_type n)
         }
         
         // remove a certain number of UTF-8 characters
-        size_type newByteSize = 0;
-        const xmlChar * b = reinterpret_cast<const xmlChar*>(_base.data());
-        const xmlChar * e = b + _base.length();
-        for ( size_type i = 0; i < n && b < e; i++ )
-        {
-            // gets the byte-length of a single UTF-8 encoded character
-            size_t len = UTF8CharLen(*b);
-            newByteSize += len;
-            b += len;
-        }
-        
-        // resize the underlying byte string
-        _base.resize(newByteSize);
+        _base.resize(to_byte_size(n));
     }
 }
 const string::value_type string::at(size_type pos) const
-{
-    return const_cast<string*>(this)->at(pos);
-}
-string::value_type string::at(size_type pos)
 {
     typedef _Convert<value_type> Converter;
     const char * _pos = reinterpret_cast<const char*>(xmlAt(pos));
     Converter::wide_string wstr = Converter::fromUTF8(_pos, 0, UTF8CharLen(*_pos));
     return wstr[0];
 }
-const xmlChar * string::xmlAt(size_type pos) const
+string::value_type string::at(size_type pos)
 {
-    return const_cast<string*>(this)->xmlAt(pos);
+    // reading a character doesn't need to discard the code-point index
+    return const_cast<const string*>(this)->at(pos);
 }
-xmlChar * string::xmlAt(size_type pos)
+const xmlChar * string::xmlAt(size_type pos) const
 {
     if ( pos >= size() )
         throw std::range_error("Position beyond size of string.");
     
     __base::size_type bpos = to_byte_size(pos);
-    const char * p = &_base.at(bpos);
-    return const_cast<xmlChar*>(reinterpret_cast<const xmlChar *>(p));
+    return reinterpret_cast<const xmlChar *>(&_base.at(bpos));
+}
+xmlChar * string::xmlAt(size_type pos)
+{
+    // the caller may write through the result, so the index can't be trusted afterwards
+    const xmlChar * p = const_cast<const string*>(this)->xmlAt(pos);
+    _invalidate_index();
+    return const_cast<xmlChar*>(p);
 }
 string::__base string::utf8At(size_type pos) const
 {
@@ -191,24 +192,28 @@ string::__base string::utf8At(size_type pos) const
 template <>
 string & string::assign(iterator first, iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first.base(), last.base());
     return *this;
 }
 template <>
 string & string::assign(__base::const_iterator first, __base::const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first, last);
     return *this;
 }
 template <>
 string & string::assign(const char *first, const char *last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first, last-first);
     return *this;
 }
 #endif
 string & string::assign(const string &o, size_type i, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     // byte offset of character i
     auto pos = o._base.cbegin();
     auto end = pos + n;
@@ -223,30 +228,35 @@ string & string::assign(const string &o, size_type i, size_type n)
 }
 string & string::assign(const_u4pointer s, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(_Convert<value_type>::toUTF8(s, 0, n));
     return *this;
 }
 string& string::assign(const char16_t* s, size_type n)
 {
-    _base.assign(_Convert<char16_t>::toUTF8(s, 0, n));
+    _IndexInvalidator __invalidator(this);
+    _base.assign(_utf16_to_utf8(s, n));
     return *this;
 }
 #ifndef UTFSTRING_SPECIALIZATIONS_INLINED
 template <>
 string & string::append(const_iterator first, const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first.base(), last.base());
     return *this;
 }
 template <>
 string & string::append(__base::const_iterator first, __base::const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first, last);
     return *this;
 }
 template <>
 string & string::append(const char * first, const char * last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first, last-first);
     return *this;
 }
@@ -259,6 +269,7 @@ string & string::append(const string &o, size_type i, size_type n)
 }
 string & string::append(const_u4pointer s, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(_Convert<value_type>::toUTF8(s, 0, n));
     return *this;
 }
@@ -270,7 +281,8 @@ string & string::append(size_type n, value_type c)
 }
 string & string::append(const char16_t* s, size_type n)
 {
-    _base.append(_Convert<char16_t>::toUTF8(s, 0, n));
+    _IndexInvalidator __invalidator(this);
+    _base.append(_utf16_to_utf8(s, n));
     return *this;
 }
 string & string::append(size_type n, char16_t c)
@@ -282,6 +294,7 @@ string & string::append(size_type n, char16_t c)
 template <>
 string::iterator string::insert(iterator pos, iterator first, iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     if ( first == last )
         return pos;
     
@@ -296,6 +309,7 @@ string::iterator string::insert(iterator pos, iterator first, iterator last)
 template <>
 string::iterator string::insert(iterator pos, __base::iterator first, __base::iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     if ( first == last )
         return pos;
 #if CXX11_STRING_UNAVAILABLE
@@ -309,6 +323,7 @@ string::iterator string::insert(iterator pos, __base::iterator first, __base::it
 #endif
 string & string::insert(size_type pos, const string &s, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( b == e )
         return *this;
     
@@ -327,6 +342,7 @@ string & string::insert(size_type pos, const string &s, size_type b, size_type e
 }
 string::iterator string::insert(iterator pos, const string &s, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( e == b )
         return pos;
     
@@ -352,6 +368,7 @@ string::iterator string::insert(iterator pos, const string &s, size_type b, size
 }
 string & string::insert(size_type pos, const_u4pointer s, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( e == 0 )
         return *this;
     
@@ -366,6 +383,7 @@ string & string::insert(size_type pos, const_u4pointer s, size_type e)
 }
 string & string::insert(size_type pos, const char16_t* s, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( e == 0 )
         return *this;
     
@@ -380,6 +398,7 @@ string & string::insert(size_type pos, const char16_t* s, size_type e)
 }
 string & string::insert(size_type pos, size_type n, value_type c)
 {
+    _IndexInvalidator __invalidator(this);
     size_type __s = size();
     if ( n == 0 )
         return *this;
@@ -408,6 +427,7 @@ string & string::insert(size_type pos, size_type n, value_type c)
 }
 string & string::insert(size_type pos, size_type n, char16_t c)
 {
+    _IndexInvalidator __invalidator(this);
     size_type __s = size();
     if ( n == 0 )
         return *this;
@@ -436,6 +456,7 @@ string & string::insert(size_type pos, size_type n, char16_t c)
 }
 string::iterator string::insert(iterator pos, const_u4pointer s, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( e == 0 )
         return pos;
     auto utf8 = _Convert<value_type>::toUTF8(s, 0, e);
@@ -449,6 +470,7 @@ string::iterator string::insert(iterator pos, const_u4pointer s, size_type e)
 }
 string::iterator string::insert(iterator pos, const char16_t* s, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( e == 0 )
         return pos;
     auto utf8 = _Convert<char16_t>::toUTF8(s, 0, e);
@@ -462,6 +484,7 @@ string::iterator string::insert(iterator pos, const char16_t* s, size_type e)
 }
 string::iterator string::insert(iterator pos, size_type n, value_type c)
 {
+    _IndexInvalidator __invalidator(this);
     if ( n == 0 )
         return pos;
     if ( pos == end() )
@@ -494,6 +517,7 @@ string::iterator string::insert(iterator pos, size_type n, value_type c)
 }
 string::iterator string::insert(iterator pos, size_type n, char16_t c)
 {
+    _IndexInvalidator __invalidator(this);
     if ( n == 0 )
         return pos;
     if ( pos == end() )
@@ -526,18 +550,21 @@ string::iterator string::insert(iterator pos, size_type n, char16_t c)
 }
 string & string::insert(size_type pos, const __base &s, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     throw_unless_insertable(s, b, e);
     _base.insert(to_byte_size(pos), s, b, e);
     return *this;
 }
 string & string::insert(size_type pos, __base::iterator b, __base::iterator e)
 {
+    _IndexInvalidator __invalidator(this);
     throw_unless_insertable(&(*b), 0, e-b);
     _base.insert(_base.begin()+to_byte_size(pos), b, e);
     return *this;
 }
 string::iterator string::insert(iterator pos, const __base &s, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     throw_unless_insertable(s, b, e);
 #if CXX11_STRING_UNAVAILABLE
     auto __b = s.begin()+b;
@@ -551,6 +578,7 @@ string::iterator string::insert(iterator pos, const __base &s, size_type b, size
 }
 string & string::insert(size_type pos, const char *s, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     throw_unless_insertable(s, b, e);
     if ( e == __base::npos )
         _base.insert(to_byte_size(pos), s+b);
@@ -560,11 +588,13 @@ string & string::insert(size_type pos, const char *s, size_type b, size_type e)
 }
 string & string::insert(size_type pos, size_type n, char c)
 {
+    _IndexInvalidator __invalidator(this);
     _base.insert(to_byte_size(pos), n, c);
     return *this;
 }
 string::iterator string::insert(iterator pos, const char * str, size_type b, size_type e)
 {
+    _IndexInvalidator __invalidator(this);
     if ( pos == end() )
         return append(str+b, e-b).end();
     
@@ -580,6 +610,7 @@ string::iterator string::insert(iterator pos, const char * str, size_type b, siz
 }
 string::iterator string::insert(iterator pos, size_type n, char c)
 {
+    _IndexInvalidator __invalidator(this);
     if ( pos == end() )
         return append(n, c).end();
 #if CXX11_STRING_UNAVAILABLE
@@ -592,6 +623,7 @@ string::iterator string::insert(iterator pos, size_type n, char c)
 }
 string & string::erase(size_type pos, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     size_type __s = size();
     if ( pos == 0 && n == npos )
     {
@@ -619,11 +651,13 @@ string & string::erase(size_type pos, size_type n)
 }
 string::iterator string::erase(cxx11_const_iterator pos)
 {
+    _IndexInvalidator __invalidator(this);
     auto modified(_base.erase(pos.base()));
     return iterator(modified, _base.begin(), _base.end());
 }
 string::iterator string::erase(cxx11_const_iterator first, cxx11_const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     auto modified(_base.erase(first.base(), last.base()));
     return iterator(modified, _base.begin(), _base.end());
 }
@@ -631,18 +665,21 @@ string::iterator string::erase(cxx11_const_iterator first, cxx11_const_iterator
 template <>
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, cxx11_const_iterator j1, cxx11_const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), j1.base(), j2.base());
     return *this;
 }
 template <>
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, __base::const_iterator j1, __base::const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), j1, j2);
     return *this;
 }
 template <>
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, std::u32string::const_iterator j1, std::u32string::const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     auto utf8 = _Convert<value_type>::toUTF8(&(*j1), 0, std::distance(j1, j2));
     _base.replace(i1.base(), i2.base(), utf8);
     return *this;
@@ -650,41 +687,49 @@ string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, std::
 #endif
 string & string::replace(size_type pos1, size_type n1, const string & str)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos1), to_byte_size(pos1, pos1+n1), str._base);
     return *this;
 }
 string & string::replace(size_type pos1, size_type n1, const string & str, size_type pos2, size_type n2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos1), to_byte_size(pos1, pos1+n1), str._base, str.to_byte_size(pos2), str.to_byte_size(pos2, pos2+n2));
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const string& str)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), str._base);
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const_u4pointer s, size_type n2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), _Convert<value_type>::toUTF8(s, 0, n2));
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const char16_t* s, size_type n2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), _Convert<char16_t>::toUTF8(s, 0, n2));
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const_u4pointer s)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), _Convert<value_type>::toUTF8(s));
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const char16_t* s)
 {
-    _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), _Convert<char16_t>::toUTF8(s));
+    _IndexInvalidator __invalidator(this);
+    _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), _utf16_to_utf8(s, npos));
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, size_type n2, value_type c)
 {
+    _IndexInvalidator __invalidator(this);
     auto utf8 = _Convert<value_type>::toUTF8(c);
     if ( n2 == 1 )
     {
@@ -707,6 +752,7 @@ string & string::replace(size_type pos, size_type n1, size_type n2, value_type c
 }
 string & string::replace(size_type pos, size_type n1, size_type n2, char16_t c)
 {
+    _IndexInvalidator __invalidator(this);
     auto utf8 = _Convert<char16_t>::toUTF8(c);
     if ( n2 == 1 )
     {
@@ -729,26 +775,31 @@ string & string::replace(size_type pos, size_type n1, size_type n2, char16_t c)
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const_u4pointer s, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), _Convert<value_type>::toUTF8(s, 0, n));
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const char16_t* s, size_type n)
 {
-    _base.replace(i1.base(), i2.base(), _Convert<char16_t>::toUTF8(s, 0, n));
+    _IndexInvalidator __invalidator(this);
+    _base.replace(i1.base(), i2.base(), _utf16_to_utf8(s, n));
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const_u4pointer s)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), _Convert<value_type>::toUTF8(s));
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const char16_t* s)
 {
-    _base.replace(i1.base(), i2.base(), _Convert<char16_t>::toUTF8(s));
+    _IndexInvalidator __invalidator(this);
+    _base.replace(i1.base(), i2.base(), _utf16_to_utf8(s, npos));
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, size_type n, char16_t c)
 {
+    _IndexInvalidator __invalidator(this);
     auto utf8 = _Convert<char16_t>::toUTF8(c);
     if ( n == 1 )
     {
@@ -771,46 +822,55 @@ string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, size_
 }
 string & string::replace(size_type pos1, size_type n1, const __base & str)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos1), to_byte_size(pos1, pos1+n1), str);
     return *this;
 }
 string & string::replace(size_type pos1, size_type n1, const __base & str, size_type pos2, size_type n2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos1), to_byte_size(pos1, pos1+n1), str, pos2, n2);
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const __base & str)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), str);
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const char * s, size_type n2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), s, n2);
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, const char * s)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), s);
     return *this;
 }
 string & string::replace(size_type pos, size_type n1, size_type n2, char c)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(to_byte_size(pos), to_byte_size(pos, pos+n1), n2, c);
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const char * s, size_type n)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), s, n);
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, const char * s)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), s);
     return *this;
 }
 string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, size_type n, char c)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), n, c);
     return *this;
 }
@@ -826,7 +886,10 @@ string::size_type string::copy(u4pointer s, size_type n, size_type pos) const
 }
 string::size_type string::copy(char16_t* s, size_type n, size_type pos) const
 {
-    return _Convert<char16_t>::fromUTF8(_base.substr(to_byte_size(pos))).copy(s, n);
+    __base::size_type bpos = to_byte_size(pos);
+    if ( bpos == __base::npos )
+        throw std::out_of_range("Position beyond size of string.");
+    return _utf8_to_utf16(_base.data() + bpos, _base.size() - bpos).copy(s, n);
 }
 string string::substr(size_type pos, size_type n) const
 {
@@ -844,10 +907,11 @@ std::u32string string::utf32string() const
 }
 std::u16string string::utf16string() const
 {
-    return _Convert<char16_t>::fromUTF8(_base);
+    return _utf8_to_utf16(_base.data(), _base.size());
 }
 string& string::tolower(const std::locale& loc)
 {
+    _IndexInvalidator __invalidator(this);
     auto& facet = std::use_facet<std::ctype<char>>(loc);
     facet.tolower(&(*_base.begin()), &(*_base.end()));
     return *this;
@@ -858,6 +922,7 @@ const string string::tolower(const std::locale& loc) const
 }
 string& string::toupper(const std::locale& loc)
 {
+    _IndexInvalidator __invalidator(this);
     auto& facet = std::use_facet<std::ctype<char>>(loc);
     facet.toupper(&(*_base.begin()), &(*_base.end()));
     return *this;
@@ -1154,12 +1219,28 @@ void string::throw_unless_insertable(const xmlChar *s, size_type b, size_type e)
 
 string::__base::size_type string::to_byte_size(size_type __n) const _NOEXCEPT
 {
+    const _CodePointIndex* __idx = _code_point_index();
+    if ( __idx != nullptr )
+    {
+        if ( __n == npos || __n > __idx->length )
+            return __base::npos;
+        if ( __idx->ascii || __n == __idx->length )
+            return (__idx->ascii ? __n : _base.size());
+        
+        // start from the nearest recorded offset
+        __base::size_type r = __idx->offsets[__n / IndexStride];
+        for ( size_type s = __n % IndexStride; s > 0; s-- )
+            r += UTF8CharLen(_base[r]);
+        return r;
+    }
+    
     __base::size_type count = 0;
-    if ( __n == npos || __n > size() )
+    size_type __sz = size();
+    if ( __n == npos || __n > __sz )
     {
         count = __base::npos;
     }
-    else if ( __n == size() )
+    else if ( __n == __sz )
     {
         count = _base.size();
     }
@@ -1182,6 +1263,14 @@ string::__base::size_type string::to_byte_size(size_type __b, size_type __e) con
     if ( __e == __base::npos )
         return __base::npos;
     
+    const _CodePointIndex* __idx = _code_point_index();
+    if ( __idx != nullptr )
+    {
+        if ( __b > __idx->length )
+            return __base::npos;
+        return to_byte_size(std::max(__b, std::min(__e, __idx->length)));
+    }
+    
     __base::size_type r = to_byte_size(__b);
     if ( __e == 0 )
         return r;
@@ -1198,39 +1287,134 @@ string::__base::size_type string::to_byte_size(size_type __b, size_type __e) con
 }
 string::size_type string::to_utf32_size(__base::size_type __n) const _NOEXCEPT
 {
-    size_type count = 0;
     if ( __n == __base::npos || __n > _base.size() )
+        return npos;
+    
+    size_type count = 0;
+    auto pos = _base.cbegin();
+    auto end = _base.cend();
+    
+    const _CodePointIndex* __idx = _code_point_index();
+    if ( __idx != nullptr )
     {
-        count = npos;
-    }
-    else
-    {
-        auto pos = _base.cbegin();
-        auto end = _base.cend();
-        for ( size_type s = 0; s < __n && pos < end; count++ )
+        if ( __idx->ascii )
+            return __n;
+        
+        // find the last recorded offset before __n and count on from there
+        auto __o = std::lower_bound(__idx->offsets.begin(), __idx->offsets.end(), __n);
+        if ( __o != __idx->offsets.begin() )
         {
-            size_t c = UTF8CharLen(*pos);
-            pos += c;
-            s += c;
+            --__o;
+            count = static_cast<size_type>(__o - __idx->offsets.begin()) * IndexStride;
+            pos += *__o;
         }
     }
     
+    for ( ; pos < end && static_cast<__base::size_type>(pos - _base.cbegin()) < __n; count++ )
+        pos += UTF8CharLen(*pos);
+    
     return count;
 }
 string::size_type string::to_utf32_size(__base::size_type __b, __base::size_type __e) const _NOEXCEPT
 {
     if ( __e == npos )
         return npos;
+    if ( __e <= __b )
+        return 0;
+    return to_utf32_size(__e) - to_utf32_size(__b);
+}
+const string::_CodePointIndex* string::_code_point_index() const _NOEXCEPT
+{
+    _CodePointIndex* __idx = _index.load(std::memory_order_acquire);
+    if ( __idx != nullptr || _base.size() < IndexThreshold )
+        return __idx;
+    
+    _CodePointIndex* __built = nullptr;
+    try
+    {
+        __built = _build_index(_base);
+    }
+    catch (...)
+    {
+        // no index is no great loss: positions will be found by walking the string
+        return nullptr;
+    }
+    
+    // const strings may be shared between threads, so another may have beaten us to it
+    if ( _index.compare_exchange_strong(__idx, __built, std::memory_order_acq_rel, std::memory_order_acquire) )
+        return __built;
+    
+    delete __built;
+    return __idx;
+}
+string::_CodePointIndex* string::_build_index(const __base& s)
+{
+    std::unique_ptr<_CodePointIndex> __idx(new _CodePointIndex);
+    const char* __p = s.data();
+    size_t __len = s.size();
+    
+    // most identifiers, paths and the like are pure ASCII
+    __idx->ascii = (ASCIIPrefixLength(__p, __len) == __len);
+    if ( __idx->ascii )
+    {
+        __idx->length = __len;
+        return __idx.release();
+    }
     
     size_type count = 0;
-    auto pos = _base.cbegin()+__b;
-    for ( size_type i = __b; i < __e; )
+    __idx->offsets.reserve(__len / IndexStride + 1);
+    
+    if ( !ValidateUTF8(__p, __len) )
     {
-        size_t c = UTF8CharLen(*pos);
-        pos += c;
-        count++;
+        // the vector routines assume well-formed input, so step through by lead bytes
+        auto pos = s.cbegin();
+        auto end = s.cend();
+        for ( ; pos < end; count++ )
+        {
+            if ( count % IndexStride == 0 )
+                __idx->offsets.push_back(static_cast<__base::size_type>(pos - s.cbegin()));
+            pos += UTF8CharLen(*pos);
+        }
+        __idx->length = count;
+        return __idx.release();
     }
-    return count;
+    
+    for ( size_t off = 0; off < __len; )
+    {
+        __idx->offsets.push_back(off);
+        size_t next = UTF8OffsetOfCodePoint(__p + off, __len - off, IndexStride);
+        if ( next == __len - off )
+        {
+            count += CountUTF8CodePoints(__p + off, __len - off);
+            break;
+        }
+        off += next;
+        count += IndexStride;
+    }
+    
+    __idx->length = count;
+    return __idx.release();
+}
+string::__base string::_utf16_to_utf8(const char16_t* s, size_type n)
+{
+    if ( n == npos )
+        n = std::char_traits<char16_t>::length(s);
+    
+    __base __r(3 * n, '\0');
+    size_t __used = (n == 0 ? 0 : TranscodeUTF16ToUTF8(s, n, &__r[0]));
+    if ( __used == TranscodeError )
+        return _Convert<char16_t>::toUTF8(s, 0, n);     // throws an appropriate exception
+    __r.resize(__used);
+    return __r;
+}
+std::u16string string::_utf8_to_utf16(const char* s, __base::size_type n)
+{
+    std::u16string __r(n, u'\0');
+    size_t __used = (n == 0 ? 0 : TranscodeUTF8ToUTF16(s, n, &__r[0]));
+    if ( __used == TranscodeError )
+        return _Convert<char16_t>::fromUTF8(s, 0, n);   // throws an appropriate exception
+    __r.resize(__used);
+    return __r;
 }
 string::size_type string::utf32_distance(__base::const_iterator first, __base::const_iterator last) _NOEXCEPT
 {
@@ -30,6 +30,7 @@
 #endif
 #include <locale>
 #include <vector>
+#include <atomic>
 #include REGEX_INCLUDE
 #include <map>
 #include <stdexcept>
@@ -101,7 +102,7 @@ public:
     // Standard
     string() : _base() {}
     string(const string &o) : _base(o._base) {}
-    string(string &&o) : _base(std::move(o._base)) {}
+    string(string &&o) : _base(std::move(o._base)), _index(std::move(o._index)) {}
     string(const string & s, size_type i, size_type n=npos) : _base(s._base, s.to_byte_size(i), s.to_byte_size(i,n)) {}
     
     // From char32_t (value_type)
@@ -168,7 +169,7 @@ public:
     
     void reserve(size_type res_arg = 0) { return _base.reserve(res_arg*4); } // best guess
     void shrink_to_fit() { _base.shrink_to_fit(); }
-    void clear() _NOEXCEPT { _base.clear(); }
+    void clear() _NOEXCEPT { _base.clear(); _invalidate_index(); }
     bool empty() const _NOEXCEPT { return _base.empty(); }
     
     iterator begin() _NOEXCEPT { return iterator(_base.begin(), _base.begin(), _base.end()); }
@@ -209,9 +210,9 @@ public:
     EPUB3_EXPORT string & assign(InputIterator first, InputIterator last);
     
     // standard
-    string & assign(const string &o) { _base.assign(o._base); return *this; }
+    string & assign(const string &o) { _base.assign(o._base); _invalidate_index(); return *this; }
     EPUB3_EXPORT string & assign(const string &o, size_type i, size_type n=npos);
-    string & assign(string &&o) { _base.assign(std::move(o._base)); return *this; }
+    string & assign(string &&o) { _base.assign(std::move(o._base)); _invalidate_index(); o._invalidate_index(); return *this; }
     string & operator=(const string & o) { return assign(o); }
     string & operator=(string &&o) { return assign(o); }
     
@@ -240,19 +241,19 @@ public:
 #endif
     
     // std::string
-    EPUB3_EXPORT string & assign(const __base & o) { _base.assign(o); return *this; }
+    EPUB3_EXPORT string & assign(const __base & o) { _base.assign(o); _invalidate_index(); return *this; }
     string & assign(const __base & o, size_type i, size_type n=npos)
-        { _base.assign(o, i, n); return *this; }
-    string & assign(__base &&o) { _base.assign(o); return *this; }
+        { _base.assign(o, i, n); _invalidate_index(); return *this; }
+    string & assign(__base &&o) { _base.assign(o); _invalidate_index(); return *this; }
     string & operator=(const __base &o) { return assign(o); }
     string & operator=(__base &&o) { return assign(o); }
     
     // char
-    string & assign(const char * s, size_type n) { _base.assign(s, n); return *this; }
-    string & assign(const char * s) { _base.assign(s); return *this; }
-    string & assign(size_type n, char c) { _base.assign(n, c); return *this; }
+    string & assign(const char * s, size_type n) { _base.assign(s, n); _invalidate_index(); return *this; }
+    string & assign(const char * s) { _base.assign(s); _invalidate_index(); return *this; }
+    string & assign(size_type n, char c) { _base.assign(n, c); _invalidate_index(); return *this; }
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
-    string & assign(std::initializer_list<__base::value_type> __il) { _base.assign(__il); return *this; }
+    string & assign(std::initializer_list<__base::value_type> __il) { _base.assign(__il); _invalidate_index(); return *this; }
 #endif
     string & operator=(const char * s) { return assign(s, __base::traits_type::length(s)); }
     string & operator=(char c) { return assign(1, c); }
@@ -261,9 +262,9 @@ public:
 #endif
     
     // xmlChar
-    string & assign(const xmlChar * s, size_type n) { _base.assign(reinterpret_cast<const char *>(s), n); return *this; }
-    string & assign(const xmlChar * s) { _base.assign(reinterpret_cast<const char *>(s), xmlStrlen(s)); return *this; }
-    string & assign(size_type n, xmlChar c) { _base.assign(n, static_cast<char>(c)); return *this; }
+    string & assign(const xmlChar * s, size_type n) { _base.assign(reinterpret_cast<const char *>(s), n); _invalidate_index(); return *this; }
+    string & assign(const xmlChar * s) { _base.assign(reinterpret_cast<const char *>(s), xmlStrlen(s)); _invalidate_index(); return *this; }
+    string & assign(size_type n, xmlChar c) { _base.assign(n, static_cast<char>(c)); _invalidate_index(); return *this; }
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
     string & assign(std::initializer_list<xmlChar> __il) { return assign(__il.begin(), __il.end()); }
 #endif
@@ -284,9 +285,9 @@ public:
     string & append(const Args&... args) { return append(string(args...)); }
 #endif
     // standard
-    string & append(const string &o) { _base.append(o._base); return *this; }
+    string & append(const string &o) { _base.append(o._base); _invalidate_index(); return *this; }
     EPUB3_EXPORT string & append(const string &o, size_type i, size_type n=npos);
-    string & append(string &&o) { _base.append(std::move(o._base)); return *this; }
+    string & append(string &&o) { _base.append(std::move(o._base)); _invalidate_index(); return *this; }
     string & operator+=(const string & o) { return append(o); }
     string & operator+=(string &&o) { return append(o); }
     
@@ -315,18 +316,18 @@ public:
 #endif
     
     // std::string
-    string & append(const __base & o) { _base.append(o); return *this; }
-    string & append(const __base & o, size_type i, size_type n=npos) { _base.append(o, i, n); return *this; }
-    string & append(__base &&o) { _base.append(o); return *this; }
+    string & append(const __base & o) { _base.append(o); _invalidate_index(); return *this; }
+    string & append(const __base & o, size_type i, size_type n=npos) { _base.append(o, i, n); _invalidate_index(); return *this; }
+    string & append(__base &&o) { _base.append(o); _invalidate_index(); return *this; }
     string & operator+=(const __base &o) { return append(o); }
     string & operator+=(__base &&o) { return append(o); }
     
     // char
-    string & append(const char * s, size_type n) { _base.append(s, n); return *this; }
-    string & append(const char * s) { _base.append(s); return *this; }
-    string & append(size_type n, char c) { _base.append(n, c); return *this; }
+    string & append(const char * s, size_type n) { _base.append(s, n); _invalidate_index(); return *this; }
+    string & append(const char * s) { _base.append(s); _invalidate_index(); return *this; }
+    string & append(size_type n, char c) { _base.append(n, c); _invalidate_index(); return *this; }
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
-    string & append(std::initializer_list<__base::value_type> __il) { _base.append(__il); return *this; }
+    string & append(std::initializer_list<__base::value_type> __il) { _base.append(__il); _invalidate_index(); return *this; }
 #endif
     string & operator+=(const char * s) { return append(s); }
     string & operator+=(char c) { return append(1, c); }
@@ -335,9 +336,9 @@ public:
 #endif
     
     // xmlChar
-    string & append(const xmlChar * s, size_type n) { _base.append(reinterpret_cast<const char *>(s), n); return *this; }
-    string & append(const xmlChar * s) { _base.append(reinterpret_cast<const char *>(s), xmlStrlen(s)); return *this; }
-    string & append(size_type n, xmlChar c) { _base.append(n, static_cast<char>(c)); return *this; }
+    string & append(const xmlChar * s, size_type n) { _base.append(reinterpret_cast<const char *>(s), n); _invalidate_index(); return *this; }
+    string & append(const xmlChar * s) { _base.append(reinterpret_cast<const char *>(s), xmlStrlen(s)); _invalidate_index(); return *this; }
+    string & append(size_type n, xmlChar c) { _base.append(n, static_cast<char>(c)); _invalidate_index(); return *this; }
 #if EPUB_COMPILER_SUPPORTS(CXX_INITIALIZER_LISTS)
     string & append(std::initializer_list<xmlChar> __il) { return append(__il.begin(), __il.end()); }
 #endif
@@ -517,6 +518,8 @@ public:
 #endif
     {
         _base.swap(str._base);
+        _invalidate_index();
+        str._invalidate_index();
     }
     
     EPUB3_EXPORT std::u32string utf32string() const;
@@ -823,8 +826,64 @@ public:
 #endif
     
 protected:
-    __base      _base;
+    /**
+     A sparse map from code-point positions to byte offsets, built on demand so
+     that positional access into longer strings doesn't have to walk them from
+     the start every time. Pure-ASCII strings only need the flag.
+     */
+    struct _CodePointIndex
+    {
+        size_type                       length;     ///< The length in code points.
+        bool                            ascii;      ///< If set, code-point and byte offsets are equal.
+        std::vector<__base::size_type>  offsets;    ///< The byte offset of every `IndexStride`th code point.
+    };
+
+    /**
+     Owns a string's code-point index. Copies start out without one, since the
+     index is cheap to rebuild and a copy is frequently modified straight away.
+     */
+    class _IndexSlot : public std::atomic<_CodePointIndex*>
+    {
+    public:
+        _IndexSlot() _NOEXCEPT : std::atomic<_CodePointIndex*>(nullptr) {}
+        _IndexSlot(const _IndexSlot&) _NOEXCEPT : std::atomic<_CodePointIndex*>(nullptr) {}
+        _IndexSlot(_IndexSlot&& o) _NOEXCEPT : std::atomic<_CodePointIndex*>(o.exchange(nullptr)) {}
+        ~_IndexSlot() { delete load(std::memory_order_relaxed); }
+
+        _IndexSlot& operator=(const _IndexSlot&) _DELETED_;
+    };
+
+    /**
+     Discards the code-point index when a mutating member function returns, by
+     whatever route. Positions computed before the mutation remain valid.
+     */
+    class _IndexInvalidator
+    {
+    public:
+        explicit _IndexInvalidator(string* s) _NOEXCEPT : _str(s) {}
+        ~_IndexInvalidator() { _str->_invalidate_index(); }
+
+    private:
+        string*     _str;
+    };
+
+    ///
+    /// Strings shorter than this many bytes are never indexed.
+    static const __base::size_type  IndexThreshold;
+    ///
+    /// The number of code points between recorded byte offsets.
+    static const size_type          IndexStride;
+
+    __base              _base;
+    mutable _IndexSlot  _index;     ///< Built lazily by _code_point_index(), released by every mutation.
+
+    void _invalidate_index() _NOEXCEPT { delete _index.exchange(nullptr, std::memory_order_acq_rel); }
+    const _CodePointIndex* _code_point_index() const _NOEXCEPT;
+    static _CodePointIndex* _build_index(const __base& s);
     
+    static __base _utf16_to_utf8(const char16_t* s, size_type n);
+    static std::u16string _utf8_to_utf16(const char* s, __base::size_type n);
+
     void validate_utf8(const __base &s) const;
     void validate_utf8(const char *s, size_type sz) const;
     void validate_utf8(const xmlChar *s, size_type sz) const;
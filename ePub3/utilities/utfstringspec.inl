@@ -27,42 +27,49 @@
 template <>
 FORCE_INLINE string & string::assign(iterator first, iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first.base(), last.base());
     return *this;
 }
 template <>
 FORCE_INLINE string & string::assign(__base::const_iterator first, __base::const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first, last);
     return *this;
 }
 template <>
 FORCE_INLINE string & string::assign(const char *first, const char *last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.assign(first, last-first);
     return *this;
 }
 template <>
 FORCE_INLINE string & string::append(const_iterator first, const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first.base(), last.base());
     return *this;
 }
 template <>
 FORCE_INLINE string & string::append(__base::const_iterator first, __base::const_iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first, last);
     return *this;
 }
 template <>
 FORCE_INLINE string & string::append(const char * first, const char * last)
 {
+    _IndexInvalidator __invalidator(this);
     _base.append(first, last-first);
     return *this;
 }
 template <>
 FORCE_INLINE string::iterator string::insert(iterator pos, iterator first, iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     if ( first == last )
         return pos;
 
@@ -77,6 +84,7 @@ FORCE_INLINE string::iterator string::insert(iterator pos, iterator first, itera
 template <>
 FORCE_INLINE string::iterator string::insert(iterator pos, __base::iterator first, __base::iterator last)
 {
+    _IndexInvalidator __invalidator(this);
     if ( first == last )
         return pos;
 #if CXX11_STRING_UNAVAILABLE
@@ -90,18 +98,21 @@ FORCE_INLINE string::iterator string::insert(iterator pos, __base::iterator firs
 template <>
 FORCE_INLINE string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, cxx11_const_iterator j1, cxx11_const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), j1.base(), j2.base());
     return *this;
 }
 template <>
 FORCE_INLINE string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, __base::const_iterator j1, __base::const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     _base.replace(i1.base(), i2.base(), j1, j2);
     return *this;
 }
 template <>
 FORCE_INLINE string & string::replace(cxx11_const_iterator i1, cxx11_const_iterator i2, std::u32string::const_iterator j1, std::u32string::const_iterator j2)
 {
+    _IndexInvalidator __invalidator(this);
     auto utf8 = _Convert<value_type>::toUTF8(&(*j1), 0, std::distance(j1, j2));
     _base.replace(i1.base(), i2.base(), utf8);
     return *this;